@@ -0,0 +1,68 @@
+/**
+ * @file batch_filter.h
+ * @brief 按列成批地求where条件的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _BATCH_FILTER_H_
+#define _BATCH_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "server_table.h"
+#include "where_cond.h"
+
+/**
+ * @brief 全表扫描的时候不再一行一行地调用Where::match，而是一次拿一块(block_rows行)连续的值求条件，
+ *        结果是一个选择向量: 满足条件的行在块中的下标，按升序排列
+ *
+ *  int列的条件都换成一个闭区间 low <= x <= high，用SIMD一次比较多个值，
+ *  按CPU在运行的时候选择AVX2、SSE4.2或者标量的实现，不需要额外的编译选项
+ *  string列的值不是定长的，按条件分别用长度+memcmp或者前缀比较的紧凑循环
+ *
+ *  and、or、not在选择向量上组合: 后面的子条件只求前面的子条件还决定不了的行
+ */
+namespace Batch_Filter {
+/**
+ * @brief 一块的行数
+ */
+constexpr size_t block_rows = 1024;
+
+/**
+ * @brief 在一块连续的行中找出快照中可见并且满足条件的行
+ * @param  table，表
+ * @param  expr，已经bind过的条件，为nullptr的时候只看可见性
+ * @param  snapshot，快照
+ * @param  begin，第一行的行号
+ * @param  end，最后一行的下一行，end - begin不超过block_rows，也不超过快照的行数
+ * @param  sel，选择向量，至少block_rows个元素，放满足条件的行减去begin
+ * @return size_t，满足条件的行数
+ */
+size_t filter_block(const Table& table, const Where_Expr* expr, const Snapshot& snapshot, size_t begin, size_t end,
+                    uint32_t* sel);
+
+/**
+ * @brief 按块扫描整张表，找出快照中可见并且满足条件的行
+ * @param  table，表
+ * @param  expr，已经bind过的条件
+ * @param  snapshot，快照
+ * @param  rows，满足条件的行号，升序追加在后面
+ */
+void filter(const Table& table, const Where_Expr& expr, const Snapshot& snapshot, std::vector<size_t>& rows);
+
+/**
+ * @brief 运行时选中的int列比较的实现
+ * @return const char*，avx2、sse4.2或者scalar
+ */
+const char* kernel_name();
+
+}  // namespace Batch_Filter
+
+#endif
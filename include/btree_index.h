@@ -0,0 +1,263 @@
+/**
+ * @file btree_index.h
+ * @brief 建在某一列上的B+树索引的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _BTREE_INDEX_H_
+#define _BTREE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief B+树索引，叶子按(键, 行号)有序并且串成链表，可以做等值、范围、前缀查询和按键的顺序遍历
+ *
+ *  键是编码之后的值: string列就是原来的字符串；int列是 0x00 + 8字节大端(符号位取反)，
+ *  这样直接按字节比较就是按数值比较，不是合法整数的值编码成 0x01 + 原字符串，排在所有整数的后面
+ *
+ *  索引文件按页存放，第一个页是文件头，后面每个节点占一个页(节点太大放不下的时候连续占用多个页，称为跨度span):
+ *
+ *  | Tree_Header | 节点0 | 节点1 | ... |
+ *
+ *  节点: | u32跨度 | u8是否叶子 | u32键数 | 叶子: u32下一个叶子的页号，每个键 u32长度 + 键 + u64行号 |
+ *                                    | 内部节点: u32孩子的页号 * (键数 + 1)，每个键 u32长度 + 键 + u64行号 |
+ *
+ *  和哈希索引一样，文件中的LSN和行数与表对不上的时候加载失败，重新从表建一遍
+ */
+class BTree_Index {
+public:
+    /**
+     * @brief 索引文件魔数，"BIDX"
+     */
+    static constexpr uint32_t magic = 0x58444942;
+
+    /**
+     * @brief 默认的页大小
+     */
+    static constexpr uint32_t default_page_size = 4096;
+
+    /**
+     * @brief 默认的扇出，一个节点最多的键数
+     */
+    static constexpr uint32_t default_fan_out = 128;
+
+    /**
+     * @brief 设置之后新建的索引的页大小，已有的索引文件按文件头中记录的读
+     * @param  page_size，页大小，至少256字节
+     */
+    static void set_page_size(uint32_t page_size);
+
+    /**
+     * @brief 设置之后新建的索引的扇出，节点的键数超过扇出或者超过一页的时候分裂
+     * @param  fan_out，扇出，至少4
+     */
+    static void set_fan_out(uint32_t fan_out);
+
+    /**
+     * @brief 把列的值编码成索引的键
+     * @param  value，列的值
+     * @param  is_int，是否是int列
+     * @return std::string
+     */
+    static std::string encode_key(const std::string& value, bool is_int);
+
+    /**
+     * @brief 把int列的值编码成索引的键
+     * @param  num，列的值
+     * @return std::string
+     */
+    static std::string encode_int(int64_t num);
+
+public:
+    /**
+     * @brief 构造函数
+     * @param  is_int，建索引的列是否是int列
+     */
+    explicit BTree_Index(bool is_int = false);
+
+    /**
+     * @brief 从表的某一列批量建索引，原来的内容清空
+     * @brief 先把(键, 行号)排好序，然后从左往右填满叶子，再一层一层往上建内部节点，不需要逐个插入
+     * @param  table，表
+     * @param  column，列的下标
+     */
+    void build(const Table& table, int column);
+
+    /**
+     * @brief 添加一行
+     * @param  value，这一行在索引列上的值
+     * @param  row，行号
+     */
+    void insert(const std::string& value, size_t row);
+
+    /**
+     * @brief 去掉一行，叶子变少了也不合并，删除之后行号都会变，表会整个重建索引
+     * @param  value，这一行在索引列上原来的值
+     * @param  row，行号
+     */
+    void erase(const std::string& value, size_t row);
+
+    /**
+     * @brief 范围查找，结果按键的顺序排列
+     * @param  low，下界，nullptr表示没有下界
+     * @param  low_inclusive，是否包含下界
+     * @param  high，上界，nullptr表示没有上界
+     * @param  high_inclusive，是否包含上界
+     * @param  rows，满足条件的行号
+     */
+    void range(const std::string* low, bool low_inclusive, const std::string* high, bool high_inclusive, std::vector<size_t>& rows) const;
+
+    /**
+     * @brief 前缀查找，只对string列有意义，结果按键的顺序排列
+     * @param  prefix，前缀
+     * @param  rows，满足条件的行号
+     */
+    void prefix(const std::string& prefix, std::vector<size_t>& rows) const;
+
+    /**
+     * @brief 按键的顺序拿到所有的行
+     * @param  rows，所有的行号
+     */
+    void scan(std::vector<size_t>& rows) const;
+
+    /**
+     * @brief 写入索引文件，先写临时文件然后rename
+     * @param  path，索引文件路径
+     * @param  lsn，表的LSN
+     * @param  row_count，表的行数
+     */
+    void save(const std::string& path, uint64_t lsn, uint64_t row_count) const;
+
+    /**
+     * @brief 读取索引文件，页大小和扇出用文件中记录的
+     * @param  path，索引文件路径
+     * @param  lsn，表的LSN
+     * @param  row_count，表的行数
+     * @return bool，文件不存在、损坏或者和表对不上的时候返回false，需要重新建
+     */
+    bool load(const std::string& path, uint64_t lsn, uint64_t row_count);
+
+    /**
+     * @brief 估算占用的内存，算进表缓存的预算
+     * @return size_t
+     */
+    size_t bytes() const;
+
+private:
+    /**
+     * @brief 叶子和内部节点中的一项，(键, 行号)一起比较，这样重复的键也是唯一的
+     */
+    struct Entry {
+        std::string m_key;
+        size_t m_row;
+
+        bool operator<(const Entry& other) const {
+            int cmp = m_key.compare(other.m_key);
+            return cmp < 0 or (0 == cmp and m_row < other.m_row);
+        }
+    };
+
+    /**
+     * @brief 节点，用在m_nodes中的下标互相引用，写文件的时候换成页号
+     */
+    struct Node {
+        /**
+         * @brief 是否是叶子
+         */
+        bool m_leaf = true;
+
+        /**
+         * @brief 叶子中是所有的项，内部节点中是分隔键，孩子i中的项都不小于分隔键i-1并且小于分隔键i
+         */
+        std::vector<Entry> m_entries;
+
+        /**
+         * @brief 内部节点的孩子，比m_entries多一个
+         */
+        std::vector<uint32_t> m_children;
+
+        /**
+         * @brief 叶子链表中的下一个叶子，没有的时候为no_node
+         */
+        uint32_t m_next;
+
+        /**
+         * @brief 节点写入文件之后的字节数
+         */
+        size_t m_bytes;
+    };
+
+    /**
+     * @brief 没有节点
+     */
+    static constexpr uint32_t no_node = UINT32_MAX;
+
+    /**
+     * @brief 一项写入文件之后的字节数
+     */
+    static size_t _entry_bytes(const Entry& entry);
+
+    /**
+     * @brief 节点是否需要分裂
+     */
+    bool _overflow(const Node& node) const;
+
+    /**
+     * @brief 新建一个空节点
+     */
+    uint32_t _new_node(bool leaf);
+
+    /**
+     * @brief 往子树中插入一项，子树的根分裂的时候返回新节点和它的分隔键
+     * @return bool，是否分裂
+     */
+    bool _insert(uint32_t node, const Entry& entry, Entry& split_key, uint32_t& split_node);
+
+    /**
+     * @brief 找到第一个不小于target的项所在的叶子和下标
+     */
+    void _lower_bound(const Entry& target, uint32_t& leaf, size_t& pos) const;
+
+private:
+    /**
+     * @brief 是否是int列
+     */
+    bool m_is_int;
+
+    /**
+     * @brief 页大小
+     */
+    uint32_t m_page_size;
+
+    /**
+     * @brief 扇出
+     */
+    uint32_t m_fan_out;
+
+    /**
+     * @brief 所有的节点
+     */
+    std::vector<Node> m_nodes;
+
+    /**
+     * @brief 根节点
+     */
+    uint32_t m_root = no_node;
+
+    /**
+     * @brief 所有叶子中的项数
+     */
+    size_t m_entries = 0;
+};
+
+#endif
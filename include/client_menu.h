@@ -39,11 +39,28 @@ public:
      */
     std::string run();
 
+    /**
+     * @brief 不打印提示，直接从标准输入读一条以分号结尾的命令，标准输入不是终端(批量执行)的时候用
+     * @return std::string，返回输入之后经过适当处理之后的字符串
+     */
+    std::string read_command();
+
+    /**
+     * @brief 标准输入是否已经读完了
+     * @return bool
+     */
+    bool eof() const { return m_eof; }
+
 private:
     /**
      * @brief 维护一个执行run命令的次数，我们的客户端只有在第一次的时候才能显示所有的信息
      */
     int count = 0;
+
+    /**
+     * @brief 读到了标准输入的末尾
+     */
+    bool m_eof = false;
 };
 
 #endif
@@ -0,0 +1,70 @@
+/**
+ * @file csv_loader.h
+ * @brief 从csv文件中批量导入数据的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _CSV_LOADER_H_
+#define _CSV_LOADER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "server_table.h"
+#include "thread_pool.h"
+
+/**
+ * @brief load data的实现: 把csv文件映射到内存中，按行的边界切成几块，交给线程池中的几个线程同时解析，最后按块的顺序拼起来
+ *
+ *  一行是一条记录，字段之间用 ',' 分隔，字段可以用双引号括起来，里面的 "" 表示一个双引号
+ *  不支持字段中换行: 按换行切块才能并行解析，带引号的字段到行尾还没有结束的时候整个文件都不导入，返回错误
+ *  第一行如果正好是表的列名，就当作表头跳过
+ *  字段个数不对或者int列不是合法整数的行不导入，只计数
+ */
+namespace Csv_Loader {
+/**
+ * @brief 一次导入的统计
+ */
+struct Stats {
+    /**
+     * @brief 导入的行数
+     */
+    size_t m_rows = 0;
+
+    /**
+     * @brief 不合法、没有导入的行数，和其中第一行在文件中的行号(从1开始，没有的时候是0)
+     */
+    size_t m_rejected = 0;
+    size_t m_first_rejected = 0;
+
+    /**
+     * @brief 文件的字节数和用了几个线程
+     */
+    size_t m_bytes = 0;
+    size_t m_threads = 0;
+};
+
+/**
+ * @brief 设置解析用的线程池，没有设置的时候在调用的线程中解析
+ * @param  pool，线程池，要比之后所有的导入活得久
+ */
+void set_thread_pool(Thread_Pool* pool);
+
+/**
+ * @brief 解析一个csv文件
+ * @param  file，文件路径
+ * @param  rows，只有表名和字段的表，解析出来的行按文件中的顺序追加在后面
+ * @param  stats，统计
+ * @param  error，文件打不开或者字段中有换行的时候给用户的提示
+ * @return bool，文件打不开或者字段中有换行的时候返回false，这时rows中没有追加任何行
+ */
+bool load(const std::string& file, Table& rows, Stats& stats, std::string& error);
+
+}  // namespace Csv_Loader
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file cursor.h
+ * @brief 服务端游标的头文件，select的结果按批次一点一点读出来
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _CURSOR_H_
+#define _CURSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "result_sink.h"
+#include "row_sorter.h"
+#include "server_table.h"
+#include "sql_parser.h"
+#include "table_cache.h"
+#include "where_cond.h"
+
+/**
+ * @brief 游标，记住一条select读到了哪里，每次fetch只把一批行编码进Result_Sink
+ *
+ *  没有order by并且where用不上索引的时候直接按行号扫描，游标里面只有一个下一行的行号，内存和结果的大小无关；
+ *  有order by的时候交给Row_Sorter排序，有limit的时候只留前offset+limit行，行多的时候排序分段写到临时文件，一边读一边归并；
+ *  其他情况在打开的时候算好行号的顺序，只存行号，不存行的内容；
+ *  从Row_Source打开的时候一次只留一批行，按顺序扫描完这一批再要下一批，要排序的话每一批都交给Row_Sorter之后就丢掉
+ *
+ *  offset在打开的时候或者扫描的时候跳过去，读够limit行之后游标就读完了，不再往后扫描
+ *
+ *  游标持有打开时的表和快照(MVCC)，之后其他连接的修改、表被淘汰甚至被删除都不影响它，一直读到的是打开时的结果；
+ *  持有期间这张表上的旧版本不会被回收，所以读完或者不用了要及时close
+ */
+class Cursor {
+public:
+    /**
+     * @brief 按select语句打开游标，where条件中的列不存在或者值不对的时候游标是空的
+     * @param  table，表，调用的时候需要持有它的m_rows共享锁
+     * @param  statement，select语句的语法树
+     * @return bool，order by中有列不存在的时候返回false
+     */
+    bool open(std::shared_ptr<const Table> table, const Statement& statement);
+
+    /**
+     * @brief 在一批一批生成的行上打开游标，where条件中的列不存在或者值不对的时候游标是空的
+     *  没有order by的时候游标读一批才要一批；有order by的时候打开时就读完所有的批，满足条件的行拷贝进排序器，
+     *  每一批用完就丢掉，有limit的时候只留前offset+limit行，行多的时候分段写到临时文件
+     * @param  source，行的来源，游标读完之前一直持有它
+     * @param  statement，select语句，列名是source的schema()中的列名
+     * @return bool，order by中有列不存在的时候返回false
+     */
+    bool open(std::shared_ptr<Row_Source> source, const Statement& statement);
+
+    /**
+     * @brief 游标之后还要读的缓存中的表的锁，每次fetch的时候拿共享锁
+     * @param  latches，表的锁
+     */
+    void hold(Read_Latches latches) { m_latches = std::move(latches); }
+
+    /**
+     * @brief 是否已经读完了
+     * @return bool
+     */
+    bool done() const {
+        if (0 == m_left)
+            return true;
+        if (m_sort)
+            return m_sorter.done();
+        if (m_scan)
+            return m_pos >= m_snapshot.m_rows and nullptr == m_source;
+        return m_pos >= m_rows.size();
+    }
+
+    /**
+     * @brief 往后读最多limit行，写进out的结果集，out的一个批次满了也停下来
+     * @param  limit，最多读的行数
+     * @param  out，结果集，已经begin_result过
+     * @return uint64_t，读到的行数
+     */
+    uint64_t fetch(uint64_t limit, Result_Sink& out);
+
+    /**
+     * @brief 打开时的表
+     * @return const Table&
+     */
+    const Table& table() const { return *m_table; }
+
+    /**
+     * @brief 要显示的列的下标
+     * @return const std::vector<int>&
+     */
+    const std::vector<int>& columns() const { return m_columns; }
+
+private:
+    /**
+     * @brief 要显示的列，为空表示全部
+     */
+    void _choose_columns(const Statement& statement);
+
+    /**
+     * @brief order by的每一列在表中的下标
+     * @return bool，有列不存在的时候返回false
+     */
+    bool _order_keys(const Statement& statement, std::vector<Row_Sorter::Key>& keys) const;
+
+    /**
+     * @brief 从Row_Source打开的时候，当前这一批扫描完了就换下一批，source也没有了的时候放掉它
+     */
+    void _refill();
+
+private:
+    /**
+     * @brief 打开时的表和快照，从Row_Source打开的时候是当前这一批
+     */
+    std::shared_ptr<const Table> m_table;
+    Snapshot m_snapshot;
+
+    /**
+     * @brief 要显示的列的下标
+     */
+    std::vector<int> m_columns;
+
+    /**
+     * @brief where条件，已经bind过
+     */
+    bool m_has_where = false;
+    Where_Expr m_cond;
+
+    /**
+     * @brief 是否按行号扫描，这时候m_pos是下一行的行号，否则m_pos是m_rows的下标
+     */
+    bool m_scan = false;
+
+    /**
+     * @brief 不按行号扫描的时候，按顺序排好的所有要显示的行
+     */
+    std::vector<size_t> m_rows;
+
+    /**
+     * @brief 读到的位置
+     */
+    size_t m_pos = 0;
+
+    /**
+     * @brief 是否从m_sorter中按顺序读
+     */
+    bool m_sort = false;
+    Row_Sorter m_sorter;
+
+    /**
+     * @brief 按行号扫描的时候还要跳过的行数(offset)，和还可以读的行数(limit)
+     */
+    uint64_t m_skip = 0;
+    uint64_t m_left = UINT64_MAX;
+
+    /**
+     * @brief 从Row_Source打开的时候，行的来源和放当前这一批的表(就是m_table)
+     */
+    std::shared_ptr<Row_Source> m_source;
+    std::shared_ptr<Table> m_batch;
+
+    /**
+     * @brief 读到的缓存中的表的锁，其他连接只在改这些表的内存的那一小会儿和fetch互斥
+     */
+    Read_Latches m_latches;
+};
+
+/**
+ * @brief 还没有发完的结果集: 游标和还要读的行数，网络层等发送缓冲区空出来再接着读下一批
+ */
+struct Result_Stream {
+    std::shared_ptr<Cursor> m_cursor;
+    uint64_t m_remaining = 0;
+
+    /**
+     * @brief 是否还有没发完的结果
+     */
+    bool pending() const { return nullptr != m_cursor; }
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file hash_aggregate.h
+ * @brief 聚合查询(聚合函数和group by)的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _HASH_AGGREGATE_H_
+#define _HASH_AGGREGATE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "server_table.h"
+#include "sql_parser.h"
+#include "thread_pool.h"
+
+/**
+ * @brief 在服务端做聚合，只把每个分组的一行结果发给客户端
+ *
+ *  分组放在开放地址的哈希表中，键是分组列，哈希表里面只记分组的第一行的行号，比较键的时候直接比较表中的值，不拷贝字符串
+ *  行多的时候按行号分给线程池中的几个线程，各自在自己的哈希表中做部分聚合，最后合并
+ *  分组多到超过内存上限的时候，把哈希表按哈希值的高位分区写进临时文件，合并的时候一个分区一个分区地聚合，
+ *  一个分区还是放不下的时候再按接下来的几位分区
+ */
+namespace Hash_Aggregate {
+/**
+ * @brief 默认的内存上限
+ */
+constexpr size_t default_memory_limit = 64ul << 20;
+
+/**
+ * @brief 设置一条聚合查询的哈希表最多用多少内存，超过之后分区写到磁盘上
+ * @param  bytes，字节数
+ */
+void set_memory_limit(size_t bytes);
+
+/**
+ * @brief 设置做部分聚合用的线程池，没有设置的时候在调用的线程中做
+ * @param  pool，线程池，要比之后所有的聚合查询活得久
+ */
+void set_thread_pool(Thread_Pool* pool);
+
+/**
+ * @brief 对快照中满足where条件的行做聚合
+ * @param  table，表，调用的时候需要持有它的m_rows共享锁
+ * @param  statement，带聚合函数或者group by的select语句
+ * @param  result，结果，每个分组一行，列名是select中写的列和去掉空白的聚合函数，没有order by的时候按分组列升序；
+ *                 没有group by的时候总是有一行，没有要聚合的行的时候avg、min和max是null
+ * @param  error，语句不对的时候给用户的提示
+ * @return bool，列不存在、对string列求sum/avg、要显示的列不在group by中或者where条件不对的时候返回false
+ */
+bool run(const Table& table, const Statement& statement, Table& result, std::string& error);
+
+/**
+ * @brief 对一批一批生成出来的行(比如join的结果)做聚合，读完一批就丢掉，只把分组的第一行拷贝一份，
+ *  不把所有的行都放进内存；在调用的线程中做，分组多的时候和从表聚合一样分区写到磁盘上
+ * @param  source，行的来源，列名是语句中用的列名
+ * @param  statement，带聚合函数或者group by的select语句
+ * @param  result，结果，和从表聚合一样
+ * @param  error，语句不对的时候给用户的提示
+ * @return bool
+ */
+bool run(Row_Source& source, const Statement& statement, Table& result, std::string& error);
+
+/**
+ * @brief 结果中一列的列名，去掉原文中的空白，count ( * ) 和 count(*) 是同一列
+ * @param  text，select中一项的原文
+ * @return std::string
+ */
+std::string column_name(std::string_view text);
+
+}  // namespace Hash_Aggregate
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * @file hash_index.h
+ * @brief 建在某一列上的哈希索引的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _HASH_INDEX_H_
+#define _HASH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief 哈希索引，列的值 -> 这个值所在的所有行号(升序)，只能用于等值查询
+ *
+ *  索引文件: | 魔数 | 版本 | 建索引时表的LSN | 表的行数 | 键的个数 | 每个键: u32长度 + 键, u32行数 + u64行号... |
+ *
+ *  索引只是表的一份冗余，文件中的LSN和行数与表对不上(比如写回表之后还没来得及写索引就挂掉了)，
+ *  加载失败，重新从表建一遍就可以了
+ */
+class Hash_Index {
+public:
+    /**
+     * @brief 索引文件魔数，"HIDX"
+     */
+    static constexpr uint32_t magic = 0x58444948;
+
+    /**
+     * @brief 索引文件的版本，版本2开始int列的键是规范化之后的十进制字符串
+     */
+    static constexpr uint32_t version = 2;
+
+public:
+    /**
+     * @brief 从表的某一列建索引，原来的内容清空，int列的键是转换成十进制之后的字符串
+     * @param  table，表
+     * @param  column，列的下标
+     */
+    void build(const Table& table, int column);
+
+    /**
+     * @brief 添加一行
+     * @param  key，这一行在索引列上的值
+     * @param  row，行号
+     */
+    void insert(const std::string& key, size_t row);
+
+    /**
+     * @brief 去掉一行，修改索引列的时候先用旧值去掉再用新值添加
+     * @param  key，这一行在索引列上原来的值
+     * @param  row，行号
+     */
+    void erase(const std::string& key, size_t row);
+
+    /**
+     * @brief 等值查找
+     * @param  key，要找的值
+     * @return const std::vector<size_t>*，升序的行号，没有这个值的时候为nullptr
+     */
+    const std::vector<size_t>* find(const std::string& key) const;
+
+    /**
+     * @brief 写入索引文件，先写临时文件然后rename
+     * @param  path，索引文件路径
+     * @param  lsn，表的LSN
+     * @param  row_count，表的行数
+     */
+    void save(const std::string& path, uint64_t lsn, uint64_t row_count) const;
+
+    /**
+     * @brief 读取索引文件
+     * @param  path，索引文件路径
+     * @param  lsn，表的LSN
+     * @param  row_count，表的行数
+     * @return bool，文件不存在、损坏或者和表对不上的时候返回false，需要重新建
+     */
+    bool load(const std::string& path, uint64_t lsn, uint64_t row_count);
+
+    /**
+     * @brief 估算占用的内存，算进表缓存的预算
+     * @return size_t
+     */
+    size_t bytes() const;
+
+private:
+    /**
+     * @brief 值 -> 行号
+     */
+    std::unordered_map<std::string, std::vector<size_t>> m_map;
+
+    /**
+     * @brief 所有键下面的行号总数
+     */
+    size_t m_entries = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file hash_join.h
+ * @brief 两张表等值连接(join)的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _HASH_JOIN_H_
+#define _HASH_JOIN_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "server_table.h"
+#include "sql_parser.h"
+
+/**
+ * @brief 在服务端做 a join b on a.x = b.y，客户端不用把两张表都拉过去再自己连接
+ *
+ *  可见行少的一边建哈希表(build)，另一边逐行去查(probe)，哈希表中只记行号和哈希值，比较键的时候直接比较表中的值
+ *  build的一边超过内存上限的时候两边都按哈希值的高位分区写进临时文件(grace hash join)，一个分区一个分区地连接
+ *  where中只涉及一张表的子条件在连接之前就用来过滤这张表，能用上这张表的索引
+ *
+ *  连接的结果不一次性生成，而是一个Row_Source，游标读一批就probe一批，列是左边的表的列再接右边的表的列中语句用到的那些，
+ *  列名带表名(a.x)，select、where、group by和order by中的列名可以带表名，不带表名的时候只能在一张表中出现
+ */
+namespace Hash_Join {
+/**
+ * @brief 默认的内存上限
+ */
+constexpr size_t default_memory_limit = 64ul << 20;
+
+/**
+ * @brief 设置一条join的哈希表最多用多少内存，超过之后分区写到磁盘上
+ * @param  bytes，字节数
+ */
+void set_memory_limit(size_t bytes);
+
+/**
+ * @brief 对两张表的快照做连接
+ * @param  left，from后面的表，调用的时候和之后每次从source读的时候都需要持有两张表的m_rows共享锁
+ * @param  right，join后面的表
+ * @param  statement，带join的select语句
+ * @param  source，连接的结果，没有order by的时候行的顺序不固定
+ * @param  view，改写成在连接的结果上执行的select，列名都换成带表名的列名，string_view指向source的schema()中的列名
+ * @param  error，语句不对的时候给用户的提示
+ * @return bool，两张表是同一张、列不存在或者不明确、on的两列类型不同的时候返回false
+ */
+bool run(std::shared_ptr<const Table> left, std::shared_ptr<const Table> right, const Statement& statement,
+         std::shared_ptr<Row_Source>& source, Statement& view, std::string& error);
+
+}  // namespace Hash_Join
+
+#endif
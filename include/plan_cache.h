@@ -0,0 +1,144 @@
+/**
+ * @file plan_cache.h
+ * @brief 服务端全局共享的语句计划缓存的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _PLAN_CACHE_H_
+#define _PLAN_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "sql_parser.h"
+
+/**
+ * @brief 解析好的带参数的语句，预备语句和计划缓存中存的都是它
+ * @brief 语法树中的string_view指向m_text，所以创建之后不能拷贝，用shared_ptr共享
+ */
+struct Plan {
+    Plan() = default;
+    Plan(const Plan&) = delete;
+    Plan& operator=(const Plan&) = delete;
+
+    /**
+     * @brief 语句文本，计划缓存中是规范化之后的文本，预备语句是as后面的原文
+     */
+    std::string m_text;
+
+    /**
+     * @brief 解析好的语法树，参数的位置都记在m_statement.m_params中
+     */
+    Statement m_statement;
+
+    /**
+     * @brief 把参数的值填回语句文本，得到一条可以直接执行的命令，写WAL的时候用它
+     * @param  args，参数的值，个数和参数相同
+     * @return std::string
+     */
+    std::string render(const std::vector<std::string_view>& args) const;
+};
+
+/**
+ * @brief 缓存增删改查语句的计划，键是Sql_Parser::normalize得到的规范化文本
+ * @brief 形状相同、只有字面量不同的语句只解析一次，之后把字面量填进缓存的语法树就能执行
+ * @brief 计划只和语句的文本有关，和表的内容、模式无关，所以建表删表的时候不需要让它失效，按LRU淘汰
+ */
+class Plan_Cache {
+public:
+    /**
+     * @brief 缓存的统计信息
+     */
+    struct Stats {
+        size_t m_hits = 0;
+        size_t m_misses = 0;
+        size_t m_evictions = 0;
+        size_t m_plans = 0;
+        size_t m_capacity = 0;
+    };
+
+    /**
+     * @brief 默认最多缓存的计划个数
+     */
+    static constexpr size_t default_capacity = 1024;
+
+public:
+    /**
+     * @brief 整个服务端只有一个计划缓存
+     * @return Plan_Cache&
+     */
+    static Plan_Cache& instance();
+
+    /**
+     * @brief 设置最多缓存的计划个数，超出的部分会马上淘汰，为0的时候不缓存
+     * @param  capacity，个数
+     */
+    void set_capacity(size_t capacity);
+
+    /**
+     * @brief 按规范化的文本找计划，同时统计命中率
+     * @param  key，规范化的文本
+     * @return std::shared_ptr<const Plan>，没有的时候返回nullptr
+     */
+    std::shared_ptr<const Plan> get(const std::string& key);
+
+    /**
+     * @brief 放入一个计划，get没有命中、解析好之后调用
+     * @param  key，规范化的文本
+     * @param  plan，计划
+     */
+    void put(const std::string& key, const std::shared_ptr<const Plan>& plan);
+
+    /**
+     * @brief 拿到统计信息
+     * @return Stats
+     */
+    Stats stats();
+
+private:
+    Plan_Cache() = default;
+
+    /**
+     * @brief 缓存中的一项
+     */
+    struct Entry {
+        std::shared_ptr<const Plan> m_plan;
+
+        /**
+         * @brief 在LRU链表中的位置
+         */
+        std::list<std::string>::iterator m_lru_pos;
+    };
+
+    /**
+     * @brief 淘汰最久没用的计划，直到不超过容量
+     */
+    void _evict();
+
+private:
+    std::mutex m_mutex;
+
+    std::unordered_map<std::string, Entry> m_entries;
+
+    /**
+     * @brief 链表头是最近用过的
+     */
+    std::list<std::string> m_lru;
+
+    size_t m_capacity = default_capacity;
+
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file protocol.h
+ * @brief 客户端和服务端之间按帧传输的二进制协议的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 以前一条命令就是一次send，回复也是一次recv，命令和回复超过BUFSIZ就会被截断，也没办法一次发送多条命令
+ * @brief 现在所有的消息都按帧发送，帧头是定长的，所有整数都是网络字节序(大端):
+ *
+ *  | u8帧类型 | u32请求号 | u32负载长度 | 负载 |
+ *
+ *  客户端发送Query帧，负载是命令字符串，请求号由客户端自己编号，可以不等回复连续发送多条(流水线)
+ *  服务端按收到的顺序执行，每条命令的回复都带着它的请求号，依次是:
+ *
+ *  Text，可选，结果集前面的提示文字
+ *  Schema，可选，只有select有: u32列数，然后每列 u8列类型 + u32名称长度 + 名称
+ *  Rows，可选，可以有多个，每个不超过batch_bytes: u32行数，然后每行按列依次存放，
+ *        int列是8字节的int64，string列是 u32长度 + 值
+ *  Status，一定有并且是最后一个: u8状态码 + 后面剩下的提示文字
+ */
+namespace Protocol {
+/**
+ * @brief 帧头的字节数
+ */
+constexpr size_t header_size = 9;
+
+/**
+ * @brief 一个帧的负载最多这么多字节，超过的认为是坏的连接
+ */
+constexpr uint32_t max_payload = 64u << 20;
+
+/**
+ * @brief 一个Rows帧攒到这么多字节就发出去，后面的行放到下一个Rows帧
+ */
+constexpr size_t batch_bytes = 64u << 10;
+
+/**
+ * @brief 帧的类型
+ */
+enum Frame_Type : uint8_t {
+    Query = 1,
+    Text,
+    Schema,
+    Rows,
+    Status,
+};
+
+/**
+ * @brief Status帧中的状态码
+ *  Ok，命令正常执行完了(包括表不存在之类的提示)
+ *  Error，命令不正确
+ *  Bye，客户端要退出，服务端不再处理这个连接后面的命令
+ */
+enum Status_Code : uint8_t {
+    Ok = 0,
+    Error,
+    Bye,
+};
+
+/**
+ * @brief 结果集中列的类型
+ */
+enum Column_Type : uint8_t {
+    Int = 0,
+    String,
+};
+
+/**
+ * @brief 一个帧，负载指向接收缓冲区，不拷贝
+ */
+struct Frame {
+    Frame_Type m_type = Query;
+    uint32_t m_id = 0;
+    std::string_view m_payload;
+
+    /**
+     * @brief 整个帧的字节数
+     */
+    size_t size() const { return header_size + m_payload.size(); }
+};
+
+/**
+ * @brief 大端追加整数
+ */
+void put_u32(std::string& buf, uint32_t value);
+void put_u64(std::string& buf, uint64_t value);
+
+/**
+ * @brief 从in的开头取出大端整数，取出之后in往后移，剩下的不够的时候返回false
+ */
+bool get_u32(std::string_view& in, uint32_t& value);
+bool get_u64(std::string_view& in, uint64_t& value);
+
+/**
+ * @brief 从in的开头取出 u32长度 + 字符串
+ */
+bool get_string(std::string_view& in, std::string_view& value);
+
+/**
+ * @brief 在out后面追加一个帧
+ * @param  out，发送缓冲区
+ * @param  type，帧类型
+ * @param  id，请求号
+ * @param  payload，负载
+ */
+void append_frame(std::string& out, Frame_Type type, uint32_t id, std::string_view payload);
+
+/**
+ * @brief 从接收缓冲区的开头取出一个完整的帧
+ * @param  buf，接收缓冲区
+ * @param  frame，取出的帧，负载指向buf
+ * @return int，1表示取出了一个帧，0表示数据还不够一个帧，-1表示负载长度超过max_payload
+ */
+int parse_frame(std::string_view buf, Frame& frame);
+
+/**
+ * @brief 把Schema帧按以前的文本格式显示出来: 列名之间用空格隔开
+ * @param  payload，Schema帧的负载
+ * @param  types，每一列的类型，解析Rows帧的时候要用
+ * @param  out，输出流
+ * @return bool，负载格式不对的时候返回false
+ */
+bool render_schema(std::string_view payload, std::vector<Column_Type>& types, std::ostream& out);
+
+/**
+ * @brief 把Rows帧按以前的文本格式显示出来: 一行一行，值之间用空格隔开
+ * @param  payload，Rows帧的负载
+ * @param  types，render_schema拿到的列类型
+ * @param  out，输出流
+ * @return bool，负载格式不对的时候返回false
+ */
+bool render_rows(std::string_view payload, const std::vector<Column_Type>& types, std::ostream& out);
+
+}  // namespace Protocol
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file result_sink.h
+ * @brief 收集命令执行结果的内存缓冲区的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _RESULT_SINK_H_
+#define _RESULT_SINK_H_
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+#include "server_table.h"
+
+/**
+ * @brief 命令的输出都写到这里，网络层拿到之后按帧发送给客户端
+ * @brief 以前是把标准输出重定向到feedback.txt再读回来，每条命令都要多好几次系统调用和读写磁盘，而且所有的命令只能共用一个文件
+ * @brief 提示文字的用法和std::cout一样，select的结果集用begin_result和add_row直接编码成Rows帧，不经过文本
+ * @brief reset之后字符串的容量留着给下一条命令用
+ */
+class Result_Sink : public std::ostream {
+public:
+    /**
+     * @brief 构造函数
+     */
+    Result_Sink();
+
+    Result_Sink(const Result_Sink&) = delete;
+    Result_Sink& operator=(const Result_Sink&) = delete;
+
+    /**
+     * @brief 到目前为止写入的内容
+     * @return const std::string&
+     */
+    const std::string& str() const { return m_buffer.m_data; }
+
+    /**
+     * @brief 清空内容，开始下一条命令
+     */
+    void reset();
+
+    /**
+     * @brief 开始输出结果集，之前写入的文字放在Text帧，之后写入的文字放在Status帧
+     * @param  table，表
+     * @param  columns，要显示的列的下标
+     */
+    void begin_result(const Table& table, const std::vector<int>& columns);
+
+    /**
+     * @brief 在结果集中添加一行，必须在begin_result之后调用
+     * @param  table，表
+     * @param  row，行号
+     */
+    void add_row(const Table& table, size_t row);
+
+    /**
+     * @brief 当前批次的行是否已经攒够了batch_bytes，游标读到这里就停下来，先把这一批发出去
+     * @return bool
+     */
+    bool batch_full() const { return !m_batches.empty() and m_batches.back().size() >= Protocol::batch_bytes; }
+
+    /**
+     * @brief 结果集还没有发完的时候调用，清空文字和已经编码的行，开始下一批，列和Schema帧不会再发一遍
+     */
+    void next_batch();
+
+    /**
+     * @brief 设置结果集后面还有没有下一批，有的时候write_frames不写Status帧
+     * @param  more，是否还有
+     */
+    void set_more(bool more) { m_more = more; }
+
+    /**
+     * @brief 设置命令的状态码，reset之后是Ok
+     * @param  code，状态码
+     */
+    void set_status(Protocol::Status_Code code) { m_status = code; }
+
+    /**
+     * @brief 命令的状态码
+     * @return Protocol::Status_Code
+     */
+    Protocol::Status_Code status() const { return m_status; }
+
+    /**
+     * @brief 把这条命令的回复编码成帧追加到发送缓冲区
+     * @param  id，请求号
+     * @param  out，发送缓冲区
+     */
+    void write_frames(uint32_t id, std::string& out) const;
+
+private:
+    /**
+     * @brief 直接追加到std::string的流缓冲区，没有额外的中间缓冲
+     */
+    class Buffer : public std::streambuf {
+    public:
+        std::string m_data;
+
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* str, std::streamsize len) override;
+    };
+
+private:
+    Buffer m_buffer;
+
+    /**
+     * @brief 状态码
+     */
+    Protocol::Status_Code m_status = Protocol::Ok;
+
+    /**
+     * @brief 是否有结果集
+     */
+    bool m_has_result = false;
+
+    /**
+     * @brief 结果集后面还有下一批
+     */
+    bool m_more = false;
+
+    /**
+     * @brief begin_result的时候已经写入的文字的长度
+     */
+    size_t m_text_end = 0;
+
+    /**
+     * @brief 结果集要显示的列的下标
+     */
+    std::vector<int> m_columns;
+
+    /**
+     * @brief Schema帧的负载，已经发过的时候为空
+     */
+    std::string m_schema;
+
+    /**
+     * @brief 每个Rows帧中各行编码之后的内容
+     */
+    std::vector<std::string> m_batches;
+
+    /**
+     * @brief 每个Rows帧的行数
+     */
+    std::vector<uint32_t> m_batch_rows;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/**
+ * @file row_sorter.h
+ * @brief 按order by给行号排序的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _ROW_SORTER_H_
+#define _ROW_SORTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief 按order by的若干列给行排序，键相同的按行号(加入的顺序)升序，结果是确定的
+ *
+ *  有limit的时候只需要前K行，用一个大小为K的堆，内存和表的大小无关；
+ *  行数超过内存上限的时候，每攒满一批就排好序写进一个临时文件(一个有序段)，最后多路归并，
+ *  归并是在next中一行一行做的，排好的结果不会一次性放在内存中
+ *
+ *  内存中只排行号，比较的时候直接看表中的值；有序段是自包含的，每一条记录是编码成可以直接按字节比较的键
+ *  和要输出的列的值，归并的时候不再看表
+ *
+ *  行有两种来源: open的时候给一张排序期间一直被持有的表，加入的是它的行号；
+ *  或者open_copy之后从一批一批的行中加入，用到的列拷贝一份自己留着，那一批之后就可以丢掉
+ */
+class Row_Sorter {
+public:
+    /**
+     * @brief order by中的一列
+     */
+    struct Key {
+        int m_column = -1;
+        bool m_desc = false;
+    };
+
+    /**
+     * @brief 默认的内存上限
+     */
+    static constexpr size_t default_memory_limit = 64ul << 20;
+
+    /**
+     * @brief 设置排序最多用多少内存，超过之后分段写到临时文件中
+     * @param  bytes，字节数
+     */
+    static void set_memory_limit(size_t bytes);
+
+    Row_Sorter() = default;
+    Row_Sorter(const Row_Sorter&) = delete;
+    Row_Sorter& operator=(const Row_Sorter&) = delete;
+    ~Row_Sorter();
+
+    /**
+     * @brief 开始给一张表中的行排序
+     * @param  table，表，排序期间要一直被持有
+     * @param  keys，排序的列
+     * @param  payload，要输出的列，升序，写到有序段中的只有这些列的值
+     * @param  top_k，只要排在最前面的这么多行，为0表示全部都要
+     */
+    void open(const Table* table, std::vector<Key> keys, std::vector<int> payload, uint64_t top_k);
+
+    /**
+     * @brief 开始给一批一批加入的行排序，之后用add(batch, row)加入
+     * @param  schema，这些行的列
+     * @param  keys，排序的列
+     * @param  payload，要输出的列，升序，只有排序的列和这些列会被拷贝
+     * @param  top_k，只要排在最前面的这么多行，为0表示全部都要
+     */
+    void open_copy(const Table& schema, std::vector<Key> keys, std::vector<int> payload, uint64_t top_k);
+
+    /**
+     * @brief 加入open时给的表中的一行
+     * @param  row，行号
+     */
+    void add(size_t row);
+
+    /**
+     * @brief open_copy之后加入一批中的一行，用到的列拷贝一份
+     * @param  batch，这一批，列和open_copy时的schema一样
+     * @param  row，这一批中的行号
+     */
+    void add(const Table& batch, size_t row);
+
+    /**
+     * @brief 所有的行都加入了，之后可以调用next
+     */
+    void finish();
+
+    /**
+     * @brief 按顺序取出下一行
+     * @param  table，这一行所在的表，列和加入的时候一样，但是只有payload中的列有值，下一次调用next之前有效
+     * @param  row，在table中的行号
+     * @return bool，没有了的时候返回false
+     */
+    bool next(const Table*& table, size_t& row);
+
+    /**
+     * @brief 是否已经取完了
+     * @return bool
+     */
+    bool done() const;
+
+    /**
+     * @brief 写到临时文件中的有序段的个数
+     * @return size_t
+     */
+    size_t runs() const { return m_runs.size(); }
+
+private:
+    /**
+     * @brief 两张表中的两行按排序的列比较，不比较行号
+     */
+    int _compare(const Table& a_table, size_t a, const Table& b_table, size_t b) const;
+
+    /**
+     * @brief m_table中的a是否排在b前面
+     */
+    bool _less(size_t a, size_t b) const;
+
+    /**
+     * @brief 把一行编码成有序段中的一条记录: u32键长 + 键 + u32值长 + 要输出的列的值
+     */
+    void _encode(size_t row, std::string& out) const;
+
+    /**
+     * @brief 把内存中的行排好序写成一个有序段
+     */
+    void _spill();
+
+    /**
+     * @brief 读有序段的下一条记录
+     * @return bool，读完了的时候返回false
+     */
+    bool _read(size_t run);
+
+    /**
+     * @brief open_copy之后用堆的时候，被挤出堆的行还留在m_own中，攒多了就只留堆中的行
+     */
+    void _compact_heap();
+
+private:
+    /**
+     * @brief 一个写在临时文件中的有序段，和它当前的一条记录
+     */
+    struct Run {
+        FILE* m_file = nullptr;
+        std::string m_key;
+        std::string m_payload;
+    };
+
+    const Table* m_table = nullptr;
+    std::vector<Key> m_keys;
+    std::vector<int> m_payload;
+    uint64_t m_top_k = 0;
+
+    /**
+     * @brief 是否用大小为m_top_k的堆
+     */
+    bool m_use_heap = false;
+
+    /**
+     * @brief open_copy之后拷贝进来的行(m_table指向它)，不用的列放空值；
+     *  m_own_bytes是它大约用的内存，m_first_row是它的第0行前面已经写出去了多少行，写进有序段的行号要加上它
+     */
+    bool m_copy = false;
+    Table m_own;
+    std::vector<bool> m_needed;
+    size_t m_own_bytes = 0;
+    uint64_t m_first_row = 0;
+
+    /**
+     * @brief 内存中的行: 堆、还没有写出去的一批或者最后排好序的结果
+     */
+    std::vector<size_t> m_rows;
+    size_t m_pos = 0;
+
+    /**
+     * @brief 有序段，和归并用的堆(放有序段的下标，堆顶是当前最小的)
+     */
+    std::vector<Run> m_runs;
+    std::vector<size_t> m_merge;
+
+    /**
+     * @brief 归并的时候解码出来的一行
+     */
+    Table m_out;
+};
+
+#endif
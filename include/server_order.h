@@ -19,48 +19,28 @@
 
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "cursor.h"
+#include "plan_cache.h"
+#include "result_sink.h"
 #include "server_table.h"
+#include "sql_parser.h"
+#include "table_cache.h"
 #include "tools.h"
+#include "wal.h"
 
+/**
+ * @brief 处理命令的类，服务端给每个连接创建一个，也就是这个连接的会话:
+ *  当前使用的数据库、预备语句和游标都是连接自己的，互相看不到
+ *  同一个会话同一时间只在一个线程中执行，不同的会话可以在不同的工作线程中并行执行
+ */
 class Order {
-public:
-    /**
-     * @brief 存储输入的命令的类型，方便定位到指定的操作函数
-     *  Show，展示命令的格式规范
-     *  Tree，展示数据库的目录架构
-     *  Quit，退出程序
-     *  Clear，清空屏幕
-     *  Create_Database，创建数据库
-     *  Drop_Database，销毁数据库
-     *  Use，切换数据库
-     *  Create_Table，创建表
-     *  Drop_Table，删除表
-     *  Select，查询表
-     *  Delete，删除表中的记录
-     *  Insert，在表中插入数据
-     *  Update，更新表中数据
-     *  Unknown，未知，表示命令可能出错
-     */
-    enum Command_Type {
-        Show = 0,
-        Tree,
-        Quit,
-        Clear,
-        Create_Database,
-        Drop_Database,
-        Use,
-        Create_Table,
-        Drop_Table,
-        Select,
-        Delete,
-        Insert,
-        Update,
-        Unknown
-    };
-
 public:
     /**
      * @brief 默认构造函数
@@ -84,32 +64,58 @@ public:
     void run();
 
     /**
-     * @brief 得到反馈字符串
-     * @return std::string
+     * @brief 得到反馈，也就是run的时候写入m_out的所有内容，下一次set_command之前一直有效
+     * @return const Result_Sink&，网络层用write_frames把它编码成帧
+     */
+    const Result_Sink& get_feedback() const { return m_out; }
+
+    /**
+     * @brief run之后结果集是否还有没读完的批次，有的时候write_frames不会写Status帧
+     * @return bool
+     */
+    bool has_stream() const { return m_stream.pending(); }
+
+    /**
+     * @brief 把没读完的结果集交给网络层，等发送缓冲区空出来之后再用resume接着读
+     * @return Result_Stream
+     */
+    Result_Stream take_stream() { return std::move(m_stream); }
+
+    /**
+     * @brief 读结果集的下一批，放在get_feedback中，读完的时候stream变成空的，这时候反馈中带有Status
+     * @param  stream，take_stream拿到的结果集
      */
-    std::string get_feedback() const { return m_feedback; }
+    void resume(Result_Stream& stream);
 
     /**
-     * @brief 从feedback.txt文件中读取信息并且修改本类中的m_feedback字符串信息
+     * @brief 服务端启动的时候调用，重放每个数据库WAL中的记录，然后做一次检查点
      */
-    void read_feedback();
+    void recover();
+
+    /**
+     * @brief 检查点，把所有数据库的脏表写回磁盘并且清空WAL，会等正在执行的命令结束
+     */
+    static void checkpoint();
 
 private:
     /**
-     * @brief 根据给定的命令找到对应的命令类型，在这个函数当中不考虑命令的具体合理性问题，这个交给另一个类去做，我们只是初步判断这个命令可能的类型
-     * @param  command，命令字符串
-     * @return Command_Type，命令枚举类型
+     * @brief 增删改查语句先规范化，到计划缓存中找同样形状的语句，没有的时候解析规范化的文本并放入缓存
+     * @brief 拿到计划之后把字面量填进去得到m_statement
+     * @return bool，语句不能走计划缓存的时候返回false，这时候需要按原文解析
+     */
+    bool _plan_from_cache();
+
+    /**
+     * @brief 把带参数的语句解析成计划
+     * @param  text，语句文本
+     * @return std::shared_ptr<const Plan>，语法不对的时候返回nullptr，原因在m_parser.error()中
      */
-    Command_Type _get_type(const std::string& command);
+    std::shared_ptr<const Plan> _make_plan(std::string_view text);
 
     /**
-     * @brief 和上面的函数配套使用，在确定是create和drop的前提下进一步确定是database还是table
-     * @param  blank_pos，第一个空格在原命令字符串当中的下标
-     * @param  command，原命令字符串
-     * @param  first，确认第一个参数是create还是drop，true代表是create，false代表是drop
-     * @return Command_Type，命令枚举类型
+     * @brief 按m_statement的类型调用对应的处理函数
      */
-    Command_Type _get_database_table(size_t blank_pos, const std::string& command, bool first);
+    void _dispatch();
 
     //------------------------------------------------------------
 
@@ -140,11 +146,27 @@ private:
      */
     void _deal_show();
 
+    /**
+     * @brief 处理Show_Cache类型命令
+     */
+    void _deal_show_cache();
+
+    /**
+     * @brief 处理Show_Plans类型命令
+     */
+    void _deal_show_plans();
+
     /**
      * @brief 处理Tree类型命令
      */
     void _deal_tree();
 
+    /**
+     * @brief 在子进程中执行外部命令，把它的标准输出收集到m_out中
+     * @param  args，命令和参数，args[0]在PATH中查找
+     */
+    void _run_program(const std::vector<std::string>& args);
+
     /**
      * @brief 处理Quit类型命令
      */
@@ -177,6 +199,34 @@ private:
      */
     bool _check_if_use();
 
+    /**
+     * @brief 当前数据库的WAL
+     * @return Wal&
+     */
+    Wal& _wal();
+
+    /**
+     * @brief 修改表之前调用，把当前命令写入WAL，返回这条记录的LSN，需要持有WAL的write_guard
+     * @brief 恢复的时候不写WAL，如果表已经包含了正在重放的记录(表的LSN不小于它)，返回0表示跳过
+     * @param  table_name，表名
+     * @param  table_lsn，表当前的LSN
+     * @return uint64_t
+     */
+    uint64_t _log_write(const std::string& table_name, uint64_t table_lsn);
+
+    /**
+     * @brief 修改完表并且释放write_guard和表的m_writer之后调用，等待日志落盘(组提交)
+     * @param  lsn，_log_write返回的LSN
+     */
+    void _commit(uint64_t lsn);
+
+    /**
+     * @brief 当前数据库中某张表的表文件路径
+     * @param  table_name，表名
+     * @return std::string
+     */
+    std::string _table_path(std::string_view table_name) const;
+
     /**
      * @brief 处理Create_Table类型命令
      */
@@ -187,6 +237,11 @@ private:
      */
     void _deal_drop_table();
 
+    /**
+     * @brief 处理Create_Index类型命令
+     */
+    void _deal_create_index();
+
     /**
      * @brief 处理Select类型命令
      */
@@ -207,6 +262,107 @@ private:
      */
     void _deal_update();
 
+    /**
+     * @brief 处理Load类型命令
+     */
+    void _deal_load();
+
+    /**
+     * @brief 处理Vacuum类型命令
+     */
+    void _deal_vacuum();
+
+    /**
+     * @brief 处理Prepare类型命令
+     */
+    void _deal_prepare();
+
+    /**
+     * @brief 处理Execute类型命令，填好参数之后按预备语句的类型执行
+     */
+    void _deal_execute();
+
+    /**
+     * @brief 处理Deallocate类型命令
+     */
+    void _deal_deallocate();
+
+    /**
+     * @brief 处理Declare类型命令，游标的行顺序在这里就确定了
+     */
+    void _deal_declare();
+
+    /**
+     * @brief 处理Fetch类型命令
+     */
+    void _deal_fetch();
+
+    /**
+     * @brief 处理Close类型命令
+     */
+    void _deal_close();
+
+    /**
+     * @brief 按m_statement中的select打开游标，表或者排序的列不存在的时候给出提示
+     * @param  table_ptr，打开的表
+     * @param  begin_result，是否马上开始输出结果集(select)，declare的时候等到fetch再输出
+     * @return std::shared_ptr<Cursor>，失败的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_cursor(std::shared_ptr<Table>& table_ptr, bool begin_result);
+
+    /**
+     * @brief 在一张表上按select语句打开游标
+     * @param  table，表
+     * @param  statement，select语句，不带聚合函数和join
+     * @param  begin_result，是否开始输出结果集
+     * @return std::shared_ptr<Cursor>，排序的列不存在的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_view(std::shared_ptr<const Table> table, const Statement& statement, bool begin_result);
+
+    /**
+     * @brief 在一批一批生成的行上按select语句打开游标
+     * @param  source，行的来源，比如join的结果或者按页读的表文件
+     * @param  statement，select语句，不带聚合函数，列名是source的schema()中的列名
+     * @param  begin_result，是否开始输出结果集
+     * @return std::shared_ptr<Cursor>，排序的列不存在的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_source(std::shared_ptr<Row_Source> source, const Statement& statement,
+                                         bool begin_result);
+
+    /**
+     * @brief 带聚合函数或者group by的select: 先在服务端聚合，游标打开在聚合的结果上
+     * @param  table，表
+     * @param  statement，select语句
+     * @param  begin_result，是否开始输出结果集
+     * @return std::shared_ptr<Cursor>，语句不对的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_aggregate(const Table& table, const Statement& statement, bool begin_result);
+
+    /**
+     * @brief 在聚合的结果上按select语句中的order by和limit打开游标
+     * @param  result，聚合的结果
+     * @param  statement，select语句
+     * @param  begin_result，是否开始输出结果集
+     * @return std::shared_ptr<Cursor>，排序的列不存在的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_grouped(std::shared_ptr<Table> result, const Statement& statement, bool begin_result);
+
+    /**
+     * @brief 带join的select: 没有聚合的时候游标一批一批地读连接的结果(要排序的话打开的时候就读完)，否则一批一批地交给聚合
+     * @param  left，from后面的表
+     * @param  right，join后面的表
+     * @param  begin_result，是否开始输出结果集
+     * @return std::shared_ptr<Cursor>，语句不对的时候返回nullptr
+     */
+    std::shared_ptr<Cursor> _open_join(std::shared_ptr<const Table> left, std::shared_ptr<const Table> right,
+                                       bool begin_result);
+
+    /**
+     * @brief 从结果集中读一批写进m_out，读完或者读够了行数的时候stream变成空的，否则告诉m_out还有下一批
+     * @param  stream，结果集
+     */
+    void _fetch_batch(Result_Stream& stream);
+
     /**
      * @brief 处理Unknown类型命令
      */
@@ -228,6 +384,13 @@ public:
      */
     static const std::string res_prefix;
 
+private:
+    /**
+     * @brief 所有会话共用的数据锁，查询和修改表中的行的命令拿共享锁(同一张表上的修改由表的锁串行)，
+     *        改表结构或者数据库目录的命令和vacuum拿独占锁
+     */
+    static std::shared_mutex data_lock;
+
 private:
     /**
      * @brief 存储当前用户输入命令的字符串
@@ -235,9 +398,45 @@ private:
     std::string m_command;
 
     /**
-     * @brief 与上面字符串命令对应的命令类型
+     * @brief 语法分析器
+     */
+    Sql_Parser m_parser;
+
+    /**
+     * @brief 与上面字符串命令对应的语法树，里面的名字和值指向m_command或者m_plan
      */
-    Command_Type m_command_type = Unknown;
+    Statement m_statement;
+
+    /**
+     * @brief m_statement来自计划缓存或者预备语句的时候，持有这个计划，保证语法树指向的文本有效
+     */
+    std::shared_ptr<const Plan> m_plan;
+
+    /**
+     * @brief 规范化之后的命令和其中的字面量，放在这里是为了重复利用内存
+     */
+    std::string m_plan_key;
+    std::vector<std::string_view> m_literals;
+
+    /**
+     * @brief 执行预备语句的时候，填好参数之后的语句文本，写WAL用它而不是execute命令本身
+     */
+    std::string m_rendered;
+
+    /**
+     * @brief 预备语句，名字到计划
+     */
+    std::unordered_map<std::string, std::shared_ptr<const Plan>> m_prepared;
+
+    /**
+     * @brief declare打开的游标，名字到游标
+     */
+    std::unordered_map<std::string, std::shared_ptr<Cursor>> m_cursors;
+
+    /**
+     * @brief 当前命令还没有读完的结果集
+     */
+    Result_Stream m_stream;
 
     /**
      * @brief 存储当前使用的数据库名称
@@ -245,9 +444,14 @@ private:
     std::string m_dbname;
 
     /**
-     * @brief 存储处理完客户端命令之后的反馈字符串
+     * @brief 存储处理完客户端命令之后的反馈，处理函数的输出都写到这里而不是标准输出
+     */
+    Result_Sink m_out;
+
+    /**
+     * @brief 恢复的时候正在重放的WAL记录的LSN，为0表示不在恢复
      */
-    std::string m_feedback;
+    uint64_t m_replay_lsn = 0;
 };
 
 #endif
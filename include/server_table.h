@@ -12,10 +12,15 @@
 #ifndef _SERVER_TABLE_H_
 #define _SERVER_TABLE_H_
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "string_heap.h"
+
 /**
  * @brief 表中的每一列(一个字段)，包含类型和命名
  */
@@ -47,6 +52,72 @@ struct Column {
     std::string m_column_type;
 };
 
+/**
+ * @brief 一列的数据，按列连续存放，int列只用m_ints，string列只用m_strings，行号就是下标
+ */
+struct Column_Data {
+    /**
+     * @brief int列的值，每个值8字节，比较的时候不需要解析字符串
+     */
+    std::vector<int64_t> m_ints;
+
+    /**
+     * @brief string列的值，内容放在按块申请的内存中，每个值只占一个(地址, 长度)
+     */
+    String_Heap m_strings;
+};
+
+class Hash_Index;
+class BTree_Index;
+
+/**
+ * @brief 建在表上的一个索引，定义存放在表文件的模式块中，索引数据存放在单独的文件中
+ */
+struct Index_Info {
+    /**
+     * @brief 索引的名字，同一张表里面不能重复
+     */
+    std::string m_index_name;
+
+    /**
+     * @brief 建索引的列
+     */
+    std::string m_column_name;
+
+    /**
+     * @brief 索引的类型，hash或者btree
+     */
+    std::string m_index_type;
+
+    /**
+     * @brief 列的下标，读表的时候才确定，不写入文件
+     */
+    int m_column_index = -1;
+
+    /**
+     * @brief 索引数据，读表的时候加载或者重建，不写入模式块，按类型只有一个不为空
+     */
+    std::shared_ptr<Hash_Index> m_hash;
+    std::shared_ptr<BTree_Index> m_btree;
+};
+
+/**
+ * @brief 表的一个快照(MVCC)，语句开始的时候拿到，之后的修改都不影响它:
+ *  行只会追加在末尾，update也是把新版本追加在末尾，所以快照之后追加的行号都不小于m_rows，看不到；
+ *  删除和update不挪动旧版本，只记下结束它的LSN，结束在m_lsn之后的旧版本快照还能看到
+ */
+struct Snapshot {
+    /**
+     * @brief 快照时的行数，也就是版本的开始
+     */
+    size_t m_rows = 0;
+
+    /**
+     * @brief 快照时表的LSN
+     */
+    uint64_t m_lsn = 0;
+};
+
 /**
  * @brief 存储表的结构体
  */
@@ -72,9 +143,167 @@ struct Table {
     std::vector<Column> m_columns;
 
     /**
-     * @brief 存储所有的数据，数据包含多项，每一项又包含不同的字段
+     * @brief 表上所有的索引
+     */
+    std::vector<Index_Info> m_indexes;
+
+    /**
+     * @brief 存储所有的数据，按列存放，和m_columns一一对应
+     */
+    std::vector<Column_Data> m_data;
+
+    /**
+     * @brief 表中的行数
+     */
+    size_t m_row_count = 0;
+
+    /**
+     * @brief 表中已经包含的最后一条WAL记录的LSN，恢复的时候跳过不大于它的记录
+     */
+    uint64_t m_lsn = 0;
+
+    /**
+     * @brief 还没有被删除或者修改掉的行的结束LSN
+     */
+    static constexpr uint64_t live = UINT64_MAX;
+
+    /**
+     * @brief 每一行的结束LSN，也就是删除或者修改掉它的WAL记录的LSN，还没有结束的是live
+     * @brief 只覆盖到最后一个结束了的行，后面的行都是live，没有删除和修改过的表不占额外的内存
+     */
+    std::vector<uint64_t> m_end;
+
+    /**
+     * @brief 已经结束了的旧版本的行数，写回的时候不写它们，没有快照在读的时候用purge_dead_rows真正删掉
+     */
+    size_t m_dead_rows = 0;
+
+    /**
+     * @brief 把字符串完整地解析成整数，前导0和正负号都可以
+     * @param  str，字符串
+     * @param  num，解析的结果
+     * @return bool，不是合法的int64的时候返回false
+     */
+    static bool parse_int(std::string_view str, int64_t& num);
+
+    /**
+     * @brief 某一列是否是int列
+     * @param  column，列的下标
+     * @return bool
+     */
+    bool is_int(int column) const { return "int" == m_columns[column].m_column_type; }
+
+    /**
+     * @brief 检查一个值能不能放进某一列，int列必须是合法的整数
+     * @param  column，列的下标
+     * @param  value，值
+     * @return bool
+     */
+    bool check_value(int column, const std::string& value) const;
+
+    /**
+     * @brief 拿到一个单元格的文本，int列会转换成字符串
+     * @param  row，行号
+     * @param  column，列的下标
+     * @return std::string
+     */
+    std::string cell(size_t row, int column) const;
+
+    /**
+     * @brief 在末尾添加一行，调用之前需要用check_value检查过每个值
+     * @param  values，每一列的值
+     */
+    void append_row(const std::vector<std::string>& values);
+
+    /**
+     * @brief 把另一张表(字段相同)中的一行添加到末尾，不经过字符串
+     * @param  other，另一张表
+     * @param  row，另一张表中的行号
+     */
+    void append_row_from(const Table& other, size_t row);
+
+    /**
+     * @brief 修改一个单元格，调用之前需要用check_value检查过值
+     * @param  row，行号
+     * @param  column，列的下标
+     * @param  value，新的值
+     */
+    void set_cell(size_t row, int column, const std::string& value);
+
+    /**
+     * @brief 拿到表当前的快照
+     * @return Snapshot
+     */
+    Snapshot snapshot() const { return {m_row_count, m_lsn}; }
+
+    /**
+     * @brief 某一行在快照中是否可见
+     * @param  row，行号
+     * @param  snapshot，快照
+     * @return bool
+     */
+    bool visible(size_t row, const Snapshot& snapshot) const {
+        return row < snapshot.m_rows and (row >= m_end.size() or m_end[row] > snapshot.m_lsn);
+    }
+
+    /**
+     * @brief 某一行是否是最新的版本(没有被删除或者修改掉)
+     * @param  row，行号
+     * @return bool
+     */
+    bool is_live(size_t row) const { return row >= m_end.size() or live == m_end[row]; }
+
+    /**
+     * @brief 删除或者修改一行的时候调用，结束这一行的版本，不挪动它
+     * @param  row，行号，必须是is_live的
+     * @param  lsn，这次修改对应的WAL记录的LSN
+     */
+    void end_version(size_t row, uint64_t lsn);
+
+    /**
+     * @brief 把已经结束了的旧版本真正删掉，行号会变，调用之前需要确认没有快照还在读这张表，之后需要重建索引
+     */
+    void purge_dead_rows();
+
+    /**
+     * @brief 删除若干行，剩下的行一次性往前挪
+     * @param  rows，要删除的行号，升序
+     */
+    void erase_rows(const std::vector<size_t>& rows);
+
+    /**
+     * @brief 删除所有的行，保留字段
+     */
+    void clear_rows();
+
+    /**
+     * @brief 预留空间
+     * @param  rows，行数
+     */
+    void reserve(size_t rows);
+};
+
+/**
+ * @brief 一批一批生成出来的行，比如join的结果或者按页读的表文件，
+ *  游标读完一批再要下一批，整个结果不用同时放在内存中
+ */
+class Row_Source {
+public:
+    virtual ~Row_Source() = default;
+
+    /**
+     * @brief 生成出来的行的列，没有行
+     * @return const Table&
+     */
+    virtual const Table& schema() const = 0;
+
+    /**
+     * @brief 再生成最多rows行，追加到out的末尾，out的列和schema()一样
+     * @param  out，放结果的表
+     * @param  rows，最多生成的行数
+     * @return size_t，生成的行数，为0表示已经没有了
      */
-    std::vector<std::vector<std::string>> m_data;
+    virtual size_t next(Table& out, size_t rows) = 0;
 };
 
 #endif
@@ -0,0 +1,527 @@
+/**
+ * @file sql_parser.h
+ * @brief 命令的词法分析和语法分析的头文件，把命令字符串解析成语法树
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _SQL_PARSER_H_
+#define _SQL_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "where_cond.h"
+
+/**
+ * @brief 词法单元，文本都是指向原命令字符串的string_view，不拷贝
+ */
+struct Token {
+    /**
+     * @brief 词法单元的种类
+     *  Word，单词，关键字、名字和不带引号的值都是单词，关键字不区分出来，由语法分析按位置判断
+     *  String，单引号括起来的值，m_text是去掉引号之后的内容，可以包含空格和符号
+     *  Symbol，符号 ( ) , = < > <= >= != <>
+     *  Param，参数 ?，只能出现在值的位置，执行的时候再填入真正的值
+     *  End，命令结束
+     *  Error，词法错误，比如引号没有闭合
+     */
+    enum Kind {
+        Word,
+        String,
+        Symbol,
+        Param,
+        End,
+        Error,
+    };
+
+    Kind m_kind = End;
+
+    /**
+     * @brief 词法单元的文本
+     */
+    std::string_view m_text;
+
+    /**
+     * @brief 在命令字符串中的起始下标(String是引号的下标)
+     */
+    size_t m_pos = 0;
+
+    /**
+     * @brief 是否是指定的单词，带引号的值不算
+     */
+    bool is_word(std::string_view word) const { return Word == m_kind and word == m_text; }
+
+    /**
+     * @brief 是否是指定的符号
+     */
+    bool is_symbol(std::string_view symbol) const { return Symbol == m_kind and symbol == m_text; }
+};
+
+/**
+ * @brief 词法分析器，从左往右扫描一遍命令字符串，每次取出一个词法单元
+ */
+class Sql_Lexer {
+public:
+    /**
+     * @brief 构造函数
+     * @param  text，命令字符串，生命周期要比词法单元长
+     */
+    explicit Sql_Lexer(std::string_view text = std::string_view()) : m_text(text) {}
+
+    /**
+     * @brief 取出下一个词法单元
+     * @return Token
+     */
+    Token next();
+
+    /**
+     * @brief 看一眼下一个词法单元，不取出
+     * @return const Token&
+     */
+    const Token& peek();
+
+    /**
+     * @brief 值写回命令文本的时候是否需要加上引号，也就是不加引号的时候会被分成多个词法单元或者被当成参数
+     * @param  value，值
+     * @return bool
+     */
+    static bool needs_quote(std::string_view value);
+
+private:
+    /**
+     * @brief 真正扫描一个词法单元
+     */
+    Token _scan();
+
+private:
+    /**
+     * @brief 命令字符串
+     */
+    std::string_view m_text;
+
+    /**
+     * @brief 扫描到的位置
+     */
+    size_t m_pos = 0;
+
+    /**
+     * @brief peek拿到的词法单元
+     */
+    Token m_peeked;
+
+    /**
+     * @brief m_peeked是否有效
+     */
+    bool m_has_peeked = false;
+};
+
+/**
+ * @brief 一条命令的语法树，名字和值都是指向原命令字符串的string_view
+ *  用到哪些成员由m_type决定，没有用到的成员保持为空
+ */
+struct Statement {
+    /**
+     * @brief 命令的类型
+     *  Show，展示命令的格式规范
+     *  Show_Cache，展示表缓存的统计信息
+     *  Tree，展示数据库的目录架构
+     *  Quit，退出程序
+     *  Clear，清空屏幕
+     *  Create_Database，创建数据库
+     *  Drop_Database，销毁数据库
+     *  Use，切换数据库
+     *  Create_Table，创建表
+     *  Drop_Table，删除表
+     *  Create_Index，在表的某一列上创建索引
+     *  Select，查询表
+     *  Delete，删除表中的记录
+     *  Insert，在表中插入数据
+     *  Update，更新表中数据
+     *  Show_Plans，展示计划缓存的统计信息
+     *  Prepare，创建预备语句
+     *  Execute，执行预备语句
+     *  Deallocate，删除预备语句
+     *  Declare，打开游标
+     *  Fetch，从游标中读取若干行
+     *  Close，关闭游标
+     *  Load，从csv文件中批量导入数据
+     *  Vacuum，回收表中已经删除的行
+     *  Unknown，命令不正确
+     */
+    enum Type {
+        Show = 0,
+        Show_Cache,
+        Tree,
+        Quit,
+        Clear,
+        Create_Database,
+        Drop_Database,
+        Use,
+        Create_Table,
+        Drop_Table,
+        Create_Index,
+        Select,
+        Delete,
+        Insert,
+        Update,
+        Show_Plans,
+        Prepare,
+        Execute,
+        Deallocate,
+        Declare,
+        Fetch,
+        Close,
+        Load,
+        Vacuum,
+        Unknown
+    };
+
+    /**
+     * @brief 语句中的一个参数 ?，记录执行的时候值要填到哪里
+     */
+    struct Param {
+        /**
+         * @brief 填入的位置
+         *  Value，m_values[m_index]
+         *  Where_Value，where中第m_index个谓词的值(between的下界)
+         *  Where_High，between的上界
+         *  Where_Like，like的值，填入之后再按有没有%确定是前缀匹配还是等值
+         *  Where_Item，in的第m_item个值
+         *  Limit，limit的行数
+         *  Offset，offset的行数
+         */
+        enum Target {
+            Value,
+            Where_Value,
+            Where_High,
+            Where_Like,
+            Where_Item,
+            Limit,
+            Offset,
+        };
+
+        Target m_target = Value;
+
+        /**
+         * @brief Value的时候是m_values的下标，其他的时候是where中谓词的下标
+         */
+        size_t m_index = 0;
+
+        /**
+         * @brief ? 在语句文本中的下标
+         */
+        size_t m_pos = 0;
+
+        /**
+         * @brief Where_Item的时候是in中值的下标
+         */
+        size_t m_item = 0;
+    };
+
+    /**
+     * @brief select中的一个聚合函数: count(*)，count/sum/min/max/avg(<column>)
+     */
+    struct Aggregate {
+        enum Func {
+            Count,
+            Sum,
+            Min,
+            Max,
+            Avg,
+        };
+
+        Func m_func = Count;
+
+        /**
+         * @brief 函数的参数列，count(*)的时候为空
+         */
+        std::string_view m_column;
+
+        /**
+         * @brief 在m_columns中的下标
+         */
+        size_t m_item = 0;
+    };
+
+    /**
+     * @brief order by中的一列
+     */
+    struct Order_Key {
+        /**
+         * @brief 列名，聚合查询中也可以是聚合函数的原文
+         */
+        std::string_view m_column;
+
+        /**
+         * @brief 是否降序
+         */
+        bool m_desc = false;
+    };
+
+    /**
+     * @brief create table中的一列
+     */
+    struct Column_Def {
+        std::string_view m_name;
+        std::string_view m_type;
+    };
+
+    Type m_type = Unknown;
+
+    /**
+     * @brief 数据库名(tree、create/drop database、use)、预备语句名(prepare、execute、deallocate)、
+     *  游标名(declare、fetch、close)或者表名(其他命令)
+     */
+    std::string_view m_name;
+
+    /**
+     * @brief select中join的另一张表，和on中等值连接的两列，列名可以带表名(a.x)，没有join的时候都为空
+     */
+    std::string_view m_join_name;
+    std::string_view m_join_left;
+    std::string_view m_join_right;
+
+    /**
+     * @brief create table的列
+     */
+    std::vector<Column_Def> m_column_defs;
+
+    /**
+     * @brief create index的索引名和索引类型，没有using的时候索引类型为空
+     */
+    std::string_view m_index_name;
+    std::string_view m_index_type;
+
+    /**
+     * @brief create index的列，update中set的列
+     */
+    std::string_view m_column;
+
+    /**
+     * @brief select要显示的列，为空表示 *，聚合函数的位置放的是它的原文，比如 count(*)
+     */
+    std::vector<std::string_view> m_columns;
+
+    /**
+     * @brief select中的聚合函数
+     */
+    std::vector<Aggregate> m_aggregates;
+
+    /**
+     * @brief group by的列
+     */
+    std::vector<std::string_view> m_group_columns;
+
+    /**
+     * @brief insert的值，update中set的值放在m_values[0]，execute的参数，fetch的行数放在m_values[0](没有写的时候为空)，
+     *  load的文件路径放在m_values[0]
+     */
+    std::vector<std::string_view> m_values;
+
+    /**
+     * @brief insert的行数，每一行的值个数相同，按顺序放在m_values中
+     */
+    size_t m_tuples = 0;
+
+    /**
+     * @brief 是否有where条件
+     */
+    bool m_has_where = false;
+
+    /**
+     * @brief where条件，还没有bind
+     */
+    Where_Expr m_where;
+
+    /**
+     * @brief order by的列，按优先级从高到低，为空表示不排序
+     */
+    std::vector<Order_Key> m_order_by;
+
+    /**
+     * @brief limit和offset的行数，没有写的时候为空
+     */
+    std::string_view m_limit;
+    std::string_view m_offset;
+
+    /**
+     * @brief 语句中的参数，按在文本中出现的顺序
+     */
+    std::vector<Param> m_params;
+
+    /**
+     * @brief prepare中as后面、declare中for后面的语句原文
+     */
+    std::string_view m_body;
+
+    /**
+     * @brief 按顺序把值填入参数的位置，值的生命周期要比语法树长
+     * @param  args，参数的值
+     * @return bool，个数不对或者like的值中%不在最后的时候返回false
+     */
+    bool bind(const std::vector<std::string_view>& args);
+
+    /**
+     * @brief 是否是可以缓存计划、可以prepare的增删改查语句
+     * @return bool
+     */
+    bool is_dml() const { return Select == m_type or Delete == m_type or Insert == m_type or Update == m_type; }
+
+    /**
+     * @brief 解析limit和offset的行数
+     * @param  offset，跳过的行数，没有写的时候是0
+     * @param  limit，最多返回的行数，没有写的时候是UINT64_MAX
+     * @return bool，不是合法的非负整数的时候返回false
+     */
+    bool limits(uint64_t& offset, uint64_t& limit) const;
+
+    /**
+     * @brief 是否是带聚合函数或者group by的select
+     * @return bool
+     */
+    bool is_aggregate() const { return !m_aggregates.empty() or !m_group_columns.empty(); }
+
+    /**
+     * @brief 是否是两张表join的select
+     * @return bool
+     */
+    bool is_join() const { return !m_join_name.empty(); }
+
+    /**
+     * @brief 清空，vector的容量留着给下一条命令用
+     */
+    void clear();
+};
+
+/**
+ * @brief 递归下降的语法分析器，每一种命令对应一个函数
+ */
+class Sql_Parser {
+public:
+    /**
+     * @brief 解析一条命令
+     * @param  text，命令字符串，语法树中的string_view指向它，所以它要活得比语法树长
+     * @param  statement，解析的结果，失败的时候m_type为Unknown
+     * @return bool，命令不正确的时候返回false
+     */
+    bool parse(std::string_view text, Statement& statement);
+
+    /**
+     * @brief 上一次解析失败的具体原因，为空表示只知道命令不正确
+     * @return const std::string&
+     */
+    const std::string& error() const { return m_error; }
+
+    /**
+     * @brief 把增删改查语句规范化成计划缓存的键: 词法单元之间用一个空格隔开，数字和带引号的值换成 ?
+     * @brief 只有形状相同、字面量不同的语句才会得到同一个键，这样它们可以共用一份解析好的语法树
+     * @param  text，命令字符串
+     * @param  key，规范化之后的文本
+     * @param  literals，被换掉的字面量，按出现的顺序，指向text
+     * @return bool，不是增删改查语句、有词法错误或者本来就带有参数的时候返回false
+     */
+    static bool normalize(std::string_view text, std::string& key, std::vector<std::string_view>& literals);
+
+private:
+    //***************************每一种命令的语法***************************
+
+    bool _parse_show(Statement& statement);
+    bool _parse_tree(Statement& statement);
+    bool _parse_create(Statement& statement);
+    bool _parse_drop(Statement& statement);
+    bool _parse_create_table(Statement& statement);
+    bool _parse_create_index(Statement& statement);
+    bool _parse_select(Statement& statement);
+    bool _parse_delete(Statement& statement);
+    bool _parse_insert(Statement& statement);
+    bool _parse_update(Statement& statement);
+    bool _parse_prepare(Statement& statement);
+    bool _parse_execute(Statement& statement);
+    bool _parse_declare(Statement& statement);
+    bool _parse_fetch(Statement& statement);
+    bool _parse_load(Statement& statement);
+
+    /**
+     * @brief select中的一项: <column> 或者 <func>(<column>|*)，text是这一项的原文
+     * @param  agg，是聚合函数的时候填进去，为nullptr的时候说明这里不能出现聚合函数
+     * @param  is_agg，是不是聚合函数
+     */
+    bool _parse_select_item(std::string_view& text, Statement::Aggregate* agg, bool& is_agg);
+
+    /**
+     * @brief 可选的where条件，解析到命令末尾或者group、order之前
+     */
+    bool _parse_opt_where(Statement& statement);
+
+    /**
+     * @brief where条件的表达式，优先级从低到高是 or、and、not，括号可以改变优先级，node是解析出来的结点的下标
+     */
+    bool _parse_or(Where_Expr::Tree& tree, int& node);
+    bool _parse_and(Where_Expr::Tree& tree, int& node);
+    bool _parse_not(Where_Expr::Tree& tree, int& node);
+
+    /**
+     * @brief 谓词: <column> <op> <value>，op是 = != <> < <= > >= 之一 / <column> [not] between <low> and <high> /
+     *  <column> [not] like <prefix>% / <column> [not] in (<value>, ...) / <column> is [not] null
+     */
+    bool _parse_condition(Where_Expr::Tree& tree, int& node);
+
+    //***************************取词法单元的辅助函数***************************
+
+    /**
+     * @brief 下一个是指定的单词就取出来
+     */
+    bool _accept_word(std::string_view word);
+
+    /**
+     * @brief 下一个是指定的符号就取出来
+     */
+    bool _accept_symbol(std::string_view symbol);
+
+    /**
+     * @brief 取出一个名字(单词)
+     */
+    bool _name(std::string_view& name);
+
+    /**
+     * @brief 取出一个值(单词、带引号的值或者参数)，是参数的时候记下它要填到哪里
+     */
+    bool _value(std::string_view& value, Statement::Param::Target target = Statement::Param::Value, size_t index = 0,
+                size_t item = 0);
+
+    /**
+     * @brief 后面不能再有东西了
+     */
+    bool _end();
+
+private:
+    /**
+     * @brief 命令字符串
+     */
+    std::string_view m_text;
+
+    /**
+     * @brief 词法分析器
+     */
+    Sql_Lexer m_lexer;
+
+    /**
+     * @brief 正在解析的语法树，记录参数用
+     */
+    Statement* m_statement = nullptr;
+
+    /**
+     * @brief 失败的原因
+     */
+    std::string m_error;
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file string_heap.h
+ * @brief 存放一个string列的所有值的内存池的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _STRING_HEAP_H_
+#define _STRING_HEAP_H_
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 一个string列的值: 字符串的内容按追加的顺序连续地放在大块的内存(chunk)中，每一行只记一个(地址, 长度)
+ *
+ *  不再是一个单元格一个std::string，追加一行不用单独申请内存，扫描的时候按行号顺序访问的也是连续的内存，
+ *  释放整列只需要释放几个大块
+ *
+ *  写进块中的字节不会再被修改，修改一个单元格是把新值追加在后面，旧值变成垃圾，垃圾比有用的数据还多的时候整理一次；
+ *  拷贝的时候新旧两份共享已经写好的块，之后各自追加到自己新申请的块中
+ *
+ *  块也可以是别人的只读内存(比如映射的表文件)，这时候值直接指向它，不拷贝，修改和整理的时候才拷贝到自己的块中
+ */
+class String_Heap {
+public:
+    /**
+     * @brief 一块的大小，超过它的四分之一的字符串单独放一块
+     */
+    static constexpr size_t chunk_size = 64 << 10;
+
+    String_Heap() = default;
+    String_Heap(const String_Heap& other);
+    String_Heap(String_Heap&& other) noexcept;
+    String_Heap& operator=(const String_Heap& other);
+    String_Heap& operator=(String_Heap&& other) noexcept;
+    ~String_Heap() = default;
+
+    /**
+     * @brief 行数
+     */
+    size_t size() const { return m_slots.size(); }
+
+    bool empty() const { return m_slots.empty(); }
+
+    /**
+     * @brief 一行的值，指向块中的内存，修改这一列之后就不能再用了
+     * @param  row，行号
+     * @return const std::string_view&
+     */
+    const std::string_view& operator[](size_t row) const { return m_slots[row]; }
+
+    /**
+     * @brief 所有行的值，按行号连续存放，批量过滤的时候直接按下标访问
+     */
+    const std::string_view* data() const { return m_slots.data(); }
+
+    /**
+     * @brief 预留行数
+     * @param  rows，行数
+     */
+    void reserve(size_t rows) { m_slots.reserve(rows); }
+
+    /**
+     * @brief 在末尾添加一个值，内容拷贝到块中
+     * @param  str，值
+     */
+    void push_back(std::string_view str) {
+        m_slots.push_back(_store(str));
+        m_bytes += str.size();
+    }
+
+    /**
+     * @brief 在末尾添加一个值，不拷贝内容，直接指向一块共享的只读内存，这一块一直被这一列持有
+     * @param  str，值，必须在chunk里面
+     * @param  chunk，str所在的那一块内存，连续添加同一块中的值的时候只记一次
+     */
+    void push_back_shared(std::string_view str, const std::shared_ptr<char[]>& chunk) {
+        if (m_chunks.empty() or m_chunks.back() != chunk)
+            m_chunks.push_back(chunk);
+        m_slots.push_back(str);
+        // 共享的块只算这一列用到的部分，整理之后就不再持有它
+        m_bytes += str.size();
+        m_heap_bytes += str.size();
+    }
+
+    /**
+     * @brief 修改一行的值
+     * @param  row，行号
+     * @param  str，新的值
+     */
+    void set(size_t row, std::string_view str);
+
+    /**
+     * @brief 把另一列的所有值接在末尾，只共享它的块，不拷贝内容
+     * @param  other，另一列
+     */
+    void append(const String_Heap& other);
+
+    /**
+     * @brief 删除若干行，剩下的行往前挪，垃圾多了就整理
+     * @param  rows，要删除的行号，升序
+     */
+    void erase(const std::vector<size_t>& rows);
+
+    /**
+     * @brief 删除所有的行，释放所有的块
+     */
+    void clear();
+
+    /**
+     * @brief 这一列占用的内存，包括每一行的(地址, 长度)和所有的块
+     * @return size_t
+     */
+    size_t memory() const { return m_slots.capacity() * sizeof(std::string_view) + m_heap_bytes; }
+
+private:
+    /**
+     * @brief 把内容拷贝到块中，返回指向它的值
+     */
+    std::string_view _store(std::string_view str);
+
+    /**
+     * @brief 垃圾比有用的数据还多的时候，把还在用的值按行号顺序拷贝到新的块中，释放旧的块
+     */
+    void _compact_if_needed();
+
+    /**
+     * @brief 每一行的值
+     */
+    std::vector<std::string_view> m_slots;
+
+    /**
+     * @brief 所有的块，拷贝出来的列共享同一个块
+     */
+    std::vector<std::shared_ptr<char[]>> m_chunks;
+
+    /**
+     * @brief 当前块中还没有用的部分，只有自己申请的块才往里面追加
+     */
+    char* m_tail = nullptr;
+    size_t m_free = 0;
+
+    /**
+     * @brief 所有行的值的总长度和所有块的总大小，两者之差就是垃圾
+     */
+    size_t m_bytes = 0;
+    size_t m_heap_bytes = 0;
+};
+
+#endif
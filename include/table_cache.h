@@ -0,0 +1,306 @@
+/**
+ * @file table_cache.h
+ * @brief 服务端全局共享的表缓存的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _TABLE_CACHE_H_
+#define _TABLE_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "server_table.h"
+
+namespace Table_File {
+class Scanner;
+}
+
+/**
+ * @brief 一张表的锁，按表文件的路径从缓存中拿，所有连接共用
+ *  m_writer，delete、insert、update和load从读表到标记脏表一直持有，同一张表上的修改一条一条来，不同的表可以同时改
+ *  m_rows，只在真正改内存中的表(结束旧版本、追加新版本、插索引)的时候独占；读表的语句只在碰表的内存的时候共享，
+ *          防止读到一半vector扩容；读到哪些行由快照(MVCC)决定，两批之间被修改也不影响
+ */
+struct Table_Latch {
+    std::mutex m_writer;
+    std::shared_mutex m_rows;
+};
+
+/**
+ * @brief 一条select读到的若干张表的m_rows，按地址的顺序一起拿共享锁，不会和别的语句互相等待，
+ *  可以直接给std::shared_lock用
+ */
+class Read_Latches {
+public:
+    /**
+     * @brief 加入一张表的锁，同一张表只拿一次
+     * @param  latch，表的锁
+     */
+    void add(std::shared_ptr<Table_Latch> latch);
+
+    void lock_shared();
+    void unlock_shared();
+
+private:
+    std::vector<std::shared_ptr<Table_Latch>> m_latches;
+};
+
+/**
+ * @brief 缓存解析好的表，键是表文件的路径(data_prefix + 数据库名 + 表名)，所有命令共用一份
+ * @brief 按LRU淘汰，修改过的表(脏表)在被淘汰或者flush的时候才写回磁盘
+ * @brief 表上的索引跟着表一起加载、一起写回，内存也算在表的头上
+ * @brief 删除和update留下的旧版本写回的时候不重写整个文件，只在文件末尾追加删除位图页；
+ *        旧版本的比例超过阈值之后在flush或者淘汰的时候回收(整理成只有最新版本的文件)，vacuum可以马上回收，
+ *        这时候还有游标持有这张表的话就留到下一次
+ */
+class Table_Cache {
+public:
+    /**
+     * @brief 缓存的统计信息，用来调整缓存大小
+     */
+    struct Stats {
+        size_t m_hits = 0;
+        size_t m_misses = 0;
+        size_t m_evictions = 0;
+        size_t m_write_backs = 0;
+        size_t m_tables = 0;
+        size_t m_used_bytes = 0;
+        size_t m_budget_bytes = 0;
+    };
+
+    /**
+     * @brief 默认的内存预算，64MB
+     */
+    static constexpr size_t default_budget = 64ul << 20;
+
+    /**
+     * @brief 默认的回收阈值，旧版本占全部行数的百分比
+     */
+    static constexpr size_t default_vacuum_percent = 20;
+
+public:
+    /**
+     * @brief 整个服务端只有一个缓存
+     * @return Table_Cache&
+     */
+    static Table_Cache& instance();
+
+    /**
+     * @brief 设置内存预算，超出的部分会马上淘汰
+     * @param  bytes，字节数
+     */
+    void set_budget(size_t bytes);
+
+    /**
+     * @brief 设置回收阈值，flush或者淘汰的时候旧版本的行数达到全部行数的这个百分比才回收，为0的时候有旧版本就回收
+     * @param  percent，百分比
+     */
+    void set_vacuum_percent(size_t percent);
+
+    /**
+     * @brief 拿到一张表，不在缓存中就从磁盘读进来；调用之前需要确认表文件存在
+     * @param  path，表文件路径
+     * @return std::shared_ptr<Table>，即使这张表随后被淘汰，拿到的指针也一直有效
+     */
+    std::shared_ptr<Table> get(const std::string& path);
+
+    /**
+     * @brief 只拿表名和字段，表在缓存中就不用读磁盘
+     * @param  path，表文件路径
+     * @return Table，其中没有数据，索引只有定义
+     */
+    Table get_schema(const std::string& path);
+
+    /**
+     * @brief 表不在缓存中的时候按页读表文件，不读进缓存；在缓存中的话文件可能不是最新的，要用get
+     * @param  path，表文件路径
+     * @param  scanner，打开在表文件上
+     * @return bool，表在缓存中或者文件不能按页读的时候返回false
+     */
+    bool scan(const std::string& path, Table_File::Scanner& scanner);
+
+    /**
+     * @brief 修改了get拿到的表之后调用，标记为脏表，等到淘汰或者flush的时候再写回
+     * @brief 如果这张表已经不在缓存中(比如比整个预算还大)，或者缓存中的已经是期间被淘汰之后重新读进来的另一份，
+     *        就直接整表写回，并且丢掉缓存中过时的那一份；调用的时候需要持有这张表的m_writer
+     * @param  path，表文件路径
+     * @param  table，修改过的表
+     * @param  rewrite，是否需要整表写回；delete和update只结束旧版本、在末尾追加新版本，写回的时候只追加，不需要重写
+     */
+    void mark_dirty(const std::string& path, const std::shared_ptr<Table>& table, bool rewrite = true);
+
+    /**
+     * @brief 插入若干行，表在缓存中就插到缓存里面(写回的时候只追加新行)，否则等这条WAL记录落盘之后直接追加到文件末尾；
+     *        调用的时候需要持有这张表的m_writer
+     * @param  path，表文件路径
+     * @param  rows，字段和表相同、已经检查过值的若干行
+     * @param  lsn，这次插入对应的WAL记录的LSN
+     */
+    void append_rows(const std::string& path, const Table& rows, uint64_t lsn);
+
+    /**
+     * @brief 删除表的时候调用，直接丢掉缓存，不写回
+     * @param  path，表文件路径
+     */
+    void erase(const std::string& path);
+
+    /**
+     * @brief 拿到一张表的锁，不管表在不在缓存中都是同一个，删除表的时候丢掉
+     * @param  path，表文件路径
+     * @return std::shared_ptr<Table_Latch>
+     */
+    std::shared_ptr<Table_Latch> latch(const std::string& path);
+
+    /**
+     * @brief 马上回收一张表的旧版本，整理成只有最新版本的表文件，不管有没有达到阈值
+     * @param  path，表文件路径
+     * @param  rows，回收的行数
+     * @return bool，还有语句或者游标持有这张表、不能回收的时候返回false
+     */
+    bool vacuum(const std::string& path, size_t& rows);
+
+    /**
+     * @brief 旧版本达到阈值的表回收旧版本，然后把脏表写回磁盘
+     * @param  prefix，只写回路径以它开头的表，默认为全部，检查点的时候用来只写回一个数据库的表
+     */
+    void flush_all(const std::string& prefix = std::string());
+
+    /**
+     * @brief 拿到统计信息
+     * @return Stats
+     */
+    Stats stats();
+
+private:
+    /**
+     * @brief 单例，不允许外面构造
+     */
+    Table_Cache() = default;
+
+    /**
+     * @brief 缓存中的一项
+     */
+    struct Entry {
+        /**
+         * @brief 解析好的表
+         */
+        std::shared_ptr<Table> m_table;
+
+        /**
+         * @brief 在LRU链表中的位置
+         */
+        std::list<std::string>::iterator m_lru_pos;
+
+        /**
+         * @brief 估算的内存占用
+         */
+        size_t m_bytes = 0;
+
+        /**
+         * @brief 磁盘上已经有的行数，写回的时候如果只有追加，只需要追加这之后的行
+         */
+        size_t m_flushed_rows = 0;
+
+        /**
+         * @brief 磁盘上的表文件的LSN，结束LSN比它大的旧版本是写回之后才删除的，下次写回的时候要记到删除位图中
+         */
+        uint64_t m_flushed_lsn = 0;
+
+        /**
+         * @brief 读进来或者上次写回之后是否被修改过，不能从行数和LSN推断: 表文件和日志中的LSN不一定对得上
+         */
+        bool m_dirty = false;
+
+        /**
+         * @brief 是否有除了追加以外的修改，有的话需要整表写回
+         */
+        bool m_modified = false;
+    };
+
+    /**
+     * @brief 估算一张表占用的内存
+     */
+    static size_t _table_bytes(const Table& table);
+
+    /**
+     * @brief 把一项写回磁盘(如果是脏的)，调用的时候需要持有锁；旧版本达到回收阈值并且没有人持有这张表的时候先回收
+     * @brief 先保证表中包含的WAL记录已经落盘，再写表文件(先写日志)；写的期间拿着表的m_rows共享锁，别的连接改不了它
+     */
+    void _write_back(const std::string& path, Entry& entry);
+
+    /**
+     * @brief 回收不在缓存中的表的旧版本: 读出表文件，去掉旧版本之后整表写回，调用的时候需要持有锁
+     * @return size_t，回收的行数
+     */
+    size_t _vacuum_file(const std::string& path);
+
+    /**
+     * @brief 拿到一张表的锁，没有就新建，调用的时候需要持有锁
+     */
+    std::shared_ptr<Table_Latch> _latch(const std::string& path);
+
+    /**
+     * @brief 没有语句或者游标持有这张表的时候，把已经结束了的旧版本真正删掉并且重建索引，调用的时候需要持有锁
+     */
+    void _purge(Entry& entry);
+
+    /**
+     * @brief 淘汰最久没用的表，直到内存占用不超过预算，调用的时候需要持有锁
+     */
+    void _evict();
+
+    /**
+     * @brief 把这一项移动到LRU链表头部，调用的时候需要持有锁
+     */
+    void _touch(Entry& entry);
+
+private:
+    /**
+     * @brief 保护下面所有的成员
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief 路径到缓存项的映射
+     */
+    std::unordered_map<std::string, Entry> m_entries;
+
+    /**
+     * @brief LRU链表，头部是最近使用的
+     */
+    std::list<std::string> m_lru;
+
+    /**
+     * @brief 内存预算
+     */
+    size_t m_budget = default_budget;
+
+    /**
+     * @brief 回收阈值
+     */
+    size_t m_vacuum_percent = default_vacuum_percent;
+
+    /**
+     * @brief 统计信息
+     */
+    Stats m_stats;
+
+    /**
+     * @brief 每张表的锁，淘汰的时候不丢，写回的时候也要拿
+     */
+    std::unordered_map<std::string, std::shared_ptr<Table_Latch>> m_latches;
+};
+
+#endif
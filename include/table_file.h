@@ -0,0 +1,276 @@
+/**
+ * @file table_file.h
+ * @brief 表文件的二进制页式存储格式(读写器)的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _TABLE_FILE_H_
+#define _TABLE_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief 表文件的格式如下(所有整数都是本机字节序，也就是小端):
+ *
+ *  | File_Header(64字节) | 模式块(schema) | 填充到页对齐 | 页0 | 页1 | ... |
+ *
+ *  模式块: u32表名长度 + 表名，u32列数，然后每列 u32名称长度 + 名称 + u32类型长度 + 类型
+ *          版本2开始后面接着 u32索引个数，然后每个索引 索引名 + 列名 + 索引类型(都是u32长度 + 字符串)
+ *
+ *  每个页都是定长的page_size字节(一行放不下一个页的时候，这个页会连续占用多个物理页，称为跨度span)
+ *
+ *  | Page_Header | Slot[0] Slot[1] ... -> 空闲空间 <- ... 行1 行0 |
+ *
+ *  槽(Slot)从页头后面往后长，行数据从页尾往前长，每一行是按列依次存放的，string列是 u32长度 + 值，
+ *  int列是8字节的int64(版本3开始，之前也是 u32长度 + 十进制字符串)
+ *  这样读取的时候不需要按行fgets，值里面出现 '\n' 或者超过 BUFSIZ 也不会把表弄坏
+ *
+ *  版本4开始还有删除位图页(页头中的种类是Delete_Page):
+ *
+ *  | Page_Header | u64起始行号 | 位图 |
+ *
+ *  页头中的m_slot_count是这个页覆盖的行数，第i位是1表示第(起始行号 + i)行已经被删除(墓碑)，
+ *  行号是所有放行的页中的槽按顺序编的号，被删除的行仍然占着自己的槽，所以行号不会变；
+ *  delete和update写回的时候只需要在文件末尾追加几个位图页，不用重写整个文件，等到vacuum的时候才真正删掉这些行；
+ *  位图页不影响行号，读的时候看完所有的页再标记，所以最后一个放行的页后面有位图页也可以接着往里面放行，新的页接在文件末尾
+ */
+namespace Table_File {
+/**
+ * @brief 文件魔数，"HSQL"
+ */
+constexpr uint32_t magic = 0x4C515348;
+
+/**
+ * @brief 当前的格式版本号，修改格式之后需要递增
+ */
+constexpr uint16_t version = 4;
+
+/**
+ * @brief 默认的页大小
+ */
+constexpr uint32_t default_page_size = 4096;
+
+/**
+ * @brief 文件头，定长64字节，放在文件的最开头
+ */
+struct File_Header {
+    /**
+     * @brief 魔数，用来区分新旧两种格式
+     */
+    uint32_t m_magic;
+
+    /**
+     * @brief 格式版本号
+     */
+    uint16_t m_version;
+
+    /**
+     * @brief 保留，对齐用
+     */
+    uint16_t m_reserved;
+
+    /**
+     * @brief 页大小
+     */
+    uint32_t m_page_size;
+
+    /**
+     * @brief 模式块的字节数
+     */
+    uint32_t m_schema_size;
+
+    /**
+     * @brief 第一个页在文件中的偏移，按页大小对齐
+     */
+    uint64_t m_data_offset;
+
+    /**
+     * @brief 物理页的总个数，文件大小 = m_data_offset + m_page_count * m_page_size
+     */
+    uint64_t m_page_count;
+
+    /**
+     * @brief 最后一个放行的页的起始物理页号，追加的时候接着往里面放(原地重写)，它后面可以有删除位图页；
+     * @brief 没有放行的页的时候为UINT64_MAX，这时候追加要开新页
+     */
+    uint64_t m_last_page;
+
+    /**
+     * @brief 表中的总行数，包括被删除的行
+     */
+    uint64_t m_row_count;
+
+    /**
+     * @brief 文件中已经包含的最后一条WAL记录的LSN，恢复的时候跳过不大于它的记录
+     */
+    uint64_t m_lsn;
+
+    /**
+     * @brief 最后一个页中有效的行数，追加写到一半挂掉的时候，页头中多出来的槽不算数
+     */
+    uint64_t m_last_page_rows;
+};
+
+static_assert(64 == sizeof(File_Header), "File_Header必须是64字节");
+
+/**
+ * @brief 页的种类
+ *  Row_Page，放行的页
+ *  Delete_Page，删除位图页
+ */
+enum Page_Kind : uint32_t { Row_Page = 0, Delete_Page = 1 };
+
+/**
+ * @brief 页头，放在每个页的最开头
+ */
+struct Page_Header {
+    /**
+     * @brief 这个页里面的行数，也就是槽的个数，删除位图页中是覆盖的行数
+     */
+    uint32_t m_slot_count;
+
+    /**
+     * @brief 行数据区的起始位置(相对页首的偏移)，行数据从页尾往前长
+     */
+    uint32_t m_free_end;
+
+    /**
+     * @brief 这个页占用的物理页个数，一般为1，放超大行的时候大于1
+     */
+    uint32_t m_span;
+
+    /**
+     * @brief 页的种类(Page_Kind)，版本4之前都是0
+     */
+    uint32_t m_kind;
+};
+
+/**
+ * @brief 页内的槽，记录一行在页内的位置
+ */
+struct Slot {
+    /**
+     * @brief 行数据相对页首的偏移
+     */
+    uint32_t m_offset;
+
+    /**
+     * @brief 行数据的字节数
+     */
+    uint32_t m_length;
+};
+
+/**
+ * @brief 把表按照页式格式写入文件，先写临时文件然后rename，写到一半挂掉也不会把原来的表弄坏
+ * @brief 表的m_lsn会一起写入文件头，已经结束了的旧版本也写，但是记在删除位图页中，文件中的行号和内存中的一致
+ * @param  table，需要写入的表
+ * @param  path，表文件路径
+ * @param  page_size，页大小
+ */
+void write(const Table& table, const std::string& path, uint32_t page_size = default_page_size);
+
+/**
+ * @brief 从文件读取表，如果不是新格式(没有魔数)，则按照旧的按行存储的格式读取
+ * @brief 被删除的行也读进来，作为在所有快照中都不可见的旧版本(结束LSN为0)，行号和文件中的一致
+ * @brief string列的值不拷贝，指向文件的只读映射，表(和它的拷贝)活着的时候映射一直在，修改一行的时候才拷贝
+ * @param  path，表文件路径
+ * @return Table
+ */
+Table read(const std::string& path);
+
+/**
+ * @brief 只读取文件头和模式块，得到表名和所有的列，不读取任何数据
+ * @brief 如果是旧格式的文件，会顺便把它转换成新格式，因为旧格式没办法追加
+ * @param  path，表文件路径
+ * @return Table，m_data为空
+ */
+Table read_schema(const std::string& path);
+
+/**
+ * @brief 把若干行追加到表文件的末尾，再追加记录新删除的行的位图页，只读写最后一个放行的页和文件头，不读取已有的行
+ * @brief 版本3之前的文件会先整个转换成新格式
+ * @param  path，表文件路径
+ * @param  table，和文件字段相同的表，追加其中从first_row开始的行
+ * @param  first_row，第一个要追加的行号
+ * @param  deleted，上次写回之后新删除的行号，升序，可以包括这次追加的行；
+ *                  只有table是整张表、文件中正好有first_row行的时候才能不为空
+ * @param  lsn，这次追加对应的WAL记录的LSN，写入文件头
+ */
+void append_rows(const std::string& path, const Table& table, size_t first_row, const std::vector<size_t>& deleted,
+                 uint64_t lsn);
+
+/**
+ * @brief 按页的顺序读表文件中的行，一次只解析要的那么多行，不把整张表读进内存，被删除的行直接跳过
+ * @brief 打开的时候映射整个文件，先看一遍所有的页头，收集删除位图页中的行号，不解析任何行
+ * @brief string列的值指向映射，读出来的行活着的时候映射一直在；之后的追加写不改已有的行，整表写回是rename，都不影响读到的内容
+ */
+class Scanner : public Row_Source {
+public:
+    /**
+     * @brief 打开表文件
+     * @param  path，表文件路径
+     * @return bool，旧格式或者版本3之前的文件不能按页读，返回false
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 表名、字段和索引的定义，没有行
+     * @return const Table&
+     */
+    const Table& schema() const override { return m_schema; }
+
+    /**
+     * @brief 接着往后读最多rows个没有被删除的行，追加到out的末尾
+     * @param  out，字段和schema()一样的表
+     * @param  rows，最多读的行数
+     * @return size_t，读到的行数，为0表示已经读完了
+     */
+    size_t next(Table& out, size_t rows) override;
+
+private:
+    std::string m_path;
+    File_Header m_header = {};
+
+    /**
+     * @brief 文件的只读映射
+     */
+    const char* m_data = nullptr;
+    std::shared_ptr<char[]> m_chunk;
+
+    Table m_schema;
+
+    /**
+     * @brief 被删除的行号，升序，和下一个还没有经过的
+     */
+    std::vector<size_t> m_deleted;
+    size_t m_next_deleted = 0;
+
+    /**
+     * @brief 下一个要读的行: 所在的物理页号，页中的槽，文件中的行号
+     */
+    uint64_t m_page_no = 0;
+    uint32_t m_slot = 0;
+    uint64_t m_row = 0;
+};
+
+/**
+ * @brief 计算一行编码之后的字节数
+ * @param  table，表
+ * @param  row，行号
+ * @return size_t
+ */
+size_t encoded_row_size(const Table& table, size_t row);
+
+}  // namespace Table_File
+
+#endif
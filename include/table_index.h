@@ -0,0 +1,163 @@
+/**
+ * @file table_index.h
+ * @brief 维护一张表上所有索引的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _TABLE_INDEX_H_
+#define _TABLE_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief 表上的索引跟着表一起在缓存中，读表的时候加载，写回表的时候写回
+ * @brief 索引文件和表文件放在同一个目录下，名字是 <表名>.<索引名>.idx
+ * @brief 修改表的命令改完数据之后调用这里的函数同步索引，保证索引中的行号和m_data的下标一致
+ */
+namespace Table_Index {
+/**
+ * @brief 索引文件的后缀
+ */
+const std::string suffix = ".idx";
+
+/**
+ * @brief 检查索引类型的名字是否支持
+ * @param  type，hash或者btree
+ * @return bool
+ */
+bool valid_type(const std::string& type);
+
+/**
+ * @brief 索引文件的路径
+ * @param  table_path，表文件路径
+ * @param  index_name，索引名
+ * @return std::string
+ */
+std::string file_path(const std::string& table_path, const std::string& index_name);
+
+/**
+ * @brief 从磁盘读表之后调用，加载索引文件，和表对不上的话重新建
+ * @param  table，刚读出来的表
+ * @param  table_path，表文件路径
+ */
+void attach(Table& table, const std::string& table_path);
+
+/**
+ * @brief 在某一列上建一个新的索引，调用之前需要检查索引名和列
+ * @param  table，表
+ * @param  index，索引的定义
+ */
+void create(Table& table, Index_Info index);
+
+/**
+ * @brief 把所有的索引写入索引文件，写回表文件之后调用
+ * @brief 旧版本也在表文件中(记在删除位图中)，行号和内存中的一致，索引中也有旧版本的行，查的时候再按快照过滤
+ * @param  table，表
+ * @param  table_path，表文件路径
+ */
+void save(const Table& table, const std::string& table_path);
+
+/**
+ * @brief 删除表的时候调用，删除所有的索引文件
+ * @param  table，表(只需要模式)
+ * @param  table_path，表文件路径
+ */
+void remove(const Table& table, const std::string& table_path);
+
+/**
+ * @brief 在表的末尾插入一行之后调用
+ * @param  table，表
+ * @param  row，新行的行号
+ */
+void insert_row(Table& table, size_t row);
+
+/**
+ * @brief 在表的末尾追加了若干行之后调用(update追加新版本)，追加的行多的时候直接重建
+ * @param  table，表
+ * @param  first_row，追加的第一行的行号
+ */
+void insert_rows(Table& table, size_t first_row);
+
+/**
+ * @brief 真正删除旧版本之后行号都变了，调用它重新建所有的索引
+ * @param  table，表
+ */
+void rebuild(Table& table);
+
+/**
+ * @brief 用索引做等值查找
+ * @param  table，表
+ * @param  column，条件中的列的下标
+ * @param  value，条件中的值
+ * @param  rows，满足条件的行号，哈希索引是升序，B+树索引是按键的顺序
+ * @return bool，这一列上没有索引的时候返回false，需要全表扫描
+ */
+bool lookup(const Table& table, int column, const std::string& value, std::vector<size_t>& rows);
+
+/**
+ * @brief 用B+树索引做范围查找
+ * @param  table，表
+ * @param  column，条件中的列的下标
+ * @param  low，下界，nullptr表示没有下界
+ * @param  low_inclusive，是否包含下界
+ * @param  high，上界，nullptr表示没有上界
+ * @param  high_inclusive，是否包含上界
+ * @param  rows，满足条件的行号，按键的顺序
+ * @return bool，这一列上没有B+树索引的时候返回false，需要全表扫描
+ */
+bool range(const Table& table, int column, const std::string* low, bool low_inclusive, const std::string* high, bool high_inclusive,
+           std::vector<size_t>& rows);
+
+/**
+ * @brief 用B+树索引做前缀查找，只支持string列
+ * @param  table，表
+ * @param  column，条件中的列的下标
+ * @param  prefix，前缀
+ * @param  rows，满足条件的行号，按键的顺序
+ * @return bool，这一列上没有B+树索引或者不是string列的时候返回false，需要全表扫描
+ */
+bool prefix(const Table& table, int column, const std::string& prefix, std::vector<size_t>& rows);
+
+/**
+ * @brief 某一列上是否有索引，哈希索引和B+树索引都算
+ * @param  table，表
+ * @param  column，列的下标
+ * @return bool
+ */
+bool has_index(const Table& table, int column);
+
+/**
+ * @brief 某一列上是否有B+树索引
+ * @param  table，表
+ * @param  column，列的下标
+ * @return bool
+ */
+bool has_btree(const Table& table, int column);
+
+/**
+ * @brief 用B+树索引按某一列的顺序拿到所有的行，order by的时候就不用排序了
+ * @param  table，表
+ * @param  column，排序的列的下标
+ * @param  rows，所有的行号，按这一列升序
+ * @return bool，这一列上没有B+树索引的时候返回false
+ */
+bool ordered(const Table& table, int column, std::vector<size_t>& rows);
+
+/**
+ * @brief 估算所有索引占用的内存
+ * @param  table，表
+ * @return size_t
+ */
+size_t bytes(const Table& table);
+
+}  // namespace Table_Index
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * @file thread_pool.h
+ * @brief 执行命令的工作线程池的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 固定个数的工作线程，从一个任务队列中取任务执行
+ * @brief epoll线程只负责收发数据，命令放到这里执行，一条慢的查询不会卡住其他的连接
+ */
+class Thread_Pool {
+public:
+    /**
+     * @brief 构造函数，马上启动工作线程
+     * @param  threads，线程个数，至少一个
+     */
+    explicit Thread_Pool(size_t threads);
+
+    Thread_Pool(const Thread_Pool&) = delete;
+    Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+    /**
+     * @brief 析构函数，调用stop
+     */
+    ~Thread_Pool();
+
+    /**
+     * @brief 放入一个任务，由某个空闲的工作线程执行
+     * @param  job，任务
+     */
+    void submit(std::function<void()> job);
+
+    /**
+     * @brief 把编号为0到tasks-1的任务分给工作线程和调用者一起做，都做完才返回
+     *  调用者自己也从同一个计数器中领任务，所以在工作线程中调用、其他工作线程都在忙的时候也不会卡住，只是变成调用者一个人做
+     * @param  tasks，任务个数
+     * @param  task，task(编号)，会被多个线程同时调用
+     */
+    void parallel_for(size_t tasks, const std::function<void(size_t)>& task);
+
+    /**
+     * @brief 等队列中的任务都执行完，然后结束所有的工作线程，之后不能再submit
+     */
+    void stop();
+
+    /**
+     * @brief 线程个数
+     * @return size_t
+     */
+    size_t size() const { return m_threads.size(); }
+
+private:
+    /**
+     * @brief 工作线程的主循环
+     */
+    void _work();
+
+private:
+    /**
+     * @brief 保护任务队列和m_stop
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief 有新任务或者要停止的时候通知工作线程
+     */
+    std::condition_variable m_cv;
+
+    /**
+     * @brief 任务队列
+     */
+    std::deque<std::function<void()>> m_jobs;
+
+    /**
+     * @brief 是否要停止
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief 工作线程
+     */
+    std::vector<std::thread> m_threads;
+};
+
+#endif
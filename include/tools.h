@@ -26,8 +26,9 @@ namespace Tools {
 /**
  * @brief 打开对应位置的文件，并且将里面的内容打印出来，定义成为extern，因为两个源文件都需要使用
  * @param  path，文件对应的目录，可能是绝对路径，也可能是相对路径
+ * @param  out，打印到哪里，客户端打印到屏幕，服务端写到返回给客户端的结果中
  */
-void open_and_print(const std::string& path);
+void open_and_print(const std::string& path, std::ostream& out = std::cout);
 
 /**
  * @brief 给定指定的字符串，按照指定的字符进行切割，类似于python的spilt函数
@@ -55,18 +56,40 @@ bool check_has_any(const std::string& str, const std::vector<char>& chs);
 /**
  * @brief 将Table对象的表对象按照某种方式写入文件，方便后续的读取
  * @brief 由于我们的表里面含有vector，没办法确定大小，所以新实例化的Table对象指针没办法定位终点的位置，直接读内存溢出，段错误
+ * @brief 现在写成二进制的页式格式(见table_file.h)，值里面可以包含任意字符
  * @param  table，需要写入文件的对象
  * @param  path，写入的文件路径
  */
 void write_table_to_file(const Table& table, const std::string& path);
 
 /**
- * @brief 从表文件中读取表，并且返回结构体存储的表
+ * @brief 从表文件中读取表，并且返回结构体存储的表，旧的按行存储的.dat文件也能读
  * @param  path，表文件的路径
  * @return Table
  */
 Table read_table_from_file(const std::string& path);
 
+/**
+ * @brief 只读取表文件的表名和字段，不读取数据，插入的时候用它来检查字段个数
+ * @param  path，表文件的路径
+ * @return Table，其中没有数据
+ */
+Table read_schema_from_file(const std::string& path);
+
+/**
+ * @brief 把若干行数据追加到表文件末尾，不需要把整张表读出来再写回去
+ * @param  rows，需要追加的行，字段和表文件相同
+ * @param  path，表文件的路径
+ * @param  lsn，这次插入对应的WAL记录的LSN
+ */
+void append_rows_to_file(const Table& rows, const std::string& path, uint64_t lsn);
+
+/**
+ * @brief 把文件和它所在目录的目录项都fsync到磁盘上，写表文件是写临时文件再rename，目录项也要落盘
+ * @param  path，文件路径
+ */
+void sync_file(const std::string& path);
+
 }  // namespace Tools
 
 #endif
@@ -0,0 +1,238 @@
+/**
+ * @file wal.h
+ * @brief 每个数据库一份的预写日志(WAL)的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _WAL_H_
+#define _WAL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief 预写日志，存放在数据库目录下的redo.wal中
+ *
+ *  | 文件头(魔数, 版本, 起始LSN) | 记录 | 记录 | ... |
+ *
+ *  每条记录: u32长度 + u32校验和 + (u64 LSN, u32长度 + 表名, u32长度 + 命令)
+ *
+ *  记录的是修改表的命令本身(逻辑重做日志)，恢复的时候按LSN的顺序重新执行一遍，
+ *  表文件头中记录了它已经包含的最后一个LSN，不大于它的记录直接跳过
+ *
+ *  修改的流程: write_guard() -> append() -> 修改缓存中的表 -> 释放guard -> wait_durable()
+ *  wait_durable()并不自己调用fsync，而是交给后台的刷盘线程，同一时间等待的多个提交只需要一次fsync(组提交)
+ */
+class Wal {
+public:
+    /**
+     * @brief 一条日志记录
+     */
+    struct Record {
+        uint64_t m_lsn;
+        std::string m_table;
+        std::string m_command;
+    };
+
+    /**
+     * @brief 日志文件名
+     */
+    static const std::string file_name;
+
+    /**
+     * @brief 日志超过这个大小之后做一次检查点
+     */
+    static constexpr size_t checkpoint_bytes = 16ul << 20;
+
+public:
+    /**
+     * @brief 拿到某个数据库的日志，第一次使用的时候打开(或者创建)日志文件
+     * @param  db_dir，数据库目录，data_prefix + 数据库名
+     * @return Wal&
+     */
+    static Wal& for_database(const std::string& db_dir);
+
+    /**
+     * @brief 拿到表所在数据库的日志
+     * @param  table_path，表文件路径
+     * @return Wal&
+     */
+    static Wal& for_table(const std::string& table_path);
+
+    /**
+     * @brief 设置组提交的等待时间，刷盘线程被唤醒之后先等这么久再fsync，让更多的提交攒到一起
+     * @brief 越大吞吐越高，但是单个提交的延迟也越高，默认为0
+     * @param  us，微秒
+     */
+    static void set_group_commit_delay(unsigned us);
+
+    /**
+     * @brief 对所有打开的日志做检查点
+     */
+    static void checkpoint_all();
+
+    /**
+     * @brief 删除数据库的时候调用，关闭并删除日志文件
+     * @param  db_dir，数据库目录
+     */
+    static void remove(const std::string& db_dir);
+
+    /**
+     * @brief 停止刷盘线程，把还没写的日志写完
+     */
+    ~Wal();
+
+public:
+    /**
+     * @brief 修改表的时候从写日志到修改完缓存都要持有，检查点会等这些修改完成
+     * @return std::shared_lock<std::shared_mutex>
+     */
+    std::shared_lock<std::shared_mutex> write_guard() { return std::shared_lock<std::shared_mutex>(m_write_lock); }
+
+    /**
+     * @brief 追加一条记录，只放进内存缓冲区，返回分配的LSN
+     * @param  table，表名
+     * @param  command，修改表的命令
+     * @return uint64_t
+     */
+    uint64_t append(const std::string& table, const std::string& command);
+
+    /**
+     * @brief 阻塞等待直到LSN不大于lsn的记录全部落盘
+     * @param  lsn，LSN
+     */
+    void wait_durable(uint64_t lsn);
+
+    /**
+     * @brief 最后分配出去的LSN
+     * @return uint64_t
+     */
+    uint64_t last_lsn();
+
+    /**
+     * @brief 读出日志中所有完整的记录，恢复的时候使用
+     * @return std::vector<Record>
+     */
+    std::vector<Record> records();
+
+    /**
+     * @brief 检查点: 把这个数据库的脏表写回并且fsync，然后清空日志
+     */
+    void checkpoint();
+
+    /**
+     * @brief 日志超过checkpoint_bytes的时候做一次检查点
+     */
+    void maybe_checkpoint();
+
+private:
+    /**
+     * @brief 打开日志文件，丢弃末尾写了一半的记录
+     * @param  db_dir，数据库目录
+     */
+    explicit Wal(const std::string& db_dir);
+
+    /**
+     * @brief 刷盘线程，把缓冲区中的记录写入文件并且fsync
+     */
+    void _flusher();
+
+    /**
+     * @brief 解析文件中的记录，返回最后一条完整记录的结束位置
+     */
+    size_t _scan(std::vector<Record>* records, uint64_t& last_lsn);
+
+    /**
+     * @brief 写文件头，调用的时候需要持有m_io_mutex
+     */
+    void _write_header(uint64_t base_lsn);
+
+private:
+    /**
+     * @brief 数据库目录
+     */
+    std::string m_dir;
+
+    /**
+     * @brief 日志文件的描述符
+     */
+    int m_fd = -1;
+
+    /**
+     * @brief 修改表的时候共享持有，检查点的时候独占持有
+     */
+    std::shared_mutex m_write_lock;
+
+    /**
+     * @brief 保护下面的缓冲区和LSN
+     */
+    std::mutex m_mutex;
+
+    /**
+     * @brief 通知刷盘线程
+     */
+    std::condition_variable m_flush_cv;
+
+    /**
+     * @brief 通知等待落盘的提交
+     */
+    std::condition_variable m_durable_cv;
+
+    /**
+     * @brief 还没有写入文件的记录
+     */
+    std::string m_buffer;
+
+    /**
+     * @brief 下一个分配的LSN
+     */
+    uint64_t m_next_lsn = 1;
+
+    /**
+     * @brief 已经落盘的最大LSN
+     */
+    uint64_t m_durable_lsn = 0;
+
+    /**
+     * @brief 上一次检查点时的m_next_lsn，相等说明检查点之后没有新的记录
+     */
+    uint64_t m_checkpoint_lsn = 1;
+
+    /**
+     * @brief 正在等待落盘的提交个数
+     */
+    int m_waiters = 0;
+
+    /**
+     * @brief 析构的时候通知刷盘线程退出
+     */
+    bool m_stop = false;
+
+    /**
+     * @brief 保护文件的读写，写入和检查点不能同时进行
+     */
+    std::mutex m_io_mutex;
+
+    /**
+     * @brief 日志文件的大小
+     */
+    size_t m_file_size = 0;
+
+    /**
+     * @brief 刷盘线程
+     */
+    std::thread m_flusher;
+};
+
+#endif
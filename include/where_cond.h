@@ -0,0 +1,250 @@
+/**
+ * @file where_cond.h
+ * @brief where条件的解析和求值的头文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#ifndef _WHERE_COND_H_
+#define _WHERE_COND_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "server_table.h"
+
+/**
+ * @brief where中的一个谓词(表达式树的叶子)，由Sql_Parser解析出来:
+ *  <column> = <value>，!=(<>)、<、<=、>、>= 同理
+ *  <column> between <low> and <high>，两边都包含
+ *  <column> like <prefix>%，前缀匹配
+ *  <column> in (<value>, ...)
+ *  <column> is null，表中的值都不为空，bind的时候折叠成常量
+ */
+struct Where_Cond {
+    /**
+     * @brief 比较的方式
+     */
+    enum Op {
+        Equal,
+        Less,
+        Less_Equal,
+        Greater,
+        Greater_Equal,
+        Between,
+        Like,
+        Not_Equal,
+        In,
+        Is_Null,
+    };
+
+    /**
+     * @brief 条件中的列名
+     */
+    std::string m_column;
+
+    /**
+     * @brief 比较的方式
+     */
+    Op m_op = Equal;
+
+    /**
+     * @brief 比较的值，between的时候是下界，like的时候是去掉%之后的前缀
+     */
+    std::string m_value;
+
+    /**
+     * @brief between的上界
+     */
+    std::string m_high;
+
+    /**
+     * @brief in的值，bind之后去掉重复的并且排好序
+     */
+    std::vector<std::string> m_values;
+
+    /**
+     * @brief 列的下标，bind之后才确定
+     */
+    int m_column_index = -1;
+
+    /**
+     * @brief 列是否是int列，int列按数值比较大小
+     */
+    bool m_is_int = false;
+
+    /**
+     * @brief int列的时候，bind把m_value和m_high解析成整数放在这里，in的值放在m_int_values中，升序
+     */
+    int64_t m_int_value = 0;
+    int64_t m_int_high = 0;
+    std::vector<int64_t> m_int_values;
+};
+
+/**
+ * @brief 整个where条件: 谓词用and、or、not和括号组合起来的表达式树
+ *
+ *  解析出来的树放在m_parsed中，参数 ? 按谓词的下标填到这里；执行的时候Where::bind对着表把它编译一次放进m_compiled:
+ *  确定列和类型、折叠常量、合并同一列上的范围、按选择率排好子结点的顺序，之后逐行或者按块求值都只看m_compiled，
+ *  不再看列名和字符串形式的值
+ *
+ *  结点都放在数组里面，用下标互相引用，拷贝一份计划的语法树的时候不需要深拷贝指针
+ */
+struct Where_Expr {
+    /**
+     * @brief 结点的种类
+     *  Cond，谓词，m_cond是谓词的下标
+     *  And、Or，m_children是子结点，至少两个
+     *  Not，m_children只有一个子结点
+     *  True、False，折叠出来的常量
+     */
+    enum Kind {
+        Cond,
+        And,
+        Or,
+        Not,
+        True,
+        False,
+    };
+
+    struct Node {
+        Kind m_kind = True;
+        int m_cond = -1;
+        std::vector<int> m_children;
+
+        /**
+         * @brief 估计的选择率(满足的比例)和逐行求值的代价，编译之后才有
+         */
+        double m_selectivity = 1;
+        double m_cost = 0;
+    };
+
+    /**
+     * @brief 一棵树，m_root是根结点的下标
+     */
+    struct Tree {
+        std::vector<Where_Cond> m_conds;
+        std::vector<Node> m_nodes;
+        int m_root = -1;
+
+        /**
+         * @brief 加一个结点
+         * @return int，结点的下标
+         */
+        int add(Kind kind, int cond = -1, std::vector<int> children = {}) {
+            m_nodes.push_back({kind, cond, std::move(children)});
+            return m_nodes.size() - 1;
+        }
+
+        const Node& root() const { return m_nodes[m_root]; }
+        const Node& node(int i) const { return m_nodes[i]; }
+
+        /**
+         * @brief 结点对应的谓词，结点不是Cond的时候不能调用
+         */
+        const Where_Cond& cond(const Node& node) const { return m_conds[node.m_cond]; }
+    };
+
+    /**
+     * @brief 解析出来的树，还没有bind
+     */
+    Tree m_parsed;
+
+    /**
+     * @brief bind编译出来的树
+     */
+    Tree m_compiled;
+};
+
+/**
+ * @brief where条件相关的函数
+ */
+namespace Where {
+/**
+ * @brief 对着表编译where条件，结果放在expr.m_compiled中，可以重复调用
+ * @param  table，表(只需要模式)
+ * @param  expr，条件
+ * @return bool，有列不存在、int列的值不是合法整数或者int列用了like的时候返回false
+ */
+bool bind(const Table& table, Where_Expr& expr);
+
+/**
+ * @brief 判断一行是否满足条件，and和or从左往右短路
+ * @param  table，表
+ * @param  row，行号
+ * @param  expr，已经bind过的条件
+ * @return bool
+ */
+bool match(const Table& table, size_t row, const Where_Expr& expr);
+
+/**
+ * @brief 判断一行是否满足一个谓词
+ * @param  table，表
+ * @param  row，行号
+ * @param  cond，已经bind过的谓词
+ * @return bool
+ */
+bool match(const Table& table, size_t row, const Where_Cond& cond);
+
+/**
+ * @brief 把int列上的=、<、<=、>、>=、between换成闭区间[low, high]
+ * @param  cond，已经bind过的int列谓词
+ * @param  low，下界
+ * @param  high，上界
+ * @return bool，不是这几种比较或者区间为空(比如 < INT64_MIN)的时候返回false
+ */
+bool int_range(const Where_Cond& cond, int64_t& low, int64_t& high);
+
+/**
+ * @brief 找到快照中所有满足条件的行，能用上索引就不用全表扫描:
+ *  单个谓词，或者and中最有选择性的可以用索引的谓词，先用索引找到候选行再求剩下的条件；
+ *  or的每一支都可以用索引的时候，把各支找到的行合起来
+ * @param  table，表
+ * @param  expr，已经bind过的条件
+ * @param  snapshot，快照，修改表的命令用table.snapshot()，只找最新的版本
+ * @param  rows，满足条件的行号
+ * @return bool，rows按index_column的列有序的时候返回true，否则rows升序
+ */
+bool find_rows(const Table& table, const Where_Expr& expr, const Snapshot& snapshot, std::vector<size_t>& rows);
+
+/**
+ * @brief find_rows能不能用上索引，等值和in条件哈希索引和B+树索引都可以，其他的条件需要B+树索引
+ * @param  table，表
+ * @param  expr，已经bind过的条件
+ * @return bool
+ */
+bool uses_index(const Table& table, const Where_Expr& expr);
+
+/**
+ * @brief find_rows用单个谓词的索引找行时谓词的列，这时候结果可能按这一列有序
+ * @param  table，表
+ * @param  expr，已经bind过的条件
+ * @return int，列的下标，不是这种情况的时候返回-1
+ */
+int index_column(const Table& table, const Where_Expr& expr);
+
+/**
+ * @brief 把解析出来的条件写回成文本，用来给出提示
+ * @param  expr，条件
+ * @return std::string，比如 id >= 3 and (name = a or name = b)
+ */
+std::string text(const Where_Expr& expr);
+
+/**
+ * @brief 比较两行在某一列上的值，int列按数值比较
+ * @param  table，表
+ * @param  a，行号
+ * @param  b，行号
+ * @param  column，列的下标
+ * @return int，小于0、等于0、大于0
+ */
+int compare(const Table& table, size_t a, size_t b, int column);
+
+}  // namespace Where
+
+#endif
@@ -0,0 +1,367 @@
+/**
+ * @file batch_filter.cpp
+ * @brief 按列成批地求where条件的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "batch_filter.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+/**
+ * @brief int列比较的实现: 在values[0, count)中找出low <= x <= high的下标写进sel，返回个数
+ */
+using Int_Kernel = size_t (*)(const int64_t* values, size_t count, int64_t low, int64_t high, uint32_t* sel);
+
+/**
+ * @brief 4位掩码对应的下标，emit4用它一次写4个下标，不需要逐位判断
+ */
+struct Emit_Table {
+    alignas(16) uint32_t m_index[16][4];
+
+    constexpr Emit_Table() : m_index() {
+        for (uint32_t mask = 0; mask < 16; ++mask) {
+            uint32_t n = 0;
+            for (uint32_t k = 0; k < 4; ++k)
+                if (mask >> k & 1)
+                    m_index[mask][n++] = k;
+        }
+    }
+};
+constexpr Emit_Table emit_table;
+
+/**
+ * @brief 把4位掩码中为1的位对应的下标写进选择向量，不分支
+ * @brief 固定写4个，多写的会被后面的覆盖，sel + n后面至少要有4个位置: n不超过当前处理到的下标，所以不会越界
+ */
+inline size_t emit4(uint32_t mask, uint32_t base, uint32_t* sel, size_t n) {
+    __m128i index = _mm_load_si128(reinterpret_cast<const __m128i*>(emit_table.m_index[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sel + n), _mm_add_epi32(index, _mm_set1_epi32(base)));
+    return n + __builtin_popcount(mask);
+}
+
+/**
+ * @brief 把16位掩码对应的下标写进选择向量，全不满足和全满足(连续的大片数据很常见)的时候走捷径
+ */
+inline size_t emit16(uint32_t mask, uint32_t base, uint32_t* sel, size_t n) {
+    if (0 == mask)
+        return n;
+    if (0xffff == mask) {
+        for (uint32_t k = 0; k < 16; k += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(sel + n + k), _mm_add_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(base + k)));
+        return n + 16;
+    }
+    for (uint32_t k = 0; k < 16; k += 4)
+        n = emit4(mask >> k & 0xf, base + k, sel, n);
+    return n;
+}
+
+/**
+ * @brief 标量的实现，不分支，编译器也可以自动向量化
+ */
+size_t scan_scalar(const int64_t* values, size_t count, int64_t low, int64_t high, uint32_t* sel) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sel[n] = i;
+        n += (values[i] >= low) & (values[i] <= high);
+    }
+    return n;
+}
+
+/**
+ * @brief SSE4.2的实现，一条指令比较2个int64，一次处理8个
+ */
+__attribute__((target("sse4.2"))) size_t scan_sse42(const int64_t* values, size_t count, int64_t low, int64_t high,
+                                                     uint32_t* sel) {
+    const __m128i lo = _mm_set1_epi64x(low);
+    const __m128i hi = _mm_set1_epi64x(high);
+    size_t n = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint32_t mask = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 2 * k));
+            // x < low 或者 x > high 的时候不满足
+            __m128i out = _mm_or_si128(_mm_cmpgt_epi64(lo, x), _mm_cmpgt_epi64(x, hi));
+            mask |= (uint32_t)_mm_movemask_pd(_mm_castsi128_pd(out)) << (2 * k);
+        }
+        mask = ~mask & 0xff;
+        n = emit4(mask & 0xf, i, sel, n);
+        n = emit4(mask >> 4, i + 4, sel, n);
+    }
+    for (; i < count; ++i) {
+        sel[n] = i;
+        n += (values[i] >= low) & (values[i] <= high);
+    }
+    return n;
+}
+
+/**
+ * @brief AVX2的实现，一条指令比较4个int64，一次处理16个
+ */
+__attribute__((target("avx2"))) size_t scan_avx2(const int64_t* values, size_t count, int64_t low, int64_t high,
+                                                 uint32_t* sel) {
+    const __m256i lo = _mm256_set1_epi64x(low);
+    const __m256i hi = _mm256_set1_epi64x(high);
+    size_t n = 0, i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint32_t mask = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4 * k));
+            __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(lo, x), _mm256_cmpgt_epi64(x, hi));
+            mask |= (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(out)) << (4 * k);
+        }
+        n = emit16(~mask & 0xffff, i, sel, n);
+    }
+    for (; i < count; ++i) {
+        sel[n] = i;
+        n += (values[i] >= low) & (values[i] <= high);
+    }
+    return n;
+}
+
+/**
+ * @brief 按CPU支持的指令集选择实现
+ */
+struct Kernel {
+    Int_Kernel m_scan;
+    const char* m_name;
+};
+
+const Kernel& kernel() {
+    static const Kernel selected = []() -> Kernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {scan_avx2, "avx2"};
+        if (__builtin_cpu_supports("sse4.2"))
+            return {scan_sse42, "sse4.2"};
+        return {scan_scalar, "scalar"};
+    }();
+    return selected;
+}
+
+/**
+ * @brief 在一块中按选择向量求谓词，谓词是模板参数，循环里面没有switch
+ *  dense的时候候选行就是块中所有的行，in可以为nullptr；out可以和in是同一个数组，写的位置不会超过读的位置
+ */
+template <typename T, typename Pred>
+size_t select(const T* values, const uint32_t* in, size_t n, bool dense, uint32_t* out, Pred pred) {
+    size_t m = 0;
+    if (dense) {
+        for (size_t i = 0; i < n; ++i) {
+            out[m] = i;
+            m += pred(values[i]);
+        }
+    } else {
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t i = in[k];
+            out[m] = i;
+            m += pred(values[i]);
+        }
+    }
+    return m;
+}
+
+/**
+ * @brief int列的谓词，范围比较在候选行是整块的时候用SIMD
+ */
+size_t filter_ints(const int64_t* values, const uint32_t* in, size_t n, bool dense, const Where_Cond& cond, uint32_t* out) {
+    switch (cond.m_op) {
+    case Where_Cond::Not_Equal: {
+        int64_t value = cond.m_int_value;
+        return select(values, in, n, dense, out, [=](int64_t v) { return v != value; });
+    }
+    case Where_Cond::In: {
+        const std::vector<int64_t>& set = cond.m_int_values;
+        return select(values, in, n, dense, out, [&](int64_t v) { return std::binary_search(set.begin(), set.end(), v); });
+    }
+    default:
+        break;
+    }
+    int64_t low, high;
+    if (!Where::int_range(cond, low, high))
+        return 0;
+    if (dense)
+        return kernel().m_scan(values, n, low, high, out);
+    return select(values, in, n, false, out, [=](int64_t v) { return (v >= low) & (v <= high); });
+}
+
+/**
+ * @brief string列的谓词
+ */
+size_t filter_strings(const std::string_view* values, const uint32_t* in, size_t n, bool dense, const Where_Cond& cond,
+                      uint32_t* out) {
+    const std::string& value = cond.m_value;
+    const char* data = value.data();
+    size_t len = value.size();
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+        // 长度不一样的直接跳过，一样的才比较内容
+        return select(values, in, n, dense, out,
+                      [&](std::string_view v) { return v.size() == len and 0 == memcmp(v.data(), data, len); });
+    case Where_Cond::Not_Equal:
+        return select(values, in, n, dense, out,
+                      [&](std::string_view v) { return v.size() != len or 0 != memcmp(v.data(), data, len); });
+    case Where_Cond::Like:
+        return select(values, in, n, dense, out,
+                      [&](std::string_view v) { return v.size() >= len and 0 == memcmp(v.data(), data, len); });
+    case Where_Cond::Less:
+        return select(values, in, n, dense, out, [&](std::string_view v) { return v.compare(value) < 0; });
+    case Where_Cond::Less_Equal:
+        return select(values, in, n, dense, out, [&](std::string_view v) { return v.compare(value) <= 0; });
+    case Where_Cond::Greater:
+        return select(values, in, n, dense, out, [&](std::string_view v) { return v.compare(value) > 0; });
+    case Where_Cond::Greater_Equal:
+        return select(values, in, n, dense, out, [&](std::string_view v) { return v.compare(value) >= 0; });
+    case Where_Cond::Between:
+        return select(values, in, n, dense, out,
+                      [&](std::string_view v) { return v.compare(value) >= 0 and v.compare(cond.m_high) <= 0; });
+    case Where_Cond::In: {
+        const std::vector<std::string>& set = cond.m_values;
+        return select(values, in, n, dense, out,
+                      [&](std::string_view v) { return std::binary_search(set.begin(), set.end(), v); });
+    }
+    case Where_Cond::Is_Null:
+        return 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief 在一块中求表达式树的一个结点，in是候选行(块内下标，升序)，满足的写进out，仍然升序
+ *  and: 每个子条件只求前面的子条件留下来的行，一块中全被排除了就不再往后求
+ *  or: 每个子条件只求前面的子条件还没有满足的行，最后按in的顺序合并
+ *  not: in中去掉子条件满足的行
+ */
+size_t eval(const Table& table, const Where_Expr::Tree& tree, int i, size_t begin, const uint32_t* in, size_t n, bool dense,
+            uint32_t* out) {
+    const Where_Expr::Node& node = tree.node(i);
+    switch (node.m_kind) {
+    case Where_Expr::Cond: {
+        const Where_Cond& cond = tree.cond(node);
+        const Column_Data& data = table.m_data[cond.m_column_index];
+        if (cond.m_is_int)
+            return filter_ints(data.m_ints.data() + begin, in, n, dense, cond, out);
+        return filter_strings(data.m_strings.data() + begin, in, n, dense, cond, out);
+    }
+    case Where_Expr::And:
+        for (int child : node.m_children) {
+            n = eval(table, tree, child, begin, in, n, dense, out);
+            in = out;
+            dense = false;
+            if (0 == n)
+                break;
+        }
+        return n;
+    case Where_Expr::Or: {
+        uint32_t rest[Batch_Filter::block_rows], hit[Batch_Filter::block_rows];
+        uint8_t matched[Batch_Filter::block_rows] = {};
+        size_t left = n;
+        const uint32_t* candidates = in;
+        bool rest_dense = dense;
+        for (int child : node.m_children) {
+            size_t found = eval(table, tree, child, begin, candidates, left, rest_dense, hit);
+            for (size_t k = 0; k < found; ++k)
+                matched[hit[k]] = 1;
+            // 剩下还没有满足的行
+            size_t kept = 0;
+            for (size_t k = 0; k < left; ++k) {
+                uint32_t row = rest_dense ? k : candidates[k];
+                rest[kept] = row;
+                kept += !matched[row];
+            }
+            left = kept;
+            candidates = rest;
+            rest_dense = false;
+            if (0 == left)
+                break;
+        }
+        size_t m = 0;
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t row = dense ? k : in[k];
+            out[m] = row;
+            m += matched[row];
+        }
+        return m;
+    }
+    case Where_Expr::Not: {
+        uint32_t hit[Batch_Filter::block_rows];
+        size_t found = eval(table, tree, node.m_children[0], begin, in, n, dense, hit);
+        size_t m = 0, j = 0;
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t row = dense ? k : in[k];
+            if (j < found and hit[j] == row)
+                ++j;
+            else
+                out[m++] = row;
+        }
+        return m;
+    }
+    case Where_Expr::True:
+        if (dense)
+            for (size_t k = 0; k < n; ++k)
+                out[k] = k;
+        else if (out != in)
+            std::copy(in, in + n, out);
+        return n;
+    default:
+        return 0;
+    }
+}
+
+}  // namespace
+
+size_t Batch_Filter::filter_block(const Table& table, const Where_Expr* expr, const Snapshot& snapshot, size_t begin, size_t end,
+                                  uint32_t* sel) {
+    end = std::min({end, snapshot.m_rows, begin + block_rows});
+    if (begin >= end)
+        return 0;
+    size_t count = end - begin;
+
+    size_t n = 0;
+    if (nullptr == expr) {
+        for (; n < count; ++n)
+            sel[n] = n;
+    } else {
+        const Where_Expr::Tree& tree = expr->m_compiled;
+        n = eval(table, tree, tree.m_root, begin, nullptr, count, true, sel);
+    }
+
+    // 块里面有结束了的旧版本的时候，再按快照过滤一遍
+    if (begin < table.m_end.size()) {
+        size_t kept = 0;
+        for (size_t k = 0; k < n; ++k) {
+            sel[kept] = sel[k];
+            kept += table.visible(begin + sel[k], snapshot);
+        }
+        n = kept;
+    }
+    return n;
+}
+
+void Batch_Filter::filter(const Table& table, const Where_Expr& expr, const Snapshot& snapshot, std::vector<size_t>& rows) {
+    uint32_t sel[block_rows];
+    for (size_t begin = 0; begin < snapshot.m_rows; begin += block_rows) {
+        size_t n = filter_block(table, &expr, snapshot, begin, begin + block_rows, sel);
+        size_t old = rows.size();
+        rows.resize(old + n);
+        for (size_t k = 0; k < n; ++k)
+            rows[old + k] = begin + sel[k];
+    }
+}
+
+const char* Batch_Filter::kernel_name() {
+    return kernel().m_name;
+}
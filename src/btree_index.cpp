@@ -0,0 +1,471 @@
+/**
+ * @file btree_index.cpp
+ * @brief 建在某一列上的B+树索引的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "btree_index.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+/**
+ * @brief 只在本文件中使用的辅助函数和变量
+ */
+namespace {
+/**
+ * @brief 新建索引的页大小和扇出，由set_page_size和set_fan_out设置
+ */
+uint32_t tree_page_size = BTree_Index::default_page_size;
+uint32_t tree_fan_out = BTree_Index::default_fan_out;
+
+/**
+ * @brief 节点在文件中的固定部分: u32跨度 + u8是否叶子 + u32键数
+ */
+constexpr size_t node_header_bytes = 9;
+
+/**
+ * @brief 索引文件头，放在第0页
+ */
+struct Tree_Header {
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_page_size;
+    uint32_t m_fan_out;
+    uint32_t m_is_int;
+    uint32_t m_root_page;
+    uint64_t m_lsn;
+    uint64_t m_row_count;
+    uint64_t m_entry_count;
+    uint64_t m_node_count;
+};
+
+template <typename T>
+void put(std::string& buf, T value) {
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool get(const char*& pos, const char* end, T& value) {
+    if ((size_t)(end - pos) < sizeof(value))
+        return false;
+    memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+}  // namespace
+
+void BTree_Index::set_page_size(uint32_t page_size) {
+    tree_page_size = std::max<uint32_t>(page_size, 256);
+}
+
+void BTree_Index::set_fan_out(uint32_t fan_out) {
+    tree_fan_out = std::max<uint32_t>(fan_out, 4);
+}
+
+std::string BTree_Index::encode_key(const std::string& value, bool is_int) {
+    if (!is_int)
+        return value;
+
+    int64_t num;
+    if (!Table::parse_int(value, num))
+        return '\x01' + value;
+    return encode_int(num);
+}
+
+std::string BTree_Index::encode_int(int64_t num) {
+    // 符号位取反之后，负数排在正数前面，大端存放让按字节比较和按数值比较一致
+    uint64_t bits = (uint64_t)num ^ (1ull << 63);
+    std::string key(9, '\0');
+    for (int i = 8; i > 0; --i, bits >>= 8)
+        key[i] = (char)(bits & 0xff);
+    return key;
+}
+
+BTree_Index::BTree_Index(bool is_int) : m_is_int(is_int), m_page_size(tree_page_size), m_fan_out(tree_fan_out) {
+    m_root = _new_node(true);
+}
+
+void BTree_Index::build(const Table& table, int column) {
+    std::vector<Entry> entries;
+    entries.reserve(table.m_row_count);
+    for (size_t i = 0; i < table.m_row_count; ++i)
+        entries.push_back({m_is_int ? encode_int(table.m_data[column].m_ints[i]) : std::string(table.m_data[column].m_strings[i]), i});
+    std::sort(entries.begin(), entries.end());
+
+    m_nodes.clear();
+    m_entries = entries.size();
+
+    // 填满叶子，level中记下这一层每个节点和它的最小项
+    std::vector<std::pair<uint32_t, Entry>> level;
+    uint32_t leaf = _new_node(true);
+    level.push_back({leaf, Entry{}});
+    for (auto& entry : entries) {
+        size_t bytes = _entry_bytes(entry);
+        if (!m_nodes[leaf].m_entries.empty() and
+            (m_nodes[leaf].m_entries.size() >= m_fan_out or m_nodes[leaf].m_bytes + bytes > m_page_size)) {
+            uint32_t next = _new_node(true);
+            m_nodes[leaf].m_next = next;
+            leaf = next;
+            level.push_back({leaf, entry});
+        }
+        m_nodes[leaf].m_bytes += bytes;
+        m_nodes[leaf].m_entries.push_back(std::move(entry));
+    }
+
+    // 一层一层往上建，直到只剩一个节点
+    while (level.size() > 1) {
+        std::vector<std::pair<uint32_t, Entry>> upper;
+        uint32_t node = no_node;
+        for (auto& [child, min_entry] : level) {
+            size_t bytes = _entry_bytes(min_entry) + sizeof(uint32_t);
+            // 内部节点至少要有两个孩子，否则键很长的时候这一层永远建不完
+            if (no_node == node or (!m_nodes[node].m_entries.empty() and
+                                    (m_nodes[node].m_entries.size() >= m_fan_out or m_nodes[node].m_bytes + bytes > m_page_size))) {
+                node = _new_node(false);
+                m_nodes[node].m_children.push_back(child);
+                upper.push_back({node, std::move(min_entry)});
+                continue;
+            }
+            m_nodes[node].m_bytes += bytes;
+            m_nodes[node].m_entries.push_back(std::move(min_entry));
+            m_nodes[node].m_children.push_back(child);
+        }
+        level = std::move(upper);
+    }
+    m_root = level.front().first;
+}
+
+void BTree_Index::insert(const std::string& value, size_t row) {
+    Entry split_key;
+    uint32_t split_node;
+    if (_insert(m_root, {encode_key(value, m_is_int), row}, split_key, split_node)) {
+        // 根分裂了，树长高一层
+        uint32_t root = _new_node(false);
+        m_nodes[root].m_bytes += _entry_bytes(split_key) + sizeof(uint32_t);
+        m_nodes[root].m_entries.push_back(std::move(split_key));
+        m_nodes[root].m_children = {m_root, split_node};
+        m_root = root;
+    }
+    ++m_entries;
+}
+
+void BTree_Index::erase(const std::string& value, size_t row) {
+    Entry target = {encode_key(value, m_is_int), row};
+    uint32_t node = m_root;
+    while (!m_nodes[node].m_leaf) {
+        auto& entries = m_nodes[node].m_entries;
+        node = m_nodes[node].m_children[std::upper_bound(entries.begin(), entries.end(), target) - entries.begin()];
+    }
+
+    auto& entries = m_nodes[node].m_entries;
+    auto pos = std::lower_bound(entries.begin(), entries.end(), target);
+    if (entries.end() == pos or target < *pos)
+        return;
+    m_nodes[node].m_bytes -= _entry_bytes(*pos);
+    entries.erase(pos);
+    --m_entries;
+}
+
+void BTree_Index::range(const std::string* low, bool low_inclusive, const std::string* high, bool high_inclusive,
+                        std::vector<size_t>& rows) const {
+    rows.clear();
+
+    // 不包含下界的时候从(下界, 最大行号)开始找，正好跳过所有等于下界的键
+    Entry start;
+    start.m_row = 0;
+    if (nullptr != low) {
+        start.m_key = encode_key(*low, m_is_int);
+        start.m_row = low_inclusive ? 0 : SIZE_MAX;
+    }
+    std::string end_key = nullptr == high ? std::string() : encode_key(*high, m_is_int);
+
+    uint32_t leaf;
+    size_t pos;
+    _lower_bound(start, leaf, pos);
+    for (; no_node != leaf; leaf = m_nodes[leaf].m_next, pos = 0) {
+        auto& entries = m_nodes[leaf].m_entries;
+        for (; pos < entries.size(); ++pos) {
+            if (nullptr != high) {
+                int cmp = entries[pos].m_key.compare(end_key);
+                if (cmp > 0 or (0 == cmp and !high_inclusive))
+                    return;
+            }
+            rows.push_back(entries[pos].m_row);
+        }
+    }
+}
+
+void BTree_Index::prefix(const std::string& prefix, std::vector<size_t>& rows) const {
+    rows.clear();
+
+    uint32_t leaf;
+    size_t pos;
+    _lower_bound({prefix, 0}, leaf, pos);
+    for (; no_node != leaf; leaf = m_nodes[leaf].m_next, pos = 0) {
+        auto& entries = m_nodes[leaf].m_entries;
+        for (; pos < entries.size(); ++pos) {
+            if (0 != entries[pos].m_key.compare(0, prefix.size(), prefix))
+                return;
+            rows.push_back(entries[pos].m_row);
+        }
+    }
+}
+
+void BTree_Index::scan(std::vector<size_t>& rows) const {
+    range(nullptr, true, nullptr, true, rows);
+}
+
+void BTree_Index::save(const std::string& path, uint64_t lsn, uint64_t row_count) const {
+    // 先算出每个节点的页号，第0页是文件头
+    std::vector<uint32_t> pages(m_nodes.size());
+    uint32_t next_page = 1;
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        pages[i] = next_page;
+        next_page += std::max<size_t>(1, (m_nodes[i].m_bytes + m_page_size - 1) / m_page_size);
+    }
+
+    std::string buf;
+    buf.reserve((size_t)next_page * m_page_size);
+
+    Tree_Header header = {magic, 1, m_page_size, m_fan_out, m_is_int, pages[m_root], lsn, row_count, m_entries, m_nodes.size()};
+    put(buf, header);
+    buf.resize(m_page_size, '\0');
+
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        const Node& node = m_nodes[i];
+        uint32_t span = (i + 1 < m_nodes.size() ? pages[i + 1] : next_page) - pages[i];
+        put<uint32_t>(buf, span);
+        put<uint8_t>(buf, node.m_leaf);
+        put<uint32_t>(buf, node.m_entries.size());
+        if (node.m_leaf)
+            put<uint32_t>(buf, no_node == node.m_next ? 0 : pages[node.m_next]);
+        else
+            for (uint32_t child : node.m_children)
+                put<uint32_t>(buf, pages[child]);
+        for (auto& entry : node.m_entries) {
+            put<uint32_t>(buf, entry.m_key.size());
+            buf += entry.m_key;
+            put<uint64_t>(buf, entry.m_row);
+        }
+        buf.resize((size_t)(i + 1 < m_nodes.size() ? pages[i + 1] : next_page) * m_page_size, '\0');
+    }
+
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+    if ((ssize_t)buf.size() != write(fd, buf.data(), buf.size())) {
+        perror("write");
+        exit(-1);
+    }
+    close(fd);
+
+    if (-1 == rename(tmp_path.c_str(), path.c_str())) {
+        perror("rename");
+        exit(-1);
+    }
+}
+
+bool BTree_Index::load(const std::string& path, uint64_t lsn, uint64_t row_count) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd)
+        return false;
+
+    struct stat st;
+    std::string buf;
+    if (0 == fstat(fd, &st)) {
+        buf.resize(st.st_size);
+        if (st.st_size != pread(fd, buf.data(), buf.size(), 0))
+            buf.clear();
+    }
+    close(fd);
+
+    const char* pos = buf.data();
+    const char* end = buf.data() + buf.size();
+    Tree_Header header;
+    if (!get(pos, end, header) or magic != header.m_magic or 1 != header.m_version or lsn != header.m_lsn or
+        row_count != header.m_row_count or m_is_int != (bool)header.m_is_int or header.m_page_size < 256 or
+        buf.size() % header.m_page_size != 0 or header.m_entry_count != row_count)
+        return false;
+
+    m_page_size = header.m_page_size;
+    m_fan_out = header.m_fan_out;
+    m_nodes.clear();
+    m_nodes.reserve(header.m_node_count);
+    m_entries = 0;
+
+    // 按顺序读出所有的节点，记下页号到节点下标的对应关系，最后再把页号换成下标
+    std::unordered_map<uint32_t, uint32_t> page_to_node;
+    uint64_t page = 1;
+    for (uint64_t i = 0; i < header.m_node_count; ++i) {
+        if (page * m_page_size >= buf.size())
+            return false;
+        pos = buf.data() + page * m_page_size;
+
+        uint32_t span, entry_nums;
+        uint8_t leaf;
+        if (!get(pos, end, span) or !get(pos, end, leaf) or !get(pos, end, entry_nums) or 0 == span)
+            return false;
+        const char* node_end = std::min<const char*>(end, buf.data() + (page + span) * m_page_size);
+
+        page_to_node[page] = i;
+        Node& node = m_nodes.emplace_back();
+        node.m_leaf = leaf;
+        node.m_next = no_node;
+        node.m_bytes = node_header_bytes;
+        if (leaf) {
+            if (!get(pos, node_end, node.m_next))
+                return false;
+            node.m_bytes += sizeof(uint32_t);
+        } else {
+            node.m_children.resize(entry_nums + 1);
+            for (auto& child : node.m_children)
+                if (!get(pos, node_end, child))
+                    return false;
+            node.m_bytes += node.m_children.size() * sizeof(uint32_t);
+        }
+
+        node.m_entries.resize(entry_nums);
+        for (auto& entry : node.m_entries) {
+            uint32_t key_len;
+            if (!get(pos, node_end, key_len) or (size_t)(node_end - pos) < key_len)
+                return false;
+            entry.m_key.assign(pos, key_len);
+            pos += key_len;
+            if (!get(pos, node_end, entry.m_row) or entry.m_row >= row_count)
+                return false;
+            node.m_bytes += _entry_bytes(entry);
+        }
+        if (leaf)
+            m_entries += entry_nums;
+        page += span;
+    }
+
+    auto to_node = [&](uint32_t& ref) {
+        auto it = page_to_node.find(ref);
+        if (page_to_node.end() == it)
+            return false;
+        ref = it->second;
+        return true;
+    };
+    for (auto& node : m_nodes) {
+        if (node.m_leaf and 0 == node.m_next)
+            node.m_next = no_node;
+        else if (node.m_leaf and !to_node(node.m_next))
+            return false;
+        for (auto& child : node.m_children)
+            if (!to_node(child))
+                return false;
+    }
+    m_root = header.m_root_page;
+    return !m_nodes.empty() and to_node(m_root) and m_entries == row_count;
+}
+
+size_t BTree_Index::bytes() const {
+    size_t bytes = sizeof(*this) + m_nodes.capacity() * sizeof(Node) + m_entries * sizeof(Entry);
+    for (auto& node : m_nodes) {
+        bytes += node.m_children.capacity() * sizeof(uint32_t);
+        for (auto& entry : node.m_entries)
+            if (entry.m_key.capacity() > 15)
+                bytes += entry.m_key.capacity() + 1;
+    }
+    return bytes;
+}
+
+size_t BTree_Index::_entry_bytes(const Entry& entry) {
+    return sizeof(uint32_t) + entry.m_key.size() + sizeof(uint64_t);
+}
+
+bool BTree_Index::_overflow(const Node& node) const {
+    // 只有一项的节点放不下一页也没办法分裂，写文件的时候让它跨多个页
+    return node.m_entries.size() > m_fan_out or (node.m_bytes > m_page_size and node.m_entries.size() > 1);
+}
+
+uint32_t BTree_Index::_new_node(bool leaf) {
+    Node& node = m_nodes.emplace_back();
+    node.m_leaf = leaf;
+    node.m_next = no_node;
+    node.m_bytes = node_header_bytes + sizeof(uint32_t);
+    return m_nodes.size() - 1;
+}
+
+bool BTree_Index::_insert(uint32_t node, const Entry& entry, Entry& split_key, uint32_t& split_node) {
+    if (m_nodes[node].m_leaf) {
+        auto& entries = m_nodes[node].m_entries;
+        entries.insert(std::upper_bound(entries.begin(), entries.end(), entry), entry);
+        m_nodes[node].m_bytes += _entry_bytes(entry);
+    } else {
+        auto& entries = m_nodes[node].m_entries;
+        size_t i = std::upper_bound(entries.begin(), entries.end(), entry) - entries.begin();
+        Entry child_key;
+        uint32_t child_node;
+        // 递归的时候m_nodes可能会扩容，之后要重新取引用
+        if (_insert(m_nodes[node].m_children[i], entry, child_key, child_node)) {
+            Node& self = m_nodes[node];
+            self.m_bytes += _entry_bytes(child_key) + sizeof(uint32_t);
+            self.m_entries.insert(self.m_entries.begin() + i, std::move(child_key));
+            self.m_children.insert(self.m_children.begin() + i + 1, child_node);
+        }
+    }
+
+    if (!_overflow(m_nodes[node]))
+        return false;
+
+    // 分裂成两半，右边一半放到新节点里面
+    bool leaf = m_nodes[node].m_leaf;
+    split_node = _new_node(leaf);
+    Node& left = m_nodes[node];
+    Node& right = m_nodes[split_node];
+    size_t mid = left.m_entries.size() / 2;
+
+    if (leaf) {
+        right.m_entries.assign(std::make_move_iterator(left.m_entries.begin() + mid), std::make_move_iterator(left.m_entries.end()));
+        left.m_entries.resize(mid);
+        split_key = right.m_entries.front();
+        right.m_next = left.m_next;
+        left.m_next = split_node;
+    } else {
+        // 中间的分隔键提上去，不留在任何一边
+        split_key = std::move(left.m_entries[mid]);
+        right.m_entries.assign(std::make_move_iterator(left.m_entries.begin() + mid + 1), std::make_move_iterator(left.m_entries.end()));
+        right.m_children.assign(left.m_children.begin() + mid + 1, left.m_children.end());
+        left.m_entries.resize(mid);
+        left.m_children.resize(mid + 1);
+    }
+
+    // 重新算两边的字节数
+    for (Node* half : {&left, &right}) {
+        half->m_bytes = node_header_bytes + (leaf ? sizeof(uint32_t) : half->m_children.size() * sizeof(uint32_t));
+        for (auto& each : half->m_entries)
+            half->m_bytes += _entry_bytes(each);
+    }
+    return true;
+}
+
+void BTree_Index::_lower_bound(const Entry& target, uint32_t& leaf, size_t& pos) const {
+    uint32_t node = m_root;
+    while (!m_nodes[node].m_leaf) {
+        auto& entries = m_nodes[node].m_entries;
+        node = m_nodes[node].m_children[std::upper_bound(entries.begin(), entries.end(), target) - entries.begin()];
+    }
+
+    auto& entries = m_nodes[node].m_entries;
+    leaf = node;
+    pos = std::lower_bound(entries.begin(), entries.end(), target) - entries.begin();
+}
@@ -24,12 +24,22 @@ std::string Menu::run() {
     // 以下是输入命令并且处理命令字符串的逻辑
     puts("请输入命令: ");  // puts()自带换行符
 
+    return read_command();
+}
+
+std::string Menu::read_command() {
     std::string command;
 
     while (1) {
         // 我们在输入的过程中对输入的字符串进行格式化，最重要的一点就是去掉没有必要的空格
         int ch = fgetc(stdin);
 
+        // 标准输入读完了，最后没有分号的命令也算一条
+        if (EOF == ch) {
+            m_eof = true;
+            break;
+        }
+
         // 我个人不允许使用缩进'\t'和回车'\n'将其替换为' '，后面的空格可以代表这三个
         if ('\t' == ch or '\n' == ch)
             ch = ' ';
@@ -38,7 +48,7 @@ std::string Menu::run() {
         if (command.empty() and ' ' == ch)
             continue;
         // 2.当上一个字符是空格的时候再次输入空格就被忽略
-        if (' ' == command.back() and ' ' == ch)
+        if (!command.empty() and ' ' == command.back() and ' ' == ch)
             continue;
 
         // 遇到分号结束输入
@@ -49,7 +59,7 @@ std::string Menu::run() {
     }
 
     // command最后很可能出现一个空格，因为本来等待下一个字符，然后就结束了，如果有需要将其弹掉
-    if (' ' == command.back())
+    if (!command.empty() and ' ' == command.back())
         command.pop_back();
 
     return command;
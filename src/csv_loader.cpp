@@ -0,0 +1,293 @@
+/**
+ * @file csv_loader.cpp
+ * @brief 从csv文件中批量导入数据的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "csv_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief 只在本文件中使用的辅助函数和变量
+ */
+namespace {
+/**
+ * @brief 每个线程至少分到这么多字节，文件小的时候开线程不划算
+ */
+constexpr size_t bytes_per_worker = 1 << 20;
+
+/**
+ * @brief 解析用的线程池，由set_thread_pool设置
+ */
+Thread_Pool* thread_pool = nullptr;
+
+/**
+ * @brief 切一行的结果: 合法；不合法，只跳过这一行；带引号的字段到行尾还没有结束，也就是字段中有换行
+ */
+enum class Split { ok, bad, open_quote };
+
+/**
+ * @brief 一个线程解析的一块，从一行的开头到另一行的开头
+ */
+struct Chunk {
+    const char* m_begin = nullptr;
+    const char* m_end = nullptr;
+
+    /**
+     * @brief 是否是文件的第一块，它的第一行可能是表头
+     */
+    bool m_first = false;
+
+    /**
+     * @brief 解析出来的行
+     */
+    Table m_rows;
+
+    /**
+     * @brief 块中的行数(包括空行和不合法的行)，不合法的行数和其中第一行在块中的行号
+     */
+    size_t m_lines = 0;
+    size_t m_rejected = 0;
+    size_t m_first_rejected = 0;
+
+    /**
+     * @brief 第一个到行尾还没有结束的带引号的字段所在的行号，没有的时候是0，遇到之后这一块就不再往下解析了
+     */
+    size_t m_open_quote = 0;
+};
+
+/**
+ * @brief 把一行切成字段，带引号的字段中有 "" 的时候，去掉转义之后的值放在scratch中
+ * @return Split，引号后面不是 ',' 的时候是bad，引号到行尾都没有结束的时候是open_quote
+ */
+Split split_line(std::string_view line, std::vector<std::string_view>& fields, std::deque<std::string>& scratch) {
+    fields.clear();
+    scratch.clear();
+    size_t pos = 0;
+    while (true) {
+        if (pos == line.size() or '"' != line[pos]) {
+            size_t comma = line.find(',', pos);
+            if (std::string_view::npos == comma) {
+                fields.push_back(line.substr(pos));
+                return Split::ok;
+            }
+            fields.push_back(line.substr(pos, comma - pos));
+            pos = comma + 1;
+            continue;
+        }
+
+        // 带引号的字段到单独的一个引号结束
+        size_t begin = ++pos;
+        bool escaped = false;
+        size_t quote;
+        while (true) {
+            quote = line.find('"', pos);
+            if (std::string_view::npos == quote)
+                return Split::open_quote;
+            if (quote + 1 < line.size() and '"' == line[quote + 1]) {
+                escaped = true;
+                pos = quote + 2;
+                continue;
+            }
+            break;
+        }
+        std::string_view text = line.substr(begin, quote - begin);
+        if (escaped) {
+            std::string& value = scratch.emplace_back();
+            for (size_t i = 0; i < text.size(); ++i) {
+                value += text[i];
+                if ('"' == text[i])
+                    ++i;
+            }
+            text = value;
+        }
+        fields.push_back(text);
+
+        pos = quote + 1;
+        if (pos == line.size())
+            return Split::ok;
+        if (',' != line[pos])
+            return Split::bad;
+        ++pos;
+    }
+}
+
+/**
+ * @brief 解析一块，合法的行追加到chunk.m_rows中
+ */
+void parse_chunk(Chunk& chunk, const std::vector<bool>& is_int) {
+    Table& rows = chunk.m_rows;
+    size_t columns = is_int.size();
+    std::vector<std::string_view> fields;
+    std::deque<std::string> scratch;
+    std::vector<int64_t> ints(columns);
+    for (const char* pos = chunk.m_begin; pos < chunk.m_end;) {
+        const char* newline = (const char*)memchr(pos, '\n', chunk.m_end - pos);
+        const char* end = nullptr == newline ? chunk.m_end : newline;
+        std::string_view line(pos, end - pos);
+        pos = nullptr == newline ? chunk.m_end : newline + 1;
+        ++chunk.m_lines;
+
+        // 兼容 \r\n 换行，空行跳过
+        if (!line.empty() and '\r' == line.back())
+            line.remove_suffix(1);
+        if (line.empty())
+            continue;
+
+        Split split = split_line(line, fields, scratch);
+        if (Split::open_quote == split) {
+            chunk.m_open_quote = chunk.m_lines;
+            return;
+        }
+        bool ok = Split::ok == split and columns == fields.size();
+        if (ok and chunk.m_first and 1 == chunk.m_lines) {
+            bool header = true;
+            for (size_t i = 0; header and i < columns; ++i)
+                header = fields[i] == rows.m_columns[i].m_column_name;
+            if (header)
+                continue;
+        }
+        for (size_t i = 0; ok and i < columns; ++i)
+            if (is_int[i])
+                ok = Table::parse_int(fields[i], ints[i]);
+        if (!ok) {
+            if (0 == chunk.m_rejected++)
+                chunk.m_first_rejected = chunk.m_lines;
+            continue;
+        }
+
+        for (size_t i = 0; i < columns; ++i) {
+            if (is_int[i])
+                rows.m_data[i].m_ints.push_back(ints[i]);
+            else
+                rows.m_data[i].m_strings.push_back(fields[i]);
+        }
+        ++rows.m_row_count;
+    }
+}
+
+}  // namespace
+
+void Csv_Loader::set_thread_pool(Thread_Pool* pool) { thread_pool = pool; }
+
+bool Csv_Loader::load(const std::string& file, Table& rows, Stats& stats, std::string& error) {
+    stats = Stats();
+    rows.m_data.resize(rows.m_columns.size());
+
+    int fd = open(file.c_str(), O_RDONLY);
+    if (-1 == fd) {
+        error = "文件 " + file + " 无法打开,请检查路径!";
+        return false;
+    }
+    struct stat st;
+    if (-1 == fstat(fd, &st)) {
+        perror("fstat");
+        exit(-1);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        error = "文件 " + file + " 不是普通文件,请检查路径!";
+        return false;
+    }
+    size_t size = st.st_size;
+    stats.m_bytes = size;
+    if (0 == size) {
+        close(fd);
+        return true;
+    }
+
+    // 整个文件只读映射到内存中，解析的时候不用再拷贝一遍，映射之后文件描述符就可以关掉了
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == data) {
+        perror("mmap");
+        exit(-1);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    const char* text = (const char*)data;
+
+    // 按字节数平均切块，每一块的结尾挪到下一个换行符之后，一行只会落在一块中
+    size_t threads = nullptr == thread_pool ? 1 : thread_pool->size();
+    size_t count = std::clamp<size_t>(size / bytes_per_worker, 1, threads);
+    std::vector<bool> is_int(rows.m_columns.size());
+    for (int i = 0; i < is_int.size(); ++i)
+        is_int[i] = rows.is_int(i);
+    std::deque<Chunk> chunks(count);
+    const char* begin = text;
+    for (size_t i = 0; i < count; ++i) {
+        Chunk& chunk = chunks[i];
+        const char* end = text + size;
+        if (i + 1 < count) {
+            end = std::max(begin, text + size * (i + 1) / count);
+            const char* newline = (const char*)memchr(end, '\n', text + size - end);
+            end = nullptr == newline ? text + size : newline + 1;
+        }
+        chunk.m_begin = begin;
+        chunk.m_end = end;
+        chunk.m_first = 0 == i;
+        chunk.m_rows.m_columns = rows.m_columns;
+        chunk.m_rows.m_data.resize(rows.m_columns.size());
+        begin = end;
+    }
+
+    auto work = [&](size_t i) { parse_chunk(chunks[i], is_int); };
+    if (nullptr == thread_pool)
+        work(0);
+    else
+        thread_pool->parallel_for(count, work);
+    munmap(data, size);
+
+    // 字段中有换行的时候，切块和按行解析都会把一条记录切开，整个文件都不导入
+    size_t lines = 0;
+    for (const Chunk& chunk : chunks) {
+        if (0 != chunk.m_open_quote) {
+            error = "文件 " + file + " 第 " + std::to_string(lines + chunk.m_open_quote) +
+                    " 行的带引号的字段到行尾还没有结束,不支持字段中换行,没有导入任何数据!";
+            return false;
+        }
+        lines += chunk.m_lines;
+    }
+
+    // 按块的顺序拼起来，string直接移动过去
+    size_t total = 0;
+    for (const Chunk& chunk : chunks)
+        total += chunk.m_rows.m_row_count;
+    rows.reserve(rows.m_row_count + total);
+    lines = 0;
+    for (Chunk& chunk : chunks) {
+        for (int i = 0; i < is_int.size(); ++i) {
+            Column_Data& in = chunk.m_rows.m_data[i];
+            Column_Data& out = rows.m_data[i];
+            if (is_int[i])
+                out.m_ints.insert(out.m_ints.end(), in.m_ints.begin(), in.m_ints.end());
+            else
+                out.m_strings.append(in.m_strings);
+        }
+        rows.m_row_count += chunk.m_rows.m_row_count;
+        if (0 != chunk.m_rejected and 0 == stats.m_rejected)
+            stats.m_first_rejected = lines + chunk.m_first_rejected;
+        stats.m_rejected += chunk.m_rejected;
+        lines += chunk.m_lines;
+        chunk.m_rows = Table();
+    }
+    stats.m_rows = total;
+    stats.m_threads = count;
+    return true;
+}
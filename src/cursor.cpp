@@ -0,0 +1,284 @@
+/**
+ * @file cursor.cpp
+ * @brief 服务端游标的源文件，select的结果按批次一点一点读出来
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "cursor.h"
+
+#include <algorithm>
+#include <shared_mutex>
+
+#include "batch_filter.h"
+#include "table_index.h"
+
+/**
+ * @brief 只在本文件中使用的函数
+ */
+namespace {
+/**
+ * @brief 从Row_Source打开的时候一批要多少行
+ */
+constexpr size_t source_batch_rows = 4 * Batch_Filter::block_rows;
+
+/**
+ * @brief 把按某一列升序的行号反过来变成降序，值相同的行仍然按行号升序，和Row_Sorter排出来的一样
+ * @param  table，表
+ * @param  column，排序的列
+ * @param  rows，行号
+ */
+void reverse_order(const Table& table, int column, std::vector<size_t>& rows) {
+    std::reverse(rows.begin(), rows.end());
+    for (auto begin = rows.begin(); begin != rows.end();) {
+        auto end = begin + 1;
+        while (end != rows.end() and 0 == Where::compare(table, *begin, *end, column))
+            ++end;
+        std::reverse(begin, end);
+        begin = end;
+    }
+}
+
+}  // namespace
+
+void Cursor::_choose_columns(const Statement& statement) {
+    const Table& table = *m_table;
+    const std::vector<std::string_view>& show_columns = statement.m_columns;
+    m_columns.clear();
+    for (int i = 0; i < table.m_columns.size(); ++i) {
+        if (show_columns.empty() or
+            show_columns.end() != std::find(show_columns.begin(), show_columns.end(), table.m_columns[i].m_column_name))
+            m_columns.push_back(i);
+    }
+}
+
+bool Cursor::_order_keys(const Statement& statement, std::vector<Row_Sorter::Key>& keys) const {
+    const Table& table = *m_table;
+    for (const Statement::Order_Key& order : statement.m_order_by) {
+        Row_Sorter::Key key;
+        for (int i = 0; i < table.m_columns.size(); ++i)
+            if (order.m_column == table.m_columns[i].m_column_name)
+                key.m_column = i;
+        if (-1 == key.m_column)
+            return false;
+        key.m_desc = order.m_desc;
+        keys.push_back(key);
+    }
+    return true;
+}
+
+bool Cursor::open(std::shared_ptr<Row_Source> source, const Statement& statement) {
+    m_source = std::move(source);
+    m_batch = std::make_shared<Table>(m_source->schema());
+    m_batch->m_data.resize(m_batch->m_columns.size());
+    m_table = m_batch;
+    m_snapshot = m_batch->snapshot();
+    m_pos = 0;
+    m_rows.clear();
+    m_sort = false;
+    m_scan = true;
+    uint64_t offset, limit;
+    if (!statement.limits(offset, limit))
+        offset = 0, limit = UINT64_MAX;
+    m_skip = offset;
+    m_left = limit;
+    _choose_columns(statement);
+    std::vector<Row_Sorter::Key> keys;
+    if (!_order_keys(statement, keys)) {
+        m_source = nullptr;
+        return false;
+    }
+
+    // where条件中的列不存在，什么都查不到，不用再生成
+    m_has_where = statement.m_has_where;
+    m_cond = statement.m_where;
+    if (m_has_where and !Where::bind(*m_batch, m_cond)) {
+        m_source = nullptr;
+        return true;
+    }
+    if (keys.empty()) {
+        _refill();
+        return true;
+    }
+
+    // 要排序的时候所有的行都要看到，每一批中满足条件的行拷贝进m_sorter，这一批就可以丢掉了
+    m_scan = false;
+    m_sort = true;
+    m_skip = 0;
+    m_sorter.open_copy(*m_batch, std::move(keys), m_columns, UINT64_MAX == limit ? 0 : offset + limit);
+    uint32_t sel[Batch_Filter::block_rows];
+    for (;;) {
+        m_batch->clear_rows();
+        if (0 == m_source->next(*m_batch, source_batch_rows))
+            break;
+        Snapshot snapshot = m_batch->snapshot();
+        for (size_t begin = 0; begin < snapshot.m_rows; begin += Batch_Filter::block_rows) {
+            size_t end = std::min(begin + Batch_Filter::block_rows, snapshot.m_rows);
+            size_t n = Batch_Filter::filter_block(*m_batch, m_has_where ? &m_cond : nullptr, snapshot, begin, end, sel);
+            for (size_t k = 0; k < n; ++k)
+                m_sorter.add(*m_batch, begin + sel[k]);
+        }
+    }
+    m_batch->clear_rows();
+    m_source = nullptr;
+    m_sorter.finish();
+    const Table* from;
+    size_t row;
+    for (uint64_t i = 0; i < offset and m_sorter.next(from, row); ++i) {
+    }
+    return true;
+}
+
+void Cursor::_refill() {
+    while (nullptr != m_source and m_pos >= m_snapshot.m_rows) {
+        if (0 == m_left) {
+            m_source = nullptr;
+            break;
+        }
+        m_batch->clear_rows();
+        if (0 == m_source->next(*m_batch, source_batch_rows))
+            m_source = nullptr;
+        m_snapshot = m_batch->snapshot();
+        m_pos = 0;
+    }
+}
+
+bool Cursor::open(std::shared_ptr<const Table> table_ptr, const Statement& statement) {
+    m_source = nullptr;
+    m_batch = nullptr;
+    m_table = std::move(table_ptr);
+    const Table& table = *m_table;
+    m_snapshot = table.snapshot();
+    m_pos = 0;
+    m_rows.clear();
+    m_scan = false;
+    m_sort = false;
+    uint64_t offset, limit;
+    if (!statement.limits(offset, limit))
+        offset = 0, limit = UINT64_MAX;
+    m_skip = 0;
+    m_left = limit;
+
+    // 要显示的列，为空表示全部展示
+    _choose_columns(statement);
+
+    // order by的每一列对应的下标
+    std::vector<Row_Sorter::Key> keys;
+    if (!_order_keys(statement, keys))
+        return false;
+
+    // where条件中的列不存在，什么都查不到
+    m_has_where = statement.m_has_where;
+    m_cond = statement.m_where;
+    if (m_has_where and !Where::bind(table, m_cond))
+        return true;
+
+    // 不用排序也用不上索引的时候边扫描边过滤，不需要先把行号都算出来，offset也在扫描的时候跳过
+    bool use_index = m_has_where and Where::uses_index(table, m_cond);
+    if (keys.empty() and !use_index) {
+        m_scan = true;
+        m_skip = offset;
+        return true;
+    }
+
+    // 只需要排在前面的这么多行，为0表示全部
+    uint64_t top_k = UINT64_MAX == limit ? 0 : offset + limit;
+    int order_index = 1 == keys.size() ? keys[0].m_column : -1;
+    int index_column = m_has_where ? Where::index_column(table, m_cond) : -1;
+    if (-1 != order_index and Table_Index::has_btree(table, order_index) and order_index != index_column) {
+        // 只按一列排序并且这一列上有B+树索引，按索引的顺序遍历再过滤，不需要排序，
+        // 索引中有所有的版本，快照看不到的也去掉，找够前offset+limit行就不再往后找
+        std::vector<size_t> ordered;
+        Table_Index::ordered(table, order_index, ordered);
+        if (keys[0].m_desc)
+            reverse_order(table, order_index, ordered);
+        for (size_t i : ordered) {
+            if (0 != top_k and m_rows.size() >= top_k)
+                break;
+            if (table.visible(i, m_snapshot) and (!m_has_where or Where::match(table, i, m_cond)))
+                m_rows.push_back(i);
+        }
+        m_pos = std::min<size_t>(offset, m_rows.size());
+        return true;
+    }
+
+    if (use_index) {
+        // 条件中的列上有合适的索引，直接拿到满足条件的行，已经按排序的列有序的话不用再排
+        bool sorted = Where::find_rows(table, m_cond, m_snapshot, m_rows);
+        if (keys.empty() or (sorted and order_index == index_column)) {
+            if (!keys.empty() and keys[0].m_desc)
+                reverse_order(table, order_index, m_rows);
+            m_pos = std::min<size_t>(offset, m_rows.size());
+            return true;
+        }
+    }
+
+    // 其余的情况一边找满足条件的行一边交给m_sorter，有limit的时候它只留前offset+limit行
+    m_sort = true;
+    m_sorter.open(&table, std::move(keys), m_columns, top_k);
+    if (use_index) {
+        for (size_t i : m_rows)
+            m_sorter.add(i);
+        m_rows = std::vector<size_t>();
+    } else {
+        uint32_t sel[Batch_Filter::block_rows];
+        for (size_t begin = 0; begin < m_snapshot.m_rows; begin += Batch_Filter::block_rows) {
+            size_t end = std::min(begin + Batch_Filter::block_rows, m_snapshot.m_rows);
+            size_t n = Batch_Filter::filter_block(table, m_has_where ? &m_cond : nullptr, m_snapshot, begin, end, sel);
+            for (size_t k = 0; k < n; ++k)
+                m_sorter.add(begin + sel[k]);
+        }
+    }
+    m_sorter.finish();
+    const Table* from;
+    size_t row;
+    for (uint64_t i = 0; i < offset and m_sorter.next(from, row); ++i) {
+    }
+    return true;
+}
+
+uint64_t Cursor::fetch(uint64_t limit, Result_Sink& out) {
+    // 读哪些行由快照决定，锁只是不让别的连接在读的时候追加行(vector可能会扩容)
+    std::shared_lock<Read_Latches> lock(m_latches);
+    const Table& table = *m_table;
+    limit = std::min(limit, m_left);
+    uint64_t count = 0;
+    if (m_scan) {
+        // 一次对一块求条件，拿到选择向量之后再输出，批次满了就停在下一个没输出的行，下次从那里接着求
+        // 从Row_Source打开的时候table就是当前这一批，扫描完了换下一批
+        uint32_t sel[Batch_Filter::block_rows];
+        while (count < limit and !out.batch_full()) {
+            _refill();
+            if (m_pos >= m_snapshot.m_rows)
+                break;
+            size_t end = std::min(m_pos + Batch_Filter::block_rows, m_snapshot.m_rows);
+            size_t n = Batch_Filter::filter_block(table, m_has_where ? &m_cond : nullptr, m_snapshot, m_pos, end, sel);
+            // offset还没跳完的时候，这一块前面满足条件的行不输出
+            size_t k = std::min<uint64_t>(m_skip, n);
+            m_skip -= k;
+            for (; k < n and count < limit and !out.batch_full(); ++k, ++count)
+                out.add_row(table, m_pos + sel[k]);
+            m_pos = k < n ? m_pos + sel[k] : end;
+        }
+    } else if (m_sort) {
+        // 排序分段写到临时文件的时候，行是从有序段中解码出来的，不在打开时的表中
+        const Table* from;
+        size_t row;
+        while (count < limit and !out.batch_full() and m_sorter.next(from, row)) {
+            out.add_row(*from, row);
+            ++count;
+        }
+    } else {
+        for (; m_pos < m_rows.size() and count < limit and !out.batch_full(); ++m_pos, ++count)
+            out.add_row(table, m_rows[m_pos]);
+    }
+    m_left -= count;
+    // 提前要下一批，done()才知道是不是真的读完了
+    if (m_scan)
+        _refill();
+    return count;
+}
@@ -0,0 +1,856 @@
+/**
+ * @file hash_aggregate.cpp
+ * @brief 聚合查询(聚合函数和group by)的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "hash_aggregate.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+
+#include "batch_filter.h"
+#include "where_cond.h"
+
+/**
+ * @brief 只在本文件中使用的辅助函数和变量
+ */
+namespace {
+/**
+ * @brief 一条聚合查询的哈希表最多用的内存，由set_memory_limit设置
+ */
+size_t memory_limit = Hash_Aggregate::default_memory_limit;
+
+/**
+ * @brief 做部分聚合的线程池，由set_thread_pool设置
+ */
+Thread_Pool* thread_pool = nullptr;
+
+/**
+ * @brief 写到磁盘上的时候按哈希值的几位分成几个区，合并的时候一次只聚合一个区
+ */
+constexpr unsigned spill_bits = 4;
+constexpr size_t spill_partitions = 1 << spill_bits;
+
+/**
+ * @brief 每个线程至少分到这么多行，行少的时候开线程不划算
+ */
+constexpr size_t rows_per_worker = 1 << 16;
+
+/**
+ * @brief 一个分组上一个聚合函数的中间状态
+ *  count: m_count是行数
+ *  sum: m_value是和
+ *  avg: m_value是和，m_count是行数
+ *  min/max: int列的时候m_value是值，string列的时候m_value是值所在的行号，不拷贝字符串；
+ *           从Row_Source聚合的时候string列的值拷贝在自己的一行中，m_count是这一行的行号+1，值变了就改这一行
+ */
+struct State {
+    int64_t m_value = 0;
+    int64_t m_count = 0;
+};
+
+/**
+ * @brief 聚合函数和它的参数列
+ */
+struct Agg {
+    Statement::Aggregate::Func m_func;
+    int m_column = -1;
+    bool m_is_int = true;
+};
+
+/**
+ * @brief 从Row_Source聚合的时候每次读的行数
+ */
+constexpr size_t source_batch_rows = 1 << 16;
+
+/**
+ * @brief 绑定到表之后的聚合查询
+ */
+struct Plan {
+    const Table* m_table = nullptr;
+
+    /**
+     * @brief 从Row_Source聚合的时候当前的这一批，行号带上batch_bit的是这一批中的行，否则是m_table中的行
+     */
+    const Table* m_batch = nullptr;
+    static constexpr uint64_t batch_bit = 1ull << 63;
+
+    /**
+     * @brief 一行所在的表的一列，去掉行号上的batch_bit
+     */
+    const Column_Data& data(int column, size_t& row) const {
+        if (0 == (row & batch_bit))
+            return m_table->m_data[column];
+        row &= ~batch_bit;
+        return m_batch->m_data[column];
+    }
+
+    /**
+     * @brief 分组列的下标
+     */
+    std::vector<int> m_group;
+
+    /**
+     * @brief 聚合函数
+     */
+    std::vector<Agg> m_aggs;
+
+    /**
+     * @brief select中的每一项: 是分组列的时候m_column是列的下标，是聚合函数的时候m_agg是m_aggs的下标
+     */
+    struct Item {
+        int m_column = -1;
+        int m_agg = -1;
+    };
+    std::vector<Item> m_items;
+
+    /**
+     * @brief 一行在分组列上的哈希值，低位用来找槽，高位用来分区
+     */
+    uint64_t hash(size_t row) const {
+        uint64_t h = 0x9e3779b97f4a7c15ull;
+        for (int column : m_group) {
+            size_t r = row;
+            const Column_Data& d = data(column, r);
+            uint64_t x = m_table->is_int(column) ? (uint64_t)d.m_ints[r] : std::hash<std::string_view>()(d.m_strings[r]);
+            h = (h ^ x) * 0xff51afd7ed558ccdull;
+            h ^= h >> 32;
+        }
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * @brief 两行是不是在同一个分组
+     */
+    bool same_group(size_t a, size_t b) const {
+        for (int column : m_group) {
+            size_t ra = a, rb = b;
+            const Column_Data& x = data(column, ra);
+            const Column_Data& y = data(column, rb);
+            if (m_table->is_int(column) ? x.m_ints[ra] != y.m_ints[rb] : x.m_strings[ra] != y.m_strings[rb])
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 比较min/max的两个候选值
+     */
+    bool less(const Agg& agg, int64_t a, int64_t b) const {
+        if (agg.m_is_int)
+            return a < b;
+        size_t ra = a, rb = b;
+        const Column_Data& x = data(agg.m_column, ra);
+        const Column_Data& y = data(agg.m_column, rb);
+        return x.m_strings[ra] < y.m_strings[rb];
+    }
+
+    /**
+     * @brief min/max的候选值，int列是值，string列是行号
+     */
+    int64_t candidate(const Agg& agg, size_t row) const {
+        if (!agg.m_is_int)
+            return (int64_t)row;
+        const Column_Data& d = data(agg.m_column, row);
+        return d.m_ints[row];
+    }
+
+    /**
+     * @brief int列上的值
+     */
+    int64_t int_value(int column, size_t row) const {
+        const Column_Data& d = data(column, row);
+        return d.m_ints[row];
+    }
+
+    /**
+     * @brief 新分组的第一行，min/max先拿它的值
+     */
+    void init(State* states, size_t row) const {
+        for (size_t i = 0; i < m_aggs.size(); ++i) {
+            states[i] = State();
+            if (Statement::Aggregate::Min == m_aggs[i].m_func or Statement::Aggregate::Max == m_aggs[i].m_func)
+                states[i].m_value = candidate(m_aggs[i], row);
+        }
+    }
+
+    /**
+     * @brief 把一行聚合进分组
+     */
+    void update(State* states, size_t row) const {
+        for (size_t i = 0; i < m_aggs.size(); ++i) {
+            const Agg& agg = m_aggs[i];
+            State& state = states[i];
+            switch (agg.m_func) {
+            case Statement::Aggregate::Count:
+                ++state.m_count;
+                break;
+            case Statement::Aggregate::Sum:
+                state.m_value += int_value(agg.m_column, row);
+                break;
+            case Statement::Aggregate::Avg:
+                state.m_value += int_value(agg.m_column, row);
+                ++state.m_count;
+                break;
+            case Statement::Aggregate::Min:
+                if (less(agg, candidate(agg, row), state.m_value))
+                    state.m_value = candidate(agg, row);
+                break;
+            case Statement::Aggregate::Max:
+                if (less(agg, state.m_value, candidate(agg, row)))
+                    state.m_value = candidate(agg, row);
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief 合并同一个分组的两份中间状态
+     */
+    void merge(State* states, const State* other) const {
+        for (size_t i = 0; i < m_aggs.size(); ++i) {
+            const Agg& agg = m_aggs[i];
+            switch (agg.m_func) {
+            case Statement::Aggregate::Min:
+                if (less(agg, other[i].m_value, states[i].m_value))
+                    states[i].m_value = other[i].m_value;
+                break;
+            case Statement::Aggregate::Max:
+                if (less(agg, states[i].m_value, other[i].m_value))
+                    states[i].m_value = other[i].m_value;
+                break;
+            default:
+                states[i].m_value += other[i].m_value;
+                states[i].m_count += other[i].m_count;
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief 一个分组大约占的内存: 行号、哈希值、中间状态和两个槽(负载不超过一半)
+     */
+    size_t group_bytes() const { return 2 * sizeof(uint64_t) + m_aggs.size() * sizeof(State) + 2 * sizeof(uint32_t); }
+};
+
+/**
+ * @brief 开放地址(线性探测)的哈希表，分组按加入的顺序连续存放，槽里面只放分组的下标
+ */
+class Group_Table {
+public:
+    explicit Group_Table(const Plan& plan) : m_plan(plan), m_slots(initial_slots, 0) {}
+
+    size_t size() const { return m_rows.size(); }
+    size_t row(size_t group) const { return m_rows[group]; }
+    uint64_t hash(size_t group) const { return m_hashes[group]; }
+    State* states(size_t group) { return m_states.data() + group * m_plan.m_aggs.size(); }
+
+    /**
+     * @brief 把一行聚合进它的分组
+     * @return State*，这个分组的中间状态
+     */
+    State* add_row(size_t row, uint64_t hash) {
+        bool added;
+        State* states = _find_or_add(row, hash, added);
+        if (added)
+            m_plan.init(states, row);
+        m_plan.update(states, row);
+        return states;
+    }
+
+    /**
+     * @brief 换掉分组的第一行，从Row_Source聚合的时候拷贝之后指向拷贝
+     */
+    void set_row(size_t group, size_t row) { m_rows[group] = row; }
+
+    /**
+     * @brief 把别处同一个分组的中间状态合并进来
+     */
+    void merge(size_t row, uint64_t hash, const State* other) {
+        bool added;
+        State* states = _find_or_add(row, hash, added);
+        if (added)
+            std::copy(other, other + m_plan.m_aggs.size(), states);
+        else
+            m_plan.merge(states, other);
+    }
+
+    /**
+     * @brief 清空，槽的数组留着
+     */
+    void clear() {
+        std::fill(m_slots.begin(), m_slots.end(), 0);
+        m_rows.clear();
+        m_hashes.clear();
+        m_states.clear();
+    }
+
+private:
+    static constexpr size_t initial_slots = 1024;
+
+    State* _find_or_add(size_t row, uint64_t hash, bool& added) {
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            uint32_t slot = m_slots[i];
+            if (0 == slot) {
+                m_slots[i] = m_rows.size() + 1;
+                m_rows.push_back(row);
+                m_hashes.push_back(hash);
+                m_states.resize(m_states.size() + m_plan.m_aggs.size());
+                added = true;
+                if (m_rows.size() * 2 > m_slots.size())
+                    _grow();
+                return states(m_rows.size() - 1);
+            }
+            // 先比较哈希值，相等的才去比较表中的值
+            if (m_hashes[slot - 1] == hash and m_plan.same_group(m_rows[slot - 1], row)) {
+                added = false;
+                return states(slot - 1);
+            }
+        }
+    }
+
+    /**
+     * @brief 槽的个数翻倍，按记下的哈希值重新放，不用再算
+     */
+    void _grow() {
+        m_slots.assign(m_slots.size() * 2, 0);
+        size_t mask = m_slots.size() - 1;
+        for (size_t group = 0; group < m_rows.size(); ++group) {
+            size_t i = m_hashes[group] & mask;
+            while (0 != m_slots[i])
+                i = (i + 1) & mask;
+            m_slots[i] = group + 1;
+        }
+    }
+
+private:
+    const Plan& m_plan;
+
+    /**
+     * @brief 槽，放分组的下标+1，0表示空
+     */
+    std::vector<uint32_t> m_slots;
+
+    /**
+     * @brief 每个分组的第一行的行号、哈希值和中间状态(每个分组m_aggs.size()个)
+     */
+    std::vector<uint64_t> m_rows;
+    std::vector<uint64_t> m_hashes;
+    std::vector<State> m_states;
+};
+
+/**
+ * @brief 一个线程写到磁盘上的分组，按哈希值从m_shift开始的spill_bits位分到spill_partitions个临时文件中
+ *  一条记录是 行号 + 哈希值 + 中间状态，都是定长的，表在查询期间一直被持有，所以行号一直有效，不用写字符串
+ *  第一次按最高的几位分区，合并的时候一个分区还是放不下，就按接下来的几位再分一次
+ */
+class Spill {
+public:
+    explicit Spill(unsigned shift = 64 - spill_bits) : m_shift(shift) {}
+    Spill(const Spill&) = delete;
+    Spill& operator=(const Spill&) = delete;
+
+    ~Spill() {
+        for (FILE* file : m_files)
+            if (nullptr != file)
+                fclose(file);
+    }
+
+    bool used() const { return m_used; }
+
+    /**
+     * @brief 是否还有没有用过的哈希值的位，可以再分一次区
+     */
+    bool can_split() const { return m_shift >= spill_bits; }
+
+    unsigned shift() const { return m_shift; }
+
+    /**
+     * @brief 把哈希表中的分组都写出去
+     */
+    void write(const Plan& plan, Group_Table& groups) {
+        m_used = true;
+        size_t state_bytes = plan.m_aggs.size() * sizeof(State);
+        for (size_t group = 0; group < groups.size(); ++group) {
+            FILE*& file = m_files[(groups.hash(group) >> m_shift) & (spill_partitions - 1)];
+            // 临时文件关闭之后自动删掉
+            if (nullptr == file and nullptr == (file = tmpfile())) {
+                perror("tmpfile");
+                exit(-1);
+            }
+            uint64_t head[2] = {groups.row(group), groups.hash(group)};
+            if (1 != fwrite(head, sizeof(head), 1, file) or
+                (0 != state_bytes and 1 != fwrite(groups.states(group), state_bytes, 1, file))) {
+                perror("fwrite");
+                exit(-1);
+            }
+        }
+    }
+
+    /**
+     * @brief 从头读一个分区，每条记录调用一次f(行号, 哈希值, 中间状态)
+     */
+    template <typename F>
+    void read(const Plan& plan, size_t partition, F f) {
+        FILE* file = m_files[partition];
+        if (nullptr == file)
+            return;
+        rewind(file);
+        uint64_t head[2];
+        std::vector<State> states(plan.m_aggs.size());
+        size_t state_bytes = states.size() * sizeof(State);
+        while (1 == fread(head, sizeof(head), 1, file)) {
+            if (0 != state_bytes and 1 != fread(states.data(), state_bytes, 1, file))
+                break;
+            f(head[0], head[1], states.data());
+        }
+    }
+
+private:
+    FILE* m_files[spill_partitions] = {};
+    bool m_used = false;
+    unsigned m_shift;
+};
+
+/**
+ * @brief 一个线程的部分聚合
+ */
+struct Worker {
+    explicit Worker(const Plan& plan) : m_groups(plan) {}
+
+    Group_Table m_groups;
+    Spill m_spill;
+};
+
+/**
+ * @brief avg的结果，最多保留4位小数，去掉末尾的0
+ */
+std::string format_avg(const State& state) {
+    if (0 == state.m_count)
+        return "null";
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.4Lf", (long double)state.m_value / state.m_count);
+    std::string text = buf;
+    while ('0' == text.back())
+        text.pop_back();
+    if ('.' == text.back())
+        text.pop_back();
+    return text;
+}
+
+/**
+ * @brief 把哈希表中的分组作为结果行追加到result中，rows记下每个结果行对应的分组的第一行
+ */
+void emit(const Plan& plan, Group_Table& groups, Table& result, std::vector<size_t>& rows) {
+    const Table& table = *plan.m_table;
+    for (size_t group = 0; group < groups.size(); ++group) {
+        size_t row = groups.row(group);
+        const State* states = groups.states(group);
+        for (size_t i = 0; i < plan.m_items.size(); ++i) {
+            const Plan::Item& item = plan.m_items[i];
+            Column_Data& out = result.m_data[i];
+            if (-1 != item.m_column) {
+                if (table.is_int(item.m_column))
+                    out.m_ints.push_back(table.m_data[item.m_column].m_ints[row]);
+                else
+                    out.m_strings.push_back(table.m_data[item.m_column].m_strings[row]);
+                continue;
+            }
+            const Agg& agg = plan.m_aggs[item.m_agg];
+            const State& state = states[item.m_agg];
+            switch (agg.m_func) {
+            case Statement::Aggregate::Count:
+                out.m_ints.push_back(state.m_count);
+                break;
+            case Statement::Aggregate::Sum:
+                out.m_ints.push_back(state.m_value);
+                break;
+            case Statement::Aggregate::Avg:
+                out.m_strings.push_back(format_avg(state));
+                break;
+            default:
+                if (agg.m_is_int)
+                    out.m_ints.push_back(state.m_value);
+                else
+                    out.m_strings.push_back(table.m_data[agg.m_column].m_strings[state.m_value]);
+                break;
+            }
+        }
+        rows.push_back(row);
+        ++result.m_row_count;
+    }
+}
+
+/**
+ * @brief 把几个Spill中同一个分区的分组合并后追加到result中，分区之间没有相同的分组
+ *  合并出来的分组超过group_limit的时候写到按下一级分区的临时文件中，最后再递归地一个分区一个分区地合并
+ */
+void merge_partition(const Plan& plan, const std::vector<Spill*>& spills, size_t partition, size_t group_limit,
+                     Table& result, std::vector<size_t>& rows) {
+    Group_Table merged(plan);
+    Spill overflow(spills[0]->shift() - spill_bits);
+    for (Spill* spill : spills)
+        spill->read(plan, partition, [&](size_t row, uint64_t hash, const State* states) {
+            merged.merge(row, hash, states);
+            // 哈希值的位都用完了说明这些分组的哈希值只差在分区用不到的位上，只能留在内存中
+            if (merged.size() > group_limit and spills[0]->can_split()) {
+                overflow.write(plan, merged);
+                merged.clear();
+            }
+        });
+    if (!overflow.used()) {
+        emit(plan, merged, result, rows);
+        return;
+    }
+    overflow.write(plan, merged);
+    merged.clear();
+    std::vector<Spill*> next = {&overflow};
+    for (size_t sub = 0; sub < spill_partitions; ++sub)
+        merge_partition(plan, next, sub, group_limit, result, rows);
+}
+
+/**
+ * @brief 没有group by、也没有要聚合的行的时候的那一行结果: count和sum是0，avg、min和max没有值，都是null
+ *  int类型的min和max放不下null，这一列改成string类型
+ */
+void emit_empty(const Plan& plan, Table& result) {
+    for (size_t i = 0; i < plan.m_items.size(); ++i) {
+        Column_Data& out = result.m_data[i];
+        switch (plan.m_aggs[plan.m_items[i].m_agg].m_func) {
+        case Statement::Aggregate::Count:
+        case Statement::Aggregate::Sum:
+            out.m_ints.push_back(0);
+            break;
+        default:
+            result.m_columns[i].m_column_type = "string";
+            out.m_strings.push_back("null");
+            break;
+        }
+    }
+    ++result.m_row_count;
+}
+
+/**
+ * @brief 列名对应的下标，不存在的时候返回-1
+ */
+int find_column(const Table& table, std::string_view name) {
+    for (int i = 0; i < table.m_columns.size(); ++i)
+        if (name == table.m_columns[i].m_column_name)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief 检查语句并绑定到表上
+ */
+bool make_plan(const Table& table, const Statement& statement, Plan& plan, std::string& error) {
+    plan.m_table = &table;
+    if (statement.m_columns.empty()) {
+        error = "聚合查询需要写出要显示的列和聚合函数,不能用 * !";
+        return false;
+    }
+    for (std::string_view name : statement.m_group_columns) {
+        int column = find_column(table, name);
+        if (-1 == column) {
+            error = "表 " + table.m_table_name + " 中不存在字段 " + std::string(name) + " ,无法分组!";
+            return false;
+        }
+        plan.m_group.push_back(column);
+    }
+
+    plan.m_items.resize(statement.m_columns.size());
+    for (const Statement::Aggregate& aggregate : statement.m_aggregates) {
+        Agg agg{aggregate.m_func};
+        if (!aggregate.m_column.empty()) {
+            agg.m_column = find_column(table, aggregate.m_column);
+            if (-1 == agg.m_column) {
+                error = "表 " + table.m_table_name + " 中不存在字段 " + std::string(aggregate.m_column) + " ,请检查之后重新输入!";
+                return false;
+            }
+            agg.m_is_int = table.is_int(agg.m_column);
+            if (!agg.m_is_int and (Statement::Aggregate::Sum == agg.m_func or Statement::Aggregate::Avg == agg.m_func)) {
+                error = "字段 " + std::string(aggregate.m_column) + " 是string类型,不能求和或者求平均值!";
+                return false;
+            }
+        }
+        plan.m_items[aggregate.m_item].m_agg = plan.m_aggs.size();
+        plan.m_aggs.push_back(agg);
+    }
+
+    // 不是聚合函数的列必须是分组列，否则一个分组中有多个不同的值
+    for (size_t i = 0; i < plan.m_items.size(); ++i) {
+        if (-1 != plan.m_items[i].m_agg)
+            continue;
+        std::string_view name = statement.m_columns[i];
+        int column = find_column(table, name);
+        if (plan.m_group.end() == std::find(plan.m_group.begin(), plan.m_group.end(), column)) {
+            error = "字段 " + std::string(name) + " 不在group by中,不能和聚合函数一起查询!";
+            return false;
+        }
+        plan.m_items[i].m_column = column;
+    }
+    return true;
+}
+
+/**
+ * @brief 结果的列: 分组列保持原来的类型，count和sum是int，min和max和参数列一样，avg有小数，用string
+ */
+void start_result(const Plan& plan, const Table& table, const Statement& statement, Table& result) {
+    result = Table();
+    result.m_table_name = table.m_table_name;
+    for (size_t i = 0; i < plan.m_items.size(); ++i) {
+        const Plan::Item& item = plan.m_items[i];
+        std::string type = "int";
+        if (-1 != item.m_column)
+            type = table.m_columns[item.m_column].m_column_type;
+        else if (Statement::Aggregate::Avg == plan.m_aggs[item.m_agg].m_func)
+            type = "string";
+        else if (-1 != plan.m_aggs[item.m_agg].m_column and !plan.m_aggs[item.m_agg].m_is_int)
+            type = "string";
+        result.m_columns.emplace_back(Hash_Aggregate::column_name(statement.m_columns[i]), type);
+    }
+    result.m_data.resize(result.m_columns.size());
+}
+
+/**
+ * @brief 所有的分组都在result中了之后: 没有group by的时候保证有一行，有group by的时候按分组列排序
+ * @param  rows，每个结果行对应的分组的第一行，在plan.m_table中
+ */
+void finish_result(const Plan& plan, const std::vector<size_t>& rows, Table& result) {
+    const Table& table = *plan.m_table;
+
+    // 没有group by的时候即使一行都没有也要有一行结果
+    if (plan.m_group.empty() and 0 == result.m_row_count)
+        emit_empty(plan, result);
+
+    // 分组在哈希表中是无序的，按分组列排好，输出稳定
+    if (!plan.m_group.empty() and result.m_row_count > 1) {
+        std::vector<size_t> order(result.m_row_count);
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            for (int column : plan.m_group) {
+                int cmp = Where::compare(table, rows[a], rows[b], column);
+                if (0 != cmp)
+                    return cmp < 0;
+            }
+            return false;
+        });
+        for (size_t i = 0; i < result.m_data.size(); ++i) {
+            Column_Data sorted;
+            if (result.is_int(i)) {
+                sorted.m_ints.reserve(order.size());
+                for (size_t j : order)
+                    sorted.m_ints.push_back(result.m_data[i].m_ints[j]);
+            } else {
+                sorted.m_strings.reserve(order.size());
+                for (size_t j : order)
+                    sorted.m_strings.push_back(result.m_data[i].m_strings[j]);
+            }
+            result.m_data[i] = std::move(sorted);
+        }
+    }
+}
+
+}  // namespace
+
+void Hash_Aggregate::set_thread_pool(Thread_Pool* pool) { thread_pool = pool; }
+
+void Hash_Aggregate::set_memory_limit(size_t bytes) {
+    memory_limit = std::max<size_t>(bytes, 1 << 16);
+}
+
+std::string Hash_Aggregate::column_name(std::string_view text) {
+    std::string name;
+    for (char ch : text)
+        if (' ' != ch and '\t' != ch and '\n' != ch and '\r' != ch)
+            name += ch;
+    return name;
+}
+
+bool Hash_Aggregate::run(const Table& table, const Statement& statement, Table& result, std::string& error) {
+    Plan plan;
+    if (!make_plan(table, statement, plan, error))
+        return false;
+
+    start_result(plan, table, statement, result);
+
+    // 要聚合的行: where能用上索引的时候先找出来，否则按块扫描的时候再求条件
+    Snapshot snapshot = table.snapshot();
+    Where_Expr where = statement.m_where;
+    const Where_Expr* cond = nullptr;
+    bool use_rows = false;
+    std::vector<size_t> candidates;
+    if (statement.m_has_where) {
+        cond = &where;
+        // 列不存在或者int列的值不是整数，和delete、update一样告诉用户，不返回空的聚合结果
+        if (!Where::bind(table, where)) {
+            error = "您输入的where条件 " + Where::text(where) + " 似乎不准确,无法聚合!";
+            return false;
+        }
+        if (Where::uses_index(table, where)) {
+            Where::find_rows(table, where, snapshot, candidates);
+            use_rows = true;
+        }
+    }
+    size_t total = use_rows ? candidates.size() : snapshot.m_rows;
+
+    // 按行分给线程池中的几个线程，每个线程在自己的哈希表中做部分聚合，分组多到超过自己那份内存的时候写到磁盘上
+    size_t threads = nullptr == thread_pool ? 1 : thread_pool->size();
+    size_t worker_count = std::clamp<size_t>(total / rows_per_worker, 1, threads);
+    size_t group_limit = std::max<size_t>(memory_limit / plan.group_bytes() / worker_count, 1024);
+    std::deque<Worker> workers;
+    for (size_t w = 0; w < worker_count; ++w)
+        workers.emplace_back(plan);
+
+    auto work = [&](size_t w) {
+        Worker& worker = workers[w];
+        auto add = [&](size_t row) {
+            worker.m_groups.add_row(row, plan.hash(row));
+            if (worker.m_groups.size() > group_limit) {
+                worker.m_spill.write(plan, worker.m_groups);
+                worker.m_groups.clear();
+            }
+        };
+        if (use_rows) {
+            for (size_t i = total * w / worker_count, end = total * (w + 1) / worker_count; i < end; ++i)
+                add(candidates[i]);
+            return;
+        }
+        // 按块分，每个线程拿连续的若干块
+        size_t blocks = (total + Batch_Filter::block_rows - 1) / Batch_Filter::block_rows;
+        size_t end = std::min(total, blocks * (w + 1) / worker_count * Batch_Filter::block_rows);
+        uint32_t sel[Batch_Filter::block_rows];
+        for (size_t begin = blocks * w / worker_count * Batch_Filter::block_rows; begin < end; begin += Batch_Filter::block_rows) {
+            size_t n = Batch_Filter::filter_block(table, cond, snapshot, begin, end, sel);
+            for (size_t k = 0; k < n; ++k)
+                add(begin + sel[k]);
+        }
+    };
+    if (nullptr == thread_pool)
+        work(0);
+    else
+        thread_pool->parallel_for(worker_count, work);
+
+    // 合并: 放得下的时候都合并到第一个线程的哈希表中；否则全部写到磁盘上，一个分区一个分区地合并
+    std::vector<size_t> rows;
+    size_t merge_limit = std::max<size_t>(memory_limit / plan.group_bytes(), 1024);
+    size_t groups = 0;
+    bool spilled = false;
+    for (Worker& worker : workers) {
+        groups += worker.m_groups.size();
+        spilled = spilled or worker.m_spill.used();
+    }
+    if (!spilled and groups <= merge_limit) {
+        Group_Table& merged = workers[0].m_groups;
+        for (size_t w = 1; w < worker_count; ++w) {
+            Group_Table& part = workers[w].m_groups;
+            for (size_t group = 0; group < part.size(); ++group)
+                merged.merge(part.row(group), part.hash(group), part.states(group));
+        }
+        emit(plan, merged, result, rows);
+    } else {
+        std::vector<Spill*> spills;
+        for (Worker& worker : workers) {
+            worker.m_spill.write(plan, worker.m_groups);
+            worker.m_groups.clear();
+            spills.push_back(&worker.m_spill);
+        }
+        for (size_t partition = 0; partition < spill_partitions; ++partition)
+            merge_partition(plan, spills, partition, merge_limit, result, rows);
+    }
+
+    finish_result(plan, rows, result);
+    return true;
+}
+
+bool Hash_Aggregate::run(Row_Source& source, const Statement& statement, Table& result, std::string& error) {
+    // 分组的第一行和string列的min/max的值拷贝到keep中，读过的批次就可以丢掉，内存只和分组的个数有关
+    Table keep = source.schema();
+    keep.m_data.resize(keep.m_columns.size());
+    Plan plan;
+    if (!make_plan(keep, statement, plan, error))
+        return false;
+    start_result(plan, keep, statement, result);
+
+    Where_Expr where = statement.m_where;
+    const Where_Expr* cond = nullptr;
+    if (statement.m_has_where) {
+        cond = &where;
+        if (!Where::bind(keep, where)) {
+            error = "您输入的where条件 " + Where::text(where) + " 似乎不准确,无法聚合!";
+            return false;
+        }
+    }
+
+    // 一批一批地聚合进同一个哈希表，分组多到超过内存上限的时候写到磁盘上，和从表聚合一样一个分区一个分区地合并
+    Group_Table groups(plan);
+    Spill spill;
+    size_t group_limit = std::max<size_t>(memory_limit / plan.group_bytes(), 1024);
+    Table batch = source.schema();
+    batch.m_data.resize(batch.m_columns.size());
+    plan.m_batch = &batch;
+    auto add = [&](size_t row) {
+        size_t id = row | Plan::batch_bit;
+        size_t before = groups.size();
+        State* states = groups.add_row(id, plan.hash(id));
+        if (groups.size() != before) {
+            keep.append_row_from(batch, row);
+            groups.set_row(groups.size() - 1, keep.m_row_count - 1);
+        }
+        for (size_t i = 0; i < plan.m_aggs.size(); ++i) {
+            const Agg& agg = plan.m_aggs[i];
+            State& state = states[i];
+            if (agg.m_is_int or (int64_t)id != state.m_value)
+                continue;
+            if (0 == state.m_count) {
+                keep.append_row_from(batch, row);
+                state.m_count = keep.m_row_count;
+            } else {
+                keep.m_data[agg.m_column].m_strings.set(state.m_count - 1, batch.m_data[agg.m_column].m_strings[row]);
+            }
+            state.m_value = state.m_count - 1;
+        }
+        if (groups.size() > group_limit) {
+            spill.write(plan, groups);
+            groups.clear();
+        }
+    };
+    uint32_t sel[Batch_Filter::block_rows];
+    while (0 != source.next(batch, source_batch_rows)) {
+        Snapshot snapshot = batch.snapshot();
+        for (size_t begin = 0; begin < snapshot.m_rows; begin += Batch_Filter::block_rows) {
+            size_t n = Batch_Filter::filter_block(batch, cond, snapshot, begin, snapshot.m_rows, sel);
+            for (size_t k = 0; k < n; ++k)
+                add(begin + sel[k]);
+        }
+        batch.clear_rows();
+    }
+    plan.m_batch = nullptr;
+
+    std::vector<size_t> rows;
+    if (!spill.used()) {
+        emit(plan, groups, result, rows);
+    } else {
+        spill.write(plan, groups);
+        groups.clear();
+        std::vector<Spill*> spills = {&spill};
+        for (size_t partition = 0; partition < spill_partitions; ++partition)
+            merge_partition(plan, spills, partition, group_limit, result, rows);
+    }
+    finish_result(plan, rows, result);
+    return true;
+}
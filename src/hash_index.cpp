@@ -0,0 +1,180 @@
+/**
+ * @file hash_index.cpp
+ * @brief 建在某一列上的哈希索引的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "hash_index.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+/**
+ * @brief 索引文件头
+ */
+struct Index_Header {
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint64_t m_lsn;
+    uint64_t m_row_count;
+    uint64_t m_key_count;
+};
+
+template <typename T>
+void put(std::string& buf, T value) {
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool get(const char*& pos, const char* end, T& value) {
+    if ((size_t)(end - pos) < sizeof(value))
+        return false;
+    memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+}  // namespace
+
+void Hash_Index::build(const Table& table, int column) {
+    m_map.clear();
+    m_map.reserve(table.m_row_count);
+    for (size_t i = 0; i < table.m_row_count; ++i)
+        m_map[table.cell(i, column)].push_back(i);
+    m_entries = table.m_row_count;
+}
+
+void Hash_Index::insert(const std::string& key, size_t row) {
+    std::vector<size_t>& rows = m_map[key];
+    // 插入的新行总是在最后，直接放到末尾；修改的时候才需要找位置
+    if (rows.empty() or rows.back() < row)
+        rows.push_back(row);
+    else
+        rows.insert(std::lower_bound(rows.begin(), rows.end(), row), row);
+    ++m_entries;
+}
+
+void Hash_Index::erase(const std::string& key, size_t row) {
+    auto it = m_map.find(key);
+    if (m_map.end() == it)
+        return;
+
+    std::vector<size_t>& rows = it->second;
+    auto pos = std::lower_bound(rows.begin(), rows.end(), row);
+    if (rows.end() == pos or row != *pos)
+        return;
+
+    rows.erase(pos);
+    --m_entries;
+    if (rows.empty())
+        m_map.erase(it);
+}
+
+const std::vector<size_t>* Hash_Index::find(const std::string& key) const {
+    auto it = m_map.find(key);
+    return m_map.end() == it ? nullptr : &it->second;
+}
+
+void Hash_Index::save(const std::string& path, uint64_t lsn, uint64_t row_count) const {
+    std::string buf;
+    buf.reserve(sizeof(Index_Header) + m_map.size() * 16 + m_entries * sizeof(uint64_t));
+
+    Index_Header header = {magic, version, lsn, row_count, m_map.size()};
+    put(buf, header);
+    for (auto& [key, rows] : m_map) {
+        put<uint32_t>(buf, key.size());
+        buf += key;
+        put<uint32_t>(buf, rows.size());
+        for (size_t row : rows)
+            put<uint64_t>(buf, row);
+    }
+
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+    if ((ssize_t)buf.size() != write(fd, buf.data(), buf.size())) {
+        perror("write");
+        exit(-1);
+    }
+    close(fd);
+
+    if (-1 == rename(tmp_path.c_str(), path.c_str())) {
+        perror("rename");
+        exit(-1);
+    }
+}
+
+bool Hash_Index::load(const std::string& path, uint64_t lsn, uint64_t row_count) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd)
+        return false;
+
+    struct stat st;
+    std::string buf;
+    if (0 == fstat(fd, &st)) {
+        buf.resize(st.st_size);
+        if (st.st_size != pread(fd, buf.data(), buf.size(), 0))
+            buf.clear();
+    }
+    close(fd);
+
+    const char* pos = buf.data();
+    const char* end = buf.data() + buf.size();
+    Index_Header header;
+    if (!get(pos, end, header) or magic != header.m_magic or version != header.m_version or lsn != header.m_lsn or
+        row_count != header.m_row_count)
+        return false;
+
+    m_map.clear();
+    m_map.reserve(header.m_key_count);
+    m_entries = 0;
+    for (uint64_t i = 0; i < header.m_key_count; ++i) {
+        uint32_t key_len, row_nums;
+        if (!get(pos, end, key_len) or (size_t)(end - pos) < key_len)
+            return false;
+        std::string key(pos, key_len);
+        pos += key_len;
+
+        if (!get(pos, end, row_nums) or (size_t)(end - pos) < (size_t)row_nums * sizeof(uint64_t))
+            return false;
+        std::vector<size_t>& rows = m_map[std::move(key)];
+        rows.resize(row_nums);
+        for (uint32_t j = 0; j < row_nums; ++j) {
+            uint64_t row;
+            get(pos, end, row);
+            if (row >= row_count)
+                return false;
+            rows[j] = row;
+        }
+        m_entries += row_nums;
+    }
+
+    return m_entries == row_count;
+}
+
+size_t Hash_Index::bytes() const {
+    // 每个键算上节点、桶和vector的开销大约64字节
+    size_t bytes = sizeof(*this) + m_entries * sizeof(size_t) + m_map.size() * 64;
+    for (auto& [key, rows] : m_map)
+        if (key.capacity() > 15)
+            bytes += key.capacity() + 1;
+    return bytes;
+}
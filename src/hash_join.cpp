@@ -0,0 +1,689 @@
+/**
+ * @file hash_join.cpp
+ * @brief 两张表等值连接(join)的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "hash_join.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "batch_filter.h"
+#include "where_cond.h"
+
+/**
+ * @brief 只在本文件中使用的辅助函数和变量
+ */
+namespace {
+/**
+ * @brief 一条join的哈希表最多用的内存，由set_memory_limit设置
+ */
+size_t memory_limit = Hash_Join::default_memory_limit;
+
+/**
+ * @brief 写到磁盘上的时候按哈希值的几位分成几个区，一次只连接一个区
+ */
+constexpr unsigned spill_bits = 4;
+constexpr size_t spill_partitions = 1 << spill_bits;
+
+/**
+ * @brief 哈希表中一行大约用多少内存: 行号、哈希值、链表的下一项，再加上平均两个桶
+ */
+constexpr size_t entry_bytes = 32;
+
+/**
+ * @brief 一行和它在连接列上的哈希值，写到临时文件中的也是这样一条定长的记录
+ */
+struct Entry {
+    uint64_t m_row;
+    uint64_t m_hash;
+};
+
+/**
+ * @brief 连接的一边
+ */
+struct Side {
+    const Table* m_table = nullptr;
+
+    /**
+     * @brief 连接列的下标
+     */
+    int m_column = -1;
+
+    /**
+     * @brief 快照中可见并且满足下推的条件的行
+     */
+    std::vector<size_t> m_rows;
+
+    /**
+     * @brief 一行在连接列上的哈希值，低位用来找桶，高位用来分区
+     */
+    uint64_t hash(size_t row) const {
+        const Column_Data& data = m_table->m_data[m_column];
+        uint64_t h = m_table->is_int(m_column) ? (uint64_t)data.m_ints[row] : std::hash<std::string_view>()(data.m_strings[row]);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+/**
+ * @brief 两边的两行在连接列上的值是否相等
+ */
+bool same_key(const Side& a, size_t row_a, const Side& b, size_t row_b) {
+    const Column_Data& x = a.m_table->m_data[a.m_column];
+    const Column_Data& y = b.m_table->m_data[b.m_column];
+    return a.m_table->is_int(a.m_column) ? x.m_ints[row_a] == y.m_ints[row_b] : x.m_strings[row_a] == y.m_strings[row_b];
+}
+
+/**
+ * @brief build一边的哈希表，桶中放链表头，同一个桶的行用m_next串起来
+ */
+class Build_Table {
+public:
+    /**
+     * @brief 清空，准备放rows行
+     */
+    void reset(size_t rows) {
+        size_t buckets = 16;
+        while (buckets < rows * 2)
+            buckets <<= 1;
+        m_mask = buckets - 1;
+        m_heads.assign(buckets, none);
+        m_next.clear();
+        m_entries.clear();
+        m_next.reserve(rows);
+        m_entries.reserve(rows);
+    }
+
+    void add(const Entry& entry) {
+        uint32_t& head = m_heads[entry.m_hash & m_mask];
+        m_next.push_back(head);
+        head = m_entries.size();
+        m_entries.push_back(entry);
+    }
+
+    /**
+     * @brief 哈希值相同的每一行调用一次f(行号)，键是否相等由调用的人比较
+     */
+    template <typename F>
+    void probe(uint64_t hash, F f) const {
+        for (uint32_t i = m_heads[hash & m_mask]; none != i; i = m_next[i])
+            if (hash == m_entries[i].m_hash)
+                f(m_entries[i].m_row);
+    }
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    uint64_t m_mask = 0;
+    std::vector<uint32_t> m_heads;
+    std::vector<uint32_t> m_next;
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * @brief 一边写到磁盘上的行，按哈希值从m_shift开始的spill_bits位分到spill_partitions个临时文件中
+ *  表在查询期间一直被持有，所以行号一直有效，不用写值
+ *  第一次按最高的几位分区，一个分区的build一边还是放不下的时候，两边的这个分区再按接下来的几位分一次
+ */
+class Partitions {
+public:
+    explicit Partitions(unsigned shift = 64 - spill_bits) : m_shift(shift) {}
+    Partitions(const Partitions&) = delete;
+    Partitions& operator=(const Partitions&) = delete;
+
+    ~Partitions() {
+        for (FILE* file : m_files)
+            if (nullptr != file)
+                fclose(file);
+    }
+
+    /**
+     * @brief 是否还有没有用过的哈希值的位，可以再分一次区
+     */
+    bool can_split() const { return m_shift >= spill_bits; }
+
+    unsigned shift() const { return m_shift; }
+
+    void write(const Entry& entry) {
+        size_t partition = (entry.m_hash >> m_shift) & (spill_partitions - 1);
+        FILE*& file = m_files[partition];
+        // 临时文件关闭之后自动删掉
+        if (nullptr == file and nullptr == (file = tmpfile())) {
+            perror("tmpfile");
+            exit(-1);
+        }
+        if (1 != fwrite(&entry, sizeof(entry), 1, file)) {
+            perror("fwrite");
+            exit(-1);
+        }
+        ++m_rows[partition];
+    }
+
+    size_t rows(size_t partition) const { return m_rows[partition]; }
+
+    /**
+     * @brief 一个分区已经分到下一级了，删掉它的临时文件
+     */
+    void drop(size_t partition) {
+        if (nullptr != m_files[partition])
+            fclose(m_files[partition]);
+        m_files[partition] = nullptr;
+        m_rows[partition] = 0;
+    }
+
+    /**
+     * @brief 准备从头读一个分区
+     */
+    void restart(size_t partition) {
+        if (nullptr != m_files[partition])
+            rewind(m_files[partition]);
+    }
+
+    /**
+     * @brief 接着上次读到的位置读一批记录放在buffer中，分区读完了返回false
+     */
+    bool read_some(size_t partition, std::vector<Entry>& buffer) {
+        FILE* file = m_files[partition];
+        buffer.resize(read_batch);
+        size_t n = nullptr == file ? 0 : fread(buffer.data(), sizeof(Entry), buffer.size(), file);
+        buffer.resize(n);
+        return 0 != n;
+    }
+
+    /**
+     * @brief 从头读一个分区，每条记录调用一次f(记录)
+     */
+    template <typename F>
+    void read(size_t partition, F f) {
+        FILE* file = m_files[partition];
+        if (nullptr == file)
+            return;
+        rewind(file);
+        std::vector<Entry> buffer;
+        while (read_some(partition, buffer))
+            for (const Entry& entry : buffer)
+                f(entry);
+    }
+
+private:
+    static constexpr size_t read_batch = 4096;
+
+    FILE* m_files[spill_partitions] = {};
+    size_t m_rows[spill_partitions] = {};
+    unsigned m_shift;
+};
+
+/**
+ * @brief 列名对应到结果中的列，a.x只找a表的x，x在两张表中都找
+ * @return int，结果中的下标，不存在的时候返回-1，两张表中都有的时候返回-2
+ */
+int find_column(const Table& result, std::string_view name) {
+    int found = -1;
+    for (int i = 0; i < result.m_columns.size(); ++i) {
+        const std::string& column = result.m_columns[i].m_column_name;
+        if (name == column)
+            return i;
+        if (std::string_view::npos == name.find('.') and column.size() > name.size() and column.ends_with(name) and
+            '.' == column[column.size() - name.size() - 1]) {
+            if (-1 != found)
+                return -2;
+            found = i;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief 子条件涉及哪一张表，0是左边，1是右边，两张表都涉及或者有列不存在的时候返回-1
+ */
+int node_side(const Where_Expr::Tree& tree, int i, const std::vector<int>& cond_sides) {
+    const Where_Expr::Node& node = tree.node(i);
+    if (Where_Expr::Cond == node.m_kind)
+        return cond_sides[node.m_cond];
+    int side = -1;
+    for (int child : node.m_children) {
+        int child_side = node_side(tree, child, cond_sides);
+        if (-1 == child_side or (-1 != side and child_side != side))
+            return -1;
+        side = child_side;
+    }
+    return side;
+}
+
+/**
+ * @brief 把子树拷贝到out中，列名去掉表名，返回新的节点
+ */
+int copy_node(const Where_Expr::Tree& in, int i, Where_Expr::Tree& out) {
+    const Where_Expr::Node& node = in.node(i);
+    if (Where_Expr::Cond == node.m_kind) {
+        Where_Cond cond = in.cond(node);
+        cond.m_column = cond.m_column.substr(cond.m_column.find('.') + 1);
+        out.m_conds.push_back(std::move(cond));
+        return out.add(Where_Expr::Cond, out.m_conds.size() - 1);
+    }
+    std::vector<int> children;
+    for (int child : node.m_children)
+        children.push_back(copy_node(in, child, out));
+    return out.add(node.m_kind, -1, std::move(children));
+}
+
+/**
+ * @brief where最外层用and连起来的子条件中，只涉及side这一张表的那些拷贝到out中
+ * @return bool，没有这样的子条件的时候返回false
+ */
+bool push_down(const Where_Expr::Tree& tree, const std::vector<int>& cond_sides, int side, Where_Expr::Tree& out) {
+    std::vector<int> parts{tree.m_root};
+    if (Where_Expr::And == tree.root().m_kind)
+        parts = tree.root().m_children;
+    std::vector<int> children;
+    for (int part : parts)
+        if (side == node_side(tree, part, cond_sides))
+            children.push_back(copy_node(tree, part, out));
+    if (children.empty())
+        return false;
+    out.m_root = 1 == children.size() ? children[0] : out.add(Where_Expr::And, -1, std::move(children));
+    return true;
+}
+
+/**
+ * @brief 找出一边快照中可见并且满足下推的条件的行
+ */
+void collect_rows(Side& side, int index, const Statement& view, const std::vector<int>& cond_sides) {
+    const Table& table = *side.m_table;
+    Snapshot snapshot = table.snapshot();
+    Where_Expr where;
+    if (view.m_has_where and push_down(view.m_where.m_parsed, cond_sides, index, where.m_parsed)) {
+        // 条件不对的时候这一边没有行，连接的结果也是空的
+        if (!Where::bind(table, where))
+            return;
+        if (Where::uses_index(table, where))
+            Where::find_rows(table, where, snapshot, side.m_rows);
+        else
+            Batch_Filter::filter(table, where, snapshot, side.m_rows);
+        return;
+    }
+    for (size_t i = 0; i < snapshot.m_rows; ++i)
+        if (table.visible(i, snapshot))
+            side.m_rows.push_back(i);
+}
+
+/**
+ * @brief 连接的结果流: 打开的时候找好两边的行，建好哈希表或者把两边分好区，之后每次next再probe一段，
+ *  连接上的行号对先放在一个不超过内存上限的缓冲区中，满了就把用到的列拷贝到输出中
+ *
+ *  没有分区的时候按probe一边的行号顺序输出，同一个probe行连接上的行按行号顺序；分区的时候一个分区一个分区地输出，
+ *  键分布不均、一个分区的build一边还是放不下的时候，这个分区的两边再按哈希值接下来的几位分区，递归下去
+ */
+class Join_Stream : public Row_Source {
+public:
+    Join_Stream(std::shared_ptr<const Table> left, std::shared_ptr<const Table> right)
+        : m_tables{std::move(left), std::move(right)} {}
+
+    const Table& schema() const override { return m_schema; }
+
+    /**
+     * @brief 选好build的一边，放得下的时候建好哈希表，否则两边都写到临时文件中
+     */
+    void start(Side (&sides)[2]) {
+        m_sides[0] = std::move(sides[0]);
+        m_sides[1] = std::move(sides[1]);
+        // 可见行少的一边建哈希表，另一边逐行去查
+        m_build = m_sides[0].m_rows.size() <= m_sides[1].m_rows.size() ? 0 : 1;
+        const Side& build = m_sides[m_build];
+        const Side& probe = m_sides[1 - m_build];
+        if (build.m_rows.size() * entry_bytes <= memory_limit) {
+            m_table.reset(build.m_rows.size());
+            for (size_t row : build.m_rows)
+                m_table.add({row, build.hash(row)});
+            return;
+        }
+        // 放不下的时候两边按同样的哈希值分区，键相同的行一定在同一个分区，一次只为一个分区建哈希表
+        m_spilled = true;
+        auto build_parts = std::make_shared<Partitions>();
+        auto probe_parts = std::make_shared<Partitions>();
+        for (size_t row : build.m_rows)
+            build_parts->write({row, build.hash(row)});
+        for (size_t row : probe.m_rows)
+            probe_parts->write({row, probe.hash(row)});
+        m_sides[0].m_rows = std::vector<size_t>();
+        m_sides[1].m_rows = std::vector<size_t>();
+        _push(build_parts, probe_parts, true);
+    }
+
+    size_t next(Table& out, size_t rows) override {
+        // 行号对的缓冲区也受内存上限的限制，满了就先输出
+        size_t max_pairs = std::max<size_t>(memory_limit / sizeof(std::pair<size_t, size_t>), 1);
+        size_t produced = 0;
+        std::vector<std::pair<size_t, size_t>> pairs;
+        while (produced < rows) {
+            pairs.clear();
+            size_t want = std::min(rows - produced, max_pairs);
+            while (pairs.size() < want) {
+                if (m_match < m_matches.size()) {
+                    size_t build_row = m_matches[m_match++];
+                    if (0 == m_build)
+                        pairs.emplace_back(build_row, m_probe_row);
+                    else
+                        pairs.emplace_back(m_probe_row, build_row);
+                    continue;
+                }
+                Entry entry;
+                if (!_next_probe(entry))
+                    break;
+                const Side& build = m_sides[m_build];
+                const Side& probe = m_sides[1 - m_build];
+                m_matches.clear();
+                m_match = 0;
+                m_probe_row = entry.m_row;
+                m_table.probe(entry.m_hash, [&](size_t row) {
+                    if (same_key(build, row, probe, entry.m_row))
+                        m_matches.push_back(row);
+                });
+                std::sort(m_matches.begin(), m_matches.end());
+            }
+            if (pairs.empty())
+                break;
+            _emit(pairs, out);
+            produced += pairs.size();
+        }
+        return produced;
+    }
+
+    /**
+     * @brief 连接之后的列中用到的那些，和每一列来自哪一边的哪一列
+     */
+    Table m_schema;
+    std::vector<std::pair<int, int>> m_outputs;
+
+private:
+    /**
+     * @brief 两边的一个分区，还没有连接
+     */
+    struct Task {
+        std::shared_ptr<Partitions> m_build;
+        std::shared_ptr<Partitions> m_probe;
+        size_t m_partition = 0;
+
+        /**
+         * @brief 放不下的时候能不能再分区；上一次分区没有把行分开(比如都是同一个键)的时候再分也没有用
+         */
+        bool m_can_split = true;
+    };
+
+    /**
+     * @brief 把两边的所有分区按顺序放进待连接的分区中
+     */
+    void _push(const std::shared_ptr<Partitions>& build, const std::shared_ptr<Partitions>& probe, bool can_split) {
+        for (size_t partition = spill_partitions; partition-- > 0;)
+            m_tasks.push_back({build, probe, partition, can_split});
+    }
+
+    /**
+     * @brief 为下一个两边都有行的分区建哈希表，build一边放不下的时候先把这个分区再分一次
+     * @return bool，所有的分区都连接完了的时候返回false
+     */
+    bool _next_partition() {
+        m_current = Task();
+        while (!m_tasks.empty()) {
+            Task task = std::move(m_tasks.back());
+            m_tasks.pop_back();
+            size_t rows = task.m_build->rows(task.m_partition);
+            if (0 == rows or 0 == task.m_probe->rows(task.m_partition))
+                continue;
+
+            if (rows * entry_bytes > memory_limit and task.m_can_split and task.m_build->can_split()) {
+                auto build = std::make_shared<Partitions>(task.m_build->shift() - spill_bits);
+                auto probe = std::make_shared<Partitions>(task.m_build->shift() - spill_bits);
+                task.m_build->read(task.m_partition, [&](const Entry& record) { build->write(record); });
+                task.m_probe->read(task.m_partition, [&](const Entry& record) { probe->write(record); });
+                task.m_build->drop(task.m_partition);
+                task.m_probe->drop(task.m_partition);
+                bool split = true;
+                for (size_t sub = 0; sub < spill_partitions; ++sub)
+                    split = split and build->rows(sub) != rows;
+                _push(build, probe, split);
+                continue;
+            }
+
+            m_table.reset(rows);
+            task.m_build->read(task.m_partition, [&](const Entry& record) { m_table.add(record); });
+            task.m_probe->restart(task.m_partition);
+            m_current = std::move(task);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief probe一边的下一行，分区的时候当前分区读完了就为下一个两边都有行的分区建哈希表
+     */
+    bool _next_probe(Entry& entry) {
+        if (!m_spilled) {
+            const Side& probe = m_sides[1 - m_build];
+            if (m_probe_pos >= probe.m_rows.size())
+                return false;
+            size_t row = probe.m_rows[m_probe_pos++];
+            entry = {row, probe.hash(row)};
+            return true;
+        }
+        while (m_probe_pos >= m_buffer.size()) {
+            m_probe_pos = 0;
+            if (nullptr != m_current.m_probe and m_current.m_probe->read_some(m_current.m_partition, m_buffer))
+                break;
+            if (!_next_partition())
+                return false;
+        }
+        entry = m_buffer[m_probe_pos++];
+        return true;
+    }
+
+    /**
+     * @brief 把连接上的行号对(左边的行号, 右边的行号)的用到的列按列拷贝到out中
+     */
+    void _emit(const std::vector<std::pair<size_t, size_t>>& pairs, Table& out) {
+        for (size_t i = 0; i < m_outputs.size(); ++i) {
+            auto [side, column] = m_outputs[i];
+            const Table& table = *m_tables[side];
+            const Column_Data& in = table.m_data[column];
+            Column_Data& data = out.m_data[i];
+            if (table.is_int(column)) {
+                data.m_ints.reserve(data.m_ints.size() + pairs.size());
+                for (const auto& pair : pairs)
+                    data.m_ints.push_back(in.m_ints[0 == side ? pair.first : pair.second]);
+            } else {
+                data.m_strings.reserve(data.m_strings.size() + pairs.size());
+                for (const auto& pair : pairs)
+                    data.m_strings.push_back(in.m_strings[0 == side ? pair.first : pair.second]);
+            }
+        }
+        out.m_row_count += pairs.size();
+    }
+
+private:
+    /**
+     * @brief 两张表，结果流读完之前一直持有
+     */
+    std::shared_ptr<const Table> m_tables[2];
+    Side m_sides[2];
+    int m_build = 0;
+
+    Build_Table m_table;
+
+    /**
+     * @brief 没有分区的时候m_probe_pos是probe一边的m_rows的下标，
+     *  分区的时候m_current是当前分区(还没有开始的时候为空)，m_tasks是还没有连接的分区(最后一个先连接)，
+     *  m_probe_pos是m_buffer的下标
+     */
+    bool m_spilled = false;
+    Task m_current;
+    std::vector<Task> m_tasks;
+    std::vector<Entry> m_buffer;
+    size_t m_probe_pos = 0;
+
+    /**
+     * @brief 当前probe行连接上的build一边的行号，下一个要输出的是m_matches[m_match]
+     */
+    size_t m_probe_row = 0;
+    std::vector<size_t> m_matches;
+    size_t m_match = 0;
+};
+
+}  // namespace
+
+void Hash_Join::set_memory_limit(size_t bytes) {
+    memory_limit = std::max<size_t>(bytes, 1 << 16);
+}
+
+bool Hash_Join::run(std::shared_ptr<const Table> left_ptr, std::shared_ptr<const Table> right_ptr,
+                    const Statement& statement, std::shared_ptr<Row_Source>& source, Statement& view, std::string& error) {
+    const Table& left = *left_ptr;
+    const Table& right = *right_ptr;
+    if (left.m_table_name == right.m_table_name) {
+        error = "不支持表 " + left.m_table_name + " 和自己连接!";
+        return false;
+    }
+
+    // 连接之后的所有列: 左边的表的所有列再接右边的表的所有列，列名带表名，先在这上面找语句中的列名
+    Table all;
+    all.m_table_name = left.m_table_name + " join " + right.m_table_name;
+    for (const Table* table : {&left, &right})
+        for (const Column& column : table->m_columns)
+            all.m_columns.emplace_back(table->m_table_name + "." + column.m_column_name, column.m_column_type);
+
+    // 语句中的列名都换成结果中的列名，must_exist为false的时候不存在的列名保持原样，之后查询的时候再处理
+    auto rename = [&](std::string_view& name, bool must_exist) {
+        int column = find_column(all, name);
+        if (-2 == column) {
+            error = "字段 " + std::string(name) + " 在两张表中都有,请写成 <table>.<column> !";
+            return false;
+        }
+        if (-1 == column) {
+            if (must_exist)
+                error = "表 " + all.m_table_name + " 中不存在字段 " + std::string(name) + " ,请检查之后重新输入!";
+            return !must_exist;
+        }
+        name = all.m_columns[column].m_column_name;
+        return true;
+    };
+    view = statement;
+    view.m_join_name = view.m_join_left = view.m_join_right = std::string_view();
+    std::string_view on[2] = {statement.m_join_left, statement.m_join_right};
+    for (std::string_view& name : on)
+        if (!rename(name, true))
+            return false;
+    for (size_t i = 0; i < view.m_columns.size(); ++i) {
+        bool is_agg = view.m_aggregates.end() != std::find_if(view.m_aggregates.begin(), view.m_aggregates.end(),
+                                                              [&](const Statement::Aggregate& agg) { return i == agg.m_item; });
+        if (!is_agg and !rename(view.m_columns[i], true))
+            return false;
+    }
+    for (Statement::Aggregate& agg : view.m_aggregates)
+        if (!agg.m_column.empty() and !rename(agg.m_column, true))
+            return false;
+    for (std::string_view& name : view.m_group_columns)
+        if (!rename(name, true))
+            return false;
+    for (Statement::Order_Key& key : view.m_order_by)
+        if (!rename(key.m_column, false))
+            return false;
+
+    // where中每个谓词涉及哪一张表
+    size_t left_columns = left.m_columns.size();
+    std::vector<int> cond_sides;
+    for (Where_Cond& cond : view.m_where.m_parsed.m_conds) {
+        std::string_view name = cond.m_column;
+        if (!rename(name, false))
+            return false;
+        cond.m_column = std::string(name);
+        int column = find_column(all, name);
+        cond_sides.push_back(-1 == column ? -1 : column >= left_columns);
+    }
+
+    // on的两列分别是两张表中的连接列
+    Side sides[2];
+    sides[0].m_table = &left;
+    sides[1].m_table = &right;
+    for (std::string_view name : on) {
+        int column = find_column(all, name);
+        Side& side = sides[column >= left_columns];
+        if (-1 != side.m_column) {
+            error = "on 的两个字段需要分别属于两张表!";
+            return false;
+        }
+        side.m_column = column >= left_columns ? column - left_columns : column;
+    }
+    if (left.is_int(sides[0].m_column) != right.is_int(sides[1].m_column)) {
+        error = "字段 " + std::string(on[0]) + " 和 " + std::string(on[1]) + " 的类型不同,无法连接!";
+        return false;
+    }
+    for (int i = 0; i < 2; ++i)
+        collect_rows(sides[i], i, view, cond_sides);
+
+    // 结果中只放语句用到的列: select的列(select *是所有列)、聚合函数和group by的列、order by和where中的列
+    std::vector<bool> needed(all.m_columns.size(), view.m_columns.empty() and !view.is_aggregate());
+    auto need = [&](std::string_view name) {
+        int column = find_column(all, name);
+        if (column >= 0)
+            needed[column] = true;
+    };
+    for (size_t i = 0; i < view.m_columns.size(); ++i)
+        need(view.m_columns[i]);
+    for (const Statement::Aggregate& agg : view.m_aggregates)
+        need(agg.m_column);
+    for (std::string_view name : view.m_group_columns)
+        need(name);
+    for (const Statement::Order_Key& key : view.m_order_by)
+        need(key.m_column);
+    for (const Where_Cond& cond : view.m_where.m_parsed.m_conds)
+        need(cond.m_column);
+    // 只有count(*)的时候也要有一列，行数才有地方放
+    if (needed.end() == std::find(needed.begin(), needed.end(), true))
+        need(on[0]);
+
+    auto stream = std::make_shared<Join_Stream>(left_ptr, right_ptr);
+    Table& schema = stream->m_schema;
+    schema.m_table_name = all.m_table_name;
+    for (int column = 0; column < all.m_columns.size(); ++column) {
+        if (!needed[column])
+            continue;
+        schema.m_columns.push_back(all.m_columns[column]);
+        stream->m_outputs.emplace_back(column >= left_columns, column >= left_columns ? column - left_columns : column);
+    }
+    schema.m_data.resize(schema.m_columns.size());
+
+    // view中的列名原来指向all，换成指向schema中同名的列，没有找到的(不存在的列)保持原样
+    auto repoint = [&](std::string_view& name) {
+        for (const Column& column : schema.m_columns)
+            if (name == column.m_column_name)
+                name = column.m_column_name;
+    };
+    for (std::string_view& name : view.m_columns)
+        repoint(name);
+    for (Statement::Aggregate& agg : view.m_aggregates)
+        repoint(agg.m_column);
+    for (std::string_view& name : view.m_group_columns)
+        repoint(name);
+    for (Statement::Order_Key& key : view.m_order_by)
+        repoint(key.m_column);
+    view.m_name = schema.m_table_name;
+
+    stream->start(sides);
+    source = std::move(stream);
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file plan_cache.cpp
+ * @brief 服务端全局共享的语句计划缓存的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "plan_cache.h"
+
+/**
+ * @brief Plan
+ */
+std::string Plan::render(const std::vector<std::string_view>& args) const {
+    std::string text;
+    text.reserve(m_text.size());
+
+    // 参数是按在文本中出现的顺序记录的，依次把 ? 换成值
+    size_t pos = 0;
+    for (size_t i = 0; i < m_statement.m_params.size() and i < args.size(); ++i) {
+        size_t param_pos = m_statement.m_params[i].m_pos;
+        text.append(m_text, pos, param_pos - pos);
+        if (Sql_Lexer::needs_quote(args[i])) {
+            text += '\'';
+            text.append(args[i]);
+            text += '\'';
+        } else
+            text.append(args[i]);
+        pos = param_pos + 1;
+    }
+    text.append(m_text, pos);
+    return text;
+}
+
+/**
+ * @brief Plan_Cache
+ */
+Plan_Cache& Plan_Cache::instance() {
+    static Plan_Cache cache;
+    return cache;
+}
+
+void Plan_Cache::set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    _evict();
+}
+
+std::shared_ptr<const Plan> Plan_Cache::get(const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(key);
+    if (m_entries.end() == it) {
+        ++m_stats.m_misses;
+        return nullptr;
+    }
+
+    ++m_stats.m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+    return it->second.m_plan;
+}
+
+void Plan_Cache::put(const std::string& key, const std::shared_ptr<const Plan>& plan) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto [it, inserted] = m_entries.try_emplace(key);
+    it->second.m_plan = plan;
+    if (inserted) {
+        m_lru.push_front(key);
+        it->second.m_lru_pos = m_lru.begin();
+    } else
+        m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_pos);
+
+    _evict();
+}
+
+Plan_Cache::Stats Plan_Cache::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats = m_stats;
+    stats.m_plans = m_entries.size();
+    stats.m_capacity = m_capacity;
+    return stats;
+}
+
+void Plan_Cache::_evict() {
+    while (m_entries.size() > m_capacity) {
+        m_entries.erase(m_lru.back());
+        m_lru.pop_back();
+        ++m_stats.m_evictions;
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * @file protocol.cpp
+ * @brief 客户端和服务端之间按帧传输的二进制协议的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "protocol.h"
+
+void Protocol::put_u32(std::string& buf, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        buf.push_back(static_cast<char>(value >> shift));
+}
+
+void Protocol::put_u64(std::string& buf, uint64_t value) {
+    put_u32(buf, value >> 32);
+    put_u32(buf, value);
+}
+
+bool Protocol::get_u32(std::string_view& in, uint32_t& value) {
+    if (in.size() < sizeof(uint32_t))
+        return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+        value = value << 8 | static_cast<uint8_t>(in[i]);
+    in.remove_prefix(sizeof(uint32_t));
+    return true;
+}
+
+bool Protocol::get_u64(std::string_view& in, uint64_t& value) {
+    uint32_t high, low;
+    if (in.size() < sizeof(uint64_t) or !get_u32(in, high) or !get_u32(in, low))
+        return false;
+    value = static_cast<uint64_t>(high) << 32 | low;
+    return true;
+}
+
+bool Protocol::get_string(std::string_view& in, std::string_view& value) {
+    uint32_t len;
+    if (!get_u32(in, len) or in.size() < len)
+        return false;
+    value = in.substr(0, len);
+    in.remove_prefix(len);
+    return true;
+}
+
+void Protocol::append_frame(std::string& out, Frame_Type type, uint32_t id, std::string_view payload) {
+    out.push_back(static_cast<char>(type));
+    put_u32(out, id);
+    put_u32(out, payload.size());
+    out += payload;
+}
+
+int Protocol::parse_frame(std::string_view buf, Frame& frame) {
+    if (buf.size() < header_size)
+        return 0;
+
+    std::string_view header = buf.substr(1);
+    uint32_t len;
+    get_u32(header, frame.m_id);
+    get_u32(header, len);
+    if (len > max_payload)
+        return -1;
+    if (buf.size() - header_size < len)
+        return 0;
+
+    frame.m_type = static_cast<Frame_Type>(buf[0]);
+    frame.m_payload = buf.substr(header_size, len);
+    return 1;
+}
+
+bool Protocol::render_schema(std::string_view payload, std::vector<Column_Type>& types, std::ostream& out) {
+    types.clear();
+    uint32_t count;
+    if (!get_u32(payload, count))
+        return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string_view name;
+        if (payload.empty())
+            return false;
+        types.push_back(static_cast<Column_Type>(payload[0]));
+        payload.remove_prefix(1);
+        if (!get_string(payload, name))
+            return false;
+        out << name << ' ';
+    }
+    out << std::endl;
+    return true;
+}
+
+bool Protocol::render_rows(std::string_view payload, const std::vector<Column_Type>& types, std::ostream& out) {
+    uint32_t count;
+    if (!get_u32(payload, count))
+        return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        for (Column_Type type : types) {
+            if (Int == type) {
+                uint64_t value;
+                if (!get_u64(payload, value))
+                    return false;
+                out << static_cast<int64_t>(value) << ' ';
+            } else {
+                std::string_view value;
+                if (!get_string(payload, value))
+                    return false;
+                out << value << ' ';
+            }
+        }
+        out << '\n';
+    }
+    return true;
+}
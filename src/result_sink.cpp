@@ -0,0 +1,121 @@
+/**
+ * @file result_sink.cpp
+ * @brief 收集命令执行结果的内存缓冲区的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "result_sink.h"
+
+Result_Sink::Result_Sink() : std::ostream(nullptr) {
+    // 基类构造的时候m_buffer还没有构造，所以在这里再设置进去
+    rdbuf(&m_buffer);
+}
+
+void Result_Sink::reset() {
+    m_buffer.m_data.clear();
+    // 上一条命令可能让流进入了错误状态
+    std::ostream::clear();
+
+    m_status = Protocol::Ok;
+    m_has_result = false;
+    m_more = false;
+    m_text_end = 0;
+    m_columns.clear();
+    m_schema.clear();
+    m_batches.clear();
+    m_batch_rows.clear();
+}
+
+void Result_Sink::next_batch() {
+    m_buffer.m_data.clear();
+    std::ostream::clear();
+
+    m_status = Protocol::Ok;
+    m_more = false;
+    m_text_end = 0;
+    m_schema.clear();
+    m_batches.clear();
+    m_batch_rows.clear();
+}
+
+void Result_Sink::begin_result(const Table& table, const std::vector<int>& columns) {
+    m_has_result = true;
+    m_text_end = m_buffer.m_data.size();
+    m_columns = columns;
+
+    Protocol::put_u32(m_schema, columns.size());
+    for (int column : columns) {
+        m_schema.push_back(table.is_int(column) ? Protocol::Int : Protocol::String);
+        const std::string& name = table.m_columns[column].m_column_name;
+        Protocol::put_u32(m_schema, name.size());
+        m_schema += name;
+    }
+}
+
+void Result_Sink::add_row(const Table& table, size_t row) {
+    // 最后一个批次满了就开一个新的
+    if (m_batches.empty() or batch_full()) {
+        m_batches.emplace_back();
+        m_batch_rows.push_back(0);
+    }
+
+    std::string& batch = m_batches.back();
+    for (int column : m_columns) {
+        const Column_Data& data = table.m_data[column];
+        if (table.is_int(column)) {
+            Protocol::put_u64(batch, data.m_ints[row]);
+        } else {
+            std::string_view value = data.m_strings[row];
+            Protocol::put_u32(batch, value.size());
+            batch += value;
+        }
+    }
+    ++m_batch_rows.back();
+}
+
+void Result_Sink::write_frames(uint32_t id, std::string& out) const {
+    std::string_view text = m_buffer.m_data;
+    if (m_has_result) {
+        if (0 != m_text_end)
+            Protocol::append_frame(out, Protocol::Text, id, text.substr(0, m_text_end));
+        if (!m_schema.empty())
+            Protocol::append_frame(out, Protocol::Schema, id, m_schema);
+        for (size_t i = 0; i < m_batches.size(); ++i) {
+            // 负载是 u32行数 + 批次的内容，直接写帧头，不用拼一个临时的负载
+            out.push_back(static_cast<char>(Protocol::Rows));
+            Protocol::put_u32(out, id);
+            Protocol::put_u32(out, sizeof(uint32_t) + m_batches[i].size());
+            Protocol::put_u32(out, m_batch_rows[i]);
+            out += m_batches[i];
+        }
+        text.remove_prefix(m_text_end);
+    }
+
+    // Status帧: u8状态码 + 剩下的文字，结果集还有下一批的时候先不发，文字留到下一批
+    if (m_more) {
+        if (!text.empty())
+            Protocol::append_frame(out, Protocol::Text, id, text);
+        return;
+    }
+    out.push_back(static_cast<char>(Protocol::Status));
+    Protocol::put_u32(out, id);
+    Protocol::put_u32(out, 1 + text.size());
+    out.push_back(static_cast<char>(m_status));
+    out += text;
+}
+
+Result_Sink::Buffer::int_type Result_Sink::Buffer::overflow(int_type ch) {
+    if (traits_type::eof() != ch)
+        m_data.push_back(traits_type::to_char_type(ch));
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize Result_Sink::Buffer::xsputn(const char* str, std::streamsize len) {
+    m_data.append(str, len);
+    return len;
+}
@@ -0,0 +1,348 @@
+/**
+ * @file row_sorter.cpp
+ * @brief 按order by给行号排序的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "row_sorter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "where_cond.h"
+
+/**
+ * @brief 只在本文件中使用的变量和函数
+ */
+namespace {
+/**
+ * @brief 排序最多用的内存，由set_memory_limit设置
+ */
+size_t memory_limit = Row_Sorter::default_memory_limit;
+
+/**
+ * @brief 有序段的文件缓冲区大小
+ */
+constexpr size_t run_buffer_bytes = 64 << 10;
+
+void put_u32(std::string& out, uint32_t value) { out.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+/**
+ * @brief 大端写一个u64，按字节比较和按数值比较一样
+ */
+void put_be64(std::string& out, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8)
+        out.push_back(static_cast<char>(value >> shift));
+}
+
+/**
+ * @brief 把一个键的值编码成可以按字节比较的形式，desc的时候每个字节取反
+ *  int: 翻转符号位之后按大端写，负数就排在正数前面
+ *  string: 0x00写成0x00 0xFF，最后以0x00 0x00结束，短的前缀排在前面
+ */
+void put_key(std::string& out, const Table& table, size_t row, int column, bool desc) {
+    size_t start = out.size();
+    const Column_Data& data = table.m_data[column];
+    if (table.is_int(column)) {
+        put_be64(out, static_cast<uint64_t>(data.m_ints[row]) ^ (1ull << 63));
+    } else {
+        for (char c : data.m_strings[row]) {
+            out.push_back(c);
+            if ('\0' == c)
+                out.push_back('\xFF');
+        }
+        out.append(2, '\0');
+    }
+    if (desc)
+        for (size_t i = start; i < out.size(); ++i)
+            out[i] = ~out[i];
+}
+
+void read_exact(FILE* file, char* data, size_t len) {
+    if (0 != len and 1 != fread(data, len, 1, file)) {
+        perror("fread");
+        exit(-1);
+    }
+}
+
+}  // namespace
+
+void Row_Sorter::set_memory_limit(size_t bytes) {
+    memory_limit = std::max<size_t>(bytes, 1 << 16);
+}
+
+Row_Sorter::~Row_Sorter() {
+    for (Run& run : m_runs)
+        fclose(run.m_file);
+}
+
+void Row_Sorter::open(const Table* table, std::vector<Key> keys, std::vector<int> payload, uint64_t top_k) {
+    for (Run& run : m_runs)
+        fclose(run.m_file);
+    m_runs.clear();
+    m_merge.clear();
+    m_rows.clear();
+    m_pos = 0;
+    m_copy = false;
+    m_own = Table();
+    m_own_bytes = 0;
+    m_first_row = 0;
+
+    m_table = table;
+    m_keys = std::move(keys);
+    m_payload = std::move(payload);
+    m_top_k = top_k;
+    // K太大的时候堆本身就放不下，和没有limit一样排
+    m_use_heap = 0 != top_k and top_k <= memory_limit / sizeof(size_t);
+}
+
+void Row_Sorter::open_copy(const Table& schema, std::vector<Key> keys, std::vector<int> payload, uint64_t top_k) {
+    open(&m_own, std::move(keys), std::move(payload), top_k);
+    m_copy = true;
+    m_own.m_table_name = schema.m_table_name;
+    m_own.m_columns = schema.m_columns;
+    m_own.m_data.resize(m_own.m_columns.size());
+    m_needed.assign(m_own.m_columns.size(), false);
+    for (const Key& key : m_keys)
+        m_needed[key.m_column] = true;
+    for (int column : m_payload)
+        m_needed[column] = true;
+}
+
+void Row_Sorter::add(size_t row) {
+    auto less = [this](size_t a, size_t b) { return _less(a, b); };
+    if (m_use_heap) {
+        // 大顶堆，堆顶是目前留下的K行中排在最后的，新的一行排在它前面才换掉它
+        if (m_rows.size() < m_top_k) {
+            m_rows.push_back(row);
+            std::push_heap(m_rows.begin(), m_rows.end(), less);
+        } else if (_less(row, m_rows.front())) {
+            std::pop_heap(m_rows.begin(), m_rows.end(), less);
+            m_rows.back() = row;
+            std::push_heap(m_rows.begin(), m_rows.end(), less);
+        }
+        return;
+    }
+
+    m_rows.push_back(row);
+    if (m_rows.size() * sizeof(size_t) + m_own_bytes >= memory_limit)
+        _spill();
+}
+
+void Row_Sorter::add(const Table& batch, size_t row) {
+    // 堆满了并且排不进去的行不用拷贝，新的一行比已有的行都后加入，键相同的时候排在后面
+    if (m_use_heap and m_rows.size() >= m_top_k and _compare(batch, row, m_own, m_rows.front()) >= 0)
+        return;
+
+    for (int column = 0; column < m_own.m_columns.size(); ++column) {
+        Column_Data& data = m_own.m_data[column];
+        if (m_own.is_int(column)) {
+            data.m_ints.push_back(m_needed[column] ? batch.m_data[column].m_ints[row] : 0);
+            m_own_bytes += sizeof(int64_t);
+        } else {
+            std::string_view value = m_needed[column] ? batch.m_data[column].m_strings[row] : std::string_view();
+            data.m_strings.push_back(value);
+            m_own_bytes += sizeof(std::string_view) + value.size();
+        }
+    }
+    ++m_own.m_row_count;
+    add(m_own.m_row_count - 1);
+
+    if (m_use_heap and m_own.m_row_count >= 2 * m_top_k + 1024)
+        _compact_heap();
+}
+
+void Row_Sorter::finish() {
+    auto less = [this](size_t a, size_t b) { return _less(a, b); };
+    m_pos = 0;
+    if (m_use_heap) {
+        std::sort_heap(m_rows.begin(), m_rows.end(), less);
+        return;
+    }
+    if (m_runs.empty()) {
+        std::sort(m_rows.begin(), m_rows.end(), less);
+        return;
+    }
+
+    // 最后一批也写出去，然后每个有序段读进第一条记录，按记录的键建一个小顶堆
+    if (!m_rows.empty())
+        _spill();
+    std::vector<size_t>().swap(m_rows);
+    for (size_t run = 0; run < m_runs.size(); ++run) {
+        rewind(m_runs[run].m_file);
+        if (_read(run))
+            m_merge.push_back(run);
+    }
+    auto later = [this](size_t a, size_t b) { return m_runs[b].m_key < m_runs[a].m_key; };
+    std::make_heap(m_merge.begin(), m_merge.end(), later);
+
+    // 归并出来的行解码到只有一行的m_out中，string列用set覆盖，垃圾多了String_Heap自己会整理
+    m_out = Table();
+    m_out.m_table_name = m_table->m_table_name;
+    m_out.m_columns = m_table->m_columns;
+    m_out.m_data.resize(m_out.m_columns.size());
+    for (int column = 0; column < m_out.m_columns.size(); ++column) {
+        if (m_out.is_int(column))
+            m_out.m_data[column].m_ints.push_back(0);
+        else
+            m_out.m_data[column].m_strings.push_back(std::string_view());
+    }
+    m_out.m_row_count = 1;
+}
+
+bool Row_Sorter::next(const Table*& table, size_t& row) {
+    if (m_runs.empty()) {
+        if (m_pos >= m_rows.size())
+            return false;
+        table = m_table;
+        row = m_rows[m_pos++];
+        return true;
+    }
+
+    if (m_merge.empty())
+        return false;
+    auto later = [this](size_t a, size_t b) { return m_runs[b].m_key < m_runs[a].m_key; };
+    std::pop_heap(m_merge.begin(), m_merge.end(), later);
+    size_t index = m_merge.back();
+    Run& run = m_runs[index];
+
+    // 记录中只有要输出的列，按列的顺序依次解出来
+    const char* p = run.m_payload.data();
+    for (int column : m_payload) {
+        Column_Data& data = m_out.m_data[column];
+        if (m_out.is_int(column)) {
+            memcpy(&data.m_ints[0], p, sizeof(int64_t));
+            p += sizeof(int64_t);
+        } else {
+            uint32_t len;
+            memcpy(&len, p, sizeof(len));
+            p += sizeof(len);
+            data.m_strings.set(0, std::string_view(p, len));
+            p += len;
+        }
+    }
+    table = &m_out;
+    row = 0;
+
+    if (_read(index))
+        std::push_heap(m_merge.begin(), m_merge.end(), later);
+    else
+        m_merge.pop_back();
+    return true;
+}
+
+bool Row_Sorter::done() const {
+    return m_runs.empty() ? m_pos >= m_rows.size() : m_merge.empty();
+}
+
+int Row_Sorter::_compare(const Table& a_table, size_t a, const Table& b_table, size_t b) const {
+    for (const Key& key : m_keys) {
+        const Column_Data& x = a_table.m_data[key.m_column];
+        const Column_Data& y = b_table.m_data[key.m_column];
+        int cmp = a_table.is_int(key.m_column) ? (x.m_ints[a] > y.m_ints[b]) - (x.m_ints[a] < y.m_ints[b])
+                                               : x.m_strings[a].compare(y.m_strings[b]);
+        if (0 != cmp)
+            return key.m_desc ? (cmp > 0 ? -1 : 1) : (cmp < 0 ? -1 : 1);
+    }
+    return 0;
+}
+
+bool Row_Sorter::_less(size_t a, size_t b) const {
+    int cmp = _compare(*m_table, a, *m_table, b);
+    return 0 != cmp ? cmp < 0 : a < b;
+}
+
+void Row_Sorter::_encode(size_t row, std::string& out) const {
+    const Table& table = *m_table;
+
+    // 键: 每一列的可比较编码，最后是大端的行号，键相同的时候按行号升序
+    size_t key_pos = out.size();
+    put_u32(out, 0);
+    for (const Key& key : m_keys)
+        put_key(out, table, row, key.m_column, key.m_desc);
+    put_be64(out, m_first_row + row);
+    uint32_t key_len = out.size() - key_pos - sizeof(uint32_t);
+    memcpy(out.data() + key_pos, &key_len, sizeof(key_len));
+
+    // 值: 和表文件中的行一样，int列是8字节，string列是 u32长度 + 值
+    size_t payload_pos = out.size();
+    put_u32(out, 0);
+    for (int column : m_payload) {
+        const Column_Data& data = table.m_data[column];
+        if (table.is_int(column)) {
+            out.append(reinterpret_cast<const char*>(&data.m_ints[row]), sizeof(int64_t));
+        } else {
+            std::string_view value = data.m_strings[row];
+            put_u32(out, value.size());
+            out += value;
+        }
+    }
+    uint32_t payload_len = out.size() - payload_pos - sizeof(uint32_t);
+    memcpy(out.data() + payload_pos, &payload_len, sizeof(payload_len));
+}
+
+void Row_Sorter::_spill() {
+    std::sort(m_rows.begin(), m_rows.end(), [this](size_t a, size_t b) { return _less(a, b); });
+    // 临时文件关闭之后自动删掉
+    Run run;
+    run.m_file = tmpfile();
+    if (nullptr == run.m_file) {
+        perror("tmpfile");
+        exit(-1);
+    }
+    setvbuf(run.m_file, nullptr, _IOFBF, run_buffer_bytes);
+    std::string record;
+    for (size_t row : m_rows) {
+        record.clear();
+        _encode(row, record);
+        if (1 != fwrite(record.data(), record.size(), 1, run.m_file)) {
+            perror("fwrite");
+            exit(-1);
+        }
+    }
+    m_runs.push_back(std::move(run));
+    m_rows.clear();
+
+    // 拷贝进来的行都写出去了，之后的行号接着往后编
+    if (m_copy) {
+        m_first_row += m_own.m_row_count;
+        m_own.clear_rows();
+        m_own_bytes = 0;
+    }
+}
+
+bool Row_Sorter::_read(size_t index) {
+    Run& run = m_runs[index];
+    uint32_t len;
+    if (1 != fread(&len, sizeof(len), 1, run.m_file))
+        return false;
+    run.m_key.resize(len);
+    read_exact(run.m_file, run.m_key.data(), len);
+    read_exact(run.m_file, reinterpret_cast<char*>(&len), sizeof(len));
+    run.m_payload.resize(len);
+    read_exact(run.m_file, run.m_payload.data(), len);
+    return true;
+}
+
+void Row_Sorter::_compact_heap() {
+    // 按行号顺序拷贝，新旧行号的大小关系不变，堆也不用重建
+    std::vector<size_t> kept = m_rows;
+    std::sort(kept.begin(), kept.end());
+    Table fresh;
+    fresh.m_table_name = m_own.m_table_name;
+    fresh.m_columns = m_own.m_columns;
+    fresh.m_data.resize(fresh.m_columns.size());
+    fresh.reserve(kept.size());
+    for (size_t row : kept)
+        fresh.append_row_from(m_own, row);
+    for (size_t& row : m_rows)
+        row = std::lower_bound(kept.begin(), kept.end(), row) - kept.begin();
+    m_own = std::move(fresh);
+    m_own_bytes = 0;
+}
@@ -11,6 +11,15 @@
 
 #include "server_order.h"
 
+#include <chrono>
+
+#include "csv_loader.h"
+#include "hash_aggregate.h"
+#include "hash_join.h"
+#include "table_file.h"
+#include "table_index.h"
+#include "where_cond.h"
+
 /**
  * @brief 初始化类内静态变量
  */
@@ -21,284 +30,429 @@ const std::string Order::data_prefix = "../data/";
 
 const std::string Order::res_prefix = "../res/";
 
+std::shared_mutex Order::data_lock;
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+/**
+ * @brief 命令对数据的访问方式，决定执行的时候拿什么锁
+ *  None，不碰表和数据库目录
+ *  Read，只读，可以和其他只读的命令并行
+ *  Modify，修改表中的行，和只读的命令一样拿共享锁，同一张表上的修改由表的m_writer串行，不同的表可以同时改
+ *  Write，修改表结构、数据库目录或者整理表，独占
+ */
+enum Access {
+    None,
+    Read,
+    Modify,
+    Write,
+};
+
+Access access_of(Statement::Type type) {
+    switch (type) {
+    case Statement::Tree:
+    case Statement::Use:
+    case Statement::Select:
+    case Statement::Declare:
+    case Statement::Fetch:
+        return Read;
+    case Statement::Delete:
+    case Statement::Insert:
+    case Statement::Update:
+    case Statement::Load:
+        return Modify;
+    case Statement::Create_Database:
+    case Statement::Drop_Database:
+    case Statement::Create_Table:
+    case Statement::Drop_Table:
+    case Statement::Create_Index:
+    case Statement::Vacuum:
+        return Write;
+    default:
+        // execute在填好参数之后再按预备语句的类型拿锁
+        return None;
+    }
+}
+
+/**
+ * @brief order by中第一个在表中不存在的列
+ */
+std::string_view missing_order_column(const Table& table, const Statement& statement) {
+    for (const Statement::Order_Key& key : statement.m_order_by) {
+        if (table.m_columns.end() == std::find_if(table.m_columns.begin(), table.m_columns.end(),
+                                                  [&](const auto& c) { return key.m_column == c.m_column_name; }))
+            return key.m_column;
+    }
+    return std::string_view();
+}
+
+/**
+ * @brief where或者order by中的列上有没有索引，有的话读进缓存才能用上它
+ */
+bool index_helps(const Table& schema, const Statement& statement) {
+    for (const Index_Info& index : schema.m_indexes) {
+        for (const Statement::Order_Key& key : statement.m_order_by)
+            if (key.m_column == index.m_column_name)
+                return true;
+        if (statement.m_has_where)
+            for (const Where_Cond& cond : statement.m_where.m_parsed.m_conds)
+                if (cond.m_column == index.m_column_name)
+                    return true;
+    }
+    return false;
+}
+
+}  // namespace
+
 /**
  * @brief 对类内函数的实现
  */
 void Order::set_command(const std::string& order) {
     // 先清空类内部的对象(m_dbname不要清空，我们要保存并且记录),因为这是一条命令处理的开始
     m_command.clear();
-    m_command_type = Order::Unknown;
-    m_feedback.clear();
+    m_statement.clear();
+    m_plan.reset();
+    m_rendered.clear();
+    m_stream = Result_Stream();
+    m_out.reset();
 
     m_command = order;
 }
 
 void Order::run() {
-    // 首先肯定是要判断命令的类型
-    // _get_type确定的是一个初步的类型，就是这个命令可能是属于这一个，具体是否属于我们调用针对性的处理函数就可以了
-    m_command_type = _get_type(m_command);
+    // 首先把命令解析成语法树，语法不对的命令类型就是Unknown
+    // 后面的处理函数直接从语法树中拿名字和值，不用再自己切割字符串
+    // 增删改查语句先到计划缓存中找，同样形状的语句只解析一次
+    if (!_plan_from_cache()) {
+        m_parser.parse(m_command, m_statement);
+        if (!m_statement.m_params.empty()) {
+            m_out << "参数 ? 只能出现在prepare的语句中,请检查之后重新输入!" << std::endl;
+            m_out.set_status(Protocol::Error);
+            return;
+        }
+    }
+
+    _dispatch();
 
-    switch (m_command_type) {
-    case Show:
+    // 告诉客户端命令不正确或者要退出了，客户端不用再去比对提示文字
+    if (Statement::Unknown == m_statement.m_type)
+        m_out.set_status(Protocol::Error);
+    else if (Statement::Quit == m_statement.m_type)
+        m_out.set_status(Protocol::Bye);
+}
+
+bool Order::_plan_from_cache() {
+    if (!Sql_Parser::normalize(m_command, m_plan_key, m_literals))
+        return false;
+
+    std::shared_ptr<const Plan> plan = Plan_Cache::instance().get(m_plan_key);
+    if (nullptr == plan) {
+        // 规范化之后解析不了的语句(比如数字出现在名字的位置)不缓存，按原文解析，错误提示也按原文给出
+        plan = _make_plan(m_plan_key);
+        if (nullptr == plan or !plan->m_statement.is_dml())
+            return false;
+        Plan_Cache::instance().put(m_plan_key, plan);
+    }
+
+    m_statement = plan->m_statement;
+    if (!m_statement.bind(m_literals))
+        return false;
+    m_plan = plan;
+    return true;
+}
+
+std::shared_ptr<const Plan> Order::_make_plan(std::string_view text) {
+    // 先把文本放进计划中，语法树指向计划自己的文本
+    auto plan = std::make_shared<Plan>();
+    plan->m_text = text;
+    if (!m_parser.parse(plan->m_text, plan->m_statement))
+        return nullptr;
+    return plan;
+}
+
+void Order::_dispatch() {
+    // 查询和修改行的命令之间可以在不同的工作线程中并行执行，读的一致性由快照保证；改表结构的命令独占
+    std::shared_lock<std::shared_mutex> read_lock(data_lock, std::defer_lock);
+    std::unique_lock<std::shared_mutex> write_lock(data_lock, std::defer_lock);
+    Access access = access_of(m_statement.m_type);
+    if (Read == access or Modify == access)
+        read_lock.lock();
+    else if (Write == access)
+        write_lock.lock();
+
+    switch (m_statement.m_type) {
+    case Statement::Show:
         _deal_show();
         break;
-    case Tree:
+    case Statement::Show_Cache:
+        _deal_show_cache();
+        break;
+    case Statement::Tree:
         _deal_tree();
         break;
-    case Quit:
+    case Statement::Quit:
         _deal_quit();
         break;
-    case Clear:
+    case Statement::Clear:
         _deal_clear();
         break;
-    case Create_Database:
+    case Statement::Create_Database:
         _deal_create_database();
         break;
-    case Drop_Database:
+    case Statement::Drop_Database:
         _deal_drop_database();
         break;
-    case Use:
+    case Statement::Use:
         _deal_use();
         break;
-    case Create_Table:
+    case Statement::Create_Table:
         _deal_create_table();
         break;
-    case Drop_Table:
+    case Statement::Drop_Table:
         _deal_drop_table();
         break;
-    case Select:
+    case Statement::Create_Index:
+        _deal_create_index();
+        break;
+    case Statement::Select:
         _deal_select();
         break;
-    case Delete:
+    case Statement::Delete:
         _deal_delete();
         break;
-    case Insert:
+    case Statement::Insert:
         _deal_insert();
         break;
-    case Update:
+    case Statement::Update:
         _deal_update();
         break;
-    case Unknown:
+    case Statement::Load:
+        _deal_load();
+        break;
+    case Statement::Vacuum:
+        _deal_vacuum();
+        break;
+    case Statement::Show_Plans:
+        _deal_show_plans();
+        break;
+    case Statement::Prepare:
+        _deal_prepare();
+        break;
+    case Statement::Execute:
+        _deal_execute();
+        break;
+    case Statement::Deallocate:
+        _deal_deallocate();
+        break;
+    case Statement::Declare:
+        _deal_declare();
+        break;
+    case Statement::Fetch:
+        _deal_fetch();
+        break;
+    case Statement::Close:
+        _deal_close();
+        break;
+    case Statement::Unknown:
         _deal_unknown();
         break;
     }
 }
 
-void Order::read_feedback() {
-    // 打开文件
-    FILE* file = fopen(std::string(Order::res_prefix + "feedback.txt").c_str(), "r");
-    if (nullptr == file) {
-        perror("fopen");
+void Order::checkpoint() {
+    // 等正在执行的命令都结束，写回的时候表不会被修改
+    std::unique_lock<std::shared_mutex> lock(data_lock);
+    Wal::checkpoint_all();
+    Table_Cache::instance().flush_all();
+}
+
+void Order::recover() {
+    DIR* dir = opendir(data_prefix.c_str());
+    if (nullptr == dir) {
+        perror("opendir");
         exit(-1);
     }
 
-    // 读取内容
-    char read_buf[BUFSIZ] = {0};  // 数组容量用系统默认给的缓冲区大小 8192
-    while (1) {
-        bzero(read_buf, BUFSIZ);
-        size_t len = fread(read_buf, 1, BUFSIZ - 1, file);
-        // 返回0表明可能出错或者读到末尾了
-        if (0 == len) {
-            if (ferror(file)) {
-                perror("fread");
-                exit(-1);
-            }
-            if (feof(file))
-                break;
-        }
+    // 重放的时候各个命令的输出没有意义，下一条命令set_command的时候就清空了
+    while (struct dirent* file = readdir(dir)) {
+        std::string dbname = file->d_name;
+        if ("." == dbname or ".." == dbname)
+            continue;
 
-        // 添加到m_feedback中
-        m_feedback += read_buf;
-    }
-
-    // 关闭
-    fclose(file);
-}
-
-Order::Command_Type Order::_get_type(const std::string& command) {
-    // 经过我们输入的处理之后字符串的开头肯定是有含义的字符，所以实现这个函数用于得到命令的类型
-    // 退出命令，show命令，tree命令查看所有，clear命令没有空格，我们直接在这里判断即可
-    if ("show" == command)
-        return Command_Type::Show;
-    if ("q" == command or "quit" == command)
-        return Command_Type::Quit;
-    if ("tree" == command)
-        return Command_Type::Tree;
-    if ("clear" == command)
-        return Command_Type::Clear;
-
-    // 在众多命令当中，只有create和drop是可以分为两种情况的，作用于数据库和表
-    // 这里我要说明一下，对于错误的指令，比如create;找不到空格，这里pos就是npos，这里就会进入unknown的处理，很合理
-    size_t pos = command.find(' ');
-    if (std::string::npos == pos)  // 一个空格都没有那肯定是不对的命令，特例都在上面判断了
-        return Command_Type::Unknown;
-
-    // std::string command_for_type = command.substr(0, pos);
-    // substr第二个参数不是末尾的位置，而是从上一个位置开始的长度!!!所以我用构造函数了
-    std::string command_for_type = std::string(m_command.begin(), m_command.begin() + pos);
-    // std::cout << command_for_type << std::endl;
-
-    if ("tree" == command_for_type)  // tree <dbname>
-        return Command_Type::Tree;
-    else if ("create" == command_for_type)
-        return _get_database_table(pos, command, true);
-    else if ("drop" == command_for_type)
-        return _get_database_table(pos, command, false);
-    else if ("use" == command_for_type)
-        return Command_Type::Use;
-    else if ("select" == command_for_type)
-        return Command_Type::Select;
-    else if ("delete" == command_for_type)
-        return Command_Type::Delete;
-    else if ("insert" == command_for_type)
-        return Command_Type::Insert;
-    else if ("update" == command_for_type)
-        return Command_Type::Update;
-    else
-        return Command_Type::Unknown;
-}
+        std::string db_dir = data_prefix + dbname;
+        if (0 != access((db_dir + "/" + Wal::file_name).c_str(), F_OK))
+            continue;
+
+        Wal& wal = Wal::for_database(db_dir);
+        std::vector<Wal::Record> records = wal.records();
 
-Order::Command_Type Order::_get_database_table(size_t blank_pos, const std::string& command, bool first) {
-    // 找到第二空格确定到底是哪一个
-    std::string right_command = std::string(m_command.begin() + blank_pos + 1, m_command.end());
-    size_t pos = right_command.find(' ');
-    if (std::string::npos == pos)
-        return Command_Type::Unknown;
+        m_dbname = dbname;
+        for (auto& record : records) {
+            m_replay_lsn = record.m_lsn;
+            set_command(record.m_command);
+            run();
+        }
+        m_replay_lsn = 0;
 
-    std::string command_for_second_type = std::string(right_command.begin(), right_command.begin() + pos);
-    // std::cout << command_for_second_type << std::endl;
+        // 重放完成之后把修改写回表文件，清空日志
+        wal.checkpoint();
+        std::cout << "database " << dbname << " has replayed " << records.size() << " wal records." << std::endl;
+    }
 
-    // 进行判断
-    if ("database" == command_for_second_type)
-        return first ? Command_Type::Create_Database : Command_Type::Drop_Database;
-    else if ("table" == command_for_second_type)
-        return first ? Command_Type::Create_Table : Command_Type::Drop_Table;
-    else
-        return Command_Type::Unknown;
+    closedir(dir);
+    m_dbname.clear();
+    set_command(std::string());
 }
 
 // show
 void Order::_deal_show() {
     // 同退出的逻辑一样，进入这里一定是正确的命令
-    Tools::open_and_print(res_prefix + "menu_start.txt");
+    Tools::open_and_print(res_prefix + "menu_start.txt", m_out);
+}
+
+// show cache
+void Order::_deal_show_cache() {
+    Table_Cache::Stats stats = Table_Cache::instance().stats();
+    size_t lookups = stats.m_hits + stats.m_misses;
+
+    m_out << "表缓存统计信息如下: " << std::endl;
+    m_out << "缓存表数: " << stats.m_tables << std::endl;
+    m_out << "内存占用: " << stats.m_used_bytes << " / " << stats.m_budget_bytes << " 字节" << std::endl;
+    m_out << "命中次数: " << stats.m_hits << std::endl;
+    m_out << "未命中次数: " << stats.m_misses << std::endl;
+    m_out << "命中率: " << (0 == lookups ? 0 : stats.m_hits * 100 / lookups) << "%" << std::endl;
+    m_out << "淘汰次数: " << stats.m_evictions << std::endl;
+    m_out << "写回次数: " << stats.m_write_backs << std::endl;
+}
+
+// show plans
+void Order::_deal_show_plans() {
+    Plan_Cache::Stats stats = Plan_Cache::instance().stats();
+    size_t lookups = stats.m_hits + stats.m_misses;
+
+    m_out << "计划缓存统计信息如下: " << std::endl;
+    m_out << "缓存计划数: " << stats.m_plans << " / " << stats.m_capacity << std::endl;
+    m_out << "命中次数: " << stats.m_hits << std::endl;
+    m_out << "未命中次数: " << stats.m_misses << std::endl;
+    m_out << "命中率: " << (0 == lookups ? 0 : stats.m_hits * 100 / lookups) << "%" << std::endl;
+    m_out << "淘汰次数: " << stats.m_evictions << std::endl;
+    m_out << "预备语句数: " << m_prepared.size() << std::endl;
 }
 
 // tree / tree <dbname>
 void Order::_deal_tree() {
-    // 首先判断命令是否为正确的tree命令
-    // tree 或者 tree <dbname>，因此出现两个或者两个以上的括号是不合法的
-    std::string dbname = std::string();
-
-    size_t pos = m_command.find(' ');
-    if (std::string::npos != pos) {
-        // 查询第二个空格
-        std::string command_dbname = std::string(m_command.begin() + pos + 1, m_command.end());
-        if (std::string::npos != command_dbname.find(' ')) {
-            _deal_unknown();
-            return;
-        }
-        // 有空格出现，说明想查询指定的数据库架构
-        dbname = command_dbname;
-    }
-    // 创建一个子进程
-    pid_t pid = fork();
-    if (-1 == pid) {
-        perror("fork");
-        exit(-1);
-    }
-
-    if (pid > 0) {
-        // 父进程，阻塞等待回收子进程
-        int ret = waitpid(-1, nullptr, 0);
-        if (-1 == ret) {
-            perror("waitpid");
-            exit(-1);
-        }
-    } else if (0 == pid) {
-        // 判断这个数据库存不存在
-        std::string path = data_prefix + dbname;
-        if (0 != access(path.c_str(), F_OK)) {
-            std::cout << "数据库 " << dbname << " 不存在,请检查之后重新输入!" << std::endl;
-            // 结束子进程，否则子进程去跑父进程的菜单代码了，会紊乱
-            exit(0);
-        }
+    // tree 或者 tree <dbname>，没有给出数据库名的时候是空的，查看所有的
+    std::string dbname = std::string(m_statement.m_name);
 
-        std::cout << "数据库目录架构如下所示: " << std::endl;
-        // 子进程逻辑，调用exec函数族执行tree命令
-        execlp("tree", "tree", path.c_str(), "-a", "-I", "README.md", nullptr);  // 忽略目录中引导作用的README.md
+    // 判断这个数据库存不存在
+    std::string path = data_prefix + dbname;
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "数据库 " << dbname << " 不存在,请检查之后重新输入!" << std::endl;
+        return;
     }
+
+    m_out << "数据库目录架构如下所示: " << std::endl;
+    // 调用tree命令，忽略目录中引导作用的README.md和WAL
+    _run_program({"tree", path, "-a", "-I", "README.md|" + Wal::file_name});
 }
 
 // q / quit
 void Order::_deal_quit() {
     // 从上面的逻辑判断，这个东西一定是对的指令
-    Tools::open_and_print(res_prefix + "menu_end.txt");
+    Tools::open_and_print(res_prefix + "menu_end.txt", m_out);
 }
 
 // clear
 void Order::_deal_clear() {
-    // 调用exec函数族清空屏幕
+    // clear命令的输出其实就是清屏的控制字符，发给客户端打印出来，清的就是客户端的屏幕
+    _run_program({"clear"});
+}
+
+void Order::_run_program(const std::vector<std::string>& args) {
+    // 子进程的标准输出接到管道上，父进程把它读到m_out中
+    int pipe_fd[2];
+    if (-1 == pipe(pipe_fd)) {
+        perror("pipe");
+        exit(-1);
+    }
+
     pid_t pid = fork();
     if (-1 == pid) {
         perror("fork");
         exit(-1);
     }
 
-    if (pid > 0) {
-        // 父进程，阻塞等待回收子进程
-        int ret = waitpid(-1, nullptr, 0);
-        if (-1 == ret) {
+    if (0 == pid) {
+        // 子进程，调用exec函数族执行命令
+        dup2(pipe_fd[1], STDOUT_FILENO);
+        close(pipe_fd[0]);
+        close(pipe_fd[1]);
+
+        std::vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+
+        // exec失败了，子进程不能回去跑服务端的代码
+        perror("execvp");
+        _exit(-1);
+    }
+
+    // 父进程，读完子进程的输出之后阻塞等待回收子进程
+    close(pipe_fd[1]);
+    char read_buf[BUFSIZ];
+    while (1) {
+        ssize_t len = read(pipe_fd[0], read_buf, sizeof(read_buf));
+        if (-1 == len and EINTR == errno)
+            continue;
+        if (len <= 0)
+            break;
+        m_out.write(read_buf, len);
+    }
+    close(pipe_fd[0]);
+
+    while (-1 == waitpid(pid, nullptr, 0)) {
+        if (EINTR != errno) {
             perror("waitpid");
             exit(-1);
         }
-    } else if (0 == pid)
-        // TODO
-        // 这里我没有更改逻辑，但是服务端调用的东西能让客户端清屏，我需要研究一下clear命令的实质了...
-        execlp("clear", "clear", nullptr);
+    }
 }
 
 // create database <dbname>
 void Order::_deal_create_database() {
-    // 前面的几个字符一定是 "create database"，并且一定存在第三个参数!
-    size_t pos = strlen("create database");
-    // 现在该拿到目录的name了
-    std::string command_dbname = std::string(m_command.begin() + pos + 1, m_command.end());
-    if (std::string::npos != command_dbname.find(' ')) {
-        _deal_unknown();
-        return;
-    }
+    // 语法分析保证了数据库名是一个单词
+    std::string command_dbname = std::string(m_statement.m_name);
 
     // 我想要把数据库创建在data目录中，需要做特殊字符的判断
     // 不能出现 \ / : * ? " < > |
     if (Tools::check_has_any(command_dbname, banned_ch)) {
-        std::cout << "数据库命名 \"" << command_dbname << "\" 当中带有非法字符,请重新输入!" << std::endl;
+        m_out << "数据库命名 \"" << command_dbname << "\" 当中带有非法字符,请重新输入!" << std::endl;
         return;
     }
 
     // 然后开始创建数据库，就是创建一个目录
     std::string path = data_prefix + command_dbname;
     if (0 == access(path.c_str(), F_OK))  // 先判断目录是否存在
-        std::cout << "数据库 " << command_dbname << " 已存在,请检查名称并修改!" << std::endl;
+        m_out << "数据库 " << command_dbname << " 已存在,请检查名称并修改!" << std::endl;
     else {
         mkdir(path.c_str(), 0755);
-        std::cout << "数据库 " << command_dbname << " 创建成功!" << std::endl;
+        m_out << "数据库 " << command_dbname << " 创建成功!" << std::endl;
     }
 }
 
 // drop database <dbname>
 void Order::_deal_drop_database() {
     // 大体的逻辑同创建数据库一样
-    size_t pos = strlen("drop database");
-    std::string command_dbname = std::string(m_command.begin() + pos + 1, m_command.end());
-    if (std::string::npos != command_dbname.find(' ')) {
-        _deal_unknown();
-        return;
-    }
+    std::string command_dbname = std::string(m_statement.m_name);
 
     // 得到数据库名字，先看存不存在
     std::string path = data_prefix + command_dbname;
     if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "数据库 " << command_dbname << " 不存在,请检查名称并修改!" << std::endl;
+        m_out << "数据库 " << command_dbname << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
     // 检查目录是否为空
@@ -323,51 +477,77 @@ void Order::_deal_drop_database() {
         }
 
         // 判断是否为空
-        // std::cout << file->d_name << std::endl;
-        if ("." != std::string(file->d_name) and ".." != std::string(file->d_name)) {
-            std::cout << "数据库 " << command_dbname << " 不为空,请将数据库清空之后再次尝试!" << std::endl;
+        // m_out << file->d_name << std::endl;
+        // WAL不算，删除数据库的时候一起删掉
+        if ("." != std::string(file->d_name) and ".." != std::string(file->d_name) and Wal::file_name != file->d_name) {
+            m_out << "数据库 " << command_dbname << " 不为空,请将数据库清空之后再次尝试!" << std::endl;
+            closedir(dir);
             return;
         }
     }
+    closedir(dir);
+
     // 删除目录
+    Wal::remove(path);
     rmdir(path.c_str());  // rmdir只能删除空目录，虽然可以通过错误号判断是错误还是非空目录，但是还是从上面的代码来吧
-    std::cout << "数据库 " << command_dbname << " 删除成功!" << std::endl;
+    m_out << "数据库 " << command_dbname << " 删除成功!" << std::endl;
 }
 
 // use <dbname>
 void Order::_deal_use() {
-    // 已经有一个空格了，剩下的部分不能存在空格
-    size_t pos = strlen("use");
-    std::string command_dbname = std::string(m_command.begin() + pos + 1, m_command.end());
-    if (std::string::npos != command_dbname.find(' ')) {
-        _deal_unknown();
-        return;
-    }
+    std::string command_dbname = std::string(m_statement.m_name);
     // 判断这个数据库存不存在
     std::string path = data_prefix + command_dbname;
     if (0 != access(path.c_str(), F_OK)) {
         m_dbname.clear();  // 清空数据库名字数据
-        std::cout << "数据库 " << command_dbname << " 不存在,请检查之后重新输入!" << std::endl;
+        m_out << "数据库 " << command_dbname << " 不存在,请检查之后重新输入!" << std::endl;
         return;
     }
 
     // 更改使用的数据库目录
     m_dbname = command_dbname;
-    std::cout << "已切换到数据库 " << m_dbname << std::endl;
+    m_out << "已切换到数据库 " << m_dbname << std::endl;
 }
 
 /*******关于表的操作都必须在选中数据库之前，所以需要先进行判断*******/
 
 bool Order::_check_if_use() {
     if (m_dbname.empty()) {
-        std::cout << "未选择任何数据库!请选择合适数据库之后重试!" << std::endl;
+        m_out << "未选择任何数据库!请选择合适数据库之后重试!" << std::endl;
         return false;
     }
     return true;
 }
 
+Wal& Order::_wal() {
+    return Wal::for_database(data_prefix + m_dbname);
+}
+
+uint64_t Order::_log_write(const std::string& table_name, uint64_t table_lsn) {
+    if (0 != m_replay_lsn)
+        return table_lsn >= m_replay_lsn ? 0 : m_replay_lsn;
+
+    // 预备语句写填好参数之后的语句，重放的时候不需要预备语句还在
+    return _wal().append(table_name, m_rendered.empty() ? m_command : m_rendered);
+}
+
+void Order::_commit(uint64_t lsn) {
+    if (0 != m_replay_lsn)
+        return;
+
+    // 修改已经在缓存中了，表的锁已经放开，这张表上的下一条修改可以接着执行，也可以和这条一起组提交
+    _wal().wait_durable(lsn);
+    _wal().maybe_checkpoint();
+}
+
+std::string Order::_table_path(std::string_view table_name) const {
+    std::string path = data_prefix + m_dbname + '/';
+    path.append(table_name);
+    path += ".dat";
+    return path;
+}
+
 // create table <table_name> ( <column> <type> ,...);
-// 写好的屎山，就不要动它了...
 void Order::_deal_create_table() {
     // 进来就检测是否选中数据库
     if (!_check_if_use())
@@ -376,106 +556,51 @@ void Order::_deal_create_table() {
     // 实例化Table对象
     Table table;
 
-    size_t pos = strlen("create table");
-    // "create table"的错误命令在上面判断过了，这里不判断
-    // 查询 '(' 和 ')'
-    size_t pos_left = m_command.find('(');
-    if (std::string::npos == pos_left) {
-        _deal_unknown();
-        return;
-    }
-    size_t pos_right = m_command.find(')');
-    if (std::string::npos == pos_right) {
-        _deal_unknown();
-        return;
-    }
-
-    // 如果 ')' 后面出现其他字符则命令不正确
-    if (')' != m_command.back()) {
-        _deal_unknown();
-        return;
-    }
-
-    // 处理table_name
-    if (pos + 1 == pos_left) {  // 到这一步table后面一定带有一个空格了，否则就是unknown命令
-        _deal_unknown();
-        return;
-    }
-
-    std::string table_name = std::string(m_command.begin() + pos + 1, m_command.begin() + pos_left);
-    // 如果<table_name>和 '(' 中间有一个空格，我们把它弹掉
-    if (' ' == m_command[pos_left - 1])
-        table_name.pop_back();
-    // 如果末尾的空格都被弹掉之后，table_name中还有空格则命令不对
-    if (std::string::npos != table_name.find(' ')) {
-        _deal_unknown();
-        return;
-    }
-
     // 检测表名是否符合命名规范
     // 不能出现 \ / : * ? " < > |
+    std::string table_name = std::string(m_statement.m_name);
     if (Tools::check_has_any(table_name, banned_ch)) {
-        std::cout << "表命名 \"" << table_name << "\" 当中带有非法字符,请重新输入!" << std::endl;
+        m_out << "表命名 \"" << table_name << "\" 当中带有非法字符,请重新输入!" << std::endl;
         return;
     }
 
     table.m_table_name = table_name;
-    // std::cout << '(' << table_name << ')' << std::endl;
 
     // 判断表是否已经存在
-    std::string path = Order::data_prefix + m_dbname + '/' + table_name + ".dat";
+    std::string path = _table_path(table_name);
     if (0 == access(path.c_str(), F_OK)) {
-        std::cout << "表 " << table.m_table_name << " 已存在,请检查名称并修改!" << std::endl;
-        return;
-    }
-
-    // 处理column_name和column_type
-    std::string column_string = std::string(m_command.begin() + pos_left + 1, m_command.begin() + pos_right);
-    // 在处理之前，我们把收尾的空格弹掉(如果存在)，方便判断最后一个列是否具有 ','
-    Tools::pop_space(column_string);
-
-    // 判断 ','
-    if (',' == column_string.back()) {
-        std::cout << "最后一列末尾不需要 ',' !请检查之后重试!" << std::endl;
+        m_out << "表 " << table.m_table_name << " 已存在,请检查名称并修改!" << std::endl;
         return;
     }
 
-    // 现在按 ',' 进行分割
-    auto type_name_s = Tools::my_spilt(column_string, ',');
-    for (auto& row : type_name_s) {
-        // 处理每一行
-        // 先把首尾的空格弹掉
-        Tools::pop_space(row);
-        // std::cout << '(' << row << ')' << std::endl;
-
-        // 现在的数据只可能是 "<column> <type>"，也就是只有一个空格
-        std::vector<std::string> type_name = Tools::my_spilt(row, ' ');
-        if (2 != type_name.size()) {
-            _deal_unknown();
-            return;
-        }
+    // 处理column_name和column_type，语法分析已经拆好了
+    for (auto& column : m_statement.m_column_defs) {
+        std::string column_name = std::string(column.m_name);
+        std::string column_type = std::string(column.m_type);
 
         // 检查名称
-        if (Tools::check_has_any(type_name[0], banned_ch)) {
-            std::cout << "字段名称 \"" << type_name[0] << "\" 当中含有非法字符,请重新输入!" << std::endl;
+        if (Tools::check_has_any(column_name, banned_ch)) {
+            m_out << "字段名称 \"" << column_name << "\" 当中含有非法字符,请重新输入!" << std::endl;
             return;
         }
         // 检查类型，目前只考虑是int或者string
-        if ("int" != type_name[1] and "string" != type_name[1]) {
-            std::cout << "字段类型 \"" << type_name[1] << "\" 不符合规范,请重新输入" << std::endl;
+        if ("int" != column_type and "string" != column_type) {
+            m_out << "字段类型 \"" << column_type << "\" 不符合规范,请重新输入" << std::endl;
             return;
         }
         // 存储
-        table.m_columns.push_back({type_name[0], type_name[1]});
+        table.m_columns.push_back({column_name, column_type});
     }
 
     // 存储到文件中，path在前面已经定义
     // Table结构体里面使用了vector，导致大小不确定，如果直接写入结构体，在读取的时候新的Table不知道大小是多少，会段错误
     // 因此在写入的时候我需要执行相关的规则才能保证正确的写入
+    // 新表不能被之前同名的表留在WAL中的记录影响，所以它的LSN从当前的位置开始
+    table.m_lsn = _wal().last_lsn();
     Tools::write_table_to_file(table, path);
 
     // 输出反馈
-    std::cout << "表 " << table.m_table_name << " 创建成功!" << std::endl;
+    m_out << "表 " << table.m_table_name << " 创建成功!" << std::endl;
 }
 
 // drop table <table_name>
@@ -483,388 +608,484 @@ void Order::_deal_drop_table() {
     if (!_check_if_use())
         return;
 
-    // 大体的逻辑同删除数据库一样
-    size_t pos = strlen("drop table");
-    std::string command_table_name = std::string(m_command.begin() + pos + 1, m_command.end());
-    if (std::string::npos != command_table_name.find(' ')) {
-        _deal_unknown();
-        return;
-    }
-
     // 得到表名字，先看存不存在
-    std::string path = data_prefix + m_dbname + "/" + command_table_name + ".dat";
+    std::string path = _table_path(m_statement.m_name);
     if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "表 " << command_table_name << " 不存在,请检查名称并修改!" << std::endl;
+        m_out << "表 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
 
-    // 删除文件
+    // 删除文件，缓存中的也不需要写回了，表上的索引文件一起删掉
+    // 持有WAL的write_guard，检查点不会在删掉之后又把表写回去
+    auto guard = _wal().write_guard();
+    Table_Index::remove(Table_Cache::instance().get_schema(path), path);
+    Table_Cache::instance().erase(path);
     int ret = unlink(path.c_str());
     if (-1 == ret) {
         perror("unlink");
         exit(-1);
     }
 
-    std::cout << "表 " << command_table_name << " 删除成功!" << std::endl;
+    m_out << "表 " << m_statement.m_name << " 删除成功!" << std::endl;
 }
 
-// select <column> from <table> [where <cond>]
-// 写好的屎山，就不要动它了...
-void Order::_deal_select() {
+// create index <index_name> on <table>(<column>) [using hash|btree]
+void Order::_deal_create_index() {
     if (!_check_if_use())
         return;
 
-    // 实例化Table对象
-    Table table;
-
-    size_t pos = strlen("select");
-    size_t pos_from = m_command.find("from");
-    if (std::string::npos == pos_from) {
-        _deal_unknown();
+    // 没有using的时候默认是哈希索引
+    std::string index_type = m_statement.m_index_type.empty() ? "hash" : std::string(m_statement.m_index_type);
+    if (!Table_Index::valid_type(index_type)) {
+        m_out << "索引类型 \"" << index_type << "\" 不符合规范,目前只支持 hash 和 btree!" << std::endl;
         return;
     }
-    // 判断这两个中间是否为空
-    if (pos + 1 == pos_from) {
-        std::cout << "未选择任何列,请检查之后重新输入!" << std::endl;
+
+    std::string index_name = std::string(m_statement.m_index_name);
+    std::string table_name = std::string(m_statement.m_name);
+    std::string column_name = std::string(m_statement.m_column);
+
+    // 索引名会出现在索引文件的文件名中
+    if (Tools::check_has_any(index_name, banned_ch)) {
+        m_out << "索引命名 \"" << index_name << "\" 当中带有非法字符,请重新输入!" << std::endl;
         return;
     }
 
-    // 拿出需要查找的列
-    std::string command_columns = std::string(m_command.begin() + pos + 1, m_command.begin() + pos_from);
-    // 这里必须有一个空格，否则<column>就和from连在一起了，不合适
-    if (' ' != command_columns.back()) {
-        _deal_unknown();
+    std::string path = _table_path(table_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
-    // 同理，from后面也要有一个空格，这就有两种错误情况，一是from后面没东西了，二是有东西但是粘在一起了
-    if (pos_from + 4 == m_command.size() or ' ' != m_command[pos_from + 4]) {
-        _deal_unknown();
+
+    std::shared_ptr<Table> table_ptr = Table_Cache::instance().get(path);
+    Table& table = *table_ptr;
+
+    if (table.m_columns.end() == std::find_if(table.m_columns.begin(), table.m_columns.end(),
+                                              [&](const Column& column) { return column_name == column.m_column_name; })) {
+        m_out << "表 " << table_name << " 中不存在字段 " << column_name << " ,请检查之后重新输入!" << std::endl;
         return;
     }
+    for (auto& index : table.m_indexes) {
+        if (index_name == index.m_index_name) {
+            m_out << "索引 " << index_name << " 已存在,请检查名称并修改!" << std::endl;
+            return;
+        }
+        if (column_name == index.m_column_name) {
+            m_out << "字段 " << column_name << " 上已经有索引 " << index.m_index_name << " 了!" << std::endl;
+            return;
+        }
+    }
+
+    // 建索引不写WAL，索引的定义在模式块里面，所以马上把表和索引文件一起写回去
+    // 改表的时候同样持有WAL的write_guard，检查点不会写回改了一半的表
+    auto guard = _wal().write_guard();
+    Index_Info index;
+    index.m_index_name = index_name;
+    index.m_column_name = column_name;
+    index.m_index_type = index_type;
+    Table_Index::create(table, index);
+    Table_Cache::instance().mark_dirty(path, table_ptr);
+    Table_Cache::instance().flush_all(path);
 
-    // 弹掉空格
-    command_columns.pop_back();
+    m_out << "索引 " << index_name << " 创建成功!" << std::endl;
+}
 
-    // 我们仍不允许末尾出现 ','
-    if (',' == command_columns.back()) {
-        std::cout << "<column>末尾不需要 ','!请检查之后重试!" << std::endl;
+// select <column> from <table> [join <table> on <column> = <column>] [where <cond>] [order by <column> [asc|desc], ...]
+//     [limit <count> [offset <skip>]]
+void Order::_deal_select() {
+    if (!_check_if_use())
         return;
-    }
 
-    // 拿到正确的<column>之后，进行处理
-    std::vector<std::string> show_columns;
-    // 为*表示全部展示，show_column为空
-    if ("*" != command_columns) {
-        show_columns = Tools::my_spilt(command_columns, ',');
-        for (auto& column : show_columns) {
-            // 去掉多余的空格
-            Tools::pop_space(column);
-            // std::cout << '(' << column << ')' << std::endl;
-            // 如果逗号之间的<column>中间还含有空格，命令肯定不对
-            if (std::string::npos != column.find(' ')) {
-                _deal_unknown();
-                return;
-            }
+    // 结果不一次性生成，先读一批，剩下的等网络层把这一批发出去之后再接着读
+    std::shared_ptr<Table> table_ptr;
+    std::shared_ptr<Cursor> cursor = _open_cursor(table_ptr, true);
+    if (nullptr == cursor)
+        return;
+
+    m_stream.m_cursor = cursor;
+    m_stream.m_remaining = UINT64_MAX;
+    _fetch_batch(m_stream);
+}
+
+std::shared_ptr<Cursor> Order::_open_cursor(std::shared_ptr<Table>& table_ptr, bool begin_result) {
+    // 判断表文件是否存在
+    std::string path = _table_path(m_statement.m_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
+        return nullptr;
+    }
+
+    uint64_t offset, limit;
+    if (!m_statement.limits(offset, limit)) {
+        m_out << "limit和offset的行数必须是非负整数!" << std::endl;
+        return nullptr;
+    }
+
+    // 有limit或者order by的单表查询，表不在缓存中并且用不上索引的时候按页读表文件，
+    // limit读够了就不再往后读，排序也只留用到的列，不把整张表读进缓存
+    if (!m_statement.is_join() and !m_statement.is_aggregate() and
+        (UINT64_MAX != limit or !m_statement.m_order_by.empty())) {
+        auto scanner = std::make_shared<Table_File::Scanner>();
+        if (Table_Cache::instance().scan(path, *scanner) and !index_helps(scanner->schema(), m_statement))
+            return _open_source(scanner, m_statement, begin_result);
+    }
+
+    // 这时候读入table对象，因为要比对了，最近用过的表直接从缓存中拿
+    table_ptr = Table_Cache::instance().get(path);
+    Read_Latches latches;
+    latches.add(Table_Cache::instance().latch(path));
+    std::shared_ptr<Table> join_ptr;
+    if (m_statement.is_join()) {
+        std::string join_path = _table_path(m_statement.m_join_name);
+        if (0 != access(join_path.c_str(), F_OK)) {
+            m_out << "表 " << m_statement.m_join_name << " 不存在,请检查名称并修改!" << std::endl;
+            return nullptr;
         }
+        join_ptr = Table_Cache::instance().get(join_path);
+        latches.add(Table_Cache::instance().latch(join_path));
     }
 
-    // 然后读取表
-    std::string command_tablename_where = std::string(m_command.begin() + pos_from + 4 + 1, m_command.end());
-    std::string table_name;
+    // 表都拿到了再锁，拿着表的锁的时候不再进缓存；读的期间其他连接只有改内存的那一小会儿要等
+    std::shared_lock<Read_Latches> lock(latches);
+    std::shared_ptr<Cursor> cursor;
+    if (m_statement.is_join())
+        cursor = _open_join(table_ptr, join_ptr, begin_result);
+    else if (m_statement.is_aggregate())
+        cursor = _open_aggregate(*table_ptr, m_statement, begin_result);
+    else
+        cursor = _open_view(table_ptr, m_statement, begin_result);
 
-    // 如果没有where，那么不允许出现空格
-    size_t pos_where = command_tablename_where.find("where");
-    // where不存在
-    std::vector<std::string> name_val;  // 在这里提前定义where后面的语句
+    // 聚合的结果是自己的一张表，其他的游标之后每次fetch还要读缓存中的表
+    if (nullptr != cursor and !m_statement.is_aggregate())
+        cursor->hold(latches);
+    return cursor;
+}
 
-    if (std::string::npos == pos_where) {
-        if (std::string::npos != command_tablename_where.find(' ')) {
-            _deal_unknown();
-            return;
-        }
-        // 拿到table_name
-        table_name = command_tablename_where;
+std::shared_ptr<Cursor> Order::_open_view(std::shared_ptr<const Table> table_ptr, const Statement& statement,
+                                          bool begin_result) {
+    const Table& table = *table_ptr;
+
+    // 游标拿到快照，找到要显示的列和行的顺序，结果集的模式(列名和类型)由m_out编码成Schema帧
+    auto cursor = std::make_shared<Cursor>();
+    bool ok = cursor->open(table_ptr, statement);
+    if (begin_result) {
+        m_out << "表 " << table.m_table_name << " 查询结果如下: " << std::endl;
+        m_out.begin_result(table, cursor->columns());
     }
-    // 存在
-    else {
-        // where存在，前面必须存在空格
-        if (' ' != command_tablename_where[pos_where - 1]) {
-            _deal_unknown();
-            return;
-        }
-        // 后面也必须存在
-        if (pos_where + 5 == command_tablename_where.size() or ' ' != command_tablename_where[pos_where + 5]) {
-            _deal_unknown();
-            return;
-        }
-        table_name = std::string(command_tablename_where.begin(), command_tablename_where.begin() + pos_where - 1);
+    if (!ok) {
+        m_out << "表 " << table.m_table_name << " 中不存在字段 " << missing_order_column(table, statement) << " ,无法排序!"
+              << std::endl;
+        return nullptr;
+    }
+    return cursor;
+}
 
-        // where正确了，获取where后面的命令
-        std::string command_after_where = std::string(command_tablename_where.begin() + pos_where + 5 + 1, command_tablename_where.end());
-        if (std::string::npos == command_after_where.find('=') or std::string::npos != command_after_where.find("==")) {  // 我怕输入 == ，这里还是判断一下
-            std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+std::shared_ptr<Cursor> Order::_open_source(std::shared_ptr<Row_Source> source, const Statement& statement,
+                                            bool begin_result) {
+    const Table& schema = source->schema();
+    auto cursor = std::make_shared<Cursor>();
+    bool ok = cursor->open(source, statement);
+    if (begin_result) {
+        m_out << "表 " << schema.m_table_name << " 查询结果如下: " << std::endl;
+        m_out.begin_result(cursor->table(), cursor->columns());
+    }
+    if (!ok) {
+        m_out << "表 " << schema.m_table_name << " 中不存在字段 " << missing_order_column(schema, statement) << " ,无法排序!"
+              << std::endl;
+        return nullptr;
+    }
+    return cursor;
+}
 
-        name_val = Tools::my_spilt(command_after_where, '=');
-        if (2 != name_val.size()) {
-            std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+std::shared_ptr<Cursor> Order::_open_aggregate(const Table& table, const Statement& statement, bool begin_result) {
+    // 在服务端聚合成每个分组一行的小表，游标打开在这张表上，order by按结果中的列排序
+    auto result = std::make_shared<Table>();
+    std::string error;
+    if (!Hash_Aggregate::run(table, statement, *result, error)) {
+        m_out << error << std::endl;
+        return nullptr;
+    }
+    return _open_grouped(result, statement, begin_result);
+}
 
-        for (auto& each : name_val) {
-            Tools::pop_space(each);
-            // 去除头尾后如果还有空格就不对
-            if (std::string::npos != each.find(' ')) {
-                std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-                return;
+std::shared_ptr<Cursor> Order::_open_grouped(std::shared_ptr<Table> result, const Statement& statement,
+                                             bool begin_result) {
+    // 结果中的列名去掉了空白，order by中的原文也要一样地处理，view里面的string_view指向order_columns
+    std::vector<std::string> order_columns;
+    for (const Statement::Order_Key& key : statement.m_order_by)
+        order_columns.push_back(Hash_Aggregate::column_name(key.m_column));
+    Statement view;
+    view.m_type = Statement::Select;
+    for (size_t i = 0; i < order_columns.size(); ++i)
+        view.m_order_by.push_back({order_columns[i], statement.m_order_by[i].m_desc});
+    view.m_limit = statement.m_limit;
+    view.m_offset = statement.m_offset;
+
+    auto cursor = std::make_shared<Cursor>();
+    bool ok = cursor->open(result, view);
+    if (begin_result) {
+        m_out << "表 " << result->m_table_name << " 查询结果如下: " << std::endl;
+        m_out.begin_result(*result, cursor->columns());
+    }
+    if (!ok) {
+        for (const std::string& column : order_columns) {
+            if (result->m_columns.end() == std::find_if(result->m_columns.begin(), result->m_columns.end(),
+                                                        [&](const auto& c) { return column == c.m_column_name; })) {
+                m_out << "聚合结果中不存在列 " << column << " ,无法排序!" << std::endl;
+                break;
             }
         }
+        return nullptr;
     }
+    return cursor;
+}
 
-    // 判断表文件是否存在
-    std::string path = Order::data_prefix + m_dbname + '/' + table_name + ".dat";
-    if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
-        return;
+std::shared_ptr<Cursor> Order::_open_join(std::shared_ptr<const Table> left, std::shared_ptr<const Table> right,
+                                          bool begin_result) {
+    // 在服务端连接，结果中只有语句用到的列，where和limit在连接的结果上执行
+    std::shared_ptr<Row_Source> source;
+    Statement view;
+    std::string error;
+    if (!Hash_Join::run(std::move(left), std::move(right), m_statement, source, view, error)) {
+        m_out << error << std::endl;
+        return nullptr;
+    }
+
+    // 聚合的时候连接的结果一批一批地直接交给聚合，不把所有的行读成一张表
+    if (view.is_aggregate()) {
+        auto result = std::make_shared<Table>();
+        if (!Hash_Aggregate::run(*source, view, *result, error)) {
+            m_out << error << std::endl;
+            return nullptr;
+        }
+        return _open_grouped(result, view, begin_result);
     }
 
-    // 这时候读入table对象，因为要比对了
-    table = Tools::read_table_from_file(path);
-
-    std::cout << "表 " << table.m_table_name << " 查询结果如下: " << std::endl;
+    // 否则游标读一批才连接一批，有limit的时候读够了就不再连接；排序的时候每一批交给排序器之后就丢掉
+    return _open_source(source, view, begin_result);
+}
 
-    // 显示字段名称
-    // 在检测字段的时候就存储一个bool数组记录哪些列是需要显示的
-    bool is_show[table.m_columns.size()] = {0};
+void Order::_fetch_batch(Result_Stream& stream) {
+    // int列直接按8字节发送，不用转成字符串
+    stream.m_remaining -= stream.m_cursor->fetch(stream.m_remaining, m_out);
+    if (0 == stream.m_remaining or stream.m_cursor->done())
+        stream = Result_Stream();
+    else
+        m_out.set_more(true);
+}
 
-    int where_index = -1;  // 定义where条件是判断哪一列
-    for (int i = 0; i < table.m_columns.size(); ++i) {
-        if (show_columns.empty() or
-            show_columns.end() != std::find(show_columns.begin(), show_columns.end(), table.m_columns[i].m_column_name)) {
-            std::cout << table.m_columns[i].m_column_name << ' ';
-            is_show[i] = true;
-        }
-        // 这个要写在外面，因为所有的列都要走一步判断
-        if (std::string::npos != pos_where and name_val[0] == table.m_columns[i].m_column_name)
-            where_index = i;
-    }
-    std::cout << std::endl;  // 这里需要换行刷新缓冲区，否则等命令结束后外面把标准输出重定向回去就输出到终端了
-
-    // 显示数据
-    bool flag = false;
-    for (auto& row : table.m_data) {
-        flag = false;
-        for (int i = 0; i < table.m_columns.size(); ++i) {
-            // 没有where
-            if (std::string::npos == pos_where) {
-                flag = true;
-                if (is_show[i])
-                    std::cout << row[i] << ' ';
-            }
-            // 有where
-            else {
-                // 先满足规则条件才能进行后面的输出
-                if (-1 != where_index and name_val[1] == row[where_index]) {
-                    flag = true;
-                    if (is_show[i])
-                        std::cout << row[i] << ' ';
-                }
-            }
-        }
-        if (flag)
-            std::cout << std::endl;
-    }
+void Order::resume(Result_Stream& stream) {
+    m_out.next_batch();
+    // 两批之间其他连接可以修改这张表，游标读的是自己的快照，不受影响
+    std::shared_lock<std::shared_mutex> read_lock(data_lock);
+    _fetch_batch(stream);
 }
 
-// 后面几个实现我准备按照某些规则把字符串进行切割，然后进行判断，这样看会不会方便点
 // delete <table> [where <cond>]
 void Order::_deal_delete() {
     if (!_check_if_use())
         return;
 
-    // 实例化Table对象
-    Table table;
-
-    // 如果没有where，那么只能存在一个空格；如果有where，那么where一定是第三个单词的位置
-    std::string table_name;
-    std::vector<std::string> command_split = Tools::my_spilt(m_command, ' ');
-
-    size_t pos_where = m_command.find("where");
-    if (std::string::npos == pos_where) {
-        if (2 != command_split.size()) {
-            _deal_unknown();
-            return;
-        }
-
-    } else {
-        if ("where" != command_split[2]) {
-            _deal_unknown();
-            return;
-        }
-    }
-    table_name = command_split[1];
+    std::string table_name = std::string(m_statement.m_name);
+    bool has_where = m_statement.m_has_where;
+    Where_Expr& cond = m_statement.m_where;
 
     // 判断表是否存在
-    std::string path = Order::data_prefix + m_dbname + '/' + table_name + ".dat";
+    std::string path = _table_path(table_name);
     if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
 
+    // 同一张表上的修改一条一条来，从读表一直持有到标记完脏表
+    std::shared_ptr<Table_Latch> latch = Table_Cache::instance().latch(path);
+    std::unique_lock<std::mutex> writer(latch->m_writer);
+
     // 读出table的内容
-    table = Tools::read_table_from_file(path);
+    std::shared_ptr<Table> table_ptr = Table_Cache::instance().get(path);
+    Table& table = *table_ptr;
 
-    // 开始delete
+    // 开始delete，先确定条件中的列存在，确定要删除之后写日志，然后才能修改表
     bool flag_del = true;  // 定义后面判断是否准确删除数据的一个标志
-    std::string command_after_where;
 
-    if (std::string::npos == pos_where)
-        table.m_data.clear();
-    else {
-        // 拿到where后面的命令
-        if (3 == command_split.size()) {  // where后面没有命令了
-            _deal_unknown();
-            return;
-        }
-        // 和前面那个where处理类似
-        command_after_where = std::string(m_command.begin() + pos_where + 5 + 1, m_command.end());
-        if (std::string::npos == command_after_where.find('=') or std::string::npos != command_after_where.find("==")) {  // 我怕输入 == ，这里还是判断一下
-            std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
-
-        std::vector<std::string> name_val = Tools::my_spilt(command_after_where, '=');
-        if (2 != name_val.size()) {
-            std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+    // 搜寻字段
+    if (has_where and !Where::bind(table, cond)) {  // 啥都删不掉
+        m_out << "您输入的where条件 " << Where::text(cond) << " 似乎不准确,什么也没删掉..." << std::endl;
+        return;
+    }
 
-        for (auto& each : name_val) {
-            Tools::pop_space(each);
-            // 去除头尾后如果还有空格就不对
-            if (std::string::npos != each.find(' ')) {
-                std::cout << "您输入的where条件 " << command_after_where << " 不正确,请检查之后重新输入" << std::endl;
-                return;
-            }
-        }
+    // 写日志
+    auto guard = _wal().write_guard();
+    uint64_t lsn = _log_write(table_name, table.m_lsn);
+    if (0 == lsn)
+        return;
 
-        // 搜寻字段
-        int where_index = -1;  // 定义where条件是判断哪一列
-        for (int i = 0; i < table.m_columns.size(); ++i)
-            if (name_val[0] == table.m_columns[i].m_column_name)
-                where_index = i;
-
-        // 删除对应数据
-        if (-1 != where_index) {
-            bool flag = false;
-            for (int i = 0; i < table.m_data.size(); ++i)
-                if (name_val[1] == table.m_data[i][where_index]) {
-                    flag = true;
-                    table.m_data.erase(table.m_data.begin() + i);
-                    --i;  // 删除之后所有人的下标前移，需要同步变化
-                }
-
-            if (!flag)  // 啥都没删掉
-                flag_del = false;
-        } else  // 啥都没删掉
+    // 找到要删除的最新版本，条件中的列上有索引就不用扫描
+    std::vector<size_t> del_rows;
+    if (!has_where) {
+        for (size_t i = 0; i < table.m_row_count; ++i)
+            if (table.is_live(i))
+                del_rows.push_back(i);
+    } else {
+        Where::find_rows(table, cond, table.snapshot(), del_rows);
+        if (del_rows.empty())  // 啥都没删掉
             flag_del = false;
     }
-    // 写回去
-    Tools::write_table_to_file(table, path);
+
+    // 不挪动行，只结束它们的版本，还在读旧快照的select和游标照样能读到，行号不变，索引也不用动
+    // 旧版本等没有快照在读的时候由缓存回收；只在改的这一小会儿挡住正在读这张表的语句
+    {
+        std::unique_lock<std::shared_mutex> rows(latch->m_rows);
+        for (size_t i : del_rows)
+            table.end_version(i, lsn);
+        if (flag_del)
+            table.m_lsn = lsn;
+    }
+
+    // 标记为脏表，由缓存负责写回
+    if (flag_del)
+        Table_Cache::instance().mark_dirty(path, table_ptr, false);
+    guard.unlock();
+    writer.unlock();
+    _commit(lsn);
 
     if (flag_del)
-        std::cout << "您指定的数据已经成功删除!" << std::endl;
+        m_out << "您指定的数据已经成功删除!" << std::endl;
     else
-        std::cout << "您输入的where条件 " << command_after_where << " 似乎不准确,什么也没删掉..." << std::endl;
+        m_out << "您输入的where条件 " << Where::text(cond) << " 似乎不准确,什么也没删掉..." << std::endl;
 }
 
-// insert <table> values (<const-value>, <const-value>, ...)
+// insert <table> values (<const-value>, <const-value>, ...), ...
 void Order::_deal_insert() {
     if (!_check_if_use())
         return;
 
-    // 实例化Table对象
-    Table table;
-
-    // 如果没有where，那么只能存在一个空格；如果有where，那么where一定是第三个单词的位置
-    std::string table_name;
-    std::vector<std::string> command_split = Tools::my_spilt(m_command, ' ');
+    std::string table_name = std::string(m_statement.m_name);
+    const std::vector<std::string_view>& values = m_statement.m_values;
 
-    size_t pos_values = m_command.find("values");
-    if (std::string::npos == pos_values) {
-        _deal_unknown();
-        return;
-    }
-    if ("values" != command_split[2]) {
-        _deal_unknown();
-        return;
-    }
-    // values后面没数据了
-    if ("values" == command_split.back()) {
-        _deal_unknown();
+    // 判断表是否存在
+    std::string path = _table_path(table_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
 
-    table_name = command_split[1];
+    // 插入只需要知道有哪些字段，不需要把数据读进来
+    Table table = Table_Cache::instance().get_schema(path);
 
-    // 判断表是否存在
-    std::string path = Order::data_prefix + m_dbname + '/' + table_name + ".dat";
-    if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
+    // 如果个数不符合则不对
+    size_t tuples = m_statement.m_tuples;
+    if (table.m_columns.size() * tuples != values.size()) {
+        m_out << "您插入的一行数据字段个数不符合表 " << table.m_table_name << " 的要求,请检查之后重试!" << std::endl;
         return;
     }
+    // 所有的行都检查过再插入，有一行不对就一行都不插入；int列的值必须是合法的整数
+    size_t width = table.m_columns.size();
+    table.reserve(tuples);
+    std::vector<std::string> row(width);
+    for (size_t t = 0; t < tuples; ++t) {
+        for (int i = 0; i < width; ++i) {
+            row[i] = values[t * width + i];
+            if (!table.check_value(i, row[i])) {
+                if (tuples > 1)
+                    m_out << "第 " << t + 1 << " 行数据中, ";
+                m_out << "字段 " << table.m_columns[i].m_column_name << " 是int类型, " << row[i]
+                      << " 不是合法的整数,请检查之后重试!" << std::endl;
+                return;
+            }
+        }
+        table.append_row(row);
+    }
 
-    // 处理values后面的数据，(...)
-    // 查询'('和')'
-    size_t pos_left = m_command.find('(');
-    if (std::string::npos == pos_left) {
-        _deal_unknown();
+    // 写日志，多行也只有一条记录，一起追加、一次落盘；同一张表上的插入按日志的顺序一条一条追加
+    std::shared_ptr<Table_Latch> latch = Table_Cache::instance().latch(path);
+    std::unique_lock<std::mutex> writer(latch->m_writer);
+    auto guard = _wal().write_guard();
+    uint64_t lsn = _log_write(table_name, table.m_lsn);
+    if (0 == lsn)
         return;
-    }
-    size_t pos_right = m_command.find(')');
-    if (std::string::npos == pos_right) {
-        _deal_unknown();
+
+    // 表在缓存中就插到缓存里面，否则直接追加到文件末尾
+    Table_Cache::instance().append_rows(path, table, lsn);
+    guard.unlock();
+    writer.unlock();
+    _commit(lsn);
+
+    if (1 == tuples)
+        m_out << "已成功插入您输入的数据!" << std::endl;
+    else
+        m_out << "已成功插入您输入的 " << tuples << " 行数据!" << std::endl;
+}
+
+// load data '<file>' into <table>
+void Order::_deal_load() {
+    if (!_check_if_use())
         return;
-    }
-    // 如果末尾不是 ')' 则不对
-    if (')' != m_command.back()) {
-        _deal_unknown();
+
+    std::string table_name = std::string(m_statement.m_name);
+    std::string file = std::string(m_statement.m_values[0]);
+    std::string path = _table_path(table_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
 
-    std::string command_values = std::string(m_command.begin() + pos_left + 1, m_command.begin() + pos_right);
-    // 如果末尾含有空格，将其弹掉
-    if (' ' == command_values.back())
-        command_values.pop_back();
-    // 如果弹掉之后末尾是 ',' 则不对
-    if (',' == command_values.back()) {
-        std::cout << "values末尾不需要 ','!请检查之后重试!" << std::endl;
+    // 和insert一样只需要字段，几个线程解析好之后一次追加到表中
+    auto start = std::chrono::steady_clock::now();
+    Table rows = Table_Cache::instance().get_schema(path);
+    Csv_Loader::Stats stats;
+    std::string error;
+    if (!Csv_Loader::load(file, rows, stats, error)) {
+        m_out << error << std::endl;
         return;
     }
 
-    // 把table读进来
-    table = Tools::read_table_from_file(path);
+    if (0 != rows.m_row_count) {
+        // 解析的时候不拿表的锁，追加的时候才和这张表上的其他修改排队
+        std::shared_ptr<Table_Latch> latch = Table_Cache::instance().latch(path);
+        std::unique_lock<std::mutex> writer(latch->m_writer);
+        auto guard = _wal().write_guard();
+        uint64_t lsn = _log_write(table_name, rows.m_lsn);
+        if (0 == lsn)
+            return;
+        Table_Cache::instance().append_rows(path, rows, lsn);
+        // 日志中只记了这条命令，重放的时候要重新读csv文件，所以马上写回表文件，
+        // 并且在确认之前fsync，表文件中的LSN落盘之后重放会跳过这条记录，之后csv文件改了或者删了也不影响恢复
+        Table_Cache::instance().flush_all(path);
+        guard.unlock();
+        writer.unlock();
+        Tools::sync_file(path);
+        _commit(lsn);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_out << "已成功导入 " << stats.m_rows << " 行数据";
+    if (0 != stats.m_rejected)
+        m_out << ",跳过 " << stats.m_rejected << " 行不合法的数据(第一行在文件的第 " << stats.m_first_rejected << " 行)";
+    m_out << ",用时 " << seconds << " 秒,每秒 " << (uint64_t)(stats.m_rows / std::max(seconds, 1e-6)) << " 行!"
+          << std::endl;
+}
 
-    std::vector<std::string> values = Tools::my_spilt(command_values, ',');
-    // 如果个数不符合则不对
-    if (table.m_columns.size() != values.size()) {
-        std::cout << "您插入的一行数据字段个数不符合表 " << table.m_table_name << " 的要求,请检查之后重试!" << std::endl;
+// vacuum <table>
+void Order::_deal_vacuum() {
+    if (!_check_if_use())
         return;
-    }
-    std::vector<std::string> new_row;
 
-    // 去掉首尾空格，并且插入数据
-    for (auto& each : values) {
-        Tools::pop_space(each);
-        new_row.push_back(each);
+    std::string table_name = std::string(m_statement.m_name);
+    std::string path = _table_path(table_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
+        return;
     }
-    table.m_data.push_back(new_row);
-
-    // 写入文件
-    Tools::write_table_to_file(table, path);
 
-    std::cout << "已成功插入您输入的数据!" << std::endl;
+    // 不改变表的内容，不写WAL；和建索引一样持有WAL的write_guard，检查点不会同时写回这张表
+    auto guard = _wal().write_guard();
+    size_t rows = 0;
+    if (!Table_Cache::instance().vacuum(path, rows)) {
+        m_out << "表 " << table_name << " 上还有打开的游标,请关闭之后重试!" << std::endl;
+        return;
+    }
+    m_out << "表 " << table_name << " 整理完成,回收了 " << rows << " 行已经删除的数据!" << std::endl;
 }
 
 // update <table> set <column> = <const-value> [where <cond>]
@@ -872,150 +1093,230 @@ void Order::_deal_update() {
     if (!_check_if_use())
         return;
 
-    // 实例化Table对象
-    Table table;
-
-    std::string table_name;
-    std::vector<std::string> command_split = Tools::my_spilt(m_command, ' ');
+    std::string table_name = std::string(m_statement.m_name);
+    std::string set_column = std::string(m_statement.m_column);
+    std::string set_value = std::string(m_statement.m_values[0]);
+    bool has_where = m_statement.m_has_where;
+    Where_Expr& cond = m_statement.m_where;
 
-    size_t pos_set = m_command.find("set");
-    if (std::string::npos == pos_set) {
-        _deal_unknown();
+    // 判断表是否存在
+    std::string path = _table_path(table_name);
+    if (0 != access(path.c_str(), F_OK)) {
+        m_out << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
         return;
     }
-    if ("set" != command_split[2]) {
-        _deal_unknown();
+
+    // 同一张表上的修改一条一条来，从读表一直持有到标记完脏表
+    std::shared_ptr<Table_Latch> latch = Table_Cache::instance().latch(path);
+    std::unique_lock<std::mutex> writer(latch->m_writer);
+
+    // 读文件
+    std::shared_ptr<Table> table_ptr = Table_Cache::instance().get(path);
+    Table& table = *table_ptr;
+
+    // 拿到之后就可以开始查询了并且修改了
+    int set_index = -1;  // 定义set条件是判断哪一列
+    for (int i = 0; i < table.m_columns.size(); ++i) {
+        if (set_column == table.m_columns[i].m_column_name)
+            set_index = i;
+    }
+    if (-1 == set_index) {
+        m_out << "您输入的set条件 " << set_column << " = " << set_value << " 似乎不准确,什么也没修改..." << std::endl;
         return;
     }
-    if ("set" == command_split.back()) {
-        _deal_unknown();
+    if (!table.check_value(set_index, set_value)) {
+        m_out << "字段 " << set_column << " 是int类型, " << set_value << " 不是合法的整数,请检查之后重试!" << std::endl;
         return;
     }
 
-    table_name = command_split[1];
-
-    // 判断表是否存在
-    std::string path = Order::data_prefix + m_dbname + '/' + table_name + ".dat";
-    if (0 != access(path.c_str(), F_OK)) {
-        std::cout << "表 " << table_name << " 不存在,请检查名称并修改!" << std::endl;
+    if (has_where and !Where::bind(table, cond)) {
+        m_out << "您输入的where条件 " << Where::text(cond) << " 似乎不准确,什么也没修改..." << std::endl;
         return;
     }
 
-    std::string command_after_set = std::string(m_command.begin() + pos_set + 3 + 1, m_command.end());
-    // 现在来处理后面的一坨答辩
-    // command_set_value是需要给某列设置的值,command_where就是列的条件
-    std::string command_set_value, command_where;
-    size_t pos_where = command_after_set.find("where");
-    if (std::string::npos != pos_where) {
-        command_set_value = std::string(command_after_set.begin(), command_after_set.begin() + pos_where);
-        if (command_set_value.empty()) {
-            _deal_unknown();
-            return;
-        }
+    // 写日志
+    auto guard = _wal().write_guard();
+    uint64_t lsn = _log_write(table_name, table.m_lsn);
+    if (0 == lsn)
+        return;
 
-        // where后面必须有空格，两种情况，where后面没数据或者单词连起来了
-        if (pos_where + 5 == command_after_set.size() or ' ' != command_after_set[pos_where + 5]) {
-            _deal_unknown();
-            return;
+    // 先找到要修改的最新版本
+    std::vector<size_t> set_rows;
+    // 如果没有where
+    if (!has_where) {
+        // 更新所有
+        for (size_t i = 0; i < table.m_row_count; ++i)
+            if (table.is_live(i))
+                set_rows.push_back(i);
+    }
+    // 根据条件查询修改，条件中的列上有索引就不用扫描，B+树给出的行号要重新排成升序
+    else if (Where::find_rows(table, cond, table.snapshot(), set_rows))
+        std::sort(set_rows.begin(), set_rows.end());
+
+    // 不在原地修改: 结束旧版本，把改好的新版本追加到末尾，还在读旧快照的select和游标看到的还是旧的值；
+    // 追加可能让vector扩容，改的这一小会儿挡住正在读这张表的语句
+    {
+        std::unique_lock<std::shared_mutex> rows(latch->m_rows);
+        size_t first_new = table.m_row_count;
+        table.reserve(first_new + set_rows.size());
+        for (size_t i : set_rows) {
+            table.append_row_from(table, i);
+            table.set_cell(table.m_row_count - 1, set_index, set_value);
+            table.end_version(i, lsn);
         }
-        command_where = std::string(command_after_set.begin() + pos_where + 5 + 1, command_after_set.end());
+        Table_Index::insert_rows(table, first_new);
+        table.m_lsn = lsn;
+    }
 
-    } else
-        command_set_value = command_after_set;
+    // 标记为脏表，由缓存负责写回
+    Table_Cache::instance().mark_dirty(path, table_ptr, false);
+    guard.unlock();
+    writer.unlock();
+    _commit(lsn);
 
-    // 处理value的设置的值，复用前面的代码
-    // -----------------------
-    if (std::string::npos == command_set_value.find('=') or std::string::npos != command_set_value.find("==")) {  // 我怕输入 == ，这里还是判断一下
-        std::cout << "您输入的set条件 " << command_set_value << " 不正确,请检查之后重新输入" << std::endl;
+    m_out << "已成功按照您的要求修改数据!" << std::endl;
+}
+
+// prepare <name> as <stmt>
+void Order::_deal_prepare() {
+    std::string name = std::string(m_statement.m_name);
+    if (m_prepared.count(name)) {
+        m_out << "预备语句 " << name << " 已存在,请先deallocate之后重试!" << std::endl;
         return;
     }
 
-    std::vector<std::string> name_val_set_value = Tools::my_spilt(command_set_value, '=');
-    if (2 != name_val_set_value.size()) {
-        std::cout << "您输入的set条件 " << command_set_value << " 不正确,请检查之后重新输入" << std::endl;
+    std::shared_ptr<const Plan> plan = _make_plan(m_statement.m_body);
+    if (nullptr == plan) {
+        _deal_unknown();
+        return;
+    }
+    if (!plan->m_statement.is_dml()) {
+        m_out << "只能prepare select、insert、update和delete语句,请检查之后重新输入!" << std::endl;
         return;
     }
 
-    for (auto& each : name_val_set_value) {
-        Tools::pop_space(each);
-        // 去除头尾后如果还有空格就不对
-        if (std::string::npos != each.find(' ')) {
-            std::cout << "您输入的set条件 " << command_set_value << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+    m_prepared[name] = plan;
+    m_out << "预备语句 " << name << " 创建成功,共有 " << plan->m_statement.m_params.size() << " 个参数!" << std::endl;
+}
+
+// execute <name> [(<value>, ...)]
+void Order::_deal_execute() {
+    auto it = m_prepared.find(std::string(m_statement.m_name));
+    if (m_prepared.end() == it) {
+        m_out << "预备语句 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
+        return;
     }
-    // -----------------------
 
-    // 处理where的条件
-    // -----------------------
-    std::vector<std::string> name_val_where;
+    // 参数指向m_command，换成预备语句的语法树之后仍然有效
+    std::vector<std::string_view> args = std::move(m_statement.m_values);
+    const Plan& plan = *it->second;
+    if (args.size() != plan.m_statement.m_params.size()) {
+        m_out << "预备语句 " << it->first << " 需要 " << plan.m_statement.m_params.size() << " 个参数,您给出了 " << args.size()
+                  << " 个,请检查之后重试!" << std::endl;
+        return;
+    }
 
-    if (std::string::npos != pos_where) {
-        if (std::string::npos == command_where.find('=') or std::string::npos != command_where.find("==")) {  // 我怕输入 == ，这里还是判断一下
-            std::cout << "您输入的where条件 " << command_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+    m_plan = it->second;
+    m_statement = plan.m_statement;
+    if (!m_statement.bind(args)) {
+        m_out << "like的参数中%只能出现在最后,请检查之后重试!" << std::endl;
+        return;
+    }
+    m_rendered = plan.render(args);
 
-        name_val_where = Tools::my_spilt(command_where, '=');
-        if (2 != name_val_where.size()) {
-            std::cout << "您输入的where条件 " << command_where << " 不正确,请检查之后重新输入" << std::endl;
-            return;
-        }
+    _dispatch();
+}
 
-        for (auto& each : name_val_where) {
-            Tools::pop_space(each);
-            // 去除头尾后如果还有空格就不对
-            if (std::string::npos != each.find(' ')) {
-                std::cout << "您输入的where条件 " << command_where << " 不正确,请检查之后重新输入" << std::endl;
-                return;
-            }
-        }
+// deallocate <name>
+void Order::_deal_deallocate() {
+    if (0 == m_prepared.erase(std::string(m_statement.m_name))) {
+        m_out << "预备语句 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
+        return;
     }
-    // -----------------------
+    m_out << "预备语句 " << m_statement.m_name << " 删除成功!" << std::endl;
+}
 
-    // 读文件
-    table = Tools::read_table_from_file(path);
+// declare <name> cursor for <select>
+void Order::_deal_declare() {
+    std::string name = std::string(m_statement.m_name);
+    if (m_cursors.count(name)) {
+        m_out << "游标 " << name << " 已存在,请先close之后重试!" << std::endl;
+        return;
+    }
 
-    // 拿到之后就可以开始查询了并且修改了
-    int set_index = -1;  // 定义set条件是判断哪一列
-    for (int i = 0; i < table.m_columns.size(); ++i) {
-        if (name_val_set_value[0] == table.m_columns[i].m_column_name)
-            set_index = i;
+    // for后面的select单独解析成计划，语法树换成它的，游标中的条件都是拷贝，计划用完就可以丢掉
+    std::shared_ptr<const Plan> plan = _make_plan(m_statement.m_body);
+    if (nullptr == plan) {
+        _deal_unknown();
+        return;
     }
-    if (-1 == set_index) {
-        std::cout << "您输入的set条件 " << command_set_value << " 似乎不准确,什么也没修改..." << std::endl;
+    if (Statement::Select != plan->m_statement.m_type) {
+        m_out << "游标只能declare在select语句上,请检查之后重新输入!" << std::endl;
         return;
     }
+    if (!plan->m_statement.m_params.empty()) {
+        m_out << "参数 ? 只能出现在prepare的语句中,请检查之后重新输入!" << std::endl;
+        return;
+    }
+    if (!_check_if_use())
+        return;
 
-    // 如果没有where
-    if (std::string::npos == pos_where) {
-        // 更新所有
-        for (auto& row : table.m_data)
-            row[set_index] = name_val_set_value[1];
-    } else {
-        int where_index = -1;  // 定义where条件是判断哪一列
-        for (int i = 0; i < table.m_columns.size(); ++i) {
-            if (name_val_where[0] == table.m_columns[i].m_column_name)
-                where_index = i;
-        }
-        if (-1 == where_index) {
-            std::cout << "您输入的where条件 " << command_where << " 似乎不准确,什么也没修改..." << std::endl;
-            return;
-        }
+    m_plan = plan;
+    m_statement = plan->m_statement;
+    std::shared_ptr<Table> table_ptr;
+    // declare只打开游标，列名留到fetch的时候再发
+    std::shared_ptr<Cursor> cursor = _open_cursor(table_ptr, false);
+    if (nullptr == cursor)
+        return;
 
-        // 根据条件查询修改
-        for (auto& row : table.m_data) {
-            if (name_val_where[1] == row[where_index])
-                row[set_index] = name_val_set_value[1];
+    m_cursors[name] = cursor;
+    m_out << "游标 " << name << " 创建成功!" << std::endl;
+}
+
+// fetch <name> / fetch <count> from <name> / fetch all from <name>
+void Order::_deal_fetch() {
+    auto it = m_cursors.find(std::string(m_statement.m_name));
+    if (m_cursors.end() == it) {
+        m_out << "游标 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
+        return;
+    }
+
+    // 没写行数的时候读一行
+    uint64_t count = 1;
+    if (!m_statement.m_values.empty() and "all" == m_statement.m_values[0]) {
+        count = UINT64_MAX;
+    } else if (!m_statement.m_values.empty()) {
+        int64_t num;
+        if (!Table::parse_int(std::string(m_statement.m_values[0]), num) or num <= 0) {
+            m_out << "fetch的行数 " << m_statement.m_values[0] << " 必须是正整数或者all,请检查之后重新输入!" << std::endl;
+            return;
         }
+        count = num;
     }
 
-    // 写入文件
-    Tools::write_table_to_file(table, path);
+    // 读的是declare时的快照，之后表被修改了也不影响
+    const std::shared_ptr<Cursor>& cursor = it->second;
+    m_out << "游标 " << it->first << " 读取结果如下: " << std::endl;
+    m_out.begin_result(cursor->table(), cursor->columns());
+    m_stream.m_cursor = cursor;
+    m_stream.m_remaining = count;
+    _fetch_batch(m_stream);
+}
 
-    std::cout << "已成功按照您的要求修改数据!" << std::endl;
+// close <name>
+void Order::_deal_close() {
+    if (0 == m_cursors.erase(std::string(m_statement.m_name))) {
+        m_out << "游标 " << m_statement.m_name << " 不存在,请检查名称并修改!" << std::endl;
+        return;
+    }
+    m_out << "游标 " << m_statement.m_name << " 关闭成功!" << std::endl;
 }
 
 void Order::_deal_unknown() {
-    std::cout << "您输入的命令不存在或者不正确,请检查之后重新输入!" << std::endl;
+    // 语法分析知道具体错在哪里的时候给出具体的提示
+    if (!m_parser.error().empty()) {
+        m_out << m_parser.error() << std::endl;
+        return;
+    }
+    m_out << "您输入的命令不存在或者不正确,请检查之后重新输入!" << std::endl;
 }
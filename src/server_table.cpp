@@ -0,0 +1,131 @@
+/**
+ * @file server_table.cpp
+ * @brief 存储数据库表的数据结构的类的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "server_table.h"
+
+#include <charconv>
+
+bool Table::parse_int(std::string_view str, int64_t& num) {
+    // from_chars不认前导的'+'
+    const char* begin = str.data();
+    const char* end = str.data() + str.size();
+    if (str.size() > 1 and '+' == str[0])
+        ++begin;
+    auto [ptr, ec] = std::from_chars(begin, end, num);
+    return begin != end and std::errc() == ec and end == ptr;
+}
+
+bool Table::check_value(int column, const std::string& value) const {
+    int64_t num;
+    return !is_int(column) or parse_int(value, num);
+}
+
+std::string Table::cell(size_t row, int column) const {
+    if (is_int(column))
+        return std::to_string(m_data[column].m_ints[row]);
+    return std::string(m_data[column].m_strings[row]);
+}
+
+void Table::append_row(const std::vector<std::string>& values) {
+    m_data.resize(m_columns.size());
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (is_int(i)) {
+            int64_t num = 0;
+            parse_int(values[i], num);
+            m_data[i].m_ints.push_back(num);
+        } else
+            m_data[i].m_strings.push_back(values[i]);
+    }
+    ++m_row_count;
+}
+
+void Table::append_row_from(const Table& other, size_t row) {
+    m_data.resize(m_columns.size());
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (is_int(i))
+            m_data[i].m_ints.push_back(other.m_data[i].m_ints[row]);
+        else
+            m_data[i].m_strings.push_back(other.m_data[i].m_strings[row]);
+    }
+    ++m_row_count;
+}
+
+void Table::set_cell(size_t row, int column, const std::string& value) {
+    if (is_int(column))
+        parse_int(value, m_data[column].m_ints[row]);
+    else
+        m_data[column].m_strings.set(row, value);
+}
+
+void Table::end_version(size_t row, uint64_t lsn) {
+    if (row >= m_end.size())
+        m_end.resize(row + 1, live);
+    m_end[row] = lsn;
+    ++m_dead_rows;
+}
+
+void Table::purge_dead_rows() {
+    std::vector<size_t> rows;
+    rows.reserve(m_dead_rows);
+    for (size_t i = 0; i < m_end.size(); ++i)
+        if (live != m_end[i])
+            rows.push_back(i);
+    erase_rows(rows);
+
+    // 剩下的都是最新的版本
+    m_end.clear();
+    m_end.shrink_to_fit();
+    m_dead_rows = 0;
+}
+
+void Table::erase_rows(const std::vector<size_t>& rows) {
+    if (rows.empty())
+        return;
+
+    // 每一列分别把留下来的值往前挪
+    for (int column = 0; column < m_data.size(); ++column) {
+        Column_Data& data = m_data[column];
+        if (!is_int(column)) {
+            data.m_strings.erase(rows);
+            continue;
+        }
+        size_t next = 0, kept = 0;
+        for (size_t i = 0; i < m_row_count; ++i) {
+            if (next < rows.size() and i == rows[next]) {
+                ++next;
+                continue;
+            }
+            data.m_ints[kept++] = data.m_ints[i];
+        }
+        data.m_ints.resize(kept);
+    }
+    m_row_count -= rows.size();
+}
+
+void Table::clear_rows() {
+    for (auto& data : m_data) {
+        data.m_ints.clear();
+        data.m_strings.clear();
+    }
+    m_row_count = 0;
+    m_end.clear();
+    m_dead_rows = 0;
+}
+
+void Table::reserve(size_t rows) {
+    m_data.resize(m_columns.size());
+    for (int i = 0; i < m_columns.size(); ++i) {
+        if (is_int(i))
+            m_data[i].m_ints.reserve(rows);
+        else
+            m_data[i].m_strings.reserve(rows);
+    }
+}
@@ -0,0 +1,821 @@
+/**
+ * @file sql_parser.cpp
+ * @brief 命令的词法分析和语法分析的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "sql_parser.h"
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+bool is_space(char ch) {
+    return ' ' == ch or '\t' == ch or '\n' == ch or '\r' == ch;
+}
+
+/**
+ * @brief 单独成为一个词法单元的符号和参数，单词遇到它们就结束
+ */
+bool is_symbol_char(char ch) {
+    return '(' == ch or ')' == ch or ',' == ch or '=' == ch or '<' == ch or '>' == ch or '?' == ch;
+}
+
+/**
+ * @brief != 是一个符号，单个 ! 可以出现在单词中
+ */
+bool is_not_equal(std::string_view text, size_t pos) {
+    return pos + 1 < text.size() and '!' == text[pos] and '=' == text[pos + 1];
+}
+
+/**
+ * @brief 整数字面量，规范化的时候换成参数
+ */
+bool is_number(std::string_view word) {
+    if (!word.empty() and ('+' == word[0] or '-' == word[0]))
+        word.remove_prefix(1);
+    if (word.empty())
+        return false;
+    for (char ch : word)
+        if (ch < '0' or ch > '9')
+            return false;
+    return true;
+}
+
+/**
+ * @brief 可以缓存计划的语句的第一个单词
+ */
+bool is_dml_word(const Token& token) {
+    return token.is_word("select") or token.is_word("delete") or token.is_word("insert") or token.is_word("update");
+}
+
+}  // namespace
+
+/**
+ * @brief Sql_Lexer
+ */
+Token Sql_Lexer::next() {
+    Token token = m_has_peeked ? m_peeked : _scan();
+    m_has_peeked = false;
+    return token;
+}
+
+const Token& Sql_Lexer::peek() {
+    if (!m_has_peeked) {
+        m_peeked = _scan();
+        m_has_peeked = true;
+    }
+    return m_peeked;
+}
+
+Token Sql_Lexer::_scan() {
+    while (m_pos < m_text.size() and is_space(m_text[m_pos]))
+        ++m_pos;
+
+    Token token;
+    token.m_pos = m_pos;
+    if (m_pos == m_text.size()) {
+        token.m_kind = Token::End;
+        return token;
+    }
+
+    size_t begin = m_pos;
+    char ch = m_text[m_pos];
+    if ('\'' == ch) {
+        // 带引号的值，里面不支持转义，也就是不能再出现单引号
+        size_t end = m_text.find('\'', begin + 1);
+        if (std::string_view::npos == end) {
+            token.m_kind = Token::Error;
+            m_pos = m_text.size();
+            return token;
+        }
+        token.m_kind = Token::String;
+        token.m_text = m_text.substr(begin + 1, end - begin - 1);
+        m_pos = end + 1;
+        return token;
+    }
+
+    if ('?' == ch) {
+        token.m_kind = Token::Param;
+        token.m_text = m_text.substr(begin, 1);
+        ++m_pos;
+        return token;
+    }
+
+    if (is_symbol_char(ch) or is_not_equal(m_text, m_pos)) {
+        token.m_kind = Token::Symbol;
+        ++m_pos;
+        // <=、>=、!= 和 <> 是一个符号
+        if (('<' == ch or '>' == ch or '!' == ch) and m_pos < m_text.size() and '=' == m_text[m_pos])
+            ++m_pos;
+        else if ('<' == ch and m_pos < m_text.size() and '>' == m_text[m_pos])
+            ++m_pos;
+        token.m_text = m_text.substr(begin, m_pos - begin);
+        return token;
+    }
+
+    while (m_pos < m_text.size() and !is_space(m_text[m_pos]) and !is_symbol_char(m_text[m_pos]) and
+           !is_not_equal(m_text, m_pos))
+        ++m_pos;
+    token.m_kind = Token::Word;
+    token.m_text = m_text.substr(begin, m_pos - begin);
+    return token;
+}
+
+bool Sql_Lexer::needs_quote(std::string_view value) {
+    if (value.empty() or '\'' == value[0])
+        return true;
+    for (size_t i = 0; i < value.size(); ++i)
+        if (is_space(value[i]) or is_symbol_char(value[i]) or is_not_equal(value, i))
+            return true;
+    return false;
+}
+
+/**
+ * @brief Statement
+ */
+void Statement::clear() {
+    m_type = Unknown;
+    m_name = std::string_view();
+    m_join_name = std::string_view();
+    m_join_left = std::string_view();
+    m_join_right = std::string_view();
+    m_column_defs.clear();
+    m_index_name = std::string_view();
+    m_index_type = std::string_view();
+    m_column = std::string_view();
+    m_columns.clear();
+    m_aggregates.clear();
+    m_group_columns.clear();
+    m_values.clear();
+    m_tuples = 0;
+    m_has_where = false;
+    m_where = Where_Expr();
+    m_order_by.clear();
+    m_limit = std::string_view();
+    m_offset = std::string_view();
+    m_params.clear();
+    m_body = std::string_view();
+}
+
+bool Statement::bind(const std::vector<std::string_view>& args) {
+    if (args.size() != m_params.size())
+        return false;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        std::string_view arg = args[i];
+        const Param& param = m_params[i];
+        if (Param::Value == param.m_target) {
+            m_values[param.m_index] = arg;
+            continue;
+        }
+        if (Param::Limit == param.m_target or Param::Offset == param.m_target) {
+            (Param::Limit == param.m_target ? m_limit : m_offset) = arg;
+            continue;
+        }
+        Where_Cond& cond = m_where.m_parsed.m_conds[param.m_index];
+        switch (param.m_target) {
+        case Param::Where_Value:
+            cond.m_value = arg;
+            break;
+        case Param::Where_High:
+            cond.m_high = arg;
+            break;
+        case Param::Where_Like:
+            // 和直接写在语句中的like一样，%只能出现在最后，没有%就是等值
+            cond.m_op = Where_Cond::Equal;
+            if (!arg.empty() and '%' == arg.back()) {
+                cond.m_op = Where_Cond::Like;
+                arg.remove_suffix(1);
+            }
+            if (std::string_view::npos != arg.find('%'))
+                return false;
+            cond.m_value = arg;
+            break;
+        case Param::Where_Item:
+            cond.m_values[param.m_item] = arg;
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+bool Statement::limits(uint64_t& offset, uint64_t& limit) const {
+    offset = 0;
+    limit = UINT64_MAX;
+    int64_t num;
+    if (!m_limit.empty()) {
+        if (!Table::parse_int(std::string(m_limit), num) or num < 0)
+            return false;
+        limit = num;
+    }
+    if (!m_offset.empty()) {
+        if (!Table::parse_int(std::string(m_offset), num) or num < 0)
+            return false;
+        offset = num;
+    }
+    return true;
+}
+
+/**
+ * @brief Sql_Parser
+ */
+bool Sql_Parser::parse(std::string_view text, Statement& statement) {
+    m_text = text;
+    m_lexer = Sql_Lexer(text);
+    m_error.clear();
+    m_statement = &statement;
+    statement.clear();
+
+    // 第一个单词决定了是哪一种命令
+    Token first = m_lexer.next();
+    bool ok = false;
+    if (first.is_word("show"))
+        ok = _parse_show(statement);
+    else if (first.is_word("prepare"))
+        ok = _parse_prepare(statement);
+    else if (first.is_word("execute"))
+        ok = _parse_execute(statement);
+    else if (first.is_word("deallocate")) {
+        statement.m_type = Statement::Deallocate;
+        ok = _name(statement.m_name) and _end();
+    } else if (first.is_word("declare"))
+        ok = _parse_declare(statement);
+    else if (first.is_word("fetch"))
+        ok = _parse_fetch(statement);
+    else if (first.is_word("close")) {
+        statement.m_type = Statement::Close;
+        ok = _name(statement.m_name) and _end();
+    } else if (first.is_word("q") or first.is_word("quit")) {
+        statement.m_type = Statement::Quit;
+        ok = _end();
+    } else if (first.is_word("clear")) {
+        statement.m_type = Statement::Clear;
+        ok = _end();
+    } else if (first.is_word("tree"))
+        ok = _parse_tree(statement);
+    else if (first.is_word("create"))
+        ok = _parse_create(statement);
+    else if (first.is_word("drop"))
+        ok = _parse_drop(statement);
+    else if (first.is_word("use")) {
+        statement.m_type = Statement::Use;
+        ok = _name(statement.m_name) and _end();
+    } else if (first.is_word("select"))
+        ok = _parse_select(statement);
+    else if (first.is_word("delete"))
+        ok = _parse_delete(statement);
+    else if (first.is_word("insert"))
+        ok = _parse_insert(statement);
+    else if (first.is_word("update"))
+        ok = _parse_update(statement);
+    else if (first.is_word("load"))
+        ok = _parse_load(statement);
+    else if (first.is_word("vacuum")) {
+        statement.m_type = Statement::Vacuum;
+        ok = _name(statement.m_name) and _end();
+    }
+
+    if (!ok)
+        statement.m_type = Statement::Unknown;
+    return ok;
+}
+
+// show / show cache / show plans
+bool Sql_Parser::_parse_show(Statement& statement) {
+    if (_accept_word("cache"))
+        statement.m_type = Statement::Show_Cache;
+    else if (_accept_word("plans"))
+        statement.m_type = Statement::Show_Plans;
+    else
+        statement.m_type = Statement::Show;
+    return _end();
+}
+
+// tree / tree <dbname>
+bool Sql_Parser::_parse_tree(Statement& statement) {
+    statement.m_type = Statement::Tree;
+    if (Token::End != m_lexer.peek().m_kind and !_name(statement.m_name))
+        return false;
+    return _end();
+}
+
+// create database <dbname> / create table ... / create index ...
+bool Sql_Parser::_parse_create(Statement& statement) {
+    if (_accept_word("database")) {
+        statement.m_type = Statement::Create_Database;
+        return _name(statement.m_name) and _end();
+    }
+    if (_accept_word("table"))
+        return _parse_create_table(statement);
+    if (_accept_word("index"))
+        return _parse_create_index(statement);
+    return false;
+}
+
+// drop database <dbname> / drop table <table>
+bool Sql_Parser::_parse_drop(Statement& statement) {
+    if (_accept_word("database"))
+        statement.m_type = Statement::Drop_Database;
+    else if (_accept_word("table"))
+        statement.m_type = Statement::Drop_Table;
+    else
+        return false;
+    return _name(statement.m_name) and _end();
+}
+
+// create table <table> (<column> <type>, ...)
+bool Sql_Parser::_parse_create_table(Statement& statement) {
+    statement.m_type = Statement::Create_Table;
+    if (!_name(statement.m_name) or !_accept_symbol("("))
+        return false;
+
+    do {
+        if (m_lexer.peek().is_symbol(")")) {
+            if (!statement.m_column_defs.empty())
+                m_error = "最后一列末尾不需要 ',' !请检查之后重试!";
+            return false;
+        }
+        Statement::Column_Def column;
+        if (!_name(column.m_name) or !_name(column.m_type))
+            return false;
+        statement.m_column_defs.push_back(column);
+    } while (_accept_symbol(","));
+
+    return _accept_symbol(")") and _end();
+}
+
+// create index <index> on <table>(<column>) [using <type>]
+bool Sql_Parser::_parse_create_index(Statement& statement) {
+    statement.m_type = Statement::Create_Index;
+    if (!_name(statement.m_index_name) or !_accept_word("on") or !_name(statement.m_name) or !_accept_symbol("(") or
+        !_name(statement.m_column) or !_accept_symbol(")"))
+        return false;
+    if (_accept_word("using") and !_name(statement.m_index_type))
+        return false;
+    return _end();
+}
+
+// select <column>|<func>(<column>|*), ... from <table> [[inner] join <table> on <column> = <column>]
+//     [where <cond>] [group by <column>, ...]
+//     [order by <column> [asc|desc], ...] [limit <count> [offset <skip>]]
+bool Sql_Parser::_parse_select(Statement& statement) {
+    statement.m_type = Statement::Select;
+    if (m_lexer.peek().is_word("from")) {
+        m_error = "未选择任何列,请检查之后重新输入!";
+        return false;
+    }
+
+    // * 表示所有的列，m_columns为空
+    if (!_accept_word("*")) {
+        do {
+            if (m_lexer.peek().is_word("from")) {
+                m_error = "<column>末尾不需要 ','!请检查之后重试!";
+                return false;
+            }
+            std::string_view item;
+            Statement::Aggregate agg;
+            bool is_agg = false;
+            if (!_parse_select_item(item, &agg, is_agg))
+                return false;
+            if (is_agg) {
+                agg.m_item = statement.m_columns.size();
+                statement.m_aggregates.push_back(agg);
+            }
+            statement.m_columns.push_back(item);
+        } while (_accept_symbol(","));
+    }
+
+    if (!_accept_word("from") or !_name(statement.m_name))
+        return false;
+
+    // 只支持两张表按一对列等值连接
+    bool inner = _accept_word("inner");
+    if (_accept_word("join")) {
+        if (!_name(statement.m_join_name) or !_accept_word("on") or !_name(statement.m_join_left) or
+            !_accept_symbol("=") or !_name(statement.m_join_right))
+            return false;
+    } else if (inner)
+        return false;
+
+    if (!_parse_opt_where(statement))
+        return false;
+
+    if (_accept_word("group")) {
+        if (!_accept_word("by"))
+            return false;
+        do {
+            std::string_view column;
+            if (!_name(column))
+                return false;
+            statement.m_group_columns.push_back(column);
+        } while (_accept_symbol(","));
+    }
+
+    if (_accept_word("order")) {
+        if (!_accept_word("by"))
+            return false;
+        do {
+            // 聚合查询可以按聚合函数的结果排序
+            Statement::Order_Key key;
+            bool is_agg = false;
+            if (!_parse_select_item(key.m_column, nullptr, is_agg))
+                return false;
+            if (_accept_word("desc"))
+                key.m_desc = true;
+            else
+                _accept_word("asc");
+            statement.m_order_by.push_back(key);
+        } while (_accept_symbol(","));
+    }
+
+    if (_accept_word("limit")) {
+        if (!_value(statement.m_limit, Statement::Param::Limit))
+            return false;
+        if (_accept_word("offset") and !_value(statement.m_offset, Statement::Param::Offset))
+            return false;
+    }
+    return _end();
+}
+
+bool Sql_Parser::_parse_select_item(std::string_view& text, Statement::Aggregate* agg, bool& is_agg) {
+    size_t begin = m_lexer.peek().m_pos;
+    std::string_view name;
+    if (!_name(name))
+        return false;
+    is_agg = _accept_symbol("(");
+    if (!is_agg) {
+        text = name;
+        return true;
+    }
+
+    Statement::Aggregate parsed;
+    if ("count" == name)
+        parsed.m_func = Statement::Aggregate::Count;
+    else if ("sum" == name)
+        parsed.m_func = Statement::Aggregate::Sum;
+    else if ("min" == name)
+        parsed.m_func = Statement::Aggregate::Min;
+    else if ("max" == name)
+        parsed.m_func = Statement::Aggregate::Max;
+    else if ("avg" == name)
+        parsed.m_func = Statement::Aggregate::Avg;
+    else {
+        m_error = "不支持聚合函数 " + std::string(name) + " ,目前只支持 count、sum、min、max、avg";
+        return false;
+    }
+    // 只有count可以写 *
+    if (!(Statement::Aggregate::Count == parsed.m_func and _accept_word("*")) and !_name(parsed.m_column))
+        return false;
+    Token close = m_lexer.next();
+    if (!close.is_symbol(")"))
+        return false;
+    text = m_text.substr(begin, close.m_pos + 1 - begin);
+    if (nullptr != agg)
+        *agg = parsed;
+    return true;
+}
+
+// delete <table> [where <cond>]
+bool Sql_Parser::_parse_delete(Statement& statement) {
+    statement.m_type = Statement::Delete;
+    return _name(statement.m_name) and _parse_opt_where(statement) and _end();
+}
+
+// load data '<file>' into <table>
+bool Sql_Parser::_parse_load(Statement& statement) {
+    statement.m_type = Statement::Load;
+    std::string_view file;
+    if (!_accept_word("data") or !_value(file) or !_accept_word("into") or !_name(statement.m_name))
+        return false;
+    statement.m_values.push_back(file);
+    return _end();
+}
+
+// insert <table> values (<value>, ...), (<value>, ...), ...
+bool Sql_Parser::_parse_insert(Statement& statement) {
+    statement.m_type = Statement::Insert;
+    if (!_name(statement.m_name) or !_accept_word("values"))
+        return false;
+
+    // 每一行的值依次放进m_values，各行的个数必须相同
+    size_t width = 0;
+    do {
+        if (!_accept_symbol("("))
+            return false;
+        size_t begin = statement.m_values.size();
+        do {
+            if (m_lexer.peek().is_symbol(")")) {
+                if (statement.m_values.size() != begin)
+                    m_error = "values末尾不需要 ','!请检查之后重试!";
+                return false;
+            }
+            std::string_view value;
+            if (!_value(value, Statement::Param::Value, statement.m_values.size()))
+                return false;
+            statement.m_values.push_back(value);
+        } while (_accept_symbol(","));
+        if (!_accept_symbol(")"))
+            return false;
+
+        if (0 == statement.m_tuples)
+            width = statement.m_values.size();
+        else if (statement.m_values.size() - begin != width) {
+            m_error = "values中每一行的字段个数必须相同,请检查之后重试!";
+            return false;
+        }
+        ++statement.m_tuples;
+    } while (_accept_symbol(","));
+
+    return _end();
+}
+
+// update <table> set <column> = <value> [where <cond>]
+bool Sql_Parser::_parse_update(Statement& statement) {
+    statement.m_type = Statement::Update;
+    if (!_name(statement.m_name) or !_accept_word("set"))
+        return false;
+
+    size_t begin = m_lexer.peek().m_pos;
+    std::string_view value;
+    if (!_name(statement.m_column) or !_accept_symbol("=") or !_value(value, Statement::Param::Value, 0)) {
+        // 提示的时候给出set后面到where之前的原文
+        size_t end = m_text.find(" where ", begin);
+        std::string_view text = m_text.substr(begin, std::string_view::npos == end ? end : end - begin);
+        m_error = "您输入的set条件 " + std::string(text) + " 不正确,请检查之后重新输入";
+        return false;
+    }
+    statement.m_values.push_back(value);
+
+    return _parse_opt_where(statement) and _end();
+}
+
+// prepare <name> as <select/insert/update/delete with ?>
+bool Sql_Parser::_parse_prepare(Statement& statement) {
+    statement.m_type = Statement::Prepare;
+    if (!_name(statement.m_name) or !_accept_word("as") or _end())
+        return false;
+    // as后面的语句由调用者单独解析成计划
+    statement.m_body = m_text.substr(m_lexer.peek().m_pos);
+    return true;
+}
+
+// execute <name> [(<value>, ...)]
+bool Sql_Parser::_parse_execute(Statement& statement) {
+    statement.m_type = Statement::Execute;
+    if (!_name(statement.m_name))
+        return false;
+    if (_accept_symbol("(") and !_accept_symbol(")")) {
+        do {
+            std::string_view value;
+            if (!_value(value))
+                return false;
+            statement.m_values.push_back(value);
+        } while (_accept_symbol(","));
+        if (!_accept_symbol(")"))
+            return false;
+    }
+    return _end();
+}
+
+// declare <name> cursor for <select>
+bool Sql_Parser::_parse_declare(Statement& statement) {
+    statement.m_type = Statement::Declare;
+    if (!_name(statement.m_name) or !_accept_word("cursor") or !_accept_word("for") or _end())
+        return false;
+    // for后面的语句由调用者单独解析
+    statement.m_body = m_text.substr(m_lexer.peek().m_pos);
+    return true;
+}
+
+// fetch <name> / fetch <count> from <name> / fetch all from <name>
+bool Sql_Parser::_parse_fetch(Statement& statement) {
+    statement.m_type = Statement::Fetch;
+    std::string_view first;
+    if (!_name(first))
+        return false;
+    if (!_accept_word("from")) {
+        statement.m_name = first;
+        return _end();
+    }
+    statement.m_values.push_back(first);
+    return _name(statement.m_name) and _end();
+}
+
+bool Sql_Parser::_parse_opt_where(Statement& statement) {
+    if (!_accept_word("where"))
+        return true;
+    if (Token::End == m_lexer.peek().m_kind)
+        return false;
+
+    statement.m_has_where = true;
+    size_t begin = m_lexer.peek().m_pos;
+    Where_Expr::Tree& tree = statement.m_where.m_parsed;
+    if (!_parse_or(tree, tree.m_root)) {
+        // 条件错了不知道它到哪里结束，把后面的都给出来
+        m_error = "您输入的where条件 " + std::string(m_text.substr(begin)) + " 不正确,请检查之后重新输入";
+        return false;
+    }
+    return true;
+}
+
+bool Sql_Parser::_parse_or(Where_Expr::Tree& tree, int& node) {
+    if (!_parse_and(tree, node))
+        return false;
+    if (!m_lexer.peek().is_word("or"))
+        return true;
+    std::vector<int> children{node};
+    while (_accept_word("or")) {
+        int child;
+        if (!_parse_and(tree, child))
+            return false;
+        children.push_back(child);
+    }
+    node = tree.add(Where_Expr::Or, -1, std::move(children));
+    return true;
+}
+
+bool Sql_Parser::_parse_and(Where_Expr::Tree& tree, int& node) {
+    if (!_parse_not(tree, node))
+        return false;
+    if (!m_lexer.peek().is_word("and"))
+        return true;
+    std::vector<int> children{node};
+    while (_accept_word("and")) {
+        int child;
+        if (!_parse_not(tree, child))
+            return false;
+        children.push_back(child);
+    }
+    node = tree.add(Where_Expr::And, -1, std::move(children));
+    return true;
+}
+
+bool Sql_Parser::_parse_not(Where_Expr::Tree& tree, int& node) {
+    if (_accept_word("not")) {
+        int child;
+        if (!_parse_not(tree, child))
+            return false;
+        node = tree.add(Where_Expr::Not, -1, {child});
+        return true;
+    }
+    if (_accept_symbol("("))
+        return _parse_or(tree, node) and _accept_symbol(")");
+    return _parse_condition(tree, node);
+}
+
+bool Sql_Parser::_parse_condition(Where_Expr::Tree& tree, int& node) {
+    std::string_view column, value;
+    if (!_name(column))
+        return false;
+    // 参数按谓词的下标记录要填到哪里
+    size_t index = tree.m_conds.size();
+    tree.m_conds.emplace_back();
+    node = tree.add(Where_Expr::Cond, index);
+    Where_Cond& cond = tree.m_conds.back();
+    cond.m_column = column;
+
+    // <column> not between/like/in 是对应条件的not
+    if (_accept_word("not")) {
+        if (!m_lexer.peek().is_word("between") and !m_lexer.peek().is_word("like") and !m_lexer.peek().is_word("in"))
+            return false;
+        node = tree.add(Where_Expr::Not, -1, {node});
+    }
+
+    if (_accept_word("between")) {
+        std::string_view high;
+        if (!_value(value, Statement::Param::Where_Value, index) or !_accept_word("and") or
+            !_value(high, Statement::Param::Where_High, index))
+            return false;
+        cond.m_op = Where_Cond::Between;
+        cond.m_value = value;
+        cond.m_high = high;
+        return true;
+    }
+
+    if (_accept_word("like")) {
+        // 参数的值执行的时候才知道，到时候再看是不是前缀匹配
+        if (Token::Param == m_lexer.peek().m_kind) {
+            cond.m_op = Where_Cond::Like;
+            return _value(value, Statement::Param::Where_Like, index);
+        }
+        if (!_value(value))
+            return false;
+        // 目前只支持前缀匹配，%只能出现在最后，没有%就是等值
+        cond.m_op = Where_Cond::Equal;
+        if (!value.empty() and '%' == value.back()) {
+            cond.m_op = Where_Cond::Like;
+            value.remove_suffix(1);
+        }
+        cond.m_value = value;
+        return std::string_view::npos == value.find('%');
+    }
+
+    if (_accept_word("in")) {
+        cond.m_op = Where_Cond::In;
+        if (!_accept_symbol("("))
+            return false;
+        do {
+            if (!_value(value, Statement::Param::Where_Item, index, cond.m_values.size()))
+                return false;
+            cond.m_values.emplace_back(value);
+        } while (_accept_symbol(","));
+        return _accept_symbol(")");
+    }
+
+    // <column> is [not] null
+    if (_accept_word("is")) {
+        cond.m_op = Where_Cond::Is_Null;
+        if (_accept_word("not"))
+            node = tree.add(Where_Expr::Not, -1, {node});
+        return _accept_word("null");
+    }
+
+    Token op = m_lexer.next();
+    if (op.is_symbol("="))
+        cond.m_op = Where_Cond::Equal;
+    else if (op.is_symbol("!=") or op.is_symbol("<>"))
+        cond.m_op = Where_Cond::Not_Equal;
+    else if (op.is_symbol("<"))
+        cond.m_op = Where_Cond::Less;
+    else if (op.is_symbol("<="))
+        cond.m_op = Where_Cond::Less_Equal;
+    else if (op.is_symbol(">"))
+        cond.m_op = Where_Cond::Greater;
+    else if (op.is_symbol(">="))
+        cond.m_op = Where_Cond::Greater_Equal;
+    else
+        return false;
+
+    if (!_value(value, Statement::Param::Where_Value, index))
+        return false;
+    cond.m_value = value;
+    return true;
+}
+
+bool Sql_Parser::_accept_word(std::string_view word) {
+    if (!m_lexer.peek().is_word(word))
+        return false;
+    m_lexer.next();
+    return true;
+}
+
+bool Sql_Parser::_accept_symbol(std::string_view symbol) {
+    if (!m_lexer.peek().is_symbol(symbol))
+        return false;
+    m_lexer.next();
+    return true;
+}
+
+bool Sql_Parser::_name(std::string_view& name) {
+    if (Token::Word != m_lexer.peek().m_kind)
+        return false;
+    name = m_lexer.next().m_text;
+    return true;
+}
+
+bool Sql_Parser::_value(std::string_view& value, Statement::Param::Target target, size_t index, size_t item) {
+    Token::Kind kind = m_lexer.peek().m_kind;
+    if (Token::Word != kind and Token::String != kind and Token::Param != kind)
+        return false;
+    Token token = m_lexer.next();
+    value = token.m_text;
+    if (Token::Param == kind)
+        m_statement->m_params.push_back({target, index, token.m_pos, item});
+    return true;
+}
+
+bool Sql_Parser::_end() {
+    return Token::End == m_lexer.peek().m_kind;
+}
+
+bool Sql_Parser::normalize(std::string_view text, std::string& key, std::vector<std::string_view>& literals) {
+    key.clear();
+    literals.clear();
+
+    Sql_Lexer lexer(text);
+    Token token = lexer.next();
+    if (!is_dml_word(token))
+        return false;
+
+    for (; Token::End != token.m_kind; token = lexer.next()) {
+        if (Token::Error == token.m_kind or Token::Param == token.m_kind)
+            return false;
+        if (!key.empty())
+            key += ' ';
+        // 不带引号的单词可能是名字，只有数字和带引号的值一定是字面量
+        if (Token::String == token.m_kind or (Token::Word == token.m_kind and is_number(token.m_text))) {
+            key += '?';
+            literals.push_back(token.m_text);
+        } else
+            key += token.m_text;
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file string_heap.cpp
+ * @brief 存放一个string列的所有值的内存池的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "string_heap.h"
+
+#include <cstring>
+
+String_Heap::String_Heap(const String_Heap& other)
+    : m_slots(other.m_slots), m_chunks(other.m_chunks), m_bytes(other.m_bytes), m_heap_bytes(other.m_heap_bytes) {}
+
+String_Heap::String_Heap(String_Heap&& other) noexcept
+    : m_slots(std::move(other.m_slots)),
+      m_chunks(std::move(other.m_chunks)),
+      m_tail(other.m_tail),
+      m_free(other.m_free),
+      m_bytes(other.m_bytes),
+      m_heap_bytes(other.m_heap_bytes) {
+    other.clear();
+}
+
+String_Heap& String_Heap::operator=(const String_Heap& other) {
+    if (this == &other)
+        return *this;
+    // 共享的块中剩下的空间留给原来的列，自己之后追加的时候另外申请
+    m_slots = other.m_slots;
+    m_chunks = other.m_chunks;
+    m_tail = nullptr;
+    m_free = 0;
+    m_bytes = other.m_bytes;
+    m_heap_bytes = other.m_heap_bytes;
+    return *this;
+}
+
+String_Heap& String_Heap::operator=(String_Heap&& other) noexcept {
+    if (this == &other)
+        return *this;
+    m_slots = std::move(other.m_slots);
+    m_chunks = std::move(other.m_chunks);
+    m_tail = other.m_tail;
+    m_free = other.m_free;
+    m_bytes = other.m_bytes;
+    m_heap_bytes = other.m_heap_bytes;
+    other.clear();
+    return *this;
+}
+
+std::string_view String_Heap::_store(std::string_view str) {
+    if (str.empty())
+        return std::string_view("", 0);
+
+    // 长字符串单独放一块，不浪费当前块剩下的空间
+    if (str.size() > chunk_size / 4) {
+        std::shared_ptr<char[]> chunk(new char[str.size()]);
+        memcpy(chunk.get(), str.data(), str.size());
+        m_chunks.push_back(std::move(chunk));
+        m_heap_bytes += str.size();
+        return std::string_view(m_chunks.back().get(), str.size());
+    }
+
+    if (m_free < str.size()) {
+        m_chunks.emplace_back(new char[chunk_size]);
+        m_heap_bytes += chunk_size;
+        m_tail = m_chunks.back().get();
+        m_free = chunk_size;
+    }
+    memcpy(m_tail, str.data(), str.size());
+    std::string_view ret(m_tail, str.size());
+    m_tail += str.size();
+    m_free -= str.size();
+    return ret;
+}
+
+void String_Heap::set(size_t row, std::string_view str) {
+    m_bytes -= m_slots[row].size();
+    m_slots[row] = _store(str);
+    m_bytes += str.size();
+    _compact_if_needed();
+}
+
+void String_Heap::append(const String_Heap& other) {
+    if (this == &other) {
+        String_Heap copy(other);
+        append(copy);
+        return;
+    }
+    m_slots.insert(m_slots.end(), other.m_slots.begin(), other.m_slots.end());
+    m_chunks.insert(m_chunks.end(), other.m_chunks.begin(), other.m_chunks.end());
+    m_bytes += other.m_bytes;
+    m_heap_bytes += other.m_heap_bytes;
+}
+
+void String_Heap::erase(const std::vector<size_t>& rows) {
+    if (rows.empty())
+        return;
+
+    size_t next = 0, kept = 0;
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        if (next < rows.size() and i == rows[next]) {
+            ++next;
+            m_bytes -= m_slots[i].size();
+            continue;
+        }
+        m_slots[kept++] = m_slots[i];
+    }
+    m_slots.resize(kept);
+    _compact_if_needed();
+}
+
+void String_Heap::clear() {
+    m_slots.clear();
+    m_chunks.clear();
+    m_tail = nullptr;
+    m_free = 0;
+    m_bytes = 0;
+    m_heap_bytes = 0;
+}
+
+void String_Heap::_compact_if_needed() {
+    // 至少有一块的垃圾才整理，整理的代价均摊到产生这些垃圾的修改上
+    if (m_heap_bytes <= 2 * m_bytes + chunk_size)
+        return;
+
+    String_Heap fresh;
+    fresh.m_slots.reserve(m_slots.size());
+    for (std::string_view str : m_slots)
+        fresh.push_back(str);
+    *this = std::move(fresh);
+}
@@ -0,0 +1,333 @@
+/**
+ * @file table_cache.cpp
+ * @brief 服务端全局共享的表缓存的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "table_cache.h"
+
+#include <algorithm>
+
+#include "table_file.h"
+#include "table_index.h"
+#include "tools.h"
+#include "wal.h"
+
+void Read_Latches::add(std::shared_ptr<Table_Latch> latch) {
+    // 按地址排好序，所有的语句都按同样的顺序拿
+    auto it = std::lower_bound(m_latches.begin(), m_latches.end(), latch);
+    if (m_latches.end() == it or *it != latch)
+        m_latches.insert(it, std::move(latch));
+}
+
+void Read_Latches::lock_shared() {
+    for (auto& latch : m_latches)
+        latch->m_rows.lock_shared();
+}
+
+void Read_Latches::unlock_shared() {
+    for (auto it = m_latches.rbegin(); it != m_latches.rend(); ++it)
+        (*it)->m_rows.unlock_shared();
+}
+
+Table_Cache& Table_Cache::instance() {
+    static Table_Cache cache;
+    return cache;
+}
+
+void Table_Cache::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    _evict();
+}
+
+void Table_Cache::set_vacuum_percent(size_t percent) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_vacuum_percent = percent;
+}
+
+std::shared_ptr<Table> Table_Cache::get(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(path);
+    if (m_entries.end() != it) {
+        ++m_stats.m_hits;
+        _touch(it->second);
+        return it->second.m_table;
+    }
+
+    ++m_stats.m_misses;
+    auto table = std::make_shared<Table>(Tools::read_table_from_file(path));
+    Table_Index::attach(*table, path);
+
+    Entry& entry = m_entries[path];
+    entry.m_table = table;
+    entry.m_bytes = _table_bytes(*table);
+    entry.m_flushed_rows = table->m_row_count;
+    entry.m_flushed_lsn = table->m_lsn;
+    m_lru.push_front(path);
+    entry.m_lru_pos = m_lru.begin();
+    m_stats.m_used_bytes += entry.m_bytes;
+
+    // 比整个预算还大的表也会在这里被淘汰掉，拿到的指针仍然有效
+    _evict();
+
+    return table;
+}
+
+Table Table_Cache::get_schema(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(path);
+    if (m_entries.end() != it) {
+        ++m_stats.m_hits;
+        _touch(it->second);
+
+        std::shared_lock<std::shared_mutex> rows(_latch(path)->m_rows);
+        Table schema;
+        schema.m_table_name = it->second.m_table->m_table_name;
+        schema.m_columns = it->second.m_table->m_columns;
+        schema.m_indexes = it->second.m_table->m_indexes;
+        schema.m_lsn = it->second.m_table->m_lsn;
+        return schema;
+    }
+
+    // 只读文件头，不算未命中，也不放进缓存
+    return Tools::read_schema_from_file(path);
+}
+
+bool Table_Cache::scan(const std::string& path, Table_File::Scanner& scanner) {
+    // 拿着锁打开，期间不会有人把它读进缓存再写回；打开之后映射的是这一刻的文件
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_entries.end() != m_entries.find(path))
+        return false;
+    return scanner.open(path);
+}
+
+void Table_Cache::mark_dirty(const std::string& path, const std::shared_ptr<Table>& table, bool rewrite) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(path);
+    if (m_entries.end() == it or it->second.m_table != table) {
+        // 已经不在缓存中了，只能马上写回；修改期间被淘汰之后别的连接又读进来的那一份没有这次修改，丢掉
+        Wal::for_table(path).wait_durable(table->m_lsn);
+        Tools::write_table_to_file(*table, path);
+        Table_Index::save(*table, path);
+        ++m_stats.m_write_backs;
+        // 调用者还拿着这张表，不能原地回收；旧版本达到阈值的时候和淘汰写回一样回收，整理刚写好的表文件
+        if (0 != table->m_dead_rows and table->m_dead_rows * 100 >= table->m_row_count * m_vacuum_percent)
+            _vacuum_file(path);
+        if (m_entries.end() != it) {
+            m_stats.m_used_bytes -= it->second.m_bytes;
+            m_lru.erase(it->second.m_lru_pos);
+            m_entries.erase(it);
+        }
+        return;
+    }
+
+    Entry& entry = it->second;
+    entry.m_dirty = true;
+    entry.m_modified |= rewrite;
+    m_stats.m_used_bytes -= entry.m_bytes;
+    entry.m_bytes = _table_bytes(*table);
+    m_stats.m_used_bytes += entry.m_bytes;
+    _touch(entry);
+    _evict();
+}
+
+void Table_Cache::append_rows(const std::string& path, const Table& rows, uint64_t lsn) {
+    std::shared_ptr<Table> table_ptr;
+    std::shared_ptr<Table_Latch> latch;
+    bool durable = false;
+    while (nullptr == table_ptr) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_entries.find(path);
+            if (m_entries.end() != it) {
+                table_ptr = it->second.m_table;
+                latch = _latch(path);
+            } else if (durable) {
+                Tools::append_rows_to_file(rows, path, lsn);
+                return;
+            }
+        }
+        // 不在缓存中的时候直接写表文件，先写日志: 这条记录落盘之前不能碰文件，等的时候不拿缓存的锁；
+        // 等完之后表可能已经被读进缓存了，这时候插到缓存里面
+        if (nullptr == table_ptr) {
+            Wal::for_table(path).wait_durable(lsn);
+            durable = true;
+        }
+    }
+
+    // 不拿着缓存的锁等读者，只在追加的时候独占这张表；期间被淘汰了的话mark_dirty会整表写回
+    Table& table = *table_ptr;
+    {
+        std::unique_lock<std::shared_mutex> lock(latch->m_rows);
+        for (size_t i = 0; i < rows.m_row_count; ++i) {
+            table.append_row_from(rows, i);
+            Table_Index::insert_row(table, table.m_row_count - 1);
+        }
+        table.m_lsn = lsn;
+    }
+    mark_dirty(path, table_ptr, false);
+}
+
+void Table_Cache::erase(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 删除表的命令独占，这时候没有别的语句拿着它的锁
+    m_latches.erase(path);
+
+    auto it = m_entries.find(path);
+    if (m_entries.end() == it)
+        return;
+
+    m_stats.m_used_bytes -= it->second.m_bytes;
+    m_lru.erase(it->second.m_lru_pos);
+    m_entries.erase(it);
+}
+
+std::shared_ptr<Table_Latch> Table_Cache::latch(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return _latch(path);
+}
+
+void Table_Cache::flush_all(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& [path, entry] : m_entries)
+        if (0 == path.compare(0, prefix.size(), prefix))
+            _write_back(path, entry);
+}
+
+bool Table_Cache::vacuum(const std::string& path, size_t& rows) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(path);
+    if (m_entries.end() == it) {
+        // 不在缓存中，也就没有谁在读它，文件就是最新的，直接读出来整理
+        rows = _vacuum_file(path);
+        return true;
+    }
+
+    Entry& entry = it->second;
+    if (1 != entry.m_table.use_count())
+        return false;
+    rows = entry.m_table->m_dead_rows;
+    _purge(entry);
+    _write_back(path, entry);
+    return true;
+}
+
+Table_Cache::Stats Table_Cache::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats = m_stats;
+    stats.m_tables = m_entries.size();
+    stats.m_budget_bytes = m_budget;
+    return stats;
+}
+
+void Table_Cache::_purge(Entry& entry) {
+    // 只有缓存自己持有这张表的时候，才没有语句或者游标在读它，拿着锁也不会有新的来拿
+    Table& table = *entry.m_table;
+    if (0 == table.m_dead_rows or 1 != entry.m_table.use_count())
+        return;
+
+    table.purge_dead_rows();
+    Table_Index::rebuild(table);
+    // 内存中的行号变了，整表写回
+    entry.m_dirty = true;
+    entry.m_modified = true;
+    m_stats.m_used_bytes -= entry.m_bytes;
+    entry.m_bytes = _table_bytes(table);
+    m_stats.m_used_bytes += entry.m_bytes;
+}
+
+size_t Table_Cache::_table_bytes(const Table& table) {
+    // 不用一行一行地数，每一列直接拿它申请的内存
+    size_t bytes = sizeof(Table) + Table_Index::bytes(table) + table.m_end.capacity() * sizeof(uint64_t);
+    for (const Column_Data& data : table.m_data)
+        bytes += data.m_ints.capacity() * sizeof(int64_t) + data.m_strings.memory();
+    return bytes;
+}
+
+void Table_Cache::_write_back(const std::string& path, Entry& entry) {
+    // flush和淘汰都走这里，旧版本达到阈值的时候顺便回收，整表写回
+    // 别的连接可能正在改这张表，写的期间不让它改
+    std::shared_lock<std::shared_mutex> rows(_latch(path)->m_rows);
+    const Table& table = *entry.m_table;
+    if (table.m_dead_rows * 100 >= table.m_row_count * m_vacuum_percent)
+        _purge(entry);
+
+    if (!entry.m_dirty)
+        return;
+
+    // 先写日志: 表文件里面不能出现WAL中还没有落盘的修改
+    Wal::for_table(path).wait_durable(table.m_lsn);
+
+    if (entry.m_modified)
+        Tools::write_table_to_file(table, path);
+    else {
+        // 只有追加和删除(update也是结束旧版本、追加新版本)，新的行追加到文件末尾，写回之后新删除的行记在删除位图页中
+        std::vector<size_t> deleted;
+        for (size_t row = 0; row < table.m_end.size(); ++row)
+            if (Table::live != table.m_end[row] and table.m_end[row] > entry.m_flushed_lsn)
+                deleted.push_back(row);
+        Table_File::append_rows(path, table, entry.m_flushed_rows, deleted, table.m_lsn);
+    }
+    // 索引文件记录的是表的LSN和行数，表变了就要跟着重写
+    Table_Index::save(table, path);
+
+    ++m_stats.m_write_backs;
+    entry.m_dirty = false;
+    entry.m_modified = false;
+    entry.m_flushed_rows = table.m_row_count;
+    entry.m_flushed_lsn = table.m_lsn;
+}
+
+size_t Table_Cache::_vacuum_file(const std::string& path) {
+    Table table = Tools::read_table_from_file(path);
+    size_t rows = table.m_dead_rows;
+    if (0 == rows)
+        return 0;
+    table.purge_dead_rows();
+    // 行号变了，索引文件中的行数对不上，会重建
+    Table_Index::attach(table, path);
+    Tools::write_table_to_file(table, path);
+    Table_Index::save(table, path);
+    ++m_stats.m_write_backs;
+    return rows;
+}
+
+void Table_Cache::_evict() {
+    while (m_stats.m_used_bytes > m_budget and !m_lru.empty()) {
+        std::string path = m_lru.back();
+        Entry& entry = m_entries[path];
+
+        _write_back(path, entry);
+
+        m_stats.m_used_bytes -= entry.m_bytes;
+        ++m_stats.m_evictions;
+        m_lru.pop_back();
+        m_entries.erase(path);
+    }
+}
+
+std::shared_ptr<Table_Latch> Table_Cache::_latch(const std::string& path) {
+    std::shared_ptr<Table_Latch>& latch = m_latches[path];
+    if (nullptr == latch)
+        latch = std::make_shared<Table_Latch>();
+    return latch;
+}
+
+void Table_Cache::_touch(Entry& entry) {
+    m_lru.splice(m_lru.begin(), m_lru, entry.m_lru_pos);
+}
@@ -0,0 +1,811 @@
+/**
+ * @file table_file.cpp
+ * @brief 表文件的二进制页式存储格式(读写器)的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "table_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+/**
+ * @brief 写文件的时候攒够这么多字节再调用一次write，减少系统调用
+ */
+constexpr size_t flush_threshold = 1 << 20;
+
+/**
+ * @brief 文件格式不对的时候直接报错退出，同项目中其他地方文件出错的处理方式一样
+ * @param  path，表文件路径
+ * @param  what，出错原因
+ */
+[[noreturn]] void corrupted(const std::string& path, const char* what) {
+    fprintf(stderr, "表文件 %s 已损坏: %s\n", path.c_str(), what);
+    exit(-1);
+}
+
+void put_u32(std::string& buf, uint32_t value) {
+    buf.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put_string(std::string& buf, const std::string& str) {
+    put_u32(buf, str.size());
+    buf += str;
+}
+
+/**
+ * @brief 在内存中顺序解析数据的游标，越界的时候报错
+ */
+struct Reader {
+    const char* m_pos;
+    const char* m_end;
+    const std::string& m_path;
+
+    uint32_t u32() {
+        if (m_end - m_pos < (long)sizeof(uint32_t))
+            corrupted(m_path, "数据被截断");
+        uint32_t value;
+        memcpy(&value, m_pos, sizeof(value));
+        m_pos += sizeof(value);
+        return value;
+    }
+
+    int64_t i64() {
+        if (m_end - m_pos < (long)sizeof(int64_t))
+            corrupted(m_path, "数据被截断");
+        int64_t value;
+        memcpy(&value, m_pos, sizeof(value));
+        m_pos += sizeof(value);
+        return value;
+    }
+
+    /**
+     * @brief 直接指向被解析的内存，不拷贝，内存失效之前要用完
+     */
+    std::string_view view() {
+        uint32_t len = u32();
+        if ((size_t)(m_end - m_pos) < len)
+            corrupted(m_path, "数据被截断");
+        std::string_view ret(m_pos, len);
+        m_pos += len;
+        return ret;
+    }
+
+    std::string str() { return std::string(view()); }
+};
+
+/**
+ * @brief 只读映射整个表文件，最后一个持有m_chunk的人释放的时候解除映射
+ *  string列的值直接指向映射中的字节，所以读出来的表活着，映射就一直在；
+ *  写整张表是写临时文件再rename，追加写不改已有的行，都不会改到映射中已经被引用的字节
+ */
+struct Mapping {
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::shared_ptr<char[]> m_chunk;
+
+    /**
+     * @param  prefetch，是否马上预读整个文件，只读前面一部分的时候不预读
+     */
+    Mapping(int fd, size_t size, const std::string& path, bool prefetch = true) : m_size(size) {
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == addr) {
+            perror(("mmap " + path).c_str());
+            exit(-1);
+        }
+        // 页是从前往后顺序解析的，让内核尽早预读
+        madvise(addr, size, MADV_SEQUENTIAL);
+        if (prefetch)
+            madvise(addr, size, MADV_WILLNEED);
+        m_data = static_cast<const char*>(addr);
+        m_chunk = std::shared_ptr<char[]>(static_cast<char*>(addr), [size](char* data) { munmap(data, size); });
+    }
+
+    /**
+     * @brief 解析完之后值是按行号随机访问的，不再按顺序预读
+     */
+    void parsed() { madvise(m_chunk.get(), m_size, MADV_NORMAL); }
+};
+
+void write_all(int fd, const char* data, size_t len, const std::string& path) {
+    while (len > 0) {
+        ssize_t ret = write(fd, data, len);
+        if (-1 == ret) {
+            if (EINTR == errno)
+                continue;
+            perror(("write " + path).c_str());
+            exit(-1);
+        }
+        data += ret;
+        len -= ret;
+    }
+}
+
+/**
+ * @brief 拼装一个页，写整张表和追加写都用它，保证两边放行的规则一致
+ */
+struct Page_Builder {
+    /**
+     * @brief 页大小
+     */
+    uint32_t m_page_size;
+
+    /**
+     * @brief 页的内容(可能跨多个物理页)，为空表示当前没有正在拼装的页
+     */
+    std::string m_page;
+
+    /**
+     * @brief 页头，封页的时候才拷贝到m_page的开头
+     */
+    Table_File::Page_Header m_header = {};
+
+    /**
+     * @brief 当前的页是不是load进来的旧页，它原地重写，在文件中的位置不变
+     */
+    bool m_loaded = false;
+
+    bool empty() const { return m_page.empty(); }
+
+    /**
+     * @brief 接着一个已经写过的页继续往里面放行，只保留前valid_rows个槽
+     */
+    void load(const char* data, size_t len, uint32_t valid_rows) {
+        m_page.assign(data, len);
+        memcpy(&m_header, data, sizeof(m_header));
+        m_loaded = true;
+
+        // 上一次追加写到一半的话，页头中的槽会比文件头记录的多，多出来的丢掉
+        if (m_header.m_slot_count > valid_rows) {
+            m_header.m_slot_count = valid_rows;
+            m_header.m_free_end = m_header.m_span * m_page_size;
+            if (valid_rows > 0) {
+                Table_File::Slot slot;
+                memcpy(&slot, data + sizeof(Table_File::Page_Header) + (valid_rows - 1) * sizeof(Table_File::Slot), sizeof(slot));
+                m_header.m_free_end = slot.m_offset;
+            }
+        }
+    }
+
+    /**
+     * @brief 开一个新页，一个页放不下这一行的时候，这个页就占用多个物理页
+     */
+    void start(size_t row_size) {
+        size_t need = sizeof(Table_File::Page_Header) + sizeof(Table_File::Slot) + row_size;
+        m_header.m_slot_count = 0;
+        m_header.m_span = (need + m_page_size - 1) / m_page_size;
+        m_header.m_free_end = m_header.m_span * m_page_size;
+        m_header.m_kind = Table_File::Row_Page;
+        m_page.assign(m_header.m_span * m_page_size, '\0');
+    }
+
+    /**
+     * @brief 剩余空间 = 行数据区起点 - 槽数组的末尾
+     */
+    bool fits(size_t row_size) const {
+        size_t used = sizeof(Table_File::Page_Header) + (m_header.m_slot_count + 1) * sizeof(Table_File::Slot);
+        return !empty() and used + row_size <= m_header.m_free_end;
+    }
+
+    void add(const Table& table, size_t row, size_t row_size) {
+        m_header.m_free_end -= row_size;
+        char* dst = m_page.data() + m_header.m_free_end;
+        for (int i = 0; i < table.m_columns.size(); ++i) {
+            // int列直接放8字节的值，string列是 u32长度 + 值
+            if (table.is_int(i)) {
+                memcpy(dst, &table.m_data[i].m_ints[row], sizeof(int64_t));
+                dst += sizeof(int64_t);
+                continue;
+            }
+            std::string_view cell = table.m_data[i].m_strings[row];
+            uint32_t len = cell.size();
+            memcpy(dst, &len, sizeof(len));
+            memcpy(dst + sizeof(len), cell.data(), len);
+            dst += sizeof(len) + len;
+        }
+
+        Table_File::Slot slot = {m_header.m_free_end, (uint32_t)row_size};
+        memcpy(m_page.data() + sizeof(Table_File::Page_Header) + m_header.m_slot_count * sizeof(Table_File::Slot), &slot, sizeof(slot));
+        ++m_header.m_slot_count;
+    }
+
+    /**
+     * @brief 封页，把页头写进去，追加到out后面，并且更新文件头中的页数；load进来的旧页还在原来的位置，页数不变
+     */
+    void seal(std::string& out, Table_File::File_Header& header) {
+        memcpy(m_page.data(), &m_header, sizeof(m_header));
+        if (!m_loaded) {
+            header.m_last_page = header.m_page_count;
+            header.m_page_count += m_header.m_span;
+        }
+        header.m_last_page_rows = m_header.m_slot_count;
+        out += m_page;
+        m_page.clear();
+        m_loaded = false;
+    }
+};
+
+/**
+ * @brief 删除位图页中一页能覆盖的行数
+ */
+size_t delete_page_rows(uint32_t page_size) {
+    return (page_size - sizeof(Table_File::Page_Header) - sizeof(uint64_t)) * 8;
+}
+
+/**
+ * @brief 把被删除的行号编码成删除位图页，追加到out后面，并且更新文件头中的页数
+ * @brief 一页从其中第一个还没有编码的行号开始，覆盖后面一页能放下的行，删除的行很稀疏的时候页也不会多
+ */
+void add_delete_pages(const std::vector<size_t>& rows, std::string& out, Table_File::File_Header& header) {
+    size_t per_page = delete_page_rows(header.m_page_size);
+    size_t i = 0;
+    while (i < rows.size()) {
+        uint64_t first = rows[i];
+        size_t last = first;
+        std::string page(header.m_page_size, '\0');
+        char* bits = page.data() + sizeof(Table_File::Page_Header) + sizeof(uint64_t);
+        for (; i < rows.size() and rows[i] - first < per_page; ++i) {
+            size_t bit = rows[i] - first;
+            bits[bit / 8] |= 1 << (bit % 8);
+            last = rows[i];
+        }
+
+        Table_File::Page_Header page_header = {};
+        page_header.m_slot_count = last - first + 1;
+        page_header.m_free_end = header.m_page_size;
+        page_header.m_span = 1;
+        page_header.m_kind = Table_File::Delete_Page;
+        memcpy(page.data(), &page_header, sizeof(page_header));
+        memcpy(page.data() + sizeof(page_header), &first, sizeof(first));
+        out += page;
+        ++header.m_page_count;
+    }
+}
+
+/**
+ * @brief 拿到第page_no个物理页开始的页和它的页头，检查跨度
+ */
+const char* page_at(const char* data, const Table_File::File_Header& header, uint64_t page_no,
+                    Table_File::Page_Header& page_header, const std::string& path) {
+    const char* page = data + header.m_data_offset + page_no * header.m_page_size;
+    memcpy(&page_header, page, sizeof(page_header));
+    if (0 == page_header.m_span or page_no + page_header.m_span > header.m_page_count)
+        corrupted(path, "页头不正确");
+    return page;
+}
+
+/**
+ * @brief 把删除位图页中被删除的行号追加到deleted后面
+ */
+void read_delete_page(const char* page, const Table_File::Page_Header& page_header, uint32_t page_size,
+                      std::vector<size_t>& deleted, const std::string& path) {
+    if (1 != page_header.m_span or page_header.m_slot_count > delete_page_rows(page_size))
+        corrupted(path, "删除位图页不正确");
+    uint64_t first;
+    memcpy(&first, page + sizeof(Table_File::Page_Header), sizeof(first));
+    const char* bits = page + sizeof(Table_File::Page_Header) + sizeof(first);
+    for (uint32_t i = 0; i < page_header.m_slot_count; ++i)
+        if (bits[i / 8] & (1 << (i % 8)))
+            deleted.push_back(first + i);
+}
+
+/**
+ * @brief 放行的页中有效的行数，最后一个页以文件头记录的行数为准
+ */
+uint32_t valid_slots(const Table_File::Page_Header& page_header, uint64_t page_no, const Table_File::File_Header& header,
+                     const std::string& path) {
+    size_t page_bytes = (size_t)page_header.m_span * header.m_page_size;
+    if (Table_File::Row_Page != page_header.m_kind or
+        sizeof(Table_File::Page_Header) + page_header.m_slot_count * sizeof(Table_File::Slot) > page_bytes)
+        corrupted(path, "页头不正确");
+    uint32_t slot_count = page_header.m_slot_count;
+    if (page_no == header.m_last_page and slot_count > header.m_last_page_rows)
+        slot_count = header.m_last_page_rows;
+    return slot_count;
+}
+
+/**
+ * @brief 页中第i行的数据
+ */
+Reader row_reader(const char* page, uint32_t i, size_t page_bytes, const std::string& path) {
+    Table_File::Slot slot;
+    memcpy(&slot, page + sizeof(Table_File::Page_Header) + i * sizeof(Table_File::Slot), sizeof(slot));
+    if ((size_t)slot.m_offset + slot.m_length > page_bytes)
+        corrupted(path, "槽越界");
+    return {page + slot.m_offset, page + slot.m_offset + slot.m_length, path};
+}
+
+/**
+ * @brief 把版本3开始的一行解码追加到表的末尾，string列的值指向映射
+ */
+void decode_row(Reader& reader, Table& table, const std::shared_ptr<char[]>& chunk) {
+    for (int j = 0; j < table.m_columns.size(); ++j) {
+        if (table.is_int(j))
+            table.m_data[j].m_ints.push_back(reader.i64());
+        else
+            table.m_data[j].m_strings.push_back_shared(reader.view(), chunk);
+    }
+    ++table.m_row_count;
+}
+
+/**
+ * @brief 读取文件头，不是新格式的时候返回false
+ */
+bool read_header(int fd, Table_File::File_Header& header) {
+    return sizeof(header) == pread(fd, &header, sizeof(header), 0) and Table_File::magic == header.m_magic;
+}
+
+/**
+ * @brief 解析模式块，得到表名、所有的列和索引的定义
+ */
+void decode_schema(Reader& schema, Table& table, uint16_t version) {
+    table.m_table_name = schema.str();
+    uint32_t column_nums = schema.u32();
+    for (uint32_t i = 0; i < column_nums; ++i) {
+        std::string name = schema.str();
+        std::string type = schema.str();
+        table.m_columns.push_back({name, type});
+    }
+
+    // 版本1没有索引
+    if (version < 2)
+        return;
+    uint32_t index_nums = schema.u32();
+    for (uint32_t i = 0; i < index_nums; ++i) {
+        Index_Info index;
+        index.m_index_name = schema.str();
+        index.m_column_name = schema.str();
+        index.m_index_type = schema.str();
+        table.m_indexes.push_back(std::move(index));
+    }
+}
+
+/**
+ * @brief 旧格式的读取，表名、列、单元格每个占一行，行数用原始的size_t写在单独一行
+ * @brief 保留下来是为了能够读取以前的.dat文件，下一次写回的时候就会变成新格式
+ */
+Table read_legacy(const std::string& path) {
+    Table table;
+
+    FILE* file = fopen(path.c_str(), "r");
+    if (nullptr == file) {
+        perror("fopen");
+        exit(-1);
+    }
+
+    char read_buf[BUFSIZ];
+    // 读取表名
+    if (fgets(read_buf, BUFSIZ - 1, file)) {
+        table.m_table_name = read_buf;
+        table.m_table_name.erase(table.m_table_name.find_last_not_of(" \n\r\t") + 1);
+    }
+
+    // 读取列数
+    size_t numColumns = 0;
+    if (fread(&numColumns, sizeof(size_t), 1, file) == 1)
+        fgetc(file);  // Read and discard newline character
+
+    // 读取每列的类型和名称
+    for (size_t i = 0; i < numColumns; ++i) {
+        Column column;
+
+        bzero(read_buf, BUFSIZ);
+        if (fgets(read_buf, BUFSIZ - 1, file)) {
+            column.m_column_name = read_buf;
+            column.m_column_name.erase(column.m_column_name.find_last_not_of(" \n\r\t") + 1);
+        }
+        bzero(read_buf, BUFSIZ);
+        if (fgets(read_buf, BUFSIZ - 1, file)) {
+            column.m_column_type = read_buf;
+            column.m_column_type.erase(column.m_column_type.find_last_not_of(" \n\r\t") + 1);
+        }
+
+        table.m_columns.push_back(column);
+    }
+
+    // 读取数据
+    while (!feof(file)) {
+        size_t row_size;
+        if (fread(&row_size, sizeof(size_t), 1, file) != 1)
+            break;
+
+        fgetc(file);  // Read and discard newline character
+        std::vector<std::string> row;
+        for (size_t i = 0; i < row_size; ++i) {
+            bzero(read_buf, BUFSIZ);
+            if (fgets(read_buf, BUFSIZ - 1, file)) {
+                std::string cell = read_buf;
+                cell.erase(cell.find_last_not_of(" \n\r\t") + 1);
+                row.push_back(cell);
+            }
+        }
+
+        // 旧格式没有检查过int列的值，不是合法整数的当作0
+        if (row.size() == table.m_columns.size())
+            table.append_row(row);
+    }
+
+    fclose(file);
+
+    return table;
+}
+
+}  // namespace
+
+size_t Table_File::encoded_row_size(const Table& table, size_t row) {
+    size_t size = 0;
+    for (int i = 0; i < table.m_columns.size(); ++i)
+        size += table.is_int(i) ? sizeof(int64_t) : sizeof(uint32_t) + table.m_data[i].m_strings[row].size();
+    return size;
+}
+
+void Table_File::write(const Table& table, const std::string& path, uint32_t page_size) {
+    // 模式块
+    std::string schema;
+    put_string(schema, table.m_table_name);
+    put_u32(schema, table.m_columns.size());
+    for (auto& column : table.m_columns) {
+        put_string(schema, column.m_column_name);
+        put_string(schema, column.m_column_type);
+    }
+    put_u32(schema, table.m_indexes.size());
+    for (auto& index : table.m_indexes) {
+        put_string(schema, index.m_index_name);
+        put_string(schema, index.m_column_name);
+        put_string(schema, index.m_index_type);
+    }
+
+    File_Header header;
+    memset(&header, 0, sizeof(header));
+    header.m_magic = magic;
+    header.m_version = version;
+    header.m_page_size = page_size;
+    header.m_schema_size = schema.size();
+    header.m_data_offset = (sizeof(File_Header) + schema.size() + page_size - 1) / page_size * page_size;
+    header.m_last_page = UINT64_MAX;
+    header.m_row_count = table.m_row_count;
+    header.m_lsn = table.m_lsn;
+
+    // 先写到临时文件，写完之后rename过去，rename是原子的
+    std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    // 文件头最后才知道页数，这里先占位，所有的输出先攒在out里面
+    std::string out(header.m_data_offset, '\0');
+    memcpy(out.data() + sizeof(File_Header), schema.data(), schema.size());
+
+    // 已经结束了的旧版本也写进去，再记在删除位图页中，这样文件中的行号和内存中的一致，之后只追加位图页就可以了
+    Page_Builder builder = {page_size};
+    std::vector<size_t> deleted;
+    deleted.reserve(table.m_dead_rows);
+    for (size_t row = 0; row < table.m_row_count; ++row) {
+        if (!table.is_live(row))
+            deleted.push_back(row);
+        size_t row_size = encoded_row_size(table, row);
+        if (!builder.fits(row_size)) {
+            if (!builder.empty())
+                builder.seal(out, header);
+            builder.start(row_size);
+
+            if (out.size() >= flush_threshold) {
+                write_all(fd, out.data(), out.size(), tmp_path);
+                out.clear();
+            }
+        }
+        builder.add(table, row, row_size);
+    }
+    if (!builder.empty())
+        builder.seal(out, header);
+    add_delete_pages(deleted, out, header);
+
+    write_all(fd, out.data(), out.size(), tmp_path);
+
+    // 回头把文件头写上
+    if (-1 == pwrite(fd, &header, sizeof(header), 0)) {
+        perror("pwrite");
+        exit(-1);
+    }
+    close(fd);
+
+    if (-1 == rename(tmp_path.c_str(), path.c_str())) {
+        perror("rename");
+        exit(-1);
+    }
+}
+
+Table Table_File::read(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st)) {
+        perror("fstat");
+        exit(-1);
+    }
+
+    // 先看魔数，不是新格式的话就走旧的读取逻辑
+    File_Header header;
+    if (!read_header(fd, header)) {
+        close(fd);
+        return read_legacy(path);
+    }
+    if (header.m_version > version)
+        corrupted(path, "格式版本过高");
+
+    // 映射整个文件，直接在页缓存上解析，不再先拷贝一份到用户态的缓冲区，string列的值也直接指向映射中的字节
+    if (sizeof(File_Header) + header.m_schema_size > (uint64_t)st.st_size or
+        header.m_data_offset + header.m_page_count * header.m_page_size > (uint64_t)st.st_size)
+        corrupted(path, "文件长度与文件头不符");
+    Mapping buf(fd, st.st_size, path);
+    close(fd);
+
+    Table table;
+    table.m_lsn = header.m_lsn;
+
+    // 模式块
+    Reader schema = {buf.m_data + sizeof(File_Header), buf.m_data + sizeof(File_Header) + header.m_schema_size, path};
+    decode_schema(schema, table, header.m_version);
+    uint32_t column_nums = table.m_columns.size();
+
+    // 按页读取数据，版本3之前int列也是按字符串存的
+    table.reserve(header.m_row_count);
+    bool typed = header.m_version >= 3;
+    std::vector<std::string> row(column_nums);
+    std::vector<size_t> deleted;
+    uint64_t page_no = 0;
+    while (page_no < header.m_page_count) {
+        Page_Header page_header;
+        const char* page = page_at(buf.m_data, header, page_no, page_header, path);
+
+        // 删除位图页，等所有的行都读完了再标记
+        if (Delete_Page == page_header.m_kind) {
+            read_delete_page(page, page_header, header.m_page_size, deleted, path);
+            ++page_no;
+            continue;
+        }
+
+        size_t page_bytes = (size_t)page_header.m_span * header.m_page_size;
+        uint32_t slot_count = valid_slots(page_header, page_no, header, path);
+        for (uint32_t i = 0; i < slot_count; ++i) {
+            Reader reader = row_reader(page, i, page_bytes, path);
+            if (!typed) {
+                for (uint32_t j = 0; j < column_nums; ++j)
+                    row[j] = reader.str();
+                table.append_row(row);
+                continue;
+            }
+            decode_row(reader, table, buf.m_chunk);
+        }
+
+        page_no += page_header.m_span;
+    }
+
+    buf.parsed();
+
+    // 被删除的行作为结束在LSN 0的旧版本，任何快照都看不到，行号不变，等vacuum的时候再真正删掉
+    for (size_t row : deleted) {
+        if (row >= table.m_row_count)
+            corrupted(path, "删除位图越界");
+        if (table.is_live(row))
+            table.end_version(row, 0);
+    }
+
+    return table;
+}
+
+Table Table_File::read_schema(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    File_Header header;
+    if (!read_header(fd, header)) {
+        // 旧格式没办法追加，这里顺便把它转换成新格式
+        close(fd);
+        Table table = read_legacy(path);
+        write(table, path);
+        table.clear_rows();
+        return table;
+    }
+    if (header.m_version > version)
+        corrupted(path, "格式版本过高");
+
+    std::string buf(header.m_schema_size, '\0');
+    if ((ssize_t)buf.size() != pread(fd, buf.data(), buf.size(), sizeof(File_Header)))
+        corrupted(path, "模式块被截断");
+    close(fd);
+
+    Table table;
+    table.m_lsn = header.m_lsn;
+    Reader schema = {buf.data(), buf.data() + buf.size(), path};
+    decode_schema(schema, table, header.m_version);
+
+    return table;
+}
+
+void Table_File::append_rows(const std::string& path, const Table& table, size_t first_row, const std::vector<size_t>& deleted,
+                             uint64_t lsn) {
+    int fd = open(path.c_str(), O_RDWR);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    File_Header header;
+    if (!read_header(fd, header))
+        corrupted(path, "不是页式格式，不能追加");
+
+    // 版本3之前的行编码不一样，不能接着放，先整个转换成新格式
+    if (header.m_version < 3) {
+        close(fd);
+        write(read(path), path);
+        fd = open(path.c_str(), O_RDWR);
+        if (-1 == fd or !read_header(fd, header)) {
+            perror("open");
+            exit(-1);
+        }
+    }
+
+    // 最后一个放行的页可能还有空间，把它读出来接着放，原地重写；它后面可能已经有删除位图页，新的页都接在文件末尾
+    Page_Builder builder = {header.m_page_size};
+    if (UINT64_MAX != header.m_last_page) {
+        off_t offset = header.m_data_offset + header.m_last_page * header.m_page_size;
+        Page_Header last;
+        if (sizeof(last) != pread(fd, &last, sizeof(last), offset))
+            corrupted(path, "最后一个页被截断");
+
+        std::string page(last.m_span * header.m_page_size, '\0');
+        if ((ssize_t)page.size() != pread(fd, page.data(), page.size(), offset))
+            corrupted(path, "最后一个页被截断");
+
+        builder.load(page.data(), page.size(), header.m_last_page_rows);
+    }
+    uint64_t last_page = header.m_last_page;
+    uint64_t first_page = header.m_page_count;
+
+    // 已经结束了的行也追加，它们在deleted中，和其他新删除的行一起记在后面的位图页中
+    std::string out, rewrite;
+    for (size_t row = first_row; row < table.m_row_count; ++row) {
+        size_t row_size = encoded_row_size(table, row);
+        if (!builder.fits(row_size)) {
+            if (!builder.empty())
+                builder.seal(builder.m_loaded ? rewrite : out, header);
+            builder.start(row_size);
+        }
+        builder.add(table, row, row_size);
+    }
+    // 没有新的行的时候最后一个页没有变，不用重写
+    if (!builder.empty() and first_row < table.m_row_count)
+        builder.seal(builder.m_loaded ? rewrite : out, header);
+    add_delete_pages(deleted, out, header);
+
+    // 先写页，再写文件头，文件头没写上之前新的行和删除标记都不算数；
+    // 原地重写的页中已有的行的字节不变，只是多了几个槽，文件头中的行数没更新之前也不算数
+    if ((ssize_t)out.size() != pwrite(fd, out.data(), out.size(), header.m_data_offset + first_page * header.m_page_size)) {
+        perror("pwrite");
+        exit(-1);
+    }
+    if (!rewrite.empty() and
+        (ssize_t)rewrite.size() != pwrite(fd, rewrite.data(), rewrite.size(), header.m_data_offset + last_page * header.m_page_size)) {
+        perror("pwrite");
+        exit(-1);
+    }
+
+    header.m_row_count += table.m_row_count - first_row;
+    header.m_version = version;
+    header.m_lsn = lsn;
+    if (-1 == pwrite(fd, &header, sizeof(header), 0)) {
+        perror("pwrite");
+        exit(-1);
+    }
+    close(fd);
+}
+
+bool Table_File::Scanner::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (-1 == fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    struct stat st;
+    if (-1 == fstat(fd, &st)) {
+        perror("fstat");
+        exit(-1);
+    }
+
+    // 旧格式和版本3之前的文件没有按类型编码，只能整个读进来
+    if (!read_header(fd, m_header) or m_header.m_version < 3) {
+        close(fd);
+        return false;
+    }
+    if (m_header.m_version > version)
+        corrupted(path, "格式版本过高");
+    if (sizeof(File_Header) + m_header.m_schema_size > (uint64_t)st.st_size or
+        m_header.m_data_offset + m_header.m_page_count * m_header.m_page_size > (uint64_t)st.st_size)
+        corrupted(path, "文件长度与文件头不符");
+    Mapping buf(fd, st.st_size, path, false);
+    close(fd);
+    m_path = path;
+    m_data = buf.m_data;
+    m_chunk = buf.m_chunk;
+
+    m_schema = Table();
+    m_schema.m_lsn = m_header.m_lsn;
+    Reader schema = {m_data + sizeof(File_Header), m_data + sizeof(File_Header) + m_header.m_schema_size, m_path};
+    decode_schema(schema, m_schema, m_header.m_version);
+    m_schema.m_data.resize(m_schema.m_columns.size());
+
+    // 删除位图页在它覆盖的行的后面，输出前面的行之前就要知道它们有没有被删除，所以先只看一遍页头
+    m_deleted.clear();
+    for (uint64_t page_no = 0; page_no < m_header.m_page_count;) {
+        Page_Header page_header;
+        const char* page = page_at(m_data, m_header, page_no, page_header, m_path);
+        if (Delete_Page == page_header.m_kind)
+            read_delete_page(page, page_header, m_header.m_page_size, m_deleted, m_path);
+        page_no += page_header.m_span;
+    }
+    std::sort(m_deleted.begin(), m_deleted.end());
+    m_next_deleted = 0;
+    m_page_no = 0;
+    m_slot = 0;
+    m_row = 0;
+    return true;
+}
+
+size_t Table_File::Scanner::next(Table& out, size_t rows) {
+    size_t count = 0;
+    while (count < rows and m_page_no < m_header.m_page_count) {
+        Page_Header page_header;
+        const char* page = page_at(m_data, m_header, m_page_no, page_header, m_path);
+        if (Delete_Page == page_header.m_kind) {
+            ++m_page_no;
+            continue;
+        }
+
+        // 接着上次停下的槽往后读，这一页读完了再换下一页
+        size_t page_bytes = (size_t)page_header.m_span * m_header.m_page_size;
+        uint32_t slot_count = valid_slots(page_header, m_page_no, m_header, m_path);
+        for (; m_slot < slot_count and count < rows; ++m_slot, ++m_row) {
+            while (m_next_deleted < m_deleted.size() and m_deleted[m_next_deleted] < m_row)
+                ++m_next_deleted;
+            if (m_next_deleted < m_deleted.size() and m_deleted[m_next_deleted] == m_row)
+                continue;
+            Reader reader = row_reader(page, m_slot, page_bytes, m_path);
+            decode_row(reader, out, m_chunk);
+            ++count;
+        }
+        if (m_slot >= slot_count) {
+            m_page_no += page_header.m_span;
+            m_slot = 0;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file table_index.cpp
+ * @brief 维护一张表上所有索引的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "table_index.h"
+
+#include <unistd.h>
+
+#include <memory>
+
+#include "btree_index.h"
+#include "hash_index.h"
+
+/**
+ * @brief 只在本文件中使用的常量
+ */
+namespace {
+/**
+ * @brief 一次修改的行数超过它(并且超过表的1/8)的时候，直接重建索引
+ */
+constexpr size_t rebuild_threshold = 64;
+
+/**
+ * @brief 按索引的类型新建空的索引数据
+ */
+void make_index(const Table& table, Index_Info& index) {
+    if ("btree" == index.m_index_type)
+        index.m_btree = std::make_shared<BTree_Index>("int" == table.m_columns[index.m_column_index].m_column_type);
+    else
+        index.m_hash = std::make_shared<Hash_Index>();
+}
+
+/**
+ * @brief 用表中的数据建索引
+ */
+void build_index(const Table& table, Index_Info& index) {
+    if (nullptr != index.m_btree)
+        index.m_btree->build(table, index.m_column_index);
+    else if (nullptr != index.m_hash)
+        index.m_hash->build(table, index.m_column_index);
+}
+
+/**
+ * @brief 找到某一列上的B+树索引
+ */
+const BTree_Index* find_btree(const Table& table, int column) {
+    for (auto& index : table.m_indexes)
+        if (nullptr != index.m_btree and column == index.m_column_index)
+            return index.m_btree.get();
+    return nullptr;
+}
+
+}  // namespace
+
+bool Table_Index::valid_type(const std::string& type) {
+    return "hash" == type or "btree" == type;
+}
+
+std::string Table_Index::file_path(const std::string& table_path, const std::string& index_name) {
+    // 去掉.dat
+    return table_path.substr(0, table_path.rfind('.')) + "." + index_name + suffix;
+}
+
+void Table_Index::attach(Table& table, const std::string& table_path) {
+    for (auto& index : table.m_indexes) {
+        index.m_column_index = -1;
+        for (int i = 0; i < table.m_columns.size(); ++i)
+            if (index.m_column_name == table.m_columns[i].m_column_name)
+                index.m_column_index = i;
+        if (-1 == index.m_column_index)
+            continue;
+
+        make_index(table, index);
+        std::string path = file_path(table_path, index.m_index_name);
+        bool loaded = nullptr != index.m_btree ? index.m_btree->load(path, table.m_lsn, table.m_row_count)
+                                               : index.m_hash->load(path, table.m_lsn, table.m_row_count);
+        if (!loaded)
+            build_index(table, index);
+    }
+}
+
+void Table_Index::create(Table& table, Index_Info index) {
+    for (int i = 0; i < table.m_columns.size(); ++i)
+        if (index.m_column_name == table.m_columns[i].m_column_name)
+            index.m_column_index = i;
+
+    make_index(table, index);
+    build_index(table, index);
+    table.m_indexes.push_back(std::move(index));
+}
+
+void Table_Index::save(const Table& table, const std::string& table_path) {
+    for (auto& index : table.m_indexes) {
+        if (nullptr != index.m_btree)
+            index.m_btree->save(file_path(table_path, index.m_index_name), table.m_lsn, table.m_row_count);
+        else if (nullptr != index.m_hash)
+            index.m_hash->save(file_path(table_path, index.m_index_name), table.m_lsn, table.m_row_count);
+    }
+}
+
+void Table_Index::remove(const Table& table, const std::string& table_path) {
+    for (auto& index : table.m_indexes)
+        unlink(file_path(table_path, index.m_index_name).c_str());
+}
+
+void Table_Index::insert_row(Table& table, size_t row) {
+    for (auto& index : table.m_indexes) {
+        if (nullptr != index.m_btree)
+            index.m_btree->insert(table.cell(row, index.m_column_index), row);
+        else if (nullptr != index.m_hash)
+            index.m_hash->insert(table.cell(row, index.m_column_index), row);
+    }
+}
+
+void Table_Index::insert_rows(Table& table, size_t first_row) {
+    // B+树批量建比逐个插入快得多，插入的行多就不如重建
+    size_t rows = table.m_row_count - first_row;
+    if (rows > rebuild_threshold and rows * 8 > table.m_row_count) {
+        rebuild(table);
+        return;
+    }
+    for (size_t row = first_row; row < table.m_row_count; ++row)
+        insert_row(table, row);
+}
+
+void Table_Index::rebuild(Table& table) {
+    for (auto& index : table.m_indexes)
+        build_index(table, index);
+}
+
+bool Table_Index::lookup(const Table& table, int column, const std::string& value, std::vector<size_t>& rows) {
+    for (auto& index : table.m_indexes)
+        if (nullptr != index.m_hash and column == index.m_column_index) {
+            // int列的键是规范化之后的，0180要按180找
+            int64_t num;
+            const std::vector<size_t>* found = nullptr;
+            if (!table.is_int(column))
+                found = index.m_hash->find(value);
+            else if (Table::parse_int(value, num))
+                found = index.m_hash->find(std::to_string(num));
+            if (nullptr == found)
+                rows.clear();
+            else
+                rows = *found;
+            return true;
+        }
+
+    if (const BTree_Index* btree = find_btree(table, column)) {
+        btree->range(&value, true, &value, true, rows);
+        return true;
+    }
+    return false;
+}
+
+bool Table_Index::range(const Table& table, int column, const std::string* low, bool low_inclusive, const std::string* high,
+                        bool high_inclusive, std::vector<size_t>& rows) {
+    const BTree_Index* btree = find_btree(table, column);
+    if (nullptr == btree)
+        return false;
+    btree->range(low, low_inclusive, high, high_inclusive, rows);
+    return true;
+}
+
+bool Table_Index::prefix(const Table& table, int column, const std::string& prefix, std::vector<size_t>& rows) {
+    // int列的键是编码之后的，不能按字符串的前缀找
+    const BTree_Index* btree = find_btree(table, column);
+    if (nullptr == btree or "int" == table.m_columns[column].m_column_type)
+        return false;
+    btree->prefix(prefix, rows);
+    return true;
+}
+
+bool Table_Index::has_index(const Table& table, int column) {
+    for (auto& index : table.m_indexes)
+        if (column == index.m_column_index)
+            return true;
+    return false;
+}
+
+bool Table_Index::has_btree(const Table& table, int column) {
+    return nullptr != find_btree(table, column);
+}
+
+bool Table_Index::ordered(const Table& table, int column, std::vector<size_t>& rows) {
+    const BTree_Index* btree = find_btree(table, column);
+    if (nullptr == btree)
+        return false;
+    btree->scan(rows);
+    return true;
+}
+
+size_t Table_Index::bytes(const Table& table) {
+    size_t bytes = 0;
+    for (auto& index : table.m_indexes) {
+        if (nullptr != index.m_btree)
+            bytes += index.m_btree->bytes();
+        else if (nullptr != index.m_hash)
+            bytes += index.m_hash->bytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file thread_pool.cpp
+ * @brief 执行命令的工作线程池的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <memory>
+
+Thread_Pool::Thread_Pool(size_t threads) {
+    if (0 == threads)
+        threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back(&Thread_Pool::_work, this);
+}
+
+Thread_Pool::~Thread_Pool() { stop(); }
+
+void Thread_Pool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+}
+
+void Thread_Pool::parallel_for(size_t tasks, const std::function<void(size_t)>& task) {
+    // 排在队列后面的帮手可能在所有任务做完、调用者返回之后才开始执行，它们只碰这个共享的状态，发现没有任务了就走
+    struct Shared {
+        std::atomic<size_t> m_next{0};
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        size_t m_done = 0;
+        const std::function<void(size_t)>* m_task;
+        size_t m_tasks;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->m_task = &task;
+    shared->m_tasks = tasks;
+
+    auto run = [](Shared& state) {
+        size_t done = 0;
+        for (size_t i; (i = state.m_next.fetch_add(1)) < state.m_tasks; ++done)
+            (*state.m_task)(i);
+        if (0 == done)
+            return;
+        std::lock_guard<std::mutex> lock(state.m_mutex);
+        state.m_done += done;
+        if (state.m_done == state.m_tasks)
+            state.m_cv.notify_all();
+    };
+    for (size_t i = 1; i < tasks and i <= m_threads.size(); ++i)
+        submit([shared, run]() { run(*shared); });
+    run(*shared);
+
+    std::unique_lock<std::mutex> lock(shared->m_mutex);
+    shared->m_cv.wait(lock, [&]() { return shared->m_done == tasks; });
+}
+
+void Thread_Pool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads)
+        if (thread.joinable())
+            thread.join();
+}
+
+void Thread_Pool::_work() {
+    while (1) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&]() { return m_stop or !m_jobs.empty(); });
+            // 停止的时候也要先把队列中剩下的任务做完
+            if (m_jobs.empty())
+                return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -11,11 +11,16 @@
 
 #include "tools.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "table_file.h"
+
 /**
  * @brief 实现头文件中声明的工具函数
  */
 
-void Tools::open_and_print(const std::string& path) {
+void Tools::open_and_print(const std::string& path, std::ostream& out) {
     // 打开文件
     FILE* file = fopen(path.c_str(), "r");
     if (nullptr == file) {
@@ -38,8 +43,8 @@ void Tools::open_and_print(const std::string& path) {
                 break;
         }
 
-        // 打印到屏幕上
-        fwrite(read_buf, 1, len, stdout);
+        // 打印出来
+        out.write(read_buf, len);
     }
 
     // 关闭
@@ -83,103 +88,36 @@ bool Tools::check_has_any(const std::string& str, const std::vector<char>& chs)
     return false;
 }
 
-//********这两个函数为了省事，我是让chat帮我写的，我提供了存储的思路，就是write_函数里面的思路********/
+// 表文件的具体格式见table_file.h
 void Tools::write_table_to_file(const Table& table, const std::string& path) {
-    FILE* file = fopen(path.c_str(), "w");
-    if (nullptr == file) {
-        perror("fopen");
-        exit(-1);
-    }
-
-    // 写入表名，fprintf格式化IO可以格式化写入到字符串中
-    fprintf(file, "%s\n", table.m_table_name.c_str());
-
-    // 写入列数
-    size_t column_nums = table.m_columns.size();
-    fwrite(&column_nums, sizeof(size_t), 1, file);
-    fprintf(file, "\n");
-
-    // 写入每列的类型和名称
-    for (auto& column : table.m_columns) {
-        fprintf(file, "%s\n", column.m_column_name.c_str());
-        fprintf(file, "%s\n", column.m_column_type.c_str());
-    }
-
-    // 写入数据
-    for (auto& row : table.m_data) {
-        size_t row_size = row.size();
-
-        fwrite(&row_size, sizeof(size_t), 1, file);
-        fprintf(file, "\n");
-
-        for (auto& cell : row)
-            fprintf(file, "%s\n", cell.c_str());
-    }
-
-    fclose(file);
+    Table_File::write(table, path);
 }
 
 Table Tools::read_table_from_file(const std::string& path) {
-    Table table;
-
-    // 按照写入的格式读取即可
-    FILE* file = fopen(path.c_str(), "r");
-    if (nullptr == file) {
-        perror("fopen");
-        exit(-1);
-    }
-
-    char read_buf[BUFSIZ];
-    // 读取表名
-    if (fgets(read_buf, BUFSIZ - 1, file)) {
-        table.m_table_name = read_buf;
-        table.m_table_name.erase(table.m_table_name.find_last_not_of(" \n\r\t") + 1);
-    }
+    return Table_File::read(path);
+}
 
-    // 读取列数
-    size_t numColumns;
-    if (fread(&numColumns, sizeof(size_t), 1, file) == 1)
-        fgetc(file);  // Read and discard newline character
+Table Tools::read_schema_from_file(const std::string& path) {
+    return Table_File::read_schema(path);
+}
 
-    // 读取每列的类型和名称
-    for (size_t i = 0; i < numColumns; ++i) {
-        Column column;
+void Tools::append_rows_to_file(const Table& rows, const std::string& path, uint64_t lsn) {
+    Table_File::append_rows(path, rows, 0, {}, lsn);
+}
 
-        bzero(read_buf, BUFSIZ);
-        if (fgets(read_buf, BUFSIZ - 1, file)) {
-            column.m_column_name = read_buf;
-            column.m_column_name.erase(column.m_column_name.find_last_not_of(" \n\r\t") + 1);
-        }
-        bzero(read_buf, BUFSIZ);
-        if (fgets(read_buf, BUFSIZ - 1, file)) {
-            column.m_column_type = read_buf;
-            column.m_column_type.erase(column.m_column_type.find_last_not_of(" \n\r\t") + 1);
+void Tools::sync_file(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = std::string::npos == slash ? "." : path.substr(0, slash + 1);
+    for (const std::string& name : {path, dir}) {
+        int fd = open(name.c_str(), O_RDONLY);
+        if (-1 == fd) {
+            perror("open");
+            exit(-1);
         }
-
-        table.m_columns.push_back(column);
-    }
-
-    // 读取数据
-    while (!feof(file)) {
-        size_t row_size;
-        if (fread(&row_size, sizeof(size_t), 1, file) != 1)
-            break;
-
-        fgetc(file);  // Read and discard newline character
-        std::vector<std::string> row;
-        for (size_t i = 0; i < row_size; ++i) {
-            bzero(read_buf, BUFSIZ);
-            if (fgets(read_buf, BUFSIZ - 1, file)) {
-                std::string cell = read_buf;
-                cell.erase(cell.find_last_not_of(" \n\r\t") + 1);
-                row.push_back(cell);
-            }
+        if (-1 == fsync(fd)) {
+            perror("fsync");
+            exit(-1);
         }
-
-        table.m_data.push_back(row);
+        close(fd);
     }
-
-    fclose(file);
-
-    return table;
 }
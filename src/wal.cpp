@@ -0,0 +1,375 @@
+/**
+ * @file wal.cpp
+ * @brief 每个数据库一份的预写日志(WAL)的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "wal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#include "table_cache.h"
+
+const std::string Wal::file_name = "redo.wal";
+
+/**
+ * @brief 只在本文件中使用的辅助函数和变量
+ */
+namespace {
+/**
+ * @brief 日志文件魔数，"HWAL"
+ */
+constexpr uint32_t wal_magic = 0x4C415748;
+
+/**
+ * @brief 日志文件头
+ */
+struct Wal_Header {
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint64_t m_base_lsn;
+};
+
+/**
+ * @brief 每条记录前面的长度和校验和
+ */
+struct Record_Header {
+    uint32_t m_length;
+    uint32_t m_crc;
+};
+
+/**
+ * @brief 组提交的等待时间，微秒
+ */
+unsigned group_commit_delay_us = 0;
+
+/**
+ * @brief 所有打开的日志，键是数据库目录
+ */
+std::mutex registry_mutex;
+std::map<std::string, std::shared_ptr<Wal>> registry;
+
+/**
+ * @brief CRC32校验和，用来识别末尾写了一半的记录
+ */
+uint32_t crc32(const char* data, size_t len) {
+    // 局部静态变量的初始化是线程安全的
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> ret;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            ret[i] = c;
+        }
+        return ret;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i)
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void put_string(std::string& buf, const std::string& str) {
+    uint32_t len = str.size();
+    buf.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    buf += str;
+}
+
+bool get_string(const char*& pos, const char* end, std::string& str) {
+    uint32_t len;
+    if (end - pos < (long)sizeof(len))
+        return false;
+    memcpy(&len, pos, sizeof(len));
+    pos += sizeof(len);
+    if ((size_t)(end - pos) < len)
+        return false;
+    str.assign(pos, len);
+    pos += len;
+    return true;
+}
+
+}  // namespace
+
+Wal& Wal::for_database(const std::string& db_dir) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto& wal = registry[db_dir];
+    if (nullptr == wal)
+        wal.reset(new Wal(db_dir));
+    return *wal;
+}
+
+Wal& Wal::for_table(const std::string& table_path) {
+    return for_database(table_path.substr(0, table_path.rfind('/')));
+}
+
+void Wal::set_group_commit_delay(unsigned us) {
+    group_commit_delay_us = us;
+}
+
+void Wal::checkpoint_all() {
+    // 先把指针拷贝出来再做检查点，检查点要拿缓存的锁，不能在持有registry_mutex的时候做
+    std::vector<std::shared_ptr<Wal>> wals;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (auto& [dir, wal] : registry)
+            wals.push_back(wal);
+    }
+
+    for (auto& wal : wals)
+        wal->checkpoint();
+}
+
+void Wal::remove(const std::string& db_dir) {
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.erase(db_dir);
+    }
+
+    unlink((db_dir + "/" + file_name).c_str());
+}
+
+Wal::Wal(const std::string& db_dir) : m_dir(db_dir) {
+    std::string path = m_dir + "/" + file_name;
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (-1 == m_fd) {
+        perror("open");
+        exit(-1);
+    }
+
+    Wal_Header header;
+    if (sizeof(header) != pread(m_fd, &header, sizeof(header), 0) or wal_magic != header.m_magic) {
+        // 新建的日志
+        std::lock_guard<std::mutex> io_lock(m_io_mutex);
+        _write_header(1);
+    } else {
+        m_next_lsn = header.m_base_lsn;
+        uint64_t last_lsn = m_next_lsn - 1;
+
+        // 末尾写了一半的记录丢掉，后面的记录从这里接着写
+        m_file_size = _scan(nullptr, last_lsn);
+        if (-1 == ftruncate(m_fd, m_file_size)) {
+            perror("ftruncate");
+            exit(-1);
+        }
+        m_next_lsn = last_lsn + 1;
+        m_checkpoint_lsn = header.m_base_lsn;
+    }
+    m_durable_lsn = m_next_lsn - 1;
+
+    m_flusher = std::thread(&Wal::_flusher, this);
+}
+
+Wal::~Wal() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_flush_cv.notify_one();
+    m_flusher.join();
+
+    close(m_fd);
+}
+
+uint64_t Wal::append(const std::string& table, const std::string& command) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t lsn = m_next_lsn++;
+
+    std::string body(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+    put_string(body, table);
+    put_string(body, command);
+
+    Record_Header header = {(uint32_t)body.size(), crc32(body.data(), body.size())};
+    m_buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_buffer += body;
+
+    return lsn;
+}
+
+void Wal::wait_durable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (lsn <= m_durable_lsn)
+        return;
+
+    ++m_waiters;
+    m_flush_cv.notify_one();
+    m_durable_cv.wait(lock, [&]() { return m_durable_lsn >= lsn; });
+    --m_waiters;
+}
+
+uint64_t Wal::last_lsn() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_next_lsn - 1;
+}
+
+std::vector<Wal::Record> Wal::records() {
+    std::lock_guard<std::mutex> io_lock(m_io_mutex);
+
+    std::vector<Record> records;
+    uint64_t last_lsn = 0;
+    _scan(&records, last_lsn);
+    return records;
+}
+
+void Wal::checkpoint() {
+    // 等正在进行的修改完成，并且不让新的修改开始
+    std::unique_lock<std::shared_mutex> guard(m_write_lock);
+
+    uint64_t last = last_lsn();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_checkpoint_lsn == last + 1)
+            return;
+    }
+    wait_durable(last);
+
+    // 把这个数据库的脏表写回，并且保证表文件落盘，之后日志就可以清空了
+    Table_Cache::instance().flush_all(m_dir + "/");
+
+    DIR* dir = opendir(m_dir.c_str());
+    if (nullptr == dir) {
+        perror("opendir");
+        exit(-1);
+    }
+    while (struct dirent* file = readdir(dir)) {
+        std::string name = file->d_name;
+        // 表文件和索引文件
+        if (name.size() < 4 or (".dat" != name.substr(name.size() - 4) and ".idx" != name.substr(name.size() - 4)))
+            continue;
+
+        int fd = open((m_dir + "/" + name).c_str(), O_RDONLY);
+        if (-1 == fd)
+            continue;
+        fsync(fd);
+        close(fd);
+    }
+    // rename之后目录项也要落盘
+    fsync(dirfd(dir));
+    closedir(dir);
+
+    std::lock_guard<std::mutex> io_lock(m_io_mutex);
+    _write_header(last + 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_checkpoint_lsn = last + 1;
+}
+
+void Wal::maybe_checkpoint() {
+    size_t size;
+    {
+        std::lock_guard<std::mutex> io_lock(m_io_mutex);
+        size = m_file_size;
+    }
+    if (size > checkpoint_bytes)
+        checkpoint();
+}
+
+void Wal::_flusher() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (1) {
+        m_flush_cv.wait(lock, [&]() { return m_stop or (m_waiters > 0 and !m_buffer.empty()); });
+        if (m_buffer.empty()) {
+            if (m_stop)
+                break;
+            continue;
+        }
+
+        // 组提交: 先等一小会儿，让更多的提交攒到这一次fsync里面
+        if (group_commit_delay_us > 0 and !m_stop) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::microseconds(group_commit_delay_us));
+            lock.lock();
+        }
+
+        std::string buf;
+        buf.swap(m_buffer);
+        uint64_t lsn = m_next_lsn - 1;
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> io_lock(m_io_mutex);
+            if ((ssize_t)buf.size() != pwrite(m_fd, buf.data(), buf.size(), m_file_size)) {
+                perror("pwrite");
+                exit(-1);
+            }
+            m_file_size += buf.size();
+            if (-1 == fdatasync(m_fd)) {
+                perror("fdatasync");
+                exit(-1);
+            }
+        }
+
+        lock.lock();
+        m_durable_lsn = lsn;
+        m_durable_cv.notify_all();
+    }
+}
+
+size_t Wal::_scan(std::vector<Record>* records, uint64_t& last_lsn) {
+    struct stat st;
+    if (-1 == fstat(m_fd, &st)) {
+        perror("fstat");
+        exit(-1);
+    }
+
+    std::string buf(st.st_size, '\0');
+    if (st.st_size != pread(m_fd, buf.data(), buf.size(), 0)) {
+        perror("pread");
+        exit(-1);
+    }
+
+    size_t pos = sizeof(Wal_Header);
+    while (pos + sizeof(Record_Header) <= buf.size()) {
+        Record_Header header;
+        memcpy(&header, buf.data() + pos, sizeof(header));
+        const char* body = buf.data() + pos + sizeof(header);
+        if (header.m_length < sizeof(uint64_t) or pos + sizeof(header) + header.m_length > buf.size() or
+            header.m_crc != crc32(body, header.m_length))
+            break;
+
+        Record record;
+        memcpy(&record.m_lsn, body, sizeof(record.m_lsn));
+        const char* cur = body + sizeof(record.m_lsn);
+        const char* end = body + header.m_length;
+        if (!get_string(cur, end, record.m_table) or !get_string(cur, end, record.m_command))
+            break;
+
+        last_lsn = record.m_lsn;
+        if (nullptr != records)
+            records->push_back(std::move(record));
+        pos += sizeof(header) + header.m_length;
+    }
+
+    return std::min(pos, buf.size());
+}
+
+void Wal::_write_header(uint64_t base_lsn) {
+    Wal_Header header = {wal_magic, 1, base_lsn};
+    if (sizeof(header) != pwrite(m_fd, &header, sizeof(header), 0) or -1 == ftruncate(m_fd, sizeof(header))) {
+        perror("wal header");
+        exit(-1);
+    }
+    if (-1 == fdatasync(m_fd)) {
+        perror("fdatasync");
+        exit(-1);
+    }
+    m_file_size = sizeof(header);
+}
@@ -0,0 +1,687 @@
+/**
+ * @file where_cond.cpp
+ * @brief where条件的解析和求值的源文件
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include "where_cond.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "batch_filter.h"
+#include "table_index.h"
+
+/**
+ * @brief 只在本文件中使用的辅助函数
+ */
+namespace {
+using Tree = Where_Expr::Tree;
+using Node = Where_Expr::Node;
+
+/**
+ * @brief 三路比较
+ */
+template <typename T>
+int three_way(const T& a, const T& b) {
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+/**
+ * @brief 比较方式和三路比较的结果是否相符
+ */
+bool satisfy(Where_Cond::Op op, int cmp) {
+    switch (op) {
+    case Where_Cond::Equal:
+        return 0 == cmp;
+    case Where_Cond::Not_Equal:
+        return 0 != cmp;
+    case Where_Cond::Less:
+        return cmp < 0;
+    case Where_Cond::Less_Equal:
+        return cmp <= 0;
+    case Where_Cond::Greater:
+        return cmp > 0;
+    case Where_Cond::Greater_Equal:
+        return cmp >= 0;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 在表中找到谓词中的列，int列的时候把值解析成整数，in的值去重排序
+ */
+bool bind_cond(const Table& table, Where_Cond& cond) {
+    cond.m_column_index = -1;
+    for (int i = 0; i < table.m_columns.size(); ++i)
+        if (cond.m_column == table.m_columns[i].m_column_name) {
+            cond.m_column_index = i;
+            cond.m_is_int = table.is_int(i);
+        }
+    if (-1 == cond.m_column_index)
+        return false;
+    if (Where_Cond::Is_Null == cond.m_op)
+        return true;
+
+    if (!cond.m_is_int) {
+        if (Where_Cond::In == cond.m_op) {
+            std::sort(cond.m_values.begin(), cond.m_values.end());
+            cond.m_values.erase(std::unique(cond.m_values.begin(), cond.m_values.end()), cond.m_values.end());
+        }
+        return true;
+    }
+
+    // int列的值在这里解析一次，后面逐行比较的时候直接比较整数
+    if (Where_Cond::Like == cond.m_op)
+        return false;
+    if (Where_Cond::In == cond.m_op) {
+        cond.m_int_values.clear();
+        for (const std::string& value : cond.m_values) {
+            int64_t num;
+            if (!Table::parse_int(value, num))
+                return false;
+            cond.m_int_values.push_back(num);
+        }
+        std::sort(cond.m_int_values.begin(), cond.m_int_values.end());
+        cond.m_int_values.erase(std::unique(cond.m_int_values.begin(), cond.m_int_values.end()), cond.m_int_values.end());
+        // 字符串形式的值也换成规范化之后的，和整数的顺序一致，用索引找的时候按这个顺序
+        cond.m_values.clear();
+        for (int64_t num : cond.m_int_values)
+            cond.m_values.push_back(std::to_string(num));
+        return true;
+    }
+    if (!Table::parse_int(cond.m_value, cond.m_int_value))
+        return false;
+    return Where_Cond::Between != cond.m_op or Table::parse_int(cond.m_high, cond.m_int_high);
+}
+
+/**
+ * @brief 是不是可以换成一个闭区间的int列谓词
+ */
+bool is_int_range(const Where_Cond& cond) {
+    return cond.m_is_int and (cond.m_op <= Where_Cond::Between);
+}
+
+/**
+ * @brief 把闭区间写成最简单的谓词
+ */
+void set_int_range(Where_Cond& cond, int64_t low, int64_t high) {
+    cond.m_int_value = low;
+    cond.m_int_high = high;
+    if (low == high)
+        cond.m_op = Where_Cond::Equal;
+    else if (INT64_MIN == low) {
+        cond.m_op = Where_Cond::Less_Equal;
+        cond.m_int_value = high;
+    } else if (INT64_MAX == high)
+        cond.m_op = Where_Cond::Greater_Equal;
+    else
+        cond.m_op = Where_Cond::Between;
+    cond.m_value = std::to_string(cond.m_int_value);
+    cond.m_high = std::to_string(cond.m_int_high);
+}
+
+/**
+ * @brief not可以直接翻转的比较方式，不能翻转的返回false
+ */
+bool negate_op(Where_Cond::Op& op) {
+    switch (op) {
+    case Where_Cond::Equal:
+        op = Where_Cond::Not_Equal;
+        return true;
+    case Where_Cond::Not_Equal:
+        op = Where_Cond::Equal;
+        return true;
+    case Where_Cond::Less:
+        op = Where_Cond::Greater_Equal;
+        return true;
+    case Where_Cond::Greater_Equal:
+        op = Where_Cond::Less;
+        return true;
+    case Where_Cond::Less_Equal:
+        op = Where_Cond::Greater;
+        return true;
+    case Where_Cond::Greater:
+        op = Where_Cond::Less_Equal;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 谓词的选择率，表没有统计信息，按System R的经验值估计: 等值1/10，范围1/3，between 1/4
+ */
+double cond_selectivity(const Where_Cond& cond) {
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+    case Where_Cond::Like:
+        return 0.1;
+    case Where_Cond::Not_Equal:
+        return 0.9;
+    case Where_Cond::Between:
+        return 0.25;
+    case Where_Cond::In:
+        return std::min(0.5, 0.1 * cond.m_values.size());
+    case Where_Cond::Is_Null:
+        return 0;
+    default:
+        return 1.0 / 3;
+    }
+}
+
+/**
+ * @brief 逐行求一个谓词的相对代价，int比较最便宜，string要比较内容，in要二分查找
+ */
+double cond_cost(const Where_Cond& cond) {
+    double cost = cond.m_is_int ? 1 : 2;
+    if (Where_Cond::In == cond.m_op)
+        cost += std::log2(cond.m_values.size() + 1);
+    return cost;
+}
+
+int constant(Tree& out, bool value) {
+    int i = out.add(value ? Where_Expr::True : Where_Expr::False);
+    out.m_nodes[i].m_selectivity = value;
+    return i;
+}
+
+/**
+ * @brief 折叠一个已经bind过的谓词: 一定满足或者一定不满足的换成常量
+ */
+int fold_cond(Tree& out, int c) {
+    Where_Cond& cond = out.m_conds[c];
+    switch (cond.m_op) {
+    case Where_Cond::Is_Null:
+        // 表中的值都不为空
+        return constant(out, false);
+    case Where_Cond::In:
+        if (1 == cond.m_values.size()) {
+            cond.m_op = Where_Cond::Equal;
+            cond.m_value = cond.m_values[0];
+            if (cond.m_is_int)
+                cond.m_int_value = cond.m_int_values[0];
+        }
+        break;
+    case Where_Cond::Like:
+        // 空前缀什么都满足
+        if (cond.m_value.empty())
+            return constant(out, true);
+        break;
+    case Where_Cond::Between:
+        if (!cond.m_is_int and cond.m_value > cond.m_high)
+            return constant(out, false);
+        break;
+    default:
+        break;
+    }
+
+    if (is_int_range(cond)) {
+        int64_t low, high;
+        if (!Where::int_range(cond, low, high))
+            return constant(out, false);
+        if (INT64_MIN == low and INT64_MAX == high)
+            return constant(out, true);
+    }
+
+    int i = out.add(Where_Expr::Cond, c);
+    out.m_nodes[i].m_selectivity = cond_selectivity(cond);
+    out.m_nodes[i].m_cost = cond_cost(cond);
+    return i;
+}
+
+/**
+ * @brief and中同一个int列上的多个范围求交集，合成一个谓词，比如 id >= 3 and id < 10 变成 id between 3 and 9
+ * @return bool，交集为空的时候返回false，整个and一定不满足
+ */
+bool merge_ranges(Tree& out, std::vector<int>& children) {
+    for (size_t i = 0; i < children.size(); ++i) {
+        const Node& first = out.node(children[i]);
+        if (Where_Expr::Cond != first.m_kind or !is_int_range(out.cond(first)))
+            continue;
+        int column = out.cond(first).m_column_index;
+        int64_t low, high;
+        Where::int_range(out.cond(first), low, high);
+
+        bool merged = false;
+        for (size_t j = i + 1; j < children.size();) {
+            const Node& other = out.node(children[j]);
+            if (Where_Expr::Cond != other.m_kind or !is_int_range(out.cond(other)) or column != out.cond(other).m_column_index) {
+                ++j;
+                continue;
+            }
+            int64_t other_low, other_high;
+            Where::int_range(out.cond(other), other_low, other_high);
+            low = std::max(low, other_low);
+            high = std::min(high, other_high);
+            children.erase(children.begin() + j);
+            merged = true;
+        }
+        if (!merged)
+            continue;
+        if (low > high)
+            return false;
+
+        Where_Cond cond = out.cond(out.node(children[i]));
+        set_int_range(cond, low, high);
+        out.m_conds.push_back(std::move(cond));
+        children[i] = fold_cond(out, out.m_conds.size() - 1);
+    }
+    return true;
+}
+
+/**
+ * @brief 把in中的第i个结点编译到out中，返回新结点的下标，谓词已经按原来的下标拷贝并bind过了
+ */
+int compile(const Tree& in, int i, Tree& out) {
+    const Node& node = in.node(i);
+    switch (node.m_kind) {
+    case Where_Expr::Cond:
+        return fold_cond(out, node.m_cond);
+    case Where_Expr::True:
+    case Where_Expr::False:
+        return constant(out, Where_Expr::True == node.m_kind);
+    case Where_Expr::Not: {
+        int child = compile(in, node.m_children[0], out);
+        Node compiled = out.node(child);
+        switch (compiled.m_kind) {
+        case Where_Expr::True:
+        case Where_Expr::False:
+            return constant(out, Where_Expr::False == compiled.m_kind);
+        case Where_Expr::Not:
+            return compiled.m_children[0];
+        case Where_Expr::Cond: {
+            // not a = 1 变成 a != 1，not a < 1 变成 a >= 1
+            Where_Cond cond = out.cond(compiled);
+            if (negate_op(cond.m_op)) {
+                out.m_conds.push_back(std::move(cond));
+                return fold_cond(out, out.m_conds.size() - 1);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        int result = out.add(Where_Expr::Not, -1, {child});
+        out.m_nodes[result].m_selectivity = 1 - compiled.m_selectivity;
+        out.m_nodes[result].m_cost = compiled.m_cost;
+        return result;
+    }
+    default:
+        break;
+    }
+
+    // and和or: 嵌套的同类结点展开，去掉不影响结果的常量，遇到决定结果的常量直接折叠
+    Where_Expr::Kind kind = node.m_kind;
+    bool is_and = Where_Expr::And == kind;
+    Where_Expr::Kind identity = is_and ? Where_Expr::True : Where_Expr::False;
+    std::vector<int> children;
+    for (int child_in : node.m_children) {
+        int child = compile(in, child_in, out);
+        const Node& compiled = out.node(child);
+        if (kind == compiled.m_kind)
+            children.insert(children.end(), compiled.m_children.begin(), compiled.m_children.end());
+        else if (Where_Expr::True == compiled.m_kind or Where_Expr::False == compiled.m_kind) {
+            if (identity != compiled.m_kind)
+                return constant(out, !is_and);
+        } else
+            children.push_back(child);
+    }
+    if (is_and and !merge_ranges(out, children))
+        return constant(out, false);
+    if (children.empty())
+        return constant(out, is_and);
+    if (1 == children.size())
+        return children[0];
+
+    // 按代价和选择率排序，让最可能决定结果的便宜的子条件先求，后面的少求一些行:
+    // and按 代价/(1-选择率) 从小到大，or按 代价/选择率 从小到大，子条件相互独立的时候这个顺序的期望代价最小
+    auto rank = [&](int i) {
+        const Node& child = out.node(i);
+        double decisive = is_and ? 1 - child.m_selectivity : child.m_selectivity;
+        return child.m_cost / std::max(decisive, 1e-9);
+    };
+    std::stable_sort(children.begin(), children.end(), [&](int a, int b) { return rank(a) < rank(b); });
+
+    double selectivity = 1, cost = 0;
+    for (int child : children) {
+        const Node& compiled = out.node(child);
+        selectivity *= is_and ? compiled.m_selectivity : 1 - compiled.m_selectivity;
+        cost += compiled.m_cost;
+    }
+    int result = out.add(kind, -1, std::move(children));
+    out.m_nodes[result].m_selectivity = is_and ? selectivity : 1 - selectivity;
+    out.m_nodes[result].m_cost = cost;
+    return result;
+}
+
+/**
+ * @brief 从第i个结点开始逐行求值
+ */
+bool match_node(const Table& table, size_t row, const Tree& tree, int i) {
+    const Node& node = tree.node(i);
+    switch (node.m_kind) {
+    case Where_Expr::Cond:
+        return Where::match(table, row, tree.cond(node));
+    case Where_Expr::And:
+        for (int child : node.m_children)
+            if (!match_node(table, row, tree, child))
+                return false;
+        return true;
+    case Where_Expr::Or:
+        for (int child : node.m_children)
+            if (match_node(table, row, tree, child))
+                return true;
+        return false;
+    case Where_Expr::Not:
+        return !match_node(table, row, tree, node.m_children[0]);
+    case Where_Expr::True:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief 谓词能不能用索引找行
+ */
+bool can_use_index(const Table& table, const Where_Cond& cond) {
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+    case Where_Cond::In:
+        return Table_Index::has_index(table, cond.m_column_index);
+    case Where_Cond::Like:
+        return !cond.m_is_int and Table_Index::has_btree(table, cond.m_column_index);
+    case Where_Cond::Not_Equal:
+    case Where_Cond::Is_Null:
+        return false;
+    default:
+        return Table_Index::has_btree(table, cond.m_column_index);
+    }
+}
+
+/**
+ * @brief 用索引找到满足谓词的所有版本，结果按谓词的列有序，需要先用can_use_index确认
+ */
+void index_rows(const Table& table, const Where_Cond& cond, std::vector<size_t>& rows) {
+    int column = cond.m_column_index;
+    rows.clear();
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+        Table_Index::lookup(table, column, cond.m_value, rows);
+        break;
+    case Where_Cond::In: {
+        // 值已经排好序，按顺序一个一个找，拼起来也按列有序
+        std::vector<size_t> found;
+        for (const std::string& value : cond.m_values) {
+            Table_Index::lookup(table, column, value, found);
+            rows.insert(rows.end(), found.begin(), found.end());
+        }
+        break;
+    }
+    case Where_Cond::Less:
+        Table_Index::range(table, column, nullptr, true, &cond.m_value, false, rows);
+        break;
+    case Where_Cond::Less_Equal:
+        Table_Index::range(table, column, nullptr, true, &cond.m_value, true, rows);
+        break;
+    case Where_Cond::Greater:
+        Table_Index::range(table, column, &cond.m_value, false, nullptr, true, rows);
+        break;
+    case Where_Cond::Greater_Equal:
+        Table_Index::range(table, column, &cond.m_value, true, nullptr, true, rows);
+        break;
+    case Where_Cond::Between:
+        Table_Index::range(table, column, &cond.m_value, true, &cond.m_high, true, rows);
+        break;
+    case Where_Cond::Like:
+        Table_Index::prefix(table, column, cond.m_value, rows);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief 用哪个谓词结点的索引找候选行: 根结点本身，或者and中排在最前面(最有选择性)的可以用索引的子条件
+ * @return int，结点的下标，没有的时候返回-1
+ */
+int index_node(const Table& table, const Tree& tree) {
+    const Node& root = tree.root();
+    if (Where_Expr::Cond == root.m_kind)
+        return can_use_index(table, tree.cond(root)) ? tree.m_root : -1;
+    if (Where_Expr::And == root.m_kind)
+        for (int child : root.m_children)
+            if (Where_Expr::Cond == tree.node(child).m_kind and can_use_index(table, tree.cond(tree.node(child))))
+                return child;
+    return -1;
+}
+
+/**
+ * @brief or的每一支是不是都是可以用索引的谓词
+ */
+bool index_union(const Table& table, const Tree& tree) {
+    const Node& root = tree.root();
+    if (Where_Expr::Or != root.m_kind)
+        return false;
+    for (int child : root.m_children)
+        if (Where_Expr::Cond != tree.node(child).m_kind or !can_use_index(table, tree.cond(tree.node(child))))
+            return false;
+    return true;
+}
+
+/**
+ * @brief 把一个谓词写回成文本，negated的时候是前面有not的between、like、in和is null
+ */
+std::string cond_text(const Where_Cond& cond, bool negated = false) {
+    std::string not_word = negated ? "not " : "";
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+        return cond.m_column + " = " + cond.m_value;
+    case Where_Cond::Not_Equal:
+        return cond.m_column + " != " + cond.m_value;
+    case Where_Cond::Less:
+        return cond.m_column + " < " + cond.m_value;
+    case Where_Cond::Less_Equal:
+        return cond.m_column + " <= " + cond.m_value;
+    case Where_Cond::Greater:
+        return cond.m_column + " > " + cond.m_value;
+    case Where_Cond::Greater_Equal:
+        return cond.m_column + " >= " + cond.m_value;
+    case Where_Cond::Between:
+        return cond.m_column + " " + not_word + "between " + cond.m_value + " and " + cond.m_high;
+    case Where_Cond::Like:
+        return cond.m_column + " " + not_word + "like " + cond.m_value + "%";
+    case Where_Cond::In: {
+        std::string text = cond.m_column + " " + not_word + "in (";
+        for (size_t i = 0; i < cond.m_values.size(); ++i)
+            text += (0 == i ? "" : ", ") + cond.m_values[i];
+        return text + ")";
+    }
+    case Where_Cond::Is_Null:
+        return cond.m_column + " is " + not_word + "null";
+    }
+    return cond.m_column;
+}
+
+/**
+ * @brief 把第i个结点写回成文本，and下面的or、not下面的and/or加上括号
+ */
+std::string node_text(const Tree& tree, int i) {
+    const Node& node = tree.node(i);
+    switch (node.m_kind) {
+    case Where_Expr::Cond:
+        return cond_text(tree.cond(node));
+    case Where_Expr::True:
+        return "true";
+    case Where_Expr::False:
+        return "false";
+    case Where_Expr::Not: {
+        int child = node.m_children[0];
+        Where_Expr::Kind kind = tree.node(child).m_kind;
+        if (Where_Expr::Cond == kind) {
+            const Where_Cond& cond = tree.cond(tree.node(child));
+            if (Where_Cond::Between == cond.m_op or Where_Cond::Like == cond.m_op or Where_Cond::In == cond.m_op or
+                Where_Cond::Is_Null == cond.m_op)
+                return cond_text(cond, true);
+        }
+        bool paren = Where_Expr::And == kind or Where_Expr::Or == kind;
+        return "not " + (paren ? "(" + node_text(tree, child) + ")" : node_text(tree, child));
+    }
+    default:
+        break;
+    }
+    std::string text;
+    for (int child : node.m_children) {
+        if (!text.empty())
+            text += Where_Expr::And == node.m_kind ? " and " : " or ";
+        bool paren = Where_Expr::And == node.m_kind and Where_Expr::Or == tree.node(child).m_kind;
+        text += paren ? "(" + node_text(tree, child) + ")" : node_text(tree, child);
+    }
+    return text;
+}
+
+}  // namespace
+
+bool Where::bind(const Table& table, Where_Expr& expr) {
+    // 谓词按原来的下标拷贝一份再bind，编译的时候新合成的谓词追加在后面
+    Tree& out = expr.m_compiled;
+    out = Tree();
+    out.m_conds = expr.m_parsed.m_conds;
+    for (Where_Cond& cond : out.m_conds)
+        if (!bind_cond(table, cond))
+            return false;
+    out.m_root = compile(expr.m_parsed, expr.m_parsed.m_root, out);
+    return true;
+}
+
+bool Where::match(const Table& table, size_t row, const Where_Expr& expr) {
+    const Tree& tree = expr.m_compiled;
+    return match_node(table, row, tree, tree.m_root);
+}
+
+bool Where::match(const Table& table, size_t row, const Where_Cond& cond) {
+    const Column_Data& data = table.m_data[cond.m_column_index];
+    if (cond.m_is_int) {
+        int64_t value = data.m_ints[row];
+        switch (cond.m_op) {
+        case Where_Cond::Not_Equal:
+            return value != cond.m_int_value;
+        case Where_Cond::In:
+            return std::binary_search(cond.m_int_values.begin(), cond.m_int_values.end(), value);
+        case Where_Cond::Is_Null:
+            return false;
+        default:
+            int64_t low, high;
+            return int_range(cond, low, high) and value >= low and value <= high;
+        }
+    }
+
+    std::string_view value = data.m_strings[row];
+    switch (cond.m_op) {
+    case Where_Cond::Between:
+        return value >= cond.m_value and value <= cond.m_high;
+    case Where_Cond::Like:
+        return 0 == value.compare(0, cond.m_value.size(), cond.m_value);
+    case Where_Cond::In:
+        return std::binary_search(cond.m_values.begin(), cond.m_values.end(), value);
+    case Where_Cond::Is_Null:
+        return false;
+    default:
+        return satisfy(cond.m_op, value.compare(cond.m_value));
+    }
+}
+
+bool Where::int_range(const Where_Cond& cond, int64_t& low, int64_t& high) {
+    int64_t value = cond.m_int_value;
+    low = INT64_MIN;
+    high = INT64_MAX;
+    switch (cond.m_op) {
+    case Where_Cond::Equal:
+        low = high = value;
+        break;
+    case Where_Cond::Less:
+        if (INT64_MIN == value)
+            return false;
+        high = value - 1;
+        break;
+    case Where_Cond::Less_Equal:
+        high = value;
+        break;
+    case Where_Cond::Greater:
+        if (INT64_MAX == value)
+            return false;
+        low = value + 1;
+        break;
+    case Where_Cond::Greater_Equal:
+        low = value;
+        break;
+    case Where_Cond::Between:
+        low = value;
+        high = cond.m_int_high;
+        break;
+    default:
+        return false;
+    }
+    return low <= high;
+}
+
+bool Where::find_rows(const Table& table, const Where_Expr& expr, const Snapshot& snapshot, std::vector<size_t>& rows) {
+    rows.clear();
+    const Tree& tree = expr.m_compiled;
+    if (Where_Expr::False == tree.root().m_kind)
+        return false;
+
+    // 先用一个谓词的索引找到候选行，索引中有所有的版本，快照看不到的去掉，and的时候再求整个条件
+    int node = index_node(table, tree);
+    if (-1 != node) {
+        index_rows(table, tree.cond(tree.node(node)), rows);
+        bool is_root = node == tree.m_root;
+        std::erase_if(rows, [&](size_t i) { return !table.visible(i, snapshot) or (!is_root and !match(table, i, expr)); });
+        return true;
+    }
+
+    // or的每一支都有索引，各自找出来再合并去重
+    if (index_union(table, tree)) {
+        std::vector<size_t> found;
+        for (int child : tree.root().m_children) {
+            index_rows(table, tree.cond(tree.node(child)), found);
+            rows.insert(rows.end(), found.begin(), found.end());
+        }
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+        std::erase_if(rows, [&](size_t i) { return !table.visible(i, snapshot); });
+        return false;
+    }
+
+    // 没有合适的索引，按块全表扫描
+    Batch_Filter::filter(table, expr, snapshot, rows);
+    return false;
+}
+
+bool Where::uses_index(const Table& table, const Where_Expr& expr) {
+    return -1 != index_node(table, expr.m_compiled) or index_union(table, expr.m_compiled);
+}
+
+int Where::index_column(const Table& table, const Where_Expr& expr) {
+    const Tree& tree = expr.m_compiled;
+    int node = index_node(table, tree);
+    return -1 == node ? -1 : tree.cond(tree.node(node)).m_column_index;
+}
+
+std::string Where::text(const Where_Expr& expr) {
+    return node_text(expr.m_parsed, expr.m_parsed.m_root);
+}
+
+int Where::compare(const Table& table, size_t a, size_t b, int column) {
+    const Column_Data& data = table.m_data[column];
+    if (table.is_int(column))
+        return three_way(data.m_ints[a], data.m_ints[b]);
+    return data.m_strings[a].compare(data.m_strings[b]);
+}
@@ -14,8 +14,111 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "client_menu.h"
+#include "protocol.h"
+
+/**
+ * @brief 把数据全部发送出去
+ * @return bool，出错的时候返回false
+ */
+static bool send_all(int connect_fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int len = send(connect_fd, data.data() + sent, data.size() - sent, 0);
+        if (-1 == len) {
+            if (EINTR == errno)
+                continue;
+            perror("send");
+            return false;
+        }
+        sent += len;
+    }
+    return true;
+}
+
+/**
+ * @brief 读到下一个完整的帧为止，读之前先把上一个帧从接收缓冲区中去掉
+ * @param  connect_fd，连接
+ * @param  recv_buf，接收缓冲区
+ * @param  frame，上一个帧，读到之后换成下一个帧，负载指向recv_buf
+ * @return int，1表示读到了，0表示服务端关闭了，-1表示出错
+ */
+static int read_frame(int connect_fd, std::string& recv_buf, Protocol::Frame& frame) {
+    recv_buf.erase(0, frame.m_payload.data() ? frame.size() : 0);
+    frame = Protocol::Frame();
+
+    char read_buf[BUFSIZ];
+    while (1) {
+        int ret = Protocol::parse_frame(recv_buf, frame);
+        if (1 == ret)
+            return 1;
+        if (-1 == ret) {
+            std::cout << "服务端发送的数据格式不对..." << std::endl;
+            return -1;
+        }
+
+        int len = recv(connect_fd, read_buf, BUFSIZ, 0);
+        if (-1 == len) {
+            if (EINTR == errno)
+                continue;
+            perror("recv");
+            return -1;
+        }
+        if (0 == len)
+            return 0;
+        recv_buf.append(read_buf, len);
+    }
+}
+
+/**
+ * @brief 显示一条命令的回复，按以前的文本格式，一直到它的Status帧为止
+ * @param  connect_fd，连接
+ * @param  recv_buf，接收缓冲区
+ * @param  frame，上一个帧
+ * @return int，回复的状态码，服务端关闭或者出错的时候返回-1
+ */
+static int show_response(int connect_fd, std::string& recv_buf, Protocol::Frame& frame) {
+    std::vector<Protocol::Column_Type> types;
+    std::cout << std::endl;
+    while (1) {
+        int ret = read_frame(connect_fd, recv_buf, frame);
+        if (0 == ret)
+            std::cout << "服务端关闭了..." << std::endl;
+        if (1 != ret)
+            return -1;
+
+        std::string_view payload = frame.m_payload;
+        bool ok = true;
+        switch (frame.m_type) {
+        case Protocol::Text:
+            std::cout << payload;
+            break;
+        case Protocol::Schema:
+            ok = Protocol::render_schema(payload, types, std::cout);
+            break;
+        case Protocol::Rows:
+            ok = Protocol::render_rows(payload, types, std::cout);
+            break;
+        case Protocol::Status:
+            if (payload.empty()) {
+                ok = false;
+                break;
+            }
+            std::cout << payload.substr(1);
+            if (Protocol::Bye != payload[0])
+                std::cout << std::endl;
+            return static_cast<uint8_t>(payload[0]);
+        default:
+            break;
+        }
+        if (!ok) {
+            std::cout << "服务端发送的数据格式不对..." << std::endl;
+            return -1;
+        }
+    }
+}
 
 int main(int argc, char* const argv[]) {
     // 判断命令行参数
@@ -55,34 +158,42 @@ int main(int argc, char* const argv[]) {
     std::cout << "连接服务端成功!" << std::endl
               << std::endl;
 
-    // 3.开始通信
-    char read_buf[BUFSIZ] = {0};
-    while (1) {
-        std::string send_commamd = menu.run();
-        // std::cout << send_commamd << std::endl;
+    // 3.开始通信，每条命令按帧发送，请求号从1开始编
+    std::string recv_buf;
+    Protocol::Frame frame;
+    uint32_t request_id = 0;
+    if (isatty(STDIN_FILENO)) {
+        // 在终端中交互，发送一条显示一条
+        while (1) {
+            std::string send_commamd = menu.run();
+            if (menu.eof() and send_commamd.empty())
+                break;
 
-        // 发送命令
-        send(connect_fd, send_commamd.c_str(), send_commamd.size(), 0);
+            std::string send_buf;
+            Protocol::append_frame(send_buf, Protocol::Query, ++request_id, send_commamd);
+            if (!send_all(connect_fd, send_buf))
+                return -1;
 
-        // 需要接收服务端发送回来的反馈
-        bzero(read_buf, BUFSIZ);  // 这里千万忘了不要忘了清空，否则如果上一条是长命令，后面一条是短命令的话会导致长命令的后半段不能被清除掉
-        int len = recv(connect_fd, read_buf, BUFSIZ - 1, 0);
-        if (-1 == len) {
-            perror("recv");
-            return -1;
-        }
-        if (0 == len) {
-            std::cout << "服务端关闭了..." << std::endl;
-            break;
-        } else if (len > 0) {
-            std::cout << std::endl
-                      << read_buf;
-            // 判断得简单粗暴一点，如果是退出信息，服务端前五个字符是 "Thanks"
-            // 注意，中文字符在char数组当中一个中文字符没办法用一个字节表示，所以我们不知道中文字符占了几个字节，所以我加上了英文前缀!
-            if ("Thanks" == std::string(read_buf).substr(0, 6))
+            // 服务端回复了Bye表示是退出命令
+            int status = show_response(connect_fd, recv_buf, frame);
+            if (-1 == status or Protocol::Bye == status)
                 break;
+        }
+    } else {
+        // 标准输入是文件或者管道的时候批量执行: 所有命令一次性发出去，不用每条都等一个来回，然后按顺序显示回复
+        std::string send_buf;
+        while (!menu.eof()) {
+            std::string send_commamd = menu.read_command();
+            if (!send_commamd.empty())
+                Protocol::append_frame(send_buf, Protocol::Query, ++request_id, send_commamd);
+        }
+        if (!send_all(connect_fd, send_buf))
+            return -1;
 
-            std::cout << std::endl;
+        for (uint32_t i = 0; i < request_id; ++i) {
+            int status = show_response(connect_fd, recv_buf, frame);
+            if (-1 == status or Protocol::Bye == status)
+                break;
         }
     }
 
@@ -0,0 +1,124 @@
+/**
+ * @file hash_aggregate_test.cpp
+ * @brief 哈希聚合的测试，重点是没有要聚合的行的时候的结果和分组多到写磁盘的时候的合并
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include <iostream>
+#include <string>
+
+#include "hash_aggregate.h"
+#include "server_table.h"
+#include "sql_parser.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * @brief 解析并执行一条聚合语句，命令字符串要活到结果用完
+ */
+bool aggregate(const Table& table, const std::string& command, Table& result, std::string& error) {
+    Sql_Parser parser;
+    Statement statement;
+    if (!parser.parse(command, statement)) {
+        error = parser.error();
+        return false;
+    }
+    return Hash_Aggregate::run(table, statement, result, error);
+}
+
+Table make_table() {
+    Table table;
+    table.m_table_name = "t";
+    table.m_columns.emplace_back("id", "int");
+    table.m_columns.emplace_back("s", "string");
+    table.m_data.resize(table.m_columns.size());
+    table.append_row({"1", "b"});
+    table.append_row({"2", "c"});
+    table.append_row({"3", "a"});
+    return table;
+}
+
+}  // namespace
+
+int main() {
+    Table table = make_table();
+    Table result;
+    std::string error;
+
+    // 没有group by，where一行都不满足: 还是有一行，count和sum是0，min、max和avg是null
+    std::string empty = "select count(*), sum(id), min(id), max(s), avg(id) from t where id > 100";
+    check(aggregate(table, empty, result, error), "empty aggregate: " + error);
+    check(1 == result.m_row_count, "empty aggregate has one row");
+    if (1 == result.m_row_count) {
+        check("0" == result.cell(0, 0), "count(*) is 0");
+        check("0" == result.cell(0, 1), "sum(id) is 0");
+        check("null" == result.cell(0, 2), "min(id) is null");
+        check("null" == result.cell(0, 3), "max(s) is null");
+        check("null" == result.cell(0, 4), "avg(id) is null");
+    }
+
+    // 只有min的时候也一样
+    std::string only_min = "select min(id) from t where id > 100";
+    check(aggregate(table, only_min, result, error), "only min: " + error);
+    check(1 == result.m_row_count and "null" == result.cell(0, 0), "only min is null");
+
+    // 有group by的时候没有行就没有分组
+    std::string grouped = "select s, min(id) from t where id > 100 group by s";
+    check(aggregate(table, grouped, result, error), "grouped: " + error);
+    check(0 == result.m_row_count, "empty grouped aggregate has no row");
+
+    // 有行的时候min和max是真正的值
+    std::string some = "select count(*), min(id), max(s) from t where id > 1";
+    check(aggregate(table, some, result, error), "some rows: " + error);
+    check(1 == result.m_row_count, "some rows has one row");
+    if (1 == result.m_row_count) {
+        check("2" == result.cell(0, 0), "count(*) is 2");
+        check("2" == result.cell(0, 1), "min(id) is 2");
+        check("c" == result.cell(0, 2), "max(s) is c");
+    }
+
+    // where中的列不存在的时候报错
+    std::string bad = "select count(*) from t where nope = 1";
+    check(!aggregate(table, bad, result, error), "bad where is rejected");
+
+    // 线程池中做部分聚合，内存上限很小，分组多到一个分区合并的时候还要再分区
+    Thread_Pool pool(4);
+    Hash_Aggregate::set_thread_pool(&pool);
+    Hash_Aggregate::set_memory_limit(1);
+    Table many;
+    many.m_table_name = "many";
+    many.m_columns.emplace_back("id", "int");
+    many.m_columns.emplace_back("k", "int");
+    many.m_data.resize(many.m_columns.size());
+    const size_t groups = 300000;
+    for (size_t i = 0; i < 2 * groups; ++i)
+        many.append_row({std::to_string(i), std::to_string(i % groups)});
+    std::string spill = "select k, count(*), sum(id) from many group by k";
+    check(aggregate(many, spill, result, error), "spilled: " + error);
+    check(groups == result.m_row_count, "spilled aggregate has every group");
+    bool all_right = true;
+    for (size_t i = 0; i < result.m_row_count and all_right; ++i)
+        all_right = std::to_string(i) == result.cell(i, 0) and "2" == result.cell(i, 1) and
+                    std::to_string(2 * i + groups) == result.cell(i, 2);
+    check(all_right, "spilled aggregate merges every group once");
+    Hash_Aggregate::set_thread_pool(nullptr);
+    Hash_Aggregate::set_memory_limit(Hash_Aggregate::default_memory_limit);
+
+    if (0 == failures)
+        std::cout << "hash_aggregate_test: ok" << std::endl;
+    return 0 == failures ? 0 : 1;
+}
@@ -11,13 +11,34 @@
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <cstring>
 #include <iostream>
-
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "batch_filter.h"
+#include "btree_index.h"
+#include "csv_loader.h"
+#include "cursor.h"
+#include "hash_aggregate.h"
+#include "hash_join.h"
+#include "protocol.h"
+#include "row_sorter.h"
 #include "server_order.h"
+#include "thread_pool.h"
 
 /**
  * @brief 定义ipv4地址的char*字符串最大长度
@@ -25,10 +46,25 @@
 #define Max_ipv4_len 16
 
 /**
- * @brief 定义epoll能检测的最大事件个数max_events
+ * @brief 定义一次epoll_wait最多取回的事件个数max_events，连接数不受它限制
  */
 #define max_events 1000
 
+/**
+ * @brief 定义空闲多久(毫秒)之后做一次检查点，把表缓存中的脏表写回磁盘
+ */
+#define flush_interval_ms 1000
+
+/**
+ * @brief 收到SIGINT或者SIGTERM之后置1，主循环退出之前把脏表写回
+ */
+static volatile sig_atomic_t stop_flag = 0;
+
+/**
+ * @brief 信号处理函数，只设置标志，真正的收尾工作在主循环里面做
+ */
+static void on_stop_signal(int) { stop_flag = 1; }
+
 /**
  * @brief 拿一个结构体来存储连接的客户端信息
  */
@@ -44,6 +80,15 @@ struct Client_Info {
     void clear() {
         ip.clear();
         port = -1;
+        in_buf.clear();
+        out_buf.clear();
+        closing = false;
+        peer_closed = false;
+        events = EPOLLIN;
+        stream = Result_Stream();
+        stream_id = 0;
+        session.reset();
+        busy = false;
     }
 
     /**
@@ -55,17 +100,341 @@ struct Client_Info {
      * @brief 客户端的端口，为了让没开的端口设置为-1，我这里用的类型是-1，当然正常使用的时候会隐式转换为unsigned short，没有区别
      */
     int port;
+
+    /**
+     * @brief 接收缓冲区，收到的数据先放在这里，凑够一个完整的帧再执行
+     */
+    std::string in_buf;
+
+    /**
+     * @brief 发送缓冲区，一次没有发完的回复留在这里，等可写的时候接着发
+     */
+    std::string out_buf;
+
+    /**
+     * @brief 客户端发送了quit，回复发完之后就关闭连接
+     */
+    bool closing;
+
+    /**
+     * @brief 客户端已经关闭了，收到的命令执行完、回复发完之后就关闭连接
+     */
+    bool peer_closed;
+
+    /**
+     * @brief 当前在epoll中监听的事件
+     */
+    uint32_t events;
+
+    /**
+     * @brief 还没有读完的select结果集和它的请求号
+     */
+    Result_Stream stream;
+    uint32_t stream_id;
+
+    /**
+     * @brief 这个连接的会话，当前数据库、预备语句和游标都在里面
+     * @brief 执行中的任务也持有它，连接关闭之后等任务结束才释放
+     */
+    std::shared_ptr<Order> session;
+
+    /**
+     * @brief 连接的编号，每次accept都不一样，文件描述符被复用的时候用来认出已经关闭的连接的任务
+     */
+    uint64_t generation = 0;
+
+    /**
+     * @brief 是否有命令正在工作线程中执行，同一个连接的命令一条一条执行，回复的顺序和命令的顺序一样
+     */
+    bool busy;
 };
 
-int main() {
-    // 创建存储客户端信息的结构体
-    struct Client_Info cli_infos[max_events + 10];  // 0 1 2文件描述符被占用，从3开始，用文件描述符当作下标，多开10个有备无患
+/**
+ * @brief 工作线程执行完一个任务之后交回给epoll线程的结果
+ */
+struct Completion {
+    /**
+     * @brief 连接的文件描述符和编号
+     */
+    int fd;
+    uint64_t generation;
+
+    /**
+     * @brief 编码好的回复帧
+     */
+    std::string frames;
+
+    /**
+     * @brief 还没有读完的结果集和它的请求号
+     */
+    Result_Stream stream;
+    uint32_t stream_id = 0;
+
+    /**
+     * @brief 客户端要退出了
+     */
+    bool bye = false;
+};
+
+/**
+ * @brief 一个反应堆: 自己的监听socket(SO_REUSEPORT，内核把新连接分到各个反应堆)、epoll实例和连接表，
+ *        在自己的线程中收发数据，命令交给所有反应堆共用的工作线程池执行
+ */
+struct Reactor {
+    /**
+     * @brief 反应堆的编号，从0开始
+     */
+    int id = 0;
+
+    /**
+     * @brief 监听socket、epoll实例，以及工作线程执行完任务之后唤醒epoll_wait的eventfd
+     */
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int event_fd = -1;
+
+    /**
+     * @brief 执行完的任务放在这里，写event_fd通知反应堆来取
+     */
+    std::mutex completion_mutex;
+    std::vector<Completion> completions;
+
+    /**
+     * @brief 连接表，文件描述符作键，大小跟着连接数走，关闭的连接直接删掉
+     */
+    std::unordered_map<int, Client_Info> clients;
+
+    /**
+     * @brief 运行这个反应堆的线程，0号反应堆在主线程中运行
+     */
+    std::thread thread;
+};
+
+/**
+ * @brief 连接的编号，所有反应堆共用，每次accept加一
+ */
+static std::atomic<uint64_t> next_generation = 0;
+
+/**
+ * @brief 最近一次有事件的时间(毫秒)，所有反应堆都空闲超过flush_interval_ms的时候才做检查点
+ */
+static std::atomic<int64_t> last_active_ms = 0;
+
+/**
+ * @brief 多个反应堆同时输出日志，一行一行地加锁输出，不让它们交错
+ */
+static std::mutex log_mutex;
+
+/**
+ * @brief 输出一行和客户端有关的日志
+ */
+static void log_client(const Client_Info& info, std::string_view what) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    std::cout << "client (ip: " << info.ip << " , "
+              << "port: " << info.port << ") " << what << std::endl;
+}
+
+/**
+ * @brief 当前时间，单位毫秒
+ */
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 唤醒反应堆的epoll_wait
+ */
+static void wake(Reactor& reactor) {
+    uint64_t one = 1;
+    if (-1 == write(reactor.event_fd, &one, sizeof(one)))
+        perror("write");
+}
+
+/**
+ * @brief 工作线程调用，把结果交回给连接所在的反应堆
+ */
+static void post_completion(Reactor& reactor, Completion&& done) {
+    {
+        std::lock_guard<std::mutex> lock(reactor.completion_mutex);
+        reactor.completions.push_back(std::move(done));
+    }
+    wake(reactor);
+}
+
+/**
+ * @brief 把连接上现在能读到的数据都读进接收缓冲区
+ * @return int，1表示读完了，0表示客户端关闭了，-1表示出错
+ */
+static int recv_all(int connect_fd, std::string& in_buf) {
+    char read_buf[BUFSIZ];
+    while (1) {
+        int len = recv(connect_fd, read_buf, BUFSIZ, 0);
+        if (len > 0) {
+            in_buf.append(read_buf, len);
+            continue;
+        }
+        if (0 == len)
+            return 0;
+        // 非阻塞的时候EAGAIN表示当前暂时没有数据可读了，EINTR表示被信号打断了，重新读
+        if (EINTR == errno)
+            continue;
+        return EAGAIN == errno or EWOULDBLOCK == errno ? 1 : -1;
+    }
+}
+
+/**
+ * @brief 尽量把发送缓冲区中的数据发出去，发不完的留着
+ * @return bool，出错的时候返回false
+ */
+static bool send_all(int connect_fd, std::string& out_buf) {
+    size_t sent = 0;
+    while (sent < out_buf.size()) {
+        int len = send(connect_fd, out_buf.data() + sent, out_buf.size() - sent, MSG_NOSIGNAL);
+        if (len >= 0) {
+            sent += len;
+            continue;
+        }
+        if (EINTR == errno)
+            continue;
+        if (EAGAIN != errno and EWOULDBLOCK != errno)
+            return false;
+        break;
+    }
+    out_buf.erase(0, sent);
+    return true;
+}
+
+/**
+ * @brief 尽量把回复发送出去，然后把下一条命令交给工作线程，回复在任务完成之后再追加到发送缓冲区
+ * @brief 客户端可以不等回复连续发送多条命令，同一个连接的命令一条一条执行；select的结果按批次读，
+ *        发送缓冲区中积压了一个批次以上的时候就停下来，等可写的时候再接着读，这样一个连接占用的内存和结果的大小无关
+ * @return bool，收到坏的帧或者发送出错的时候返回false，需要关闭连接
+ */
+static bool serve(Reactor& reactor, Thread_Pool& pool, int connect_fd, Client_Info& info) {
+    std::string_view buf = info.in_buf;
+    size_t used = 0;
+    bool ok = true;
+    while (1) {
+        if (!send_all(connect_fd, info.out_buf)) {
+            perror("send");
+            ok = false;
+            break;
+        }
+        if (info.busy or info.out_buf.size() >= Protocol::batch_bytes)
+            break;
+
+        // 上一条命令的结果还没有读完，先接着读，后面的命令要等它发完
+        if (info.stream.pending()) {
+            info.busy = true;
+            pool.submit([&reactor, session = info.session, stream = std::move(info.stream), id = info.stream_id, connect_fd,
+                         generation = info.generation]() mutable {
+                Completion done{connect_fd, generation};
+                session->resume(stream);
+                session->get_feedback().write_frames(id, done.frames);
+                done.stream = std::move(stream);
+                done.stream_id = id;
+                post_completion(reactor, std::move(done));
+            });
+            info.stream = Result_Stream();
+            break;
+        }
+        if (info.closing)
+            break;
+
+        Protocol::Frame frame;
+        int ret = Protocol::parse_frame(buf.substr(used), frame);
+        if (0 == ret)
+            break;
+        if (-1 == ret) {
+            ok = false;
+            break;
+        }
+        used += frame.size();
+
+        if (Protocol::Query != frame.m_type) {
+            std::string payload(1, static_cast<char>(Protocol::Error));
+            payload += "未知的帧类型,请检查客户端!\n";
+            Protocol::append_frame(info.out_buf, Protocol::Status, frame.m_id, payload);
+            continue;
+        }
+
+        log_client(info, "send: " + std::string(frame.m_payload));
+
+        // 处理该命令，会话把输出都写在内存中，编码成帧之后交回来
+        info.busy = true;
+        pool.submit([&reactor, session = info.session, command = std::string(frame.m_payload), id = frame.m_id, connect_fd,
+                     generation = info.generation]() {
+            Completion done{connect_fd, generation};
+            session->set_command(command);
+            session->run();
+
+            const Result_Sink& feedback = session->get_feedback();
+            feedback.write_frames(id, done.frames);
+            if (session->has_stream()) {
+                done.stream = session->take_stream();
+                done.stream_id = id;
+            }
+            done.bye = Protocol::Bye == feedback.status();
+            post_completion(reactor, std::move(done));
+        });
+        break;
+    }
+    info.in_buf.erase(0, used);
+    return ok;
+}
+
+/**
+ * @brief 连接上有事件或者有任务完成之后调用: 接着执行命令、发送回复，该关闭的时候关闭，然后更新监听的事件
+ * @param  alive，连接是否还正常，为false的时候直接关闭
+ * @return bool，epoll_ctl出错的时候返回false
+ * @note   关闭的连接会从连接表中删掉，info在这之后就不能再用了
+ */
+static bool update_client(Reactor& reactor, Thread_Pool& pool, int connect_fd, Client_Info& info, bool alive) {
+    // 执行完整的帧并且发送回复，发不完的时候等可写事件接着发
+    if (alive)
+        alive = serve(reactor, pool, connect_fd, info);
+    // 客户端退出或者关闭之后，等正在执行的命令结束、回复发完再关
+    if (alive and (info.closing or info.peer_closed) and !info.busy and info.out_buf.empty() and !info.stream.pending())
+        alive = false;
+
+    if (!alive) {  // 客户端关闭或者退出
+        // 从监听事件中删除
+        if (-1 == epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, connect_fd, nullptr)) {
+            perror("epoll_ctl");
+            return false;
+        }
 
-    // 实例化Order对象
-    Order order;
+        log_client(info, "has closed.");
+        // 关闭文件描述符，还在执行的任务完成之后在连接表中找不到或者按连接编号认出来丢掉
+        close(connect_fd);
+        reactor.clients.erase(connect_fd);
+        return true;
+    }
 
-    // 1.创建socket套接字
-    int listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    // 发送缓冲区中还有数据的时候才关心可写事件，否则每次epoll_wait都会立刻返回
+    // 客户端关闭之后就不再关心可读事件，否则它会一直触发
+    uint32_t events = (info.peer_closed ? 0 : EPOLLIN) | (info.out_buf.empty() ? 0 : EPOLLOUT);
+    if (events != info.events) {
+        struct epoll_event connect_event;
+        connect_event.data.fd = connect_fd;
+        connect_event.events = events;
+        if (-1 == epoll_ctl(reactor.epoll_fd, EPOLL_CTL_MOD, connect_fd, &connect_event)) {
+            perror("epoll_ctl");
+            return false;
+        }
+        info.events = events;
+    }
+    return true;
+}
+
+/**
+ * @brief 创建一个反应堆的监听socket，每个反应堆都设置SO_REUSEPORT绑定同一个端口，内核按四元组把新连接分给它们
+ * @param  backlog，listen的全连接队列长度，实际还受/proc/sys/net/core/somaxconn限制
+ * @return int，监听socket，出错的时候返回-1
+ */
+static int open_listener(unsigned short port, int backlog) {
+    // 1.创建socket套接字，非阻塞，一次可写事件中把排队的连接都accept掉
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
     if (-1 == listen_fd) {
         perror("socket");
         return -1;
@@ -75,172 +444,344 @@ int main() {
     int optval = 1;
     int ret = setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
     if (-1 == ret) {
-        perror("bind");
+        perror("setsockopt");
+        close(listen_fd);
         return -1;
     }
 
     // 2.绑定IP和端口
     struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
     // 地址族
     server_addr.sin_family = AF_INET;
     // IP
     server_addr.sin_addr.s_addr = INADDR_ANY;
     // 端口
-    server_addr.sin_port = htons(8080);
+    server_addr.sin_port = htons(port);
 
     ret = bind(listen_fd, (struct sockaddr*)&server_addr, sizeof(server_addr));
     if (-1 == ret) {
         perror("bind");
+        close(listen_fd);
         return -1;
     }
 
-    std::cout << "server has successfully initialized." << std::endl;
-
-    //********************从这里开始，修改成为epoll架构********************
-
     // 3.开始监听
-    ret = listen(listen_fd, 8);
+    ret = listen(listen_fd, backlog);
     if (-1 == ret) {
         perror("listen");
+        close(listen_fd);
         return -1;
     }
+    return listen_fd;
+}
+
+/**
+ * @brief 创建反应堆的监听socket、epoll实例和eventfd，并且把监听socket和eventfd加入epoll
+ * @return bool，出错的时候返回false
+ */
+static bool open_reactor(Reactor& reactor, unsigned short port, int backlog) {
+    reactor.listen_fd = open_listener(port, backlog);
+    if (-1 == reactor.listen_fd)
+        return false;
 
     // 创建epoll实例
-    int epoll_fd = epoll_create(1);
-    if (-1 == epoll_fd) {
+    reactor.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == reactor.epoll_fd) {
         perror("epoll_create");
-        return -1;
+        return false;
     }
 
-    // 将listen_fd加入epoll监听事件中
-    struct epoll_event listen_event;
-    listen_event.data.fd = listen_fd;
-    listen_event.events = EPOLLIN;
+    // 工作线程执行完任务之后写event_fd，唤醒反应堆来取结果；退出的时候也用它唤醒
+    reactor.event_fd = eventfd(0, EFD_NONBLOCK);
+    if (-1 == reactor.event_fd) {
+        perror("eventfd");
+        return false;
+    }
 
-    ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event);
-    if (-1 == ret) {
-        perror("epoll_ctl");
-        return -1;
+    for (int fd : {reactor.listen_fd, reactor.event_fd}) {
+        struct epoll_event event;
+        event.data.fd = fd;
+        event.events = EPOLLIN;
+        if (-1 == epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+            perror("epoll_ctl");
+            return false;
+        }
     }
+    return true;
+}
 
-    // 开始检测
+/**
+ * @brief 把监听队列中排队的新连接都接受下来，加入这个反应堆的连接表和epoll
+ * @return bool，epoll_ctl出错的时候返回false
+ */
+static bool accept_clients(Reactor& reactor) {
     while (1) {
-        struct epoll_event ret_events[max_events] = {0};
-        int count = epoll_wait(epoll_fd, ret_events, max_events, -1);  //-1表示阻塞
+        // 接受请求，直接设置非阻塞，IO多路复用技术是建立在非阻塞IO基础上的
+        struct sockaddr_in client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        int connect_fd = accept4(reactor.listen_fd, (struct sockaddr*)&client_addr, &client_addr_len, SOCK_NONBLOCK);
+        if (-1 == connect_fd) {
+            if (EINTR == errno or ECONNABORTED == errno)
+                continue;
+            // EAGAIN表示已经接受完了；文件描述符用完之类的错误不影响已有的连接，等下次再接受
+            if (EAGAIN != errno and EWOULDBLOCK != errno)
+                perror("accept");
+            return true;
+        }
+
+        // 获得客户端信息
+        char client_ip[Max_ipv4_len] = {0};
+        inet_ntop(AF_INET, &client_addr.sin_addr.s_addr, client_ip, Max_ipv4_len);
+
+        // 将客户端信息存入连接表当中，connect_fd作键，每个连接有自己的会话
+        Client_Info& info = reactor.clients[connect_fd];
+        info.clear();
+        info.ip = std::string(client_ip);
+        info.port = ntohs(client_addr.sin_port);
+        info.session = std::make_shared<Order>();
+        info.generation = ++next_generation;
+
+        log_client(info, "has connected.");
+
+        // 将新客户端加入到检测事件
+        struct epoll_event connect_event;
+        connect_event.data.fd = connect_fd;
+        connect_event.events = EPOLLIN;
+        if (-1 == epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, connect_fd, &connect_event)) {
+            perror("epoll_ctl");
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief 反应堆的事件循环，收到退出信号之后返回
+ * @param  checkpointing，检查点也放在工作线程中做，正在做的时候不再放新的
+ * @return bool，出错的时候返回false
+ */
+static bool run_reactor(Reactor& reactor, Thread_Pool& pool, std::atomic<bool>& checkpointing) {
+    struct epoll_event ret_events[max_events];
+    while (!stop_flag) {
+        int count = epoll_wait(reactor.epoll_fd, ret_events, max_events, flush_interval_ms);
         if (-1 == count) {
+            if (EINTR == errno)
+                continue;
             perror("epoll_wait");
-            return -1;
+            return false;
+        }
+
+        // 所有反应堆都空闲的时候做检查点，把缓存中的脏表写回磁盘并且清空WAL
+        if (0 == count) {
+            if (now_ms() - last_active_ms >= flush_interval_ms and !checkpointing.exchange(true)) {
+                pool.submit([&checkpointing]() {
+                    Order::checkpoint();
+                    checkpointing = false;
+                });
+            }
+            continue;
         }
+        last_active_ms = now_ms();
 
         for (int i = 0; i < count; ++i) {
             // 新客户端加入
-            if (listen_fd == ret_events[i].data.fd) {
-                // 接受请求
-                struct sockaddr_in client_addr;
-                socklen_t client_addr_len = sizeof(client_addr);
-
-                int connect_fd = accept(listen_fd, (struct sockaddr*)&client_addr, &client_addr_len);
-                if (-1 == connect_fd) {
-                    perror("accept");
-                    return -1;
+            if (reactor.listen_fd == ret_events[i].data.fd) {
+                if (!accept_clients(reactor))
+                    return false;
+            }
+            // 工作线程有任务完成了，或者要退出了
+            else if (reactor.event_fd == ret_events[i].data.fd) {
+                uint64_t value;
+                if (-1 == read(reactor.event_fd, &value, sizeof(value)) and EAGAIN != errno) {
+                    perror("read");
+                    return false;
                 }
 
-                // 获得客户端信息
-                unsigned short client_port = ntohs(client_addr.sin_port);
-                char client_ip[Max_ipv4_len] = {0};
-                inet_ntop(AF_INET, &client_addr.sin_addr.s_addr, client_ip, Max_ipv4_len);
-
-                // 将客户端信息存入客户端信息数组当中，connect_fd作下标
-                cli_infos[connect_fd].ip = std::string(client_ip);
-                cli_infos[connect_fd].port = client_port;
-
-                std::cout << "client (ip: " << client_ip << " , "
-                          << "port: " << client_port << ") has connected." << std::endl;
-
-                // 设置读取非阻塞，必须设置，虽然在这个示例当中没有太大影响
-                // 但是IO多路复用技术是建立在非阻塞IO基础上的
-                int flag = fcntl(connect_fd, F_GETFL);
-                flag |= O_NONBLOCK;
-                fcntl(connect_fd, F_SETFL, flag);
-
-                // 将新客户端加入到检测事件
-                struct epoll_event connect_event;
-                connect_event.data.fd = connect_fd;
-                connect_event.events = EPOLLIN;
-
-                ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connect_fd, &connect_event);
-                if (-1 == ret) {
-                    perror("epoll_ctl");
-                    return -1;
+                std::vector<Completion> done;
+                {
+                    std::lock_guard<std::mutex> lock(reactor.completion_mutex);
+                    done.swap(reactor.completions);
+                }
+                for (Completion& completion : done) {
+                    auto it = reactor.clients.find(completion.fd);
+                    // 连接在执行的过程中已经关闭了，文件描述符可能已经给了新的连接
+                    if (reactor.clients.end() == it or completion.generation != it->second.generation)
+                        continue;
+
+                    Client_Info& info = it->second;
+                    info.busy = false;
+                    info.out_buf += completion.frames;
+                    info.stream = std::move(completion.stream);
+                    info.stream_id = completion.stream_id;
+                    // quit之后的命令不再执行
+                    if (completion.bye)
+                        info.closing = true;
+                    if (!update_client(reactor, pool, completion.fd, info, true))
+                        return false;
                 }
             }
             // 老客户端通信
             else {
                 int connect_fd = ret_events[i].data.fd;
-                std::string client_ip = cli_infos[connect_fd].ip;
-                unsigned short client_port = cli_infos[connect_fd].port;
+                auto it = reactor.clients.find(connect_fd);
+                if (reactor.clients.end() == it)
+                    continue;
+                Client_Info& info = it->second;
 
                 // 接受客户端的命令
-                char read_buf[BUFSIZ] = {0};
-                int len = recv(connect_fd, read_buf, BUFSIZ - 1, 0);
-                if (-1 == len) {
-                    // 非阻塞有两种特殊情况返回-1，但是我们这里遇不到
-                    // errno==EINTR，收到信号并从信号处理函数返回时，慢系统调用会返回并设置errno为EINTR，应该重新调用read。
-                    // errno==EAGAIN，表示当前暂时没有数据可读，应该稍后读取。
-                    perror("recv");
-                    return -1;
-                }
-                if (0 == len) {  // 客户端关闭
-                    // 从监听事件中删除
-                    ret = epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connect_fd, nullptr);
-                    if (-1 == ret) {
-                        perror("epoll_ctl");
-                        return -1;
+                bool alive = true;
+                if ((ret_events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) and !info.peer_closed) {
+                    int status = recv_all(connect_fd, info.in_buf);
+                    if (-1 == status) {
+                        perror("recv");
+                        alive = false;
                     }
+                    // 客户端关闭之前发来的命令照样执行，回复发完再关
+                    if (0 == status)
+                        info.peer_closed = true;
+                }
 
-                    std::cout << "client (ip: " << client_ip << " , "
-                              << "port: " << client_port << ") has closed." << std::endl;
-                    // 关闭文件描述符
-                    close(connect_fd);
-                    break;
-                } else if (len > 0) {
-                    std::cout << "client (ip: " << client_ip << " , "
-                              << "port: " << client_port << ") send: " << read_buf << std::endl;
-
-                    // 处理该命令
-                    order.set_command(std::string(read_buf));
-
-                    // 我们设计order里面的标准输出全部重定向文件当中，这样我们可以非常方便的读取m_feedback，完事之后再设置回去
-                    // 先把文件长度截断为0，然后从头开始写，可以下面这么做，我这里在open中加入O_TRUNC也可以
-                    // truncate(std::string(Order::res_prefix + "feedback.txt").c_str(), 0);
-
-                    int fd = open(std::string(Order::res_prefix + "feedback.txt").c_str(), O_RDWR | O_TRUNC);
-                    if (-1 == fd) {
-                        perror("open");
-                        return -1;
-                    }
+                if (!update_client(reactor, pool, connect_fd, info, alive))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* const argv[]) {
+    // 解析命令行参数
+    int opt;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t reactor_count = workers;
+    int backlog = SOMAXCONN;
+    while (-1 != (opt = getopt(argc, argv, "m:g:p:f:c:w:r:b:a:s:j:v:"))) {
+        switch (opt) {
+        case 'm':  // 表缓存的内存预算，单位MB
+            Table_Cache::instance().set_budget(std::stoul(optarg) << 20);
+            break;
+        case 'g':  // WAL组提交的等待时间，单位微秒
+            Wal::set_group_commit_delay(std::stoul(optarg));
+            break;
+        case 'p':  // 新建的B+树索引的页大小，单位字节
+            BTree_Index::set_page_size(std::stoul(optarg));
+            break;
+        case 'f':  // 新建的B+树索引的扇出
+            BTree_Index::set_fan_out(std::stoul(optarg));
+            break;
+        case 'c':  // 计划缓存最多缓存的语句形状个数
+            Plan_Cache::instance().set_capacity(std::stoul(optarg));
+            break;
+        case 'w':  // 执行命令的工作线程个数，默认是CPU核数
+            workers = std::stoul(optarg);
+            break;
+        case 'r':  // 接受连接、收发数据的反应堆个数，默认是CPU核数
+            reactor_count = std::max(1ul, std::stoul(optarg));
+            break;
+        case 'b':  // listen的全连接队列长度，默认是SOMAXCONN
+            backlog = std::stoi(optarg);
+            break;
+        case 'a':  // 一条聚合查询的哈希表的内存上限，单位MB，超过之后写到临时文件中
+            Hash_Aggregate::set_memory_limit(std::stoul(optarg) << 20);
+            break;
+        case 's':  // 一条order by的排序的内存上限，单位MB，超过之后分段写到临时文件中归并
+            Row_Sorter::set_memory_limit(std::stoul(optarg) << 20);
+            break;
+        case 'j':  // 一条join的哈希表的内存上限，单位MB，超过之后两张表分区写到临时文件中
+            Hash_Join::set_memory_limit(std::stoul(optarg) << 20);
+            break;
+        case 'v':  // 旧版本(已经删除的行)达到全部行数的这个百分比之后，检查点或者淘汰的时候回收
+            Table_Cache::instance().set_vacuum_percent(std::stoul(optarg));
+            break;
+        default:
+            std::cout << "usage: " << argv[0] << " [-m <cache-MB>] [-g <group-commit-us>] [-p <btree-page-bytes>] [-f <btree-fan-out>] [-c <plan-cache-entries>] [-w <workers>] [-r <reactors>] [-b <listen-backlog>] [-a <aggregate-MB>] [-s <sort-MB>] [-j <join-MB>] [-v <vacuum-percent>]" << std::endl;
+            return -1;
+        }
+    }
 
-                    int copy = dup(STDOUT_FILENO);  // 拷贝原先标准输出的文件描述符
-                    dup2(fd, STDOUT_FILENO);        // dup2的第二个参数会指向第一个参数指向的文件描述符
+    // 注册信号处理函数，不设置SA_RESTART，这样epoll_wait会被打断返回EINTR
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &act, nullptr);
+    sigaction(SIGTERM, &act, nullptr);
+
+    // 每个连接占一个文件描述符，把软限制提到硬限制，这样才能同时保持上万个连接
+    struct rlimit limit;
+    if (0 == getrlimit(RLIMIT_NOFILE, &limit) and limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        if (-1 == setrlimit(RLIMIT_NOFILE, &limit))
+            perror("setrlimit");
+    }
 
-                    order.run();
+    // 重放WAL，把上一次没有写回表文件的修改恢复出来，每个连接的会话在accept的时候再创建
+    Order().recover();
 
-                    dup2(copy, STDOUT_FILENO);  // 重定向回去
-                    close(fd);
+    // 每个反应堆有自己的监听socket、epoll实例和连接表
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    for (size_t i = 0; i < reactor_count; ++i) {
+        reactors.push_back(std::make_unique<Reactor>());
+        reactors.back()->id = i;
+        if (!open_reactor(*reactors.back(), 8080, backlog))
+            return -1;
+    }
 
-                    // order读取feedback.txt中的反馈信息
-                    order.read_feedback();
+    std::cout << "server has successfully initialized." << std::endl;
 
-                    // 拿到Order类中存储的m_feedback字符串，发送回去
-                    send(connect_fd, order.get_feedback().c_str(), order.get_feedback().size(), 0);
-                }
+    // 执行命令的工作线程，反应堆只负责收发数据
+    Thread_Pool pool(workers);
+    // 聚合查询的部分聚合和导入csv文件的解析也交给这些工作线程
+    Hash_Aggregate::set_thread_pool(&pool);
+    Csv_Loader::set_thread_pool(&pool);
+    std::cout << "server has started " << reactors.size() << " reactors and " << pool.size() << " workers." << std::endl;
+    std::cout << "server uses " << Batch_Filter::kernel_name() << " predicate kernels." << std::endl;
+
+    // 检查点也放在工作线程中做，正在做的时候不再放新的
+    std::atomic<bool> checkpointing = false;
+    last_active_ms = now_ms();
+
+    // 信号只交给主线程处理，其他反应堆线程屏蔽掉，退出的时候由主线程通过eventfd唤醒它们
+    sigset_t stop_signals, old_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_signals);
+    std::atomic<bool> failed = false;
+    for (size_t i = 1; i < reactors.size(); ++i) {
+        reactors[i]->thread = std::thread([&, reactor = reactors[i].get()]() {
+            if (!run_reactor(*reactor, pool, checkpointing)) {
+                // 出错的反应堆让整个服务端退出
+                failed = true;
+                stop_flag = 1;
+                wake(*reactors[0]);
             }
-        }
+        });
+    }
+    pthread_sigmask(SIG_SETMASK, &old_signals, nullptr);
+
+    // 0号反应堆在主线程中运行
+    bool ok = run_reactor(*reactors[0], pool, checkpointing);
+    stop_flag = 1;
+    for (size_t i = 1; i < reactors.size(); ++i) {
+        wake(*reactors[i]);
+        reactors[i]->thread.join();
+    }
+    ok = ok and !failed;
+
+    // 6.关闭，等工作线程把手上的命令做完，然后做检查点，把缓存中的脏表写回
+    pool.stop();
+    Hash_Aggregate::set_thread_pool(nullptr);
+    Csv_Loader::set_thread_pool(nullptr);
+    Order::checkpoint();
+    std::cout << "server has exited." << std::endl;
+
+    for (auto& reactor : reactors) {
+        for (auto& [connect_fd, info] : reactor->clients)
+            close(connect_fd);
+        close(reactor->event_fd);
+        close(reactor->epoll_fd);
+        close(reactor->listen_fd);
     }
 
-    // 6.关闭
-    close(epoll_fd);
-    close(listen_fd);
-
-    return 0;
+    return ok ? 0 : -1;
 }
@@ -0,0 +1,136 @@
+/**
+ * @file vacuum_test.cpp
+ * @brief 旧版本(墓碑)和回收的测试，重点是写回之后删除位图还在、有游标的时候不回收、回收之后最新版本不变
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "server_order.h"
+#include "table_cache.h"
+#include "tools.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::string run(Order& order, const std::string& command) {
+    order.set_command(command);
+    order.run();
+    return order.get_feedback().str();
+}
+
+/**
+ * @brief 表文件中最新版本的行，id到name
+ */
+std::map<std::string, std::string> live_rows(const Table& table) {
+    std::map<std::string, std::string> rows;
+    for (size_t row = 0; row < table.m_row_count; ++row)
+        if (table.is_live(row))
+            rows[table.cell(row, 0)] = table.cell(row, 1);
+    return rows;
+}
+
+}  // namespace
+
+int main() {
+    // 数据库目录是 ../data/，放到临时目录中，不碰仓库里面的数据
+    char root[] = "/tmp/vacuum_test.XXXXXX";
+    if (nullptr == mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::filesystem::create_directories(std::string(root) + "/data");
+    std::filesystem::create_directories(std::string(root) + "/bin");
+    if (-1 == chdir((std::string(root) + "/bin").c_str())) {
+        perror("chdir");
+        return 1;
+    }
+    std::string table_path = "../data/db/t.dat";
+
+    // 先不自动回收，写回的时候只追加删除位图页
+    Table_Cache::instance().set_vacuum_percent(100);
+    Order order;
+    run(order, "create database db");
+    run(order, "use db");
+    run(order, "create table t (id int, name string)");
+    std::string values;
+    for (int i = 0; i < 100; ++i)
+        values += std::string(0 == i ? "" : ", ") + "(" + std::to_string(i) + ", 'n" + std::to_string(i) + "')";
+    run(order, "insert t values " + values);
+    run(order, "delete t where id < 50");
+    run(order, "update t set name = 'u' where id > 89");
+    Order::checkpoint();
+
+    Table table = Tools::read_table_from_file(table_path);
+    std::map<std::string, std::string> expected = live_rows(table);
+    check(110 == table.m_row_count, "old versions stay in the table file");
+    check(60 == table.m_dead_rows, "tombstones survive a write back");
+    check(50 == expected.size() and 0 == expected.count("0") and "u" == expected["95"] and "n60" == expected["60"],
+          "table file has the latest versions");
+
+    // 还有游标持有这张表的时候不回收
+    Order reader;
+    run(reader, "use db");
+    run(reader, "declare c cursor for select * from t");
+    std::string busy = run(order, "vacuum t");
+    check(std::string::npos != busy.find("游标"), "vacuum waits for open cursors: " + busy);
+    Order::checkpoint();
+    check(60 == Tools::read_table_from_file(table_path).m_dead_rows, "tombstones are kept while a cursor is open");
+
+    // 关掉游标之后回收，最新版本不变，行号变了之后还能接着修改
+    run(reader, "close c");
+    std::string done = run(order, "vacuum t");
+    check(std::string::npos != done.find("60"), "vacuum reclaims every tombstone: " + done);
+    run(order, "delete t where id = 60");
+    expected.erase("60");
+    Order::checkpoint();
+    table = Tools::read_table_from_file(table_path);
+    check(50 == table.m_row_count and 1 == table.m_dead_rows, "vacuumed table keeps only new tombstones");
+    check(expected == live_rows(table), "vacuum keeps the latest versions");
+
+    // 不在缓存中的表直接整理表文件
+    Table_Cache::instance().set_budget(0);
+    done = run(order, "vacuum t");
+    check(std::string::npos != done.find("1"), "vacuum of an evicted table reclaims its tombstone: " + done);
+    table = Tools::read_table_from_file(table_path);
+    check(49 == table.m_row_count and 0 == table.m_dead_rows, "evicted table file has no tombstones");
+    check(expected == live_rows(table), "vacuum of an evicted table keeps the latest versions");
+
+    // 旧版本超过阈值之后淘汰写回的时候自动回收
+    Table_Cache::instance().set_vacuum_percent(20);
+    run(order, "delete t where id > 79");
+    for (auto it = expected.begin(); it != expected.end();)
+        it = std::stoi(it->first) > 79 ? expected.erase(it) : std::next(it);
+    Order::checkpoint();
+    table = Tools::read_table_from_file(table_path);
+    check(0 == table.m_dead_rows and expected.size() == table.m_row_count, "write back vacuums past the threshold");
+    check(expected == live_rows(table), "automatic vacuum keeps the latest versions");
+
+    Table_Cache::instance().set_budget(Table_Cache::default_budget);
+    Table_Cache::instance().set_vacuum_percent(Table_Cache::default_vacuum_percent);
+    chdir("/");
+    std::filesystem::remove_all(root);
+
+    if (0 == failures)
+        std::cout << "vacuum_test: ok" << std::endl;
+    return 0 == failures ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file wal_replay_test.cpp
+ * @brief 崩溃恢复的测试，子进程修改完表之后不做检查点直接退出，父进程重放WAL，检查表文件的内容
+ * @author lzx0626 (2065666169@qq.com)
+ * @version 1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2023  电子科技大学
+ *
+ */
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "server_order.h"
+#include "table_cache.h"
+#include "tools.h"
+#include "wal.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::string run(Order& order, const std::string& command) {
+    order.set_command(command);
+    order.run();
+    return order.get_feedback().str();
+}
+
+/**
+ * @brief 模拟崩溃: 修改都确认之后(WAL已经落盘)，不写回缓存中的表，不做检查点，直接退出
+ *  中间把表写回一次，表文件中的LSN比WAL中后面的记录小，重放的时候前面的记录要跳过；最后在WAL末尾留下写了一半的记录
+ */
+void crash() {
+    Order order;
+    run(order, "create database db");
+    run(order, "use db");
+    run(order, "create table t (id int, name string)");
+    for (int i = 1; i <= 10; ++i)
+        run(order, "insert t values (" + std::to_string(i) + ", 'n" + std::to_string(i) + "')");
+    run(order, "update t set name = 'y' where id = 2");
+
+    // 相当于这张表被淘汰写回了，之后的修改只在WAL中
+    Table_Cache::instance().flush_all();
+
+    run(order, "insert t values (11, 'n11')");
+    run(order, "delete t where id = 3");
+    run(order, "update t set name = 'z' where id = 5");
+
+    int fd = open(("../data/db/" + Wal::file_name).c_str(), O_WRONLY | O_APPEND);
+    if (-1 == fd)
+        _exit(2);
+    const char torn[] = {64, 0, 0, 0, 1, 2, 3};
+    if (sizeof(torn) != write(fd, torn, sizeof(torn)))
+        _exit(2);
+    close(fd);
+
+    // 不调用析构函数，缓存中的修改都丢掉
+    _exit(0);
+}
+
+}  // namespace
+
+int main() {
+    // 数据库目录是 ../data/，放到临时目录中，不碰仓库里面的数据
+    char root[] = "/tmp/wal_replay_test.XXXXXX";
+    if (nullptr == mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::filesystem::create_directories(std::string(root) + "/data");
+    std::filesystem::create_directories(std::string(root) + "/bin");
+    if (-1 == chdir((std::string(root) + "/bin").c_str())) {
+        perror("chdir");
+        return 1;
+    }
+    std::string table_path = "../data/db/t.dat";
+
+    // 在子进程中修改，父进程还没有打开过任何WAL和表，重放的时候和重启之后的服务端一样
+    pid_t pid = fork();
+    if (-1 == pid) {
+        perror("fork");
+        return 1;
+    }
+    if (0 == pid)
+        crash();
+    int status = 0;
+    waitpid(pid, &status, 0);
+    check(WIFEXITED(status) and 0 == WEXITSTATUS(status), "crashing child ran every command");
+
+    // 表文件中只有写回之前的修改
+    Table before = Tools::read_table_from_file(table_path);
+    size_t live = 0;
+    for (size_t row = 0; row < before.m_row_count; ++row)
+        live += before.is_live(row);
+    check(10 == live, "table file holds only the rows written back before the crash");
+
+    Order().recover();
+
+    // 写回之前的记录被跳过，之后的记录重放了一次，写了一半的记录被丢掉
+    Table table = Tools::read_table_from_file(table_path);
+    std::map<std::string, std::string> rows;
+    std::string last;
+    bool unique = true;
+    for (size_t row = 0; row < table.m_row_count; ++row) {
+        if (!table.is_live(row))
+            continue;
+        unique = unique and rows.emplace(table.cell(row, 0), table.cell(row, 1)).second;
+        last = table.cell(row, 0);
+    }
+    check(unique, "replay skips records already in the table file");
+    check(10 == rows.size(), "replayed table has 10 live rows");
+    check(0 == rows.count("3"), "replayed delete removes id 3");
+    check("n11" == rows["11"], "replayed insert adds id 11");
+    check("y" == rows["2"], "update written back before the crash is kept");
+    check("z" == rows["5"], "replayed update sets id 5");
+    check("5" == last, "updated row moves to the end of the table");
+    check(table.m_lsn == Wal::for_database("../data/db").last_lsn(), "table file has the last replayed lsn");
+
+    // 检查点之后WAL是空的，再恢复一次什么都不做
+    check(Wal::for_database("../data/db").records().empty(), "wal is empty after recovery");
+    Order().recover();
+    Table again = Tools::read_table_from_file(table_path);
+    check(table.m_row_count == again.m_row_count, "second recovery changes nothing");
+
+    chdir("/");
+    std::filesystem::remove_all(root);
+
+    if (0 == failures)
+        std::cout << "wal_replay_test: ok" << std::endl;
+    return 0 == failures ? 0 : 1;
+}